@@ -0,0 +1,133 @@
+// Copyright 2018 municHMotorsport e.V. <info@munichmotorsport.de>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KAFI_BENCHMARKS_BENCHMARK_H
+#define KAFI_BENCHMARKS_BENCHMARK_H
+
+#include <algorithm>
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#include "../tests/equivalence.h"
+
+/** \brief Shared helpers of the benchmarks
+ *
+ * A filter is benchmarked by replaying observations through the `kafi::kafi` interface, the same
+ * interface the equivalence harness in tests/equivalence.h relies on.
+ */
+namespace benchmark {
+
+    using clock_t    = std::chrono::steady_clock;
+    using duration_t = std::chrono::duration<double>;
+
+    /** \brief Timing and estimated states of a single replay
+     */
+    template< typename State >
+    struct replay_result
+    {
+        //! time spent in `step()` only
+        duration_t          filter_time;
+        //! estimated state after every step
+        std::vector<State>  states;
+    };
+
+    /** \brief Replays `observations` through `filter`, only `set_current_observation()` and `step()` are timed
+     *
+     * The observations are converted to the element type of the filter upfront.
+     */
+    template< typename Filter
+            , typename Observation >
+    replay_result<typename Filter::nx1_vector> replay(Filter & filter, const std::vector<Observation> & observations)
+    {
+        using mx1_vector = typename Filter::mx1_vector;
+
+        std::vector< std::shared_ptr<mx1_vector> > inputs;
+        inputs.reserve(observations.size());
+        for (const Observation & observation : observations)
+        {
+            inputs.push_back(std::make_shared<mx1_vector>(equivalence::convert<mx1_vector>(observation)));
+        }
+
+        replay_result<typename Filter::nx1_vector> result;
+        result.states.reserve(observations.size());
+
+        clock_t::time_point start = clock_t::now();
+        for (const std::shared_ptr<mx1_vector> & input : inputs)
+        {
+            filter.set_current_observation(input);
+            result.states.push_back(std::get<0>(filter.step()));
+        }
+        result.filter_time = clock_t::now() - start;
+        return result;
+    }
+
+    /** \brief Maximum and mean deviation of the estimated states from the reference
+     */
+    template< typename Reference
+            , typename Candidate >
+    std::tuple<double, double> deviation(const std::vector<Reference> & reference
+                                       , const std::vector<Candidate> & candidate)
+    {
+        double max  = 0;
+        double mean = 0;
+        const size_t steps = std::min(reference.size(), candidate.size());
+        for (size_t step = 0; step < steps; ++step)
+        {
+            const double current = equivalence::max_deviation(reference[step], candidate[step]);
+            max   = equivalence::worst(max, current);
+            mean += current;
+        }
+        return std::make_tuple(max, steps > 0 ? mean / steps : 0.0);
+    }
+
+    //! prints the header of the table printed by benchmark::print_row(), `label` names the first column
+    inline void print_header(std::ostream & stream, const std::string & title, const size_t samples, const std::string & label = "scalar")
+    {
+        stream << title << ", " << samples << " samples\n"
+               << std::setw(12) << label
+               << std::setw(14) << "filter [ms]"
+               << std::setw(16) << "samples/sec"
+               << std::setw(12) << "vs double"
+               << std::setw(16) << "max deviation"
+               << std::setw(16) << "mean deviation" << '\n';
+    }
+
+    /** \brief Prints a row of timings and state deviations compared to the `double` reference
+     */
+    template< typename Reference
+            , typename Candidate >
+    void print_row(std::ostream & stream
+                 , const std::string & name
+                 , const replay_result<Reference> & reference
+                 , const replay_result<Candidate> & candidate)
+    {
+        double max, mean;
+        std::tie(max, mean) = deviation(reference.states, candidate.states);
+        const double samples = static_cast<double>(candidate.states.size());
+        stream << std::setw(12) << name
+               << std::setw(14) << candidate.filter_time.count() * 1e3
+               << std::setw(16) << samples / candidate.filter_time.count()
+               << std::setw(12) << reference.filter_time.count() / candidate.filter_time.count()
+               << std::setw(16) << max
+               << std::setw(16) << mean << '\n';
+    }
+
+} // namespace benchmark
+
+#endif // KAFI_BENCHMARKS_BENCHMARK_H
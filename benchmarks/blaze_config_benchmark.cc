@@ -0,0 +1,84 @@
+// Copyright 2018 municHMotorsport e.V. <info@munichmotorsport.de>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <blaze/Math.h>
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include "../library/kafi.h"
+#include "../tests/models.h"
+#include "benchmark.h"
+
+/** \brief Time per `step()` of `kafi::kafi<N, N/2>` for growing `N` with the blaze configuration of this build
+ *
+ * One row of the matrix per build, configure the build with the ENABLE_BLAZE_* options, see README.md.
+ */
+
+//! prints the value of a blaze configuration switch, if blaze defines it
+#define KAFI_PRINT_SWITCH(name) print_switch(#name, KAFI_SWITCH_VALUE(name))
+#define KAFI_SWITCH_STRING(value) #value
+#define KAFI_SWITCH_VALUE(name) KAFI_SWITCH_STRING(name)
+
+void print_switch(const std::string & name, const std::string & value)
+{
+    // an undefined macro expands to its own name
+    std::cout << "  " << std::setw(42) << std::left << name << std::right
+              << (value == name ? "blaze default" : value) << '\n';
+}
+
+template< size_t N >
+void print_step_time()
+{
+    const size_t M = std::max<size_t>(1UL, N / 2UL);
+    // the same amount of work for every N, but at least 200 steps
+    const size_t steps = std::max<size_t>(200UL, 2000000UL / (N * N));
+    const models::linear::random_model<N,M> model(N, steps);
+
+    kafi::kafi<N,M> filter(model.transition()
+                         , model.prediction_scaling()
+                         , model.starting_state
+                         , model.process_noise
+                         , model.sensor_noise);
+    const auto result = benchmark::replay(filter, model.observations);
+
+    std::cout << std::setw(6)  << N
+              << std::setw(6)  << M
+              << std::setw(10) << steps
+              << std::setw(16) << result.filter_time.count() / steps * 1e6 << '\n';
+}
+
+int main()
+{
+    std::cout << "blaze configuration:\n";
+    KAFI_PRINT_SWITCH(BLAZE_USE_VECTORIZATION);
+    KAFI_PRINT_SWITCH(BLAZE_USE_PADDING);
+    KAFI_PRINT_SWITCH(BLAZE_USE_SHARED_MEMORY_PARALLELIZATION);
+#ifdef _OPENMP
+    std::cout << "  OpenMP is enabled\n";
+#endif
+
+    std::cout << std::setw(6)  << "N"
+              << std::setw(6)  << "M"
+              << std::setw(10) << "steps"
+              << std::setw(16) << "us per step" << '\n';
+    print_step_time<2>();
+    print_step_time<4>();
+    print_step_time<7>();
+    print_step_time<16>();
+    print_step_time<32>();
+    print_step_time<64>();
+    return 0;
+}
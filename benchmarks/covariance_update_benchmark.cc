@@ -0,0 +1,162 @@
+// Copyright 2018 municHMotorsport e.V. <info@munichmotorsport.de>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <blaze/Math.h>
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../library/kafi.h"
+#include "../library/fixed_point.h"
+#include "../tests/models.h"
+#include "benchmark.h"
+
+/** \brief Throughput and drift of the covariance update forms of kafi::kafi, see kafi::covariance_update
+ *
+ * Replays the wemding log through the correvit model (`N = 7`, `M = 5`) with both forms in `double`, `float`
+ * and the fixed-point Q11.20 (`fixed`). The drift is the largest asymmetry `|P(i,j) - P(j,i)|` and the smallest diagonal
+ * element of the covariance over the replay, a negative variance means the covariance lost its definiteness.
+ *
+ * The randomized linear models compare the full update with the frozen steady-state gain, see kafi::solve_steady_state().
+ */
+
+//! the correvit model in the scalar type `T` with the covariance update `form`
+template< typename T >
+std::unique_ptr< kafi::kafi<models::correvit::N, models::correvit::M, T> >
+make_correvit(const std::vector< models::correvit::mx1_vector > & observations, const kafi::covariance_update form)
+{
+    using namespace models::correvit;
+    std::unique_ptr< kafi::kafi<N,M,T> > filter(
+        new kafi::kafi<N,M,T>(transition<T>()
+                            , prediction_scaling<T>()
+                            , starting_state<T>(observations[0])
+                            , process_noise<T>()
+                            , sensor_noise<T>()));
+    filter->set_covariance_update(form);
+    return filter;
+}
+
+//! timed replay of the wemding log
+template< typename T >
+benchmark::replay_result< typename kafi::kafi<models::correvit::N, models::correvit::M, T>::nx1_vector >
+replay_correvit(const std::vector< models::correvit::mx1_vector > & observations, const kafi::covariance_update form)
+{
+    auto filter = make_correvit<T>(observations, form);
+    return benchmark::replay(*filter, observations);
+}
+
+//! prints the largest asymmetry and the smallest variance of the covariance after the updates of a second, untimed replay
+template< typename T >
+void print_drift(const std::string & name
+               , const std::vector< models::correvit::mx1_vector > & observations
+               , const kafi::covariance_update form)
+{
+    using namespace models::correvit;
+    using mx1_t = typename kafi::kafi<N,M,T>::mx1_vector;
+
+    auto filter = make_correvit<T>(observations, form);
+    double asymmetry = 0;
+    double variance  = std::numeric_limits<double>::max();
+    for (const mx1_vector & observation : observations)
+    {
+        // kafi only keeps a weak reference to the observation
+        const std::shared_ptr<mx1_t> input = std::make_shared<mx1_t>(equivalence::convert<mx1_t>(observation));
+        filter->set_current_observation(input);
+        filter->step();
+        const auto & P = filter->_prediction_error;
+        for (size_t row = 0UL; row < N; ++row)
+        {
+            variance = std::min(variance, static_cast<double>(P(row, row)));
+            for (size_t col = 0UL; col < row; ++col)
+            {
+                asymmetry = std::max(asymmetry, std::abs(static_cast<double>(P(row, col)) - static_cast<double>(P(col, row))));
+            }
+        }
+    }
+    std::cout << std::setw(12) << name
+              << std::setw(16) << asymmetry
+              << std::setw(16) << variance << '\n';
+}
+
+//! a randomized linear model, with the steady-state gain if `steady_state`
+template< size_t N
+        , size_t M >
+benchmark::replay_result< typename kafi::kafi<N,M>::nx1_vector >
+replay_linear(const models::linear::random_model<N,M> & model, const bool steady_state)
+{
+    kafi::kafi<N,M> filter(model.transition()
+                         , model.prediction_scaling()
+                         , model.starting_state
+                         , model.process_noise
+                         , model.sensor_noise);
+    if (steady_state)
+    {
+        filter.solve_steady_state(1e-12);
+    }
+    return benchmark::replay(filter, model.observations);
+}
+
+//! full update against the steady-state gain on a randomized linear model
+template< size_t N
+        , size_t M >
+void print_steady_state()
+{
+    const models::linear::random_model<N,M> model(N, 100000);
+    const auto reference = replay_linear<N,M>(model, false);
+
+    std::cout << '\n';
+    benchmark::print_header(std::cout, "randomized linear model, N = " + std::to_string(N) + ", M = " + std::to_string(M)
+                          , model.observations.size(), "gain");
+    benchmark::print_row(std::cout, "full",   reference, reference);
+    benchmark::print_row(std::cout, "steady", reference, replay_linear<N,M>(model, true));
+}
+
+int main()
+{
+    using namespace models::correvit;
+    using q20 = kafi::fixed<20>;
+    using form = kafi::covariance_update;
+
+    const std::vector< mx1_vector > observations = read_log(wemding_log);
+
+    const auto reference = replay_correvit<double>(observations, form::standard);
+    benchmark::print_header(std::cout, "wemding replay, N = 7, M = 5", observations.size(), "form");
+    benchmark::print_row(std::cout, "std",          reference, reference);
+    benchmark::print_row(std::cout, "joseph",       reference, replay_correvit<double>(observations, form::joseph));
+    benchmark::print_row(std::cout, "std float",    reference, replay_correvit<float>(observations, form::standard));
+    benchmark::print_row(std::cout, "joseph float", reference, replay_correvit<float>(observations, form::joseph));
+    benchmark::print_row(std::cout, "std fixed",    reference, replay_correvit<q20>(observations, form::standard));
+    benchmark::print_row(std::cout, "joseph fixed", reference, replay_correvit<q20>(observations, form::joseph));
+
+    std::cout << "\ncovariance drift over the replay\n"
+              << std::setw(12) << "form"
+              << std::setw(16) << "max asymmetry"
+              << std::setw(16) << "min variance" << '\n';
+    print_drift<double>("std",          observations, form::standard);
+    print_drift<double>("joseph",       observations, form::joseph);
+    print_drift<float>( "std float",    observations, form::standard);
+    print_drift<float>( "joseph float", observations, form::joseph);
+    print_drift<q20>(   "std fixed",    observations, form::standard);
+    print_drift<q20>(   "joseph fixed", observations, form::joseph);
+
+    print_steady_state<1,1>();
+    print_steady_state<4,2>();
+    print_steady_state<12,4>();
+    return 0;
+}
@@ -0,0 +1,149 @@
+// Copyright 2018 municHMotorsport e.V. <info@munichmotorsport.de>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <blaze/Math.h>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "../library/kafi.h"
+#include "../library/dynamic_kafi.h"
+#include "../library/ensemble_kafi.h"
+#include "../tests/models.h"
+#include "benchmark.h"
+
+/** \brief Throughput of kafi::ensemble_kafi with `K` members on 1, 2 and 4 workers compared to kafi::kafi
+ *
+ * The randomized linear models of tests/models.h, the ensemble filter only gets the functions `f` and `h`.
+ * A step of kafi::kafi costs `O(N^3)`, a step of the ensemble filter `O(N^2 * K + N * K * M + M^3)` plus `K`
+ * calls of `f`, the deviation is the sampling error of the ensemble. The filters are allocated on the heap.
+ * From `N = 250` on the models are runtime-sized and the reference is kafi::dynamic_kafi, the `StaticMatrix`
+ * members of kafi::kafi and of the static models don't fit on the stack for these `N`.
+ */
+
+//! the ensemble filter of a randomized linear model, `f` and `h` are the functions of its jacobian functions
+template< size_t N
+        , size_t M
+        , size_t K >
+std::unique_ptr< kafi::ensemble_kafi<N,M,K> > make_ensemble(const models::linear::random_model<N,M> & model, const size_t workers)
+{
+    return std::unique_ptr< kafi::ensemble_kafi<N,M,K> >(
+        new kafi::ensemble_kafi<N,M,K>(model.transition().function()
+                                     , model.prediction_scaling().function()
+                                     , model.starting_state
+                                     , model.process_noise
+                                     , model.sensor_noise
+                                     , workers));
+}
+
+//! the ensemble filter of a runtime-sized linear model, `f` and `h` are the products with its matrices
+template< size_t N
+        , size_t M
+        , size_t K >
+std::unique_ptr< kafi::ensemble_kafi<N,M,K> > make_ensemble(const models::linear::runtime_model & model, const size_t workers)
+{
+    using filter_t   = kafi::ensemble_kafi<N,M,K>;
+    using nx1_vector = typename filter_t::nx1_vector;
+    using mx1_vector = typename filter_t::mx1_vector;
+    using mxm_matrix = typename filter_t::mxm_matrix;
+
+    // the members only read the matrices of the model, which outlives the filter
+    const models::linear::runtime_model * source = &model;
+    const typename filter_t::f_func f = [source](const nx1_vector & input, nx1_vector & output)
+    {
+        output = source->A * input;
+    };
+    const typename filter_t::h_func h = [source](const nx1_vector & input, mx1_vector & output)
+    {
+        output = source->C * input;
+    };
+    return std::unique_ptr< filter_t >(
+        new filter_t(f
+                   , h
+                   , equivalence::convert<nx1_vector>(model.starting_state)
+                   , model.process_noise
+                   , equivalence::convert<mxm_matrix>(model.sensor_noise)
+                   , workers));
+}
+
+template< size_t   N
+        , size_t   M
+        , size_t   K
+        , typename Model
+        , typename Reference >
+void print_ensemble_rows(const Model & model, const benchmark::replay_result<Reference> & reference_result)
+{
+    for (const size_t workers : { 1UL, 2UL, 4UL })
+    {
+        const auto candidate = make_ensemble<N,M,K>(model, workers);
+        benchmark::print_row(std::cout, "K=" + std::to_string(K) + " w=" + std::to_string(workers), reference_result
+                           , benchmark::replay(*candidate, model.observations));
+    }
+}
+
+template< size_t N
+        , size_t M >
+void print_ensemble(const size_t steps)
+{
+    const models::linear::random_model<N,M> model(N, steps);
+
+    std::unique_ptr< kafi::kafi<N,M> > reference(
+        new kafi::kafi<N,M>(model.transition()
+                          , model.prediction_scaling()
+                          , model.starting_state
+                          , model.process_noise
+                          , model.sensor_noise));
+    const auto reference_result = benchmark::replay(*reference, model.observations);
+
+    benchmark::print_header(std::cout, "randomized linear model, N = " + std::to_string(N) + ", M = " + std::to_string(M)
+                          , model.observations.size(), "filter");
+    benchmark::print_row(std::cout, "kafi", reference_result, reference_result);
+    print_ensemble_rows<N,M,20>(model, reference_result);
+    print_ensemble_rows<N,M,100>(model, reference_result);
+    std::cout << '\n';
+}
+
+//! the large-state regime, e.g. a tyre thermal model, against kafi::dynamic_kafi with the blaze products
+template< size_t N
+        , size_t M >
+void print_large_ensemble(const size_t steps)
+{
+    const models::linear::runtime_model model(N, M, 1, steps);
+
+    kafi::dynamic_kafi<> reference(model.transition()
+                                 , model.prediction_scaling()
+                                 , model.starting_state
+                                 , model.process_noise
+                                 , model.sensor_noise);
+    const auto reference_result = benchmark::replay(reference, model.observations);
+
+    benchmark::print_header(std::cout, "runtime-sized linear model, N = " + std::to_string(N) + ", M = " + std::to_string(M)
+                          , model.observations.size(), "filter");
+    benchmark::print_row(std::cout, "dynamic", reference_result, reference_result);
+    print_ensemble_rows<N,M,20>(model, reference_result);
+    print_ensemble_rows<N,M,100>(model, reference_result);
+    std::cout << '\n';
+}
+
+int main()
+{
+    std::cout << "hardware threads: " << std::thread::hardware_concurrency() << "\n\n";
+    print_ensemble<7,5>(20000);
+    print_ensemble<40,8>(2000);
+    print_ensemble<120,8>(200);
+    print_large_ensemble<250,25>(20);
+    print_large_ensemble<500,50>(10);
+    return 0;
+}
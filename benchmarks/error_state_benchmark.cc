@@ -0,0 +1,134 @@
+// Copyright 2018 municHMotorsport e.V. <info@munichmotorsport.de>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <blaze/Math.h>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../library/kafi.h"
+#include "../library/error_state_kafi.h"
+#include "../tests/models.h"
+#include "benchmark.h"
+
+/** \brief Time per step of kafi::error_state_kafi with the error covariance propagated every 1, 5, 10 and 20 steps
+ *
+ * The error is additive and has the dimensions of the state, see models::additive_error_state().
+ * The rows `kafi K=10` propagate the prediction error of kafi::kafi every 10 steps with the jacobian of the
+ * first step held over the interval, see kafi::kafi::set_covariance_rate().
+ *
+ * The wemding log through the correvit model (1 kHz) and the randomized linear models of tests/models.h, integrated
+ * every step with an observation every 10th step, e.g. a 1 kHz IMU with 100 Hz measurements. The deviation is the
+ * one from kafi::kafi, which propagates the covariance every step; for linear models the held jacobian is exact.
+ */
+
+//! steps per observation
+const size_t observation_rate = 10UL;
+
+template< typename Filter >
+benchmark::replay_result< typename Filter::nx1_vector > replay_sparse(Filter & filter, const std::vector< typename Filter::mx1_vector > & observations)
+{
+    using mx1_vector = typename Filter::mx1_vector;
+
+    std::shared_ptr< mx1_vector > input = std::make_shared< mx1_vector >();
+    benchmark::replay_result< typename Filter::nx1_vector > result;
+    result.states.reserve(observations.size());
+
+    benchmark::clock_t::time_point start = benchmark::clock_t::now();
+    for (size_t step = 0UL; step < observations.size(); ++step)
+    {
+        if (step % observation_rate == 0UL)
+        {
+            *input = observations[step];
+            filter.set_current_observation(input);
+        }
+        result.states.push_back(std::get<0>(filter.step()));
+    }
+    result.filter_time = benchmark::clock_t::now() - start;
+    return result;
+}
+
+void print_correvit()
+{
+    using namespace models::correvit;
+
+    const std::vector< mx1_vector > observations = read_log(wemding_log);
+    std::unique_ptr< kafi::kafi<N,M> > reference(
+        new kafi::kafi<N,M>(transition(), prediction_scaling(), starting_state(observations[0]), process_noise(), sensor_noise()));
+    const auto reference_result = replay_sparse(*reference, observations);
+
+    benchmark::print_header(std::cout, "wemding replay, N = 7, M = 5, observation every " + std::to_string(observation_rate) + " steps"
+                          , observations.size(), "filter");
+    benchmark::print_row(std::cout, "kafi", reference_result, reference_result);
+    for (const size_t rate : { 1UL, 5UL, 10UL, 20UL })
+    {
+        auto candidate = models::additive_error_state<N,M>(transition(), prediction_scaling(), starting_state(observations[0]), process_noise(), sensor_noise());
+        candidate->set_covariance_rate(rate);
+        benchmark::print_row(std::cout, "K=" + std::to_string(rate), reference_result, replay_sparse(*candidate, observations));
+    }
+    std::unique_ptr< kafi::kafi<N,M> > decoupled(
+        new kafi::kafi<N,M>(transition(), prediction_scaling(), starting_state(observations[0]), process_noise(), sensor_noise()));
+    decoupled->set_covariance_rate(observation_rate);
+    benchmark::print_row(std::cout, "kafi K=" + std::to_string(observation_rate), reference_result, replay_sparse(*decoupled, observations));
+    std::cout << '\n';
+}
+
+template< size_t N
+        , size_t M >
+void print_error_state(const size_t steps)
+{
+    const models::linear::random_model<N,M> model(N, steps);
+
+    std::unique_ptr< kafi::kafi<N,M> > reference(
+        new kafi::kafi<N,M>(model.transition()
+                          , model.prediction_scaling()
+                          , model.starting_state
+                          , model.process_noise
+                          , model.sensor_noise));
+    const auto reference_result = replay_sparse(*reference, model.observations);
+
+    benchmark::print_header(std::cout, "randomized linear model, N = " + std::to_string(N) + ", M = " + std::to_string(M)
+                          + ", observation every " + std::to_string(observation_rate) + " steps", model.observations.size(), "filter");
+    benchmark::print_row(std::cout, "kafi", reference_result, reference_result);
+    for (const size_t rate : { 1UL, 5UL, 10UL, 20UL })
+    {
+        auto candidate = models::additive_error_state<N,M>(model.transition()
+                                                         , model.prediction_scaling()
+                                                         , model.starting_state
+                                                         , model.process_noise
+                                                         , model.sensor_noise);
+        candidate->set_covariance_rate(rate);
+        benchmark::print_row(std::cout, "K=" + std::to_string(rate), reference_result, replay_sparse(*candidate, model.observations));
+    }
+    std::unique_ptr< kafi::kafi<N,M> > decoupled(
+        new kafi::kafi<N,M>(model.transition()
+                          , model.prediction_scaling()
+                          , model.starting_state
+                          , model.process_noise
+                          , model.sensor_noise));
+    decoupled->set_covariance_rate(observation_rate);
+    benchmark::print_row(std::cout, "kafi K=" + std::to_string(observation_rate), reference_result, replay_sparse(*decoupled, model.observations));
+    std::cout << '\n';
+}
+
+int main()
+{
+    print_correvit();
+    print_error_state<7,5>(100000);
+    print_error_state<15,6>(50000);
+    print_error_state<30,8>(10000);
+    return 0;
+}
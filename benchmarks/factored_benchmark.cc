@@ -0,0 +1,65 @@
+// Copyright 2018 municHMotorsport e.V. <info@munichmotorsport.de>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <blaze/Math.h>
+#include <iostream>
+#include <vector>
+
+#include "../library/kafi.h"
+#include "../library/sqrt_kafi.h"
+#include "../library/ud_kafi.h"
+#include "../library/fixed_point.h"
+#include "../tests/models.h"
+#include "benchmark.h"
+
+/** \brief Throughput and accuracy of the factored covariance filters compared to kafi::kafi in `double`
+ *
+ * Replays the wemding log through the correvit model (`N = 7`, `M = 5`) with every filter in `double`
+ * and in `float`, the filters without square roots in the fixed-point Q11.20 as well.
+ */
+
+//! the correvit model on the wemding log with the filter `Filter`
+template< typename Filter >
+benchmark::replay_result< typename Filter::nx1_vector >
+replay_correvit(const std::vector< models::correvit::mx1_vector > & observations)
+{
+    using namespace models::correvit;
+    using T = typename Filter::value_t;
+    Filter filter(transition<T>()
+                , prediction_scaling<T>()
+                , starting_state<T>(observations[0])
+                , process_noise<T>()
+                , sensor_noise<T>());
+    return benchmark::replay(filter, observations);
+}
+
+int main()
+{
+    using namespace models::correvit;
+    using q20 = kafi::fixed<20>;
+
+    const std::vector< mx1_vector > observations = read_log(wemding_log);
+
+    const auto reference = replay_correvit< kafi::kafi<N,M> >(observations);
+    benchmark::print_header(std::cout, "wemding replay, N = 7, M = 5", observations.size(), "filter");
+    benchmark::print_row(std::cout, "kafi",       reference, reference);
+    benchmark::print_row(std::cout, "kafi float", reference, replay_correvit< kafi::kafi<N,M,float> >(observations));
+    benchmark::print_row(std::cout, "sqrt",       reference, replay_correvit< kafi::sqrt_kafi<N,M> >(observations));
+    benchmark::print_row(std::cout, "sqrt float", reference, replay_correvit< kafi::sqrt_kafi<N,M,float> >(observations));
+    benchmark::print_row(std::cout, "ud",         reference, replay_correvit< kafi::ud_kafi<N,M> >(observations));
+    benchmark::print_row(std::cout, "ud float",   reference, replay_correvit< kafi::ud_kafi<N,M,float> >(observations));
+    benchmark::print_row(std::cout, "kafi Q11.20", reference, replay_correvit< kafi::kafi<N,M,q20> >(observations));
+    benchmark::print_row(std::cout, "ud Q11.20",  reference, replay_correvit< kafi::ud_kafi<N,M,q20> >(observations));
+    return 0;
+}
@@ -0,0 +1,89 @@
+// Copyright 2018 municHMotorsport e.V. <info@munichmotorsport.de>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <blaze/Math.h>
+#include <iostream>
+#include <vector>
+
+#include "../library/kafi.h"
+#include "../library/fixed_point.h"
+#include "../tests/models.h"
+#include "benchmark.h"
+
+/** \brief Accuracy and throughput of the fixed-point backend compared to the `double` build
+ *
+ * The host numbers only show the relative cost of the integer arithmetic, the absolute numbers on a
+ * Cortex-M0 are a lot lower. The deviations are the same on every target, the arithmetic is exact.
+ */
+
+//! the correvit model on the wemding log with the scalar type `T`
+template< typename T >
+benchmark::replay_result< typename kafi::kafi<models::correvit::N, models::correvit::M, T>::nx1_vector >
+replay_correvit(const std::vector< models::correvit::mx1_vector > & observations)
+{
+    using namespace models::correvit;
+    kafi::kafi<N,M,T> filter(transition<T>()
+                           , prediction_scaling<T>()
+                           , starting_state<T>(observations[0])
+                           , process_noise<T>()
+                           , sensor_noise<T>());
+    return benchmark::replay(filter, observations);
+}
+
+//! a randomized linear model with the scalar type `T`
+template< size_t   N
+        , size_t   M
+        , typename T >
+benchmark::replay_result< typename kafi::kafi<N,M,T>::nx1_vector >
+replay_linear(const models::linear::random_model<N,M> & model)
+{
+    kafi::kafi<N,M,T> filter(model.template transition<T>()
+                           , model.template prediction_scaling<T>()
+                           , equivalence::convert<typename kafi::kafi<N,M,T>::nx1_vector>(model.starting_state)
+                           , equivalence::convert<typename kafi::kafi<N,M,T>::nxn_matrix>(model.process_noise)
+                           , equivalence::convert<typename kafi::kafi<N,M,T>::mxm_matrix>(model.sensor_noise));
+    return benchmark::replay(filter, model.observations);
+}
+
+int main()
+{
+    using q16 = kafi::fixed<16>;
+    using q20 = kafi::fixed<20>;
+
+    {
+        const std::vector< models::correvit::mx1_vector > observations =
+            models::correvit::read_log(models::correvit::wemding_log);
+
+        const auto reference = replay_correvit<double>(observations);
+        benchmark::print_header(std::cout, "wemding replay, N = 7, M = 5", observations.size());
+        benchmark::print_row(std::cout, "double", reference, reference);
+        benchmark::print_row(std::cout, "float",  reference, replay_correvit<float>(observations));
+        benchmark::print_row(std::cout, "Q15.16", reference, replay_correvit<q16>(observations));
+        benchmark::print_row(std::cout, "Q11.20", reference, replay_correvit<q20>(observations));
+        std::cout << '\n';
+    }
+
+    {
+        const size_t N = 4UL;
+        const size_t M = 2UL;
+        const models::linear::random_model<N,M> model(1, 100000);
+
+        const auto reference = replay_linear<N,M,double>(model);
+        benchmark::print_header(std::cout, "randomized linear model, N = 4, M = 2", model.observations.size());
+        benchmark::print_row(std::cout, "double", reference, reference);
+        benchmark::print_row(std::cout, "float",  reference, replay_linear<N,M,float>(model));
+        benchmark::print_row(std::cout, "Q15.16", reference, replay_linear<N,M,q16>(model));
+    }
+    return 0;
+}
@@ -0,0 +1,99 @@
+// Copyright 2018 municHMotorsport e.V. <info@munichmotorsport.de>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <blaze/Math.h>
+#include <array>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <utility>
+
+#include "../library/kafi.h"
+#include "../library/imm_kafi.h"
+#include "../tests/models.h"
+#include "benchmark.h"
+
+/** \brief Time per step of kafi::imm_kafi with 3, 4 and 5 modes of `N = 7`, `M = 5` on 1 and 2 workers
+ *
+ * The randomized linear model of tests/models.h with the process noise of mode `j` scaled by `10^(j - 1)`,
+ * a filter for calm, normal and agitated regimes. The modes stay in their mode with probability `0.9`.
+ * The deviation is the one from kafi::kafi with the unscaled process noise.
+ */
+
+const size_t N = 7UL;
+const size_t M = 5UL;
+
+template< size_t   R
+        , size_t... Index >
+std::array< typename kafi::imm_kafi<N,M,R>::mode, R > make_modes(const models::linear::random_model<N,M> & model
+                                                               , std::index_sequence<Index...>)
+{
+    using mode = typename kafi::imm_kafi<N,M,R>::mode;
+    return std::array< mode, R >{ { mode{ model.transition()
+                                        , model.prediction_scaling()
+                                        , std::pow(10.0, static_cast<double>(Index) - 1.0) * model.process_noise
+                                        , model.sensor_noise }... } };
+}
+
+template< size_t R >
+void print_imm_rows(const models::linear::random_model<N,M> & model
+                  , const benchmark::replay_result< typename kafi::kafi<N,M>::nx1_vector > & reference_result)
+{
+    using imm_t = kafi::imm_kafi<N,M,R>;
+    typename imm_t::rxr_matrix transitions;
+    for (size_t from = 0UL; from < R; ++from)
+    {
+        for (size_t to = 0UL; to < R; ++to)
+        {
+            transitions(from, to) = from == to ? 0.9 : 0.1 / (R - 1UL);
+        }
+    }
+
+    for (const size_t workers : { 1UL, 2UL })
+    {
+        std::unique_ptr< imm_t > candidate(new imm_t(make_modes<R>(model, std::make_index_sequence<R>())
+                                                   , transitions
+                                                   , model.starting_state
+                                                   , workers));
+        const auto result = benchmark::replay(*candidate, model.observations);
+        benchmark::print_row(std::cout, "R=" + std::to_string(R) + " w=" + std::to_string(workers), reference_result, result);
+        std::cout << std::setw(12) << "" << "  " << result.filter_time.count() / model.observations.size() * 1e6 << " us per step\n";
+    }
+}
+
+int main()
+{
+    const size_t steps = 20000UL;
+    const models::linear::random_model<N,M> model(N, steps);
+
+    std::unique_ptr< kafi::kafi<N,M> > reference(
+        new kafi::kafi<N,M>(model.transition()
+                          , model.prediction_scaling()
+                          , model.starting_state
+                          , model.process_noise
+                          , model.sensor_noise));
+    const auto reference_result = benchmark::replay(*reference, model.observations);
+
+    std::cout << "hardware threads: " << std::thread::hardware_concurrency() << "\n\n";
+    benchmark::print_header(std::cout, "randomized linear model, N = " + std::to_string(N) + ", M = " + std::to_string(M)
+                          , model.observations.size(), "filter");
+    benchmark::print_row(std::cout, "kafi", reference_result, reference_result);
+    print_imm_rows<3>(model, reference_result);
+    print_imm_rows<4>(model, reference_result);
+    print_imm_rows<5>(model, reference_result);
+    return 0;
+}
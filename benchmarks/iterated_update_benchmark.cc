@@ -0,0 +1,109 @@
+// Copyright 2018 municHMotorsport e.V. <info@munichmotorsport.de>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <blaze/Math.h>
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "../library/kafi.h"
+#include "../tests/models.h"
+#include "benchmark.h"
+
+/** \brief Cost and accuracy of the iterated update on range and bearing to a track cone
+ *
+ * Every row replays the same simulated passes of the cone, see models::cone, with up to `K` linearizations
+ * of `h` per update and the given tolerance of the early termination. `K = 1` is the extended Kalman filter.
+ */
+
+//! simulated passes of the cone
+const size_t passes = 200UL;
+//! steps per pass
+const size_t steps  = 100UL;
+
+void print_iterated_row(const std::vector< models::cone::drive > & drives, const size_t iterations, const double tolerance)
+{
+    using namespace models::cone;
+
+    benchmark::duration_t time(0);
+    double squared_error  = 0;
+    double largest_error  = 0;
+    size_t linearizations = 0UL;
+    std::shared_ptr< mx1_vector > observation = std::make_shared< mx1_vector >();
+    std::vector< nx1_vector > states(steps);
+    for (const drive & pass : drives)
+    {
+        kafi::kafi<N,M> filter(transition()
+                             , prediction_scaling()
+                             , pass.starting_state
+                             , pass.process_noise
+                             , pass.sensor_noise
+                             , pass.prediction_error);
+        filter.set_iterated_update(iterations, tolerance);
+
+        benchmark::clock_t::time_point start = benchmark::clock_t::now();
+        for (size_t step = 0UL; step < steps; ++step)
+        {
+            *observation = pass.observations[step];
+            filter.set_current_observation(observation);
+            states[step] = std::get<0>(filter.step());
+            linearizations += filter.update_iterations();
+        }
+        time += benchmark::clock_t::now() - start;
+
+        for (size_t step = 0UL; step < steps; ++step)
+        {
+            const double error = std::hypot(states[step](0, 0) - pass.states[step](0, 0)
+                                          , states[step](1, 0) - pass.states[step](1, 0));
+            squared_error += error * error;
+            largest_error  = std::max(largest_error, error);
+        }
+    }
+
+    const double updates = static_cast<double>(passes * steps);
+    std::cout << std::setw(4)  << iterations
+              << std::setw(12) << tolerance
+              << std::setw(14) << time.count() / updates * 1e6
+              << std::setw(16) << linearizations / updates
+              << std::setw(14) << std::sqrt(squared_error / updates)
+              << std::setw(14) << largest_error << '\n';
+}
+
+int main()
+{
+    std::vector< models::cone::drive > drives;
+    drives.reserve(passes);
+    for (size_t seed = 0UL; seed < passes; ++seed)
+    {
+        drives.push_back(models::cone::drive(static_cast<unsigned int>(seed), steps));
+    }
+
+    std::cout << "range and bearing to a cone, N = 4, M = 2, " << passes << " passes of " << steps << " steps\n"
+              << std::setw(4)  << "K"
+              << std::setw(12) << "tolerance"
+              << std::setw(14) << "us per step"
+              << std::setw(16) << "linearizations"
+              << std::setw(14) << "rmse [m]"
+              << std::setw(14) << "max [m]" << '\n';
+    print_iterated_row(drives, 1UL,  0.0);
+    print_iterated_row(drives, 2UL,  0.0);
+    print_iterated_row(drives, 3UL,  0.0);
+    print_iterated_row(drives, 5UL,  0.0);
+    print_iterated_row(drives, 10UL, 1e-6);
+    print_iterated_row(drives, 10UL, 1e-3);
+    return 0;
+}
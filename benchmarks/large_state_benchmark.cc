@@ -0,0 +1,94 @@
+// Copyright 2018 municHMotorsport e.V. <info@munichmotorsport.de>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <blaze/Math.h>
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../library/dynamic_kafi.h"
+#include "../tests/models.h"
+#include "benchmark.h"
+
+/** \brief Time per `step()` of the large-state mode of `kafi::dynamic_kafi` for growing `N` and thread counts
+ *
+ * `M = N / 10`, like a map-augmented state with a few sensors. The first row of every `N` uses the blaze
+ * products, the following rows util::blocked_propagation with `1, 2, 4, ...` workers up to the number of cores.
+ * `kafi::kafi` is not measured, its `StaticMatrix` members don't fit on the stack for these `N`.
+ */
+
+//! runs the model with `workers` threads of the large-state mode, `0` for the blaze products
+benchmark::replay_result< kafi::dynamic_kafi<>::nx1_vector >
+replay_runtime_linear(const models::linear::runtime_model & model, const size_t workers)
+{
+    kafi::dynamic_kafi<> filter(model.transition()
+                              , model.prediction_scaling()
+                              , model.starting_state
+                              , model.process_noise
+                              , model.sensor_noise
+                              , workers);
+    return benchmark::replay(filter, model.observations);
+}
+
+void print_scaling(const size_t N, const size_t steps)
+{
+    const size_t M = std::max<size_t>(1UL, N / 10UL);
+    const models::linear::runtime_model model(N, M, 1, steps);
+    const size_t cores = std::max<size_t>(1UL, std::thread::hardware_concurrency());
+
+    const auto reference = replay_runtime_linear(model, 0UL);
+    const double reference_ms = reference.filter_time.count() / steps * 1e3;
+    std::cout << std::setw(6)  << N
+              << std::setw(6)  << M
+              << std::setw(10) << "blaze"
+              << std::setw(14) << reference_ms
+              << std::setw(12) << 1.0
+              << std::setw(16) << 0.0 << '\n';
+
+    double single_ms = 0;
+    for (size_t workers = 1UL; workers <= cores; workers *= 2UL)
+    {
+        const auto candidate = replay_runtime_linear(model, workers);
+        const double candidate_ms = candidate.filter_time.count() / steps * 1e3;
+        if (workers == 1UL) single_ms = candidate_ms;
+
+        double max, mean;
+        std::tie(max, mean) = benchmark::deviation(reference.states, candidate.states);
+        std::cout << std::setw(6)  << N
+                  << std::setw(6)  << M
+                  << std::setw(10) << workers
+                  << std::setw(14) << candidate_ms
+                  << std::setw(12) << reference_ms / candidate_ms
+                  << std::setw(16) << max
+                  << "   x" << single_ms / candidate_ms << " of 1 worker\n";
+    }
+}
+
+int main()
+{
+    std::cout << "large-state mode, " << std::thread::hardware_concurrency() << " cores\n"
+              << std::setw(6)  << "N"
+              << std::setw(6)  << "M"
+              << std::setw(10) << "workers"
+              << std::setw(14) << "ms per step"
+              << std::setw(12) << "vs blaze"
+              << std::setw(16) << "max deviation" << '\n';
+    print_scaling(100UL, 100UL);
+    print_scaling(250UL, 20UL);
+    print_scaling(500UL, 10UL);
+    return 0;
+}
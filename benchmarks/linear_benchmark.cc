@@ -0,0 +1,66 @@
+// Copyright 2018 municHMotorsport e.V. <info@munichmotorsport.de>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <blaze/Math.h>
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include "../library/kafi.h"
+#include "../library/linear_kafi.h"
+#include "../tests/models.h"
+#include "benchmark.h"
+
+/** \brief Throughput of kafi::linear_kafi compared to kafi::kafi with the same linear models as kafi::jacobian_function
+ *
+ * The randomized linear models of tests/models.h, i.e. dense jacobians with every partial derivative a `std::function`.
+ * The filters are allocated on the heap, the larger ones don't fit on the stack.
+ */
+
+template< size_t N
+        , size_t M >
+void print_linear(const size_t steps)
+{
+    const models::linear::random_model<N,M> model(N, steps);
+
+    std::unique_ptr< kafi::kafi<N,M> > reference(
+        new kafi::kafi<N,M>(model.transition()
+                          , model.prediction_scaling()
+                          , model.starting_state
+                          , model.process_noise
+                          , model.sensor_noise));
+    std::unique_ptr< kafi::linear_kafi<N,M> > candidate(
+        new kafi::linear_kafi<N,M>(model.A
+                                 , model.C
+                                 , model.starting_state
+                                 , model.process_noise
+                                 , model.sensor_noise));
+
+    const auto reference_result = benchmark::replay(*reference, model.observations);
+    benchmark::print_header(std::cout, "randomized linear model, N = " + std::to_string(N) + ", M = " + std::to_string(M)
+                          , model.observations.size(), "filter");
+    benchmark::print_row(std::cout, "kafi",   reference_result, reference_result);
+    benchmark::print_row(std::cout, "linear", reference_result, benchmark::replay(*candidate, model.observations));
+    std::cout << '\n';
+}
+
+int main()
+{
+    print_linear<1,1>(200000);
+    print_linear<4,2>(100000);
+    print_linear<7,5>(100000);
+    print_linear<12,4>(50000);
+    print_linear<32,8>(10000);
+    return 0;
+}
@@ -0,0 +1,84 @@
+// Copyright 2018 municHMotorsport e.V. <info@munichmotorsport.de>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <blaze/Math.h>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "../library/kafi.h"
+#include "../tests/models.h"
+#include "benchmark.h"
+
+/** \brief Time of the model evaluation with and without the fused evaluation of `f` and its jacobian
+ *
+ * The correvit transition computes the trigonometric terms of `f` and of the 10 state dependent partial
+ * derivatives once when fused. Prints the time per `evaluate()` and the wemding replay of kafi::kafi with both.
+ */
+
+//! evaluations per measurement
+const size_t repetitions = 1000000UL;
+
+//! nanoseconds per `function.evaluate()`, the heading is perturbed so the calls can't be hoisted
+template< size_t N >
+double time_evaluation(const kafi::jacobian_function<N,N> & function)
+{
+    typename kafi::jacobian_function<N,N>::nx1_vector state(0.5);
+    typename kafi::jacobian_function<N,N>::nx1_vector output(0);
+    typename kafi::jacobian_function<N,N>::nxn_matrix jacobian(0);
+
+    double checksum = 0;
+    benchmark::clock_t::time_point start = benchmark::clock_t::now();
+    for (size_t repetition = 0UL; repetition < repetitions; ++repetition)
+    {
+        state(6, 0) += 1e-7;
+        function.evaluate(state, output, jacobian);
+        checksum += output(0, 0) + jacobian(0, 6);
+    }
+    const benchmark::duration_t time = benchmark::clock_t::now() - start;
+
+    // keeps the loop alive
+    if (checksum == 0) std::cout << ' ';
+    return time.count() / repetitions * 1e9;
+}
+
+//! the correvit model on the wemding log, with the fused transition if `fused`
+benchmark::replay_result< models::correvit::nx1_vector >
+replay_correvit(const std::vector< models::correvit::mx1_vector > & observations, const bool fused)
+{
+    using namespace models::correvit;
+    kafi::kafi<N,M> filter(transition(sample_time, fused)
+                         , prediction_scaling()
+                         , starting_state(observations[0])
+                         , process_noise()
+                         , sensor_noise());
+    return benchmark::replay(filter, observations);
+}
+
+int main()
+{
+    using namespace models::correvit;
+
+    std::cout << "correvit transition, ns per evaluate()\n"
+              << std::setw(12) << "separate" << std::setw(12) << "fused" << '\n'
+              << std::setw(12) << time_evaluation<N>(transition(sample_time, false))
+              << std::setw(12) << time_evaluation<N>(transition(sample_time, true)) << "\n\n";
+
+    const std::vector< mx1_vector > observations = read_log(wemding_log);
+    const auto reference = replay_correvit(observations, false);
+    benchmark::print_header(std::cout, "wemding replay, N = 7, M = 5", observations.size(), "transition");
+    benchmark::print_row(std::cout, "separate", reference, reference);
+    benchmark::print_row(std::cout, "fused",    reference, replay_correvit(observations, true));
+    return 0;
+}
@@ -0,0 +1,97 @@
+// Copyright 2018 municHMotorsport e.V. <info@munichmotorsport.de>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <blaze/Math.h>
+#include <iomanip>
+#include <iostream>
+#include <random>
+
+#include "../library/small_matrix.h"
+#include "benchmark.h"
+
+/** \brief Time per inversion of the built-in kernels of small_matrix.h and of `blaze::inv` (LAPACK)
+ *
+ * Every kernel inverts the same symmetric positive definite `M x M` matrix, like the innovation covariance.
+ */
+
+//! inversions per measurement
+const size_t repetitions = 200000UL;
+
+//! nanoseconds per call of `invert(S, inverse)`, the input is perturbed so the calls can't be hoisted
+template< size_t   M
+        , typename Function >
+double time_inversion(Function invert)
+{
+    using matrix_t = blaze::StaticMatrix<double, M, M, blaze::rowMajor>;
+
+    std::mt19937 generator(M);
+    std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+    matrix_t root;
+    for (size_t row = 0UL; row < M; ++row)
+    {
+        for (size_t col = 0UL; col < M; ++col)
+        {
+            root(row, col) = uniform(generator);
+        }
+    }
+    matrix_t S = root * blaze::trans(root) + kafi::util::create_identity<M, blaze::rowMajor>();
+    matrix_t inverse;
+
+    double checksum = 0;
+    benchmark::clock_t::time_point start = benchmark::clock_t::now();
+    for (size_t repetition = 0UL; repetition < repetitions; ++repetition)
+    {
+        S(0, 0) += 1e-9;
+        invert(S, inverse);
+        checksum += inverse(0, 0);
+    }
+    const benchmark::duration_t time = benchmark::clock_t::now() - start;
+
+    // keeps the loop alive
+    if (checksum == 0) std::cout << ' ';
+    return time.count() / repetitions * 1e9;
+}
+
+template< size_t M >
+void print_inversion_row()
+{
+    using matrix_t = blaze::StaticMatrix<double, M, M, blaze::rowMajor>;
+
+    std::cout << std::setw(4) << M
+              << std::setw(16) << time_inversion<M>([](const matrix_t & in, matrix_t & out){ kafi::util::inverse(in, out); })
+              << std::setw(16) << time_inversion<M>([](const matrix_t & in, matrix_t & out){ kafi::util::gauss_jordan_inverse(in, out); });
+#ifdef KAFI_NO_LAPACK
+    std::cout << std::setw(16) << "-" << '\n';
+#else
+    std::cout << std::setw(16) << time_inversion<M>([](const matrix_t & in, matrix_t & out){ out = blaze::inv(in); }) << '\n';
+#endif
+}
+
+int main()
+{
+    std::cout << "inversion of an M x M covariance in double, ns per call\n"
+              << std::setw(4)  << "M"
+              << std::setw(16) << "util::inverse"
+              << std::setw(16) << "gauss_jordan"
+              << std::setw(16) << "blaze::inv" << '\n';
+    print_inversion_row<1>();
+    print_inversion_row<2>();
+    print_inversion_row<3>();
+    print_inversion_row<4>();
+    print_inversion_row<5>();
+    print_inversion_row<6>();
+    print_inversion_row<7>();
+    print_inversion_row<8>();
+    return 0;
+}
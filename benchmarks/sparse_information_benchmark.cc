@@ -0,0 +1,99 @@
+// Copyright 2018 municHMotorsport e.V. <info@munichmotorsport.de>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <blaze/Math.h>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <tuple>
+
+#include "../library/kafi.h"
+#include "../library/information_kafi.h"
+#include "../tests/models.h"
+#include "benchmark.h"
+
+/** \brief Time per `step()` of the sparse kafi::information_kafi against the dense kafi::kafi on a chain
+ *
+ * The chain of models::linear::chain_model has a tridiagonal transition and `M = N / 10` sensors. The exact
+ * information filter computes the dense predicted information matrix, the sparsified one only the elements in the
+ * pattern of `inv(Q) + F * Omega * trans(F)` and keeps the ones above the relative threshold.
+ */
+
+//! ms per step, speedup against the reference, state deviation and the final non-zeros of the information matrix
+template< typename Reference
+        , typename Candidate >
+void print_information_row(const std::string & name
+                         , const benchmark::replay_result<Reference> & reference
+                         , const benchmark::replay_result<Candidate> & candidate
+                         , const size_t non_zeros)
+{
+    double max, mean;
+    std::tie(max, mean) = benchmark::deviation(reference.states, candidate.states);
+    std::cout << std::setw(20) << name
+              << std::setw(14) << candidate.filter_time.count() / candidate.states.size() * 1e3
+              << std::setw(12) << reference.filter_time.count() / candidate.filter_time.count()
+              << std::setw(16) << max
+              << std::setw(12) << non_zeros << '\n';
+}
+
+template< size_t N >
+void print_chain()
+{
+    const size_t M     = N / 10UL;
+    const size_t steps = 100UL;
+    // all of them on the heap, the static matrices of a large N would exceed the stack
+    std::unique_ptr< models::linear::chain_model<N,M> > model(new models::linear::chain_model<N,M>(N, steps));
+
+    std::unique_ptr< kafi::kafi<N,M> > dense(
+        new kafi::kafi<N,M>(model->transition()
+                          , model->prediction_scaling()
+                          , model->starting_state
+                          , model->process_noise
+                          , model->sensor_noise));
+    const auto reference = benchmark::replay(*dense, model->observations);
+
+    std::cout << "chain, N = " << N << ", M = " << M << ", " << steps << " steps\n"
+              << std::setw(20) << "filter"
+              << std::setw(14) << "ms per step"
+              << std::setw(12) << "vs dense"
+              << std::setw(16) << "max deviation"
+              << std::setw(12) << "non-zeros" << '\n';
+    print_information_row("kafi", reference, reference, N * N);
+
+    for (const double threshold : { 0.0, 1e-4, 1e-2 })
+    {
+        std::unique_ptr< kafi::information_kafi<N,M> > information(
+            new kafi::information_kafi<N,M>(model->transition()
+                                          , model->prediction_scaling()
+                                          , model->starting_state
+                                          , model->process_noise
+                                          , model->sensor_noise
+                                          , threshold));
+        const auto result = benchmark::replay(*information, model->observations);
+        std::ostringstream name;
+        name << "information " << threshold;
+        print_information_row(name.str(), reference, result, information->information_non_zeros());
+    }
+    std::cout << '\n';
+}
+
+int main()
+{
+    print_chain<50>();
+    print_chain<100>();
+    print_chain<200>();
+    return 0;
+}
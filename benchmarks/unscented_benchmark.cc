@@ -0,0 +1,72 @@
+// Copyright 2018 municHMotorsport e.V. <info@munichmotorsport.de>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <blaze/Math.h>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+
+#include "../library/kafi.h"
+#include "../library/unscented_kafi.h"
+#include "../tests/models.h"
+#include "benchmark.h"
+
+/** \brief Throughput of kafi::unscented_kafi with 1, 2 and 4 workers compared to kafi::kafi
+ *
+ * The randomized linear models of tests/models.h, the unscented filter only gets the functions `f` and `h`.
+ * The sigma points are evaluated on the workers, the weighted sums on the calling thread. The filters are
+ * allocated on the heap, the larger ones don't fit on the stack.
+ */
+
+template< size_t N
+        , size_t M >
+void print_unscented(const size_t steps)
+{
+    const models::linear::random_model<N,M> model(N, steps);
+
+    std::unique_ptr< kafi::kafi<N,M> > reference(
+        new kafi::kafi<N,M>(model.transition()
+                          , model.prediction_scaling()
+                          , model.starting_state
+                          , model.process_noise
+                          , model.sensor_noise));
+    const auto reference_result = benchmark::replay(*reference, model.observations);
+
+    benchmark::print_header(std::cout, "randomized linear model, N = " + std::to_string(N) + ", M = " + std::to_string(M)
+                          , model.observations.size(), "filter");
+    benchmark::print_row(std::cout, "kafi", reference_result, reference_result);
+    for (const size_t workers : { 1UL, 2UL, 4UL })
+    {
+        std::unique_ptr< kafi::unscented_kafi<N,M> > candidate(
+            new kafi::unscented_kafi<N,M>(model.transition().function()
+                                        , model.prediction_scaling().function()
+                                        , model.starting_state
+                                        , model.process_noise
+                                        , model.sensor_noise
+                                        , workers));
+        benchmark::print_row(std::cout, "ukf " + std::to_string(workers), reference_result
+                           , benchmark::replay(*candidate, model.observations));
+    }
+    std::cout << '\n';
+}
+
+int main()
+{
+    std::cout << "hardware threads: " << std::thread::hardware_concurrency() << "\n\n";
+    print_unscented<4,2>(100000);
+    print_unscented<7,5>(50000);
+    print_unscented<30,8>(5000);
+    return 0;
+}
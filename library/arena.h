@@ -0,0 +1,143 @@
+// Copyright 2018 municHMotorsport e.V. <info@munichmotorsport.de>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KAFI_ARENA_H
+#define KAFI_ARENA_H
+
+/*!
+ *  \addtogroup kafi::util
+ *  @{
+ */
+
+#include <blaze/Math.h>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+namespace kafi
+{
+    namespace util {
+
+        /** \brief A single preallocated block of scalars which hands out matrix views
+         *
+         * All matrices of a runtime-sized filter are carved out of one contiguous allocation at construction,
+         * e.g. in kafi::dynamic_kafi. The views never own memory, so nothing is allocated or freed afterwards.
+         * Every view starts on a cache line if the size of `T` divides it, so the rows of the large-state mode
+         * don't share cache lines with other matrices.
+         *
+         * Template arguments:
+         * * `T` = scalar type (default: `double`)
+         *
+         * The arena is neither copyable nor movable, every view points into it.
+         */
+        template< typename T = double >
+        class arena {
+
+            // typenames
+            public:
+                //! self type for conciseness
+                using self_t = arena<T>;
+                //! row-major view into the arena
+                using view_t = blaze::CustomMatrix<T, blaze::unaligned, blaze::unpadded, blaze::rowMajor>;
+
+                //! size of a cache line in bytes
+                static const size_t cache_line_size = 64UL;
+
+            // constructors
+            public:
+                /** \brief Allocates `capacity` scalars, initialized with `0`
+                 *
+                 * Use arena::padded_size() to compute the capacity of aligned views.
+                 */
+                explicit arena(const size_t capacity)
+                : _memory(capacity + alignment() - 1UL, T(0))
+                , _offset(aligned_offset(_memory.data()))
+                , _capacity(capacity)
+                , _used(0UL)
+                { }
+
+                //! Copy constructor is deleted, the handed out views point into this arena
+                arena(const self_t & other) = delete;
+                //! Move constructor is deleted, the handed out views point into this arena
+                arena(const self_t && other) = delete;
+
+            // methods
+            public:
+                //! number of scalars per cache line, `1` if the size of `T` doesn't divide a cache line
+                static constexpr size_t alignment()
+                {
+                    return cache_line_size % sizeof(T) == 0UL ? cache_line_size / sizeof(T) : 1UL;
+                }
+
+                //! number of scalars arena::allocate() takes for a `rows x columns` view, rounded up to a cache line
+                static size_t padded_size(const size_t rows, const size_t columns)
+                {
+                    return (rows * columns + alignment() - 1UL) / alignment() * alignment();
+                }
+
+                /** \brief The next `rows x columns` scalars of the arena as a matrix view
+                 *
+                 * Throws `std::length_error` if the arena is exhausted
+                 */
+                view_t allocate(const size_t rows, const size_t columns)
+                {
+                    const size_t size = padded_size(rows, columns);
+                    if (size > _capacity - _used)
+                    {
+                        throw std::length_error("kafi::util::arena is exhausted");
+                    }
+                    view_t view(_memory.data() + _offset + _used, rows, columns);
+                    _used += size;
+                    return view;
+                }
+
+                //! number of scalars of the arena
+                size_t capacity() const
+                {
+                    return _capacity;
+                }
+
+                //! number of scalars handed out by arena::allocate()
+                size_t used() const
+                {
+                    return _used;
+                }
+
+            //! Private methods
+            private:
+                //! number of scalars from `memory` to the next cache line, `0` if it can't be reached in whole scalars
+                static size_t aligned_offset(const T * memory)
+                {
+                    const size_t misalignment = reinterpret_cast<std::uintptr_t>(memory) % cache_line_size;
+                    const size_t bytes        = (cache_line_size - misalignment) % cache_line_size;
+                    return alignment() > 1UL && bytes % sizeof(T) == 0UL ? bytes / sizeof(T) : 0UL;
+                }
+
+            // member
+            private:
+                //! the only allocation
+                std::vector<T> _memory;
+                //! first aligned scalar of `_memory`
+                const size_t   _offset;
+                //! number of usable scalars after `_offset`
+                const size_t   _capacity;
+                //! number of scalars handed out by arena::allocate()
+                size_t         _used;
+        };
+
+    } // namespace util
+} // namespace kafi
+
+/*! @} End of Doxygen Groups*/
+#endif // KAFI_ARENA_H
@@ -0,0 +1,8 @@
+
+// generated by cmake from INSTANTIATIONS_KAFI, included at the end of kafi.h
+KAFI_INSTANTIATE_JACOBIAN_FUNCTION(1, 1, double)
+KAFI_INSTANTIATE_JACOBIAN_FUNCTION(1, 2, double)
+KAFI_INSTANTIATE_JACOBIAN_FUNCTION(7, 7, double)
+KAFI_INSTANTIATE_JACOBIAN_FUNCTION(7, 5, double)
+KAFI_INSTANTIATE_KAFI(1, 2, double)
+KAFI_INSTANTIATE_KAFI(7, 5, double)
@@ -0,0 +1,174 @@
+// Copyright 2018 municHMotorsport e.V. <info@munichmotorsport.de>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KAFI_BLOCKED_PROPAGATION_H
+#define KAFI_BLOCKED_PROPAGATION_H
+
+/*!
+ *  \addtogroup kafi::util
+ *  @{
+ */
+
+#include <algorithm>
+#include <blaze/Math.h>
+#include "tile_pool.h"
+
+namespace kafi
+{
+    namespace util {
+
+        //! rows and columns of a tile of the blocked kernels, 64 doubles are a 512 byte row segment
+        const size_t propagation_block_size = 64UL;
+
+        /** \brief `C = A * B` for the rows `[row_begin, row_end)` of `C`, blocked over the inner dimension
+         *
+         * Accumulates rows of `B` into the rows of `C` (row-major, unit stride), a block of `B` stays in the cache
+         * for all rows of the tile. `A`, `B` and `C` must not overlap.
+         */
+        template< typename A
+                , typename B
+                , typename C >
+        void blocked_multiply_rows(const A & a, const B & b, C & c, const size_t row_begin, const size_t row_end)
+        {
+            using T = typename C::ElementType;
+            const size_t inner   = a.columns();
+            const size_t columns = b.columns();
+
+            for (size_t row = row_begin; row < row_end; ++row)
+            {
+                T * c_row = c.data() + row * c.spacing();
+                std::fill(c_row, c_row + columns, T(0));
+            }
+            for (size_t k_begin = 0UL; k_begin < inner; k_begin += propagation_block_size)
+            {
+                const size_t k_end = std::min(inner, k_begin + propagation_block_size);
+                for (size_t row = row_begin; row < row_end; ++row)
+                {
+                    T *       c_row = c.data() + row * c.spacing();
+                    const T * a_row = a.data() + row * a.spacing();
+                    for (size_t k = k_begin; k < k_end; ++k)
+                    {
+                        const T   factor = a_row[k];
+                        const T * b_row  = b.data() + k * b.spacing();
+                        for (size_t col = 0UL; col < columns; ++col)
+                        {
+                            c_row[col] += factor * b_row[col];
+                        }
+                    }
+                }
+            }
+        }
+
+        /** \brief `P = FP * trans(F) + Q` for the row block `[row_begin, row_end)`, only the upper triangle is computed
+         *
+         * `P(i,j)` is the dot product of the rows `i` of `FP` and `j` of `F`, both unit stride. The result is
+         * symmetric, every element `(i,j)` with `j >= i` is computed once and mirrored to `(j,i)`. `Q` has to be
+         * symmetric.
+         */
+        template< typename FP
+                , typename F
+                , typename Q
+                , typename P >
+        void blocked_symmetric_rows(const FP & fp, const F & f, const Q & q, P & p, const size_t row_begin, const size_t row_end)
+        {
+            using T = typename P::ElementType;
+            const size_t n = f.rows();
+
+            for (size_t col_begin = row_begin; col_begin < n; col_begin += propagation_block_size)
+            {
+                const size_t col_end = std::min(n, col_begin + propagation_block_size);
+                for (size_t row = row_begin; row < row_end; ++row)
+                {
+                    const T * fp_row = fp.data() + row * fp.spacing();
+                    for (size_t col = std::max(row, col_begin); col < col_end; ++col)
+                    {
+                        const T * f_row = f.data() + col * f.spacing();
+                        T sum = T(0);
+                        for (size_t k = 0UL; k < n; ++k)
+                        {
+                            sum += fp_row[k] * f_row[k];
+                        }
+                        sum += q(row, col);
+                        p(row, col) = sum;
+                        p(col, row) = sum;
+                    }
+                }
+            }
+        }
+
+        /** \brief Covariance propagation `P = F * P * trans(F) + Q` of large states with cache blocked tiles on a util::tile_pool
+         *
+         * The rows are split in blocks of util::propagation_block_size, the workers take every `workers`-th block,
+         * which balances the triangular second product. Neither spawns threads nor allocates per call.
+         *
+         * Template arguments:
+         * * `T` = scalar type (default: `double`)
+         */
+        template< typename T = double >
+        class blocked_propagation {
+
+            // constructors
+            public:
+                //! Starts `workers - 1` threads, the calling thread is the first worker
+                explicit blocked_propagation(const size_t workers)
+                : _pool(workers)
+                { }
+
+            // methods
+            public:
+                //! number of workers including the calling thread
+                size_t workers() const
+                {
+                    return _pool.workers();
+                }
+
+                /** \brief `P = F * P * trans(F) + Q`, `FP` is the preallocated space for `F * P`
+                 *
+                 * All matrices are dense, row-major and `N x N` with `data()` and `spacing()`, e.g. blaze::CustomMatrix
+                 */
+                template< typename Matrix >
+                void operator()(const Matrix & F, Matrix & P, const Matrix & Q, Matrix & FP)
+                {
+                    const size_t n = F.rows();
+
+                    auto first = [&](const size_t worker, const size_t workers)
+                    {
+                        for (size_t block = worker * propagation_block_size; block < n; block += workers * propagation_block_size)
+                        {
+                            blocked_multiply_rows(F, P, FP, block, std::min(n, block + propagation_block_size));
+                        }
+                    };
+                    _pool.run(first);
+
+                    auto second = [&](const size_t worker, const size_t workers)
+                    {
+                        for (size_t block = worker * propagation_block_size; block < n; block += workers * propagation_block_size)
+                        {
+                            blocked_symmetric_rows(FP, F, Q, P, block, std::min(n, block + propagation_block_size));
+                        }
+                    };
+                    _pool.run(second);
+                }
+
+            // member
+            private:
+                //! the workers of both products
+                tile_pool _pool;
+        };
+
+    } // namespace util
+} // namespace kafi
+
+/*! @} End of Doxygen Groups*/
+#endif // KAFI_BLOCKED_PROPAGATION_H
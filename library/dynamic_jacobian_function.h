@@ -0,0 +1,263 @@
+// Copyright 2018 municHMotorsport e.V. <info@munichmotorsport.de>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef DYNAMIC_JACOBIAN_FUNCTION_H
+#define DYNAMIC_JACOBIAN_FUNCTION_H
+
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <blaze/Math.h>
+#include "arena.h"
+#include "jacobian_function.h"
+
+namespace kafi {
+
+/**
+ * \brief The runtime-sized counterpart of kafi::jacobian_function, used by kafi::dynamic_kafi
+ *
+ * The input dimension `N` and output dimension `M` are constructor arguments. The function and its partial
+ * derivatives work on views into the arena of the filter, so calling them doesn't allocate.
+ *
+ * Template arguments:
+ * * `T`  = scalar type of all vectors and matrices (default: `double`)
+ *
+ * A model written for the static kafi::jacobian_function can be reused with kafi::make_dynamic().
+ */
+template< typename T = double > // scalar type
+class dynamic_jacobian_function {
+
+    // typenames
+    public:
+        //! self type for conciseness
+        using self_t          = dynamic_jacobian_function<T>;
+        //! scalar type of all vectors and matrices
+        using value_t         = T;
+        /** view into the arena of kafi::dynamic_kafi, `(N x 1)`, `(M x 1)` or `(M x N)` */
+        using view_t          = typename util::arena<T>::view_t;
+        /** function that takes `(N x 1)` and returns `(M x 1)` */
+        using func            = std::function<void(const view_t &, view_t &)>;
+        /** partial derivative of fun for a single dimension of `N` */
+        using par_jacobi_func = std::function<T(const view_t &)>;
+        /** full `M x N` matrix of partial derivatives of dynamic_jacobian_function::func */
+        using jacobi_func     = blaze::DynamicMatrix<par_jacobi_func, blaze::rowMajor>;
+        /** function that takes `(N x 1)` and writes `(M x 1)` and every entry of its jacobian `(M x N)` in a single call */
+        using fused_func      = std::function<void(const view_t &, view_t &, view_t &)>;
+
+    // constructors
+    public:
+        /** \brief Default constructor with the dimensions, the normal function `f` and its derivative `F`
+         *
+         * Throws `std::invalid_argument` if `F` is not `M x N`
+         */
+        dynamic_jacobian_function(const size_t n, const size_t m, func f, jacobi_func F)
+        : dynamic_jacobian_function(n, m, f, F, fused_func())
+        { }
+
+        /**
+         * \brief The same as the default constructor, with the fused evaluation `fused` of `f` and `F`, see dynamic_jacobian_function::evaluate()
+         *
+         * Unlike jacobian_function::evaluate(), `fused` writes every entry of the jacobian.
+         */
+        dynamic_jacobian_function(const size_t n, const size_t m, func f, jacobi_func F, fused_func fused)
+        : _n(n)
+        , _m(m)
+        , _f(f)
+        , _F(F)
+        , _fused(fused)
+        {
+            if (_F.rows() != _m || _F.columns() != _n)
+            {
+                throw std::invalid_argument("kafi::dynamic_jacobian_function: jacobian has to be M x N");
+            }
+        }
+
+        //! copy constructor is deleted, like for kafi::jacobian_function
+        dynamic_jacobian_function(const self_t & other) = delete;
+        //! move constructor
+        dynamic_jacobian_function(const self_t && other)
+        : _n(other._n)
+        , _m(other._m)
+        , _f(std::move(other._f))
+        , _F(std::move(other._F))
+        , _fused(std::move(other._fused)) { }
+
+    // methods
+    public:
+        //! input dimension `N`
+        size_t input_dimension() const
+        {
+            return _n;
+        }
+
+        //! output dimension `M`
+        size_t output_dimension() const
+        {
+            return _m;
+        }
+
+        /**
+         * \brief Forwarding to the 'f' function
+         * * `state` ~= input, read-only and never the same view as `output`, like in jacobian_function::operator()
+         * * `output` is preallocated by the caller
+         */
+        void operator()(const view_t & state, view_t & output) const
+        {
+            return _f(state, output);
+        }
+
+        /**
+         * \brief Iterates over all partial derivatives of `_f` in `_F` and runs them with `state`
+         */
+        view_t & jacobian(const view_t & state, view_t & jacobi_temp) const
+        {
+            for(size_t row = 0UL; row < _m; ++row)
+            {
+                for(size_t col = 0UL; col < _n; ++col)
+                {
+                    const par_jacobi_func & j_func = _F(row, col);
+                    jacobi_temp(row, col) = j_func ? j_func(state) : T(0);
+                }
+            }
+            return jacobi_temp;
+        }
+
+        /**
+         * \brief The function value and the jacobian at `state`, in a single call if a fused function was given
+         *
+         * Without a fused function this is dynamic_jacobian_function::jacobian() followed by dynamic_jacobian_function::operator().
+         */
+        void evaluate(const view_t & state, view_t & output, view_t & jacobi_temp) const
+        {
+            if (_fused)
+            {
+                _fused(state, output, jacobi_temp);
+            }
+            else
+            {
+                jacobian(state, jacobi_temp);
+                _f(state, output);
+            }
+        }
+
+    // member
+    private:
+        //! input dimension
+        const size_t      _n;
+        //! output dimension
+        const size_t      _m;
+        //! normal function `_f :: view_t (N x 1) -> view_t (M x 1)`
+        const func        _f;
+        //! jacobian function `_F :: view_t (N x 1) -> view_t (M x N)`
+        const jacobi_func _F;
+        //! `_f` and `_F` in a single call, may be empty
+        const fused_func  _fused;
+};
+
+namespace detail {
+
+    /** \brief A copy of a static kafi::jacobian_function with the static vectors of its calls, see kafi::make_dynamic()
+     *
+     * The vectors are reused by every call, so the adapted functions must not be called concurrently.
+     */
+    template< size_t   N
+            , size_t   M
+            , typename T >
+    struct static_adapter
+    {
+        using static_t = jacobian_function<N,M,T>;
+
+        //! copies the functions of `other`, its constant entries are cached again
+        explicit static_adapter(const static_t & other)
+        : function(other.function(), partial_derivatives(other), other.fused_function())
+        , input(0)
+        , output(0)
+        , jacobian(0)
+        { }
+
+        //! the partial derivatives of `other`, structural zeros stay empty
+        static typename static_t::jacobi_func partial_derivatives(const static_t & other)
+        {
+            typename static_t::jacobi_func F;
+            for (size_t row = 0UL; row < M; ++row)
+            {
+                for (size_t col = 0UL; col < N; ++col)
+                {
+                    F(row, col) = other.partial_derivative(row, col);
+                }
+            }
+            return F;
+        }
+
+        const static_t                 function;
+        typename static_t::nx1_vector  input;
+        typename static_t::mx1_vector  output;
+        typename static_t::mxn_matrix  jacobian;
+    };
+
+} // namespace detail
+
+/** \brief Wraps a static kafi::jacobian_function for kafi::dynamic_kafi
+ *
+ * The state is copied once per call into a static vector, which is reused and doesn't allocate.
+ * dynamic_jacobian_function::evaluate() runs jacobian_function::evaluate() of the copy, i.e. its fused
+ * function and its cached constant entries, and copies the output and the whole jacobian back. A copy of
+ * `static_function` is stored, `static_function` doesn't have to outlive the result. The result must not be
+ * called concurrently, see detail::static_adapter.
+ */
+template< size_t   N
+        , size_t   M
+        , typename T >
+dynamic_jacobian_function<T> make_dynamic(const jacobian_function<N,M,T> & static_function)
+{
+    using adapter_t = detail::static_adapter<N,M,T>;
+    using view_t    = typename dynamic_jacobian_function<T>::view_t;
+
+    const std::shared_ptr<adapter_t> adapter = std::make_shared<adapter_t>(static_function);
+
+    const typename dynamic_jacobian_function<T>::func dynamic_f = [adapter](const view_t & input, view_t & output)
+    {
+        adapter->input = input;
+        adapter->function(adapter->input, adapter->output);
+        output = adapter->output;
+    };
+
+    typename dynamic_jacobian_function<T>::jacobi_func dynamic_F(M, N);
+    for (size_t row = 0UL; row < M; ++row)
+    {
+        for (size_t col = 0UL; col < N; ++col)
+        {
+            // structural zeros stay empty
+            if (static_function.structural_zero(row, col)) continue;
+            dynamic_F(row, col) = [adapter, row, col](const view_t & input)
+            {
+                adapter->input = input;
+                return adapter->function.partial_derivative(row, col)(adapter->input);
+            };
+        }
+    }
+
+    const typename dynamic_jacobian_function<T>::fused_func dynamic_fused = [adapter](const view_t & input, view_t & output, view_t & jacobi_temp)
+    {
+        adapter->input = input;
+        adapter->function.evaluate(adapter->input, adapter->output, adapter->jacobian);
+        output      = adapter->output;
+        jacobi_temp = adapter->jacobian;
+    };
+    return dynamic_jacobian_function<T>(N, M, dynamic_f, dynamic_F, dynamic_fused);
+}
+
+} // namespace kafi
+
+#endif // DYNAMIC_JACOBIAN_FUNCTION_H
@@ -0,0 +1,468 @@
+// Copyright 2018 municHMotorsport e.V. <info@munichmotorsport.de>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef DYNAMIC_KAFI_H
+#define DYNAMIC_KAFI_H
+
+#include <array>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include "arena.h"
+#include "blocked_propagation.h"
+#include "dynamic_jacobian_function.h"
+#include "small_matrix.h"
+#include "autogen-KAFI-macros.h"
+
+/*!
+ *  \addtogroup kafi
+ *  @{
+ */
+
+namespace kafi {
+
+/** \brief A runtime-sized EKF, `N` and `M` are constructor arguments instead of template arguments
+ *
+ * The same filter as kafi::kafi, but a single binary can run models of every size, e.g. loaded from a
+ * configuration file. Every matrix is a view into one util::arena which is allocated in the constructor,
+ * `step()` never allocates afterwards:
+ * * every product is written into its own preallocated view, so blaze doesn't need temporaries
+ * * the innovation covariance is inverted by util::gauss_jordan_eliminate() in the arena (LAPACK would allocate)
+ * * `step()` returns references to the views instead of copies
+ *
+ * Large-state mode: with `propagation_workers > 0` the covariance propagation `F * P * trans(F) + Q`, the
+ * `O(N^3)` bottleneck of states with hundreds of dimensions, runs in cache blocked tiles on that many threads,
+ * see util::blocked_propagation. The threads are started in the constructor. Below `N ~ 100` the blaze
+ * products of the default mode are faster.
+ *
+ * Template arguments:
+ * * `T`  = scalar type of the state, the models and the propagation (default: `double`)
+ *
+ * Static models can be reused with kafi::make_dynamic(), see [tests/dynamic_kafi_tests.cc](../../tests/dynamic_kafi_tests.cc)
+ */
+template< typename T = double > // scalar type
+class dynamic_kafi {
+
+    // typenames
+    public:
+        //! self type for conciseness
+        using self_t     = dynamic_kafi<T>;
+        //! scalar type of the state, the models and the propagation
+        using value_t    = T;
+        //! view into the arena
+        using view_t     = typename util::arena<T>::view_t;
+        //! owning matrix type of the constructor arguments
+        using matrix_t   = blaze::DynamicMatrix<T, blaze::rowMajor>;
+        //! `(N x 1)`, only used by the caller, e.g. for the observations
+        using nx1_vector = matrix_t;
+        //! `(M x 1)`, the type of the observations
+        using mx1_vector = matrix_t;
+        /** \brief Shorthand for a useful return type for the kalman filter, references into the arena
+         *  * `const view_t & = std::get<0>(x)` = state              
+         *  * `const view_t & = std::get<1>(x)` = prediction error   
+         *  * `const view_t & = std::get<2>(x)` = gain               
+         */
+        using return_t   = std::tuple<const view_t &,
+                                      const view_t &,
+                                      const view_t &>;
+
+    // constructors
+    public:
+
+        /** \brief Default constructor
+         *
+         * Arguments:
+         * * `dynamic_jacobian_function<T> f`: state transision function with their jacobian, `N -> N`
+         * * `dynamic_jacobian_function<T> h`: prediction scaling function with their jacobian, `N -> M`
+         * * `const matrix_t & starting_state`: `(N x 1)`, copied into the arena
+         * * `const matrix_t &  process_noise`: `(N x N)`, the *real world* noise
+         * * `const matrix_t &   sensor_noise`: `(M x M)`, the sensor covariance noise matrix
+         * * `size_t  propagation_workers`: `0` for the blaze products, otherwise the threads of the large-state mode
+         *
+         * Initializing `prediction_error` to identity matrix
+         *
+         * Throws `std::invalid_argument` if the dimensions don't match
+         */
+        dynamic_kafi(dynamic_jacobian_function<T> f
+                   , dynamic_jacobian_function<T> h
+                   , const matrix_t &             starting_state
+                   , const matrix_t &             process_noise
+                   , const matrix_t &             sensor_noise
+                   , const size_t                 propagation_workers = 0UL)
+        : dynamic_kafi<T>(std::move(f)
+                        , std::move(h)
+                        , starting_state
+                        , process_noise
+                        , sensor_noise
+                        , identity(starting_state.rows())
+                        , propagation_workers)
+        { }
+
+        /**
+         * \brief The same as the default constructor, but with custom `prediction error` initialization
+         */
+        dynamic_kafi(dynamic_jacobian_function<T> f
+                   , dynamic_jacobian_function<T> h
+                   , const matrix_t &             starting_state
+                   , const matrix_t &             process_noise
+                   , const matrix_t &             sensor_noise
+                   , const matrix_t &             prediction_error
+                   , const size_t                 propagation_workers = 0UL)
+        : _n(f.input_dimension())
+        , _m(h.output_dimension())
+        , _f(std::move(f))
+        , _h(std::move(h))
+        , _arena(required_capacity(_n, _m))
+        , _states{{_arena.allocate(_n, 1UL), _arena.allocate(_n, 1UL)}}
+        , _current_state(0UL)
+        , _prediction_error(_arena.allocate(_n, _n))
+        , _gain(_arena.allocate(_n, _m))
+        , _process_noise(_arena.allocate(_n, _n))
+        , _sensor_noise(_arena.allocate(_m, _m))
+        , _f_jacobian_temp(_arena.allocate(_n, _n))
+        , _f_product_temp(_arena.allocate(_n, _n))
+        , _h_temp(_arena.allocate(_m, 1UL))
+        , _h_jacobian_temp(_arena.allocate(_m, _n))
+        , _h_trans_temp(_arena.allocate(_n, _m))
+        , _gain_numerator_temp(_arena.allocate(_n, _m))
+        , _innovation_covariance_temp(_arena.allocate(_m, _m))
+        , _innovation_work_temp(_arena.allocate(_m, _m))
+        , _innovation_inverse_temp(_arena.allocate(_m, _m))
+        , _innovation_temp(_arena.allocate(_m, 1UL))
+        , _correction_temp(_arena.allocate(_n, 1UL))
+        , _h_p_temp(_arena.allocate(_m, _n))
+        , _propagation(propagation_workers > 0UL ? new util::blocked_propagation<T>(propagation_workers) : nullptr)
+        , _new_data_available(false)
+        , _prediction_count(0)
+        , _update_count(0)
+        {
+            check_dimensions(starting_state,   _n, 1UL, "starting_state has to be N x 1");
+            check_dimensions(process_noise,    _n, _n,  "process_noise has to be N x N");
+            check_dimensions(sensor_noise,     _m, _m,  "sensor_noise has to be M x M");
+            check_dimensions(prediction_error, _n, _n,  "prediction_error has to be N x N");
+            if (_f.output_dimension() != _n || _h.input_dimension() != _n)
+            {
+                throw std::invalid_argument("kafi::dynamic_kafi: f has to be N -> N and h has to be N -> M");
+            }
+
+            state()           = starting_state;
+            _prediction_error = prediction_error;
+            _process_noise    = process_noise;
+            _sensor_noise     = sensor_noise;
+        }
+
+        //! Copy constructor is deleted because dynamic_kafi owns multiple different potentially big matrices
+        dynamic_kafi(const self_t & other) = delete;
+        //! Move constructor is deleted because every view points into the arena
+        dynamic_kafi(const self_t && other) = delete;
+
+    // methods
+    public:
+        /** \brief Number of scalars in the arena of a filter with `n` states and `m` sensors
+         */
+        static size_t required_capacity(const size_t n, const size_t m)
+        {
+            using arena_t = util::arena<T>;
+            return 4UL * arena_t::padded_size(n, n)     // P, Q, F, F * P
+                 + 5UL * arena_t::padded_size(n, m)     // G, trans(H), P * trans(H), H, H * P
+                 + 4UL * arena_t::padded_size(m, m)     // R, S, inv(S) and the elimination work
+                 + 3UL * arena_t::padded_size(n, 1UL)   // both state buffers, G * innovation
+                 + 2UL * arena_t::padded_size(m, 1UL);  // h(state), innovation
+        }
+
+        //! state dimension `N`
+        size_t state_dimension() const
+        {
+            return _n;
+        }
+
+        //! sensor dimension `M`
+        size_t sensor_dimension() const
+        {
+            return _m;
+        }
+
+        //! threads of the large-state mode, `0` if the blaze products are used
+        size_t propagation_workers() const
+        {
+            return _propagation ? _propagation->workers() : 0UL;
+        }
+
+        /**
+         * The same as kafi::set_current_observation()
+         *
+         * Throws `std::invalid_argument` if the observation is not `M x 1`
+         */
+        void set_current_observation(std::shared_ptr<mx1_vector> observation)
+        {
+            check_dimensions(*observation, _m, 1UL, "observation has to be M x 1");
+            _observation = observation;
+            _new_data_available = true;
+        }
+
+        /**\brief Main function that runs the Kalman Filter based on new or old observation, and apply the prediction and update step
+         *
+         * Modifying:
+         *     * `_gain`
+         *     * `_states`
+         *     * `_prediction_error`
+         *
+         * Return:
+         *     * tuple of references, valid until the next step()
+         *         - state
+         *         - prediction_error
+         *         - gain
+         */
+        return_t step()
+        {
+            apply_prediction();
+            if (new_data_available())
+            {
+                apply_update();
+            }
+
+            DEBUG_MSG_KAFI(*this);
+            return return_t(state(), _prediction_error, _gain);
+        }
+
+        /** \brief Overloading stream operator for logging purposes, the same format as kafi::kafi
+         */
+        friend std::ostream & operator<<(std::ostream& stream, const self_t & rhs)
+        {
+            std::shared_ptr<mx1_vector> o = rhs._observation.lock();
+            const char * line = "============================\n";
+            stream << "Kafi (N = " << rhs._n << ", M = " << rhs._m << "):\n"
+                   << "  Update      # calls: "   << rhs._update_count     << '\n'
+                   << "  Predictions # calls: "   << rhs._prediction_count << '\n'
+                   << " [S] _state:\n"            << rhs.state()           << line;
+            if (o)
+            {
+                stream << " [O] _observation:\n"  << (*o)                  << line;
+            }
+            stream << " [P] _prediction_error:\n" << rhs._prediction_error << line
+                   << " [G] _gain:\n"             << rhs._gain             << line;
+            return stream;
+        }
+
+        /** print helper for conciseness
+         */
+        void print_state_to(std::ostream & stream)
+        {
+            stream << *this;
+        }
+
+    //! Private methods
+    private:
+        //! `I` of size `n`, only used by the constructor
+        static matrix_t identity(const size_t n)
+        {
+            matrix_t matrix(n, n, T(0));
+            for (size_t i = 0UL; i < n; ++i)
+            {
+                matrix(i, i) = T(1);
+            }
+            return matrix;
+        }
+
+        //! throws `std::invalid_argument` with `message` if `matrix` is not `rows x columns`
+        static void check_dimensions(const matrix_t & matrix, const size_t rows, const size_t columns, const char * message)
+        {
+            if (matrix.rows() != rows || matrix.columns() != columns)
+            {
+                throw std::invalid_argument(std::string("kafi::dynamic_kafi: ") + message);
+            }
+        }
+
+        /** \brief A check if the flag `_new_data_available` is true and flips it
+         */
+        bool new_data_available()
+        {
+            if (_new_data_available) {
+                _new_data_available = false;
+                return true;
+            } else {
+                return false;
+            }
+        }
+
+        //! `s_t`, the input of `_f` and `_h`
+        view_t & state()
+        {
+            return _states[_current_state];
+        }
+
+        //! `s_t`, the input of `_f` and `_h`
+        const view_t & state() const
+        {
+            return _states[_current_state];
+        }
+
+        //! the view which is written by `_f`, it never aliases dynamic_kafi::state()
+        view_t & next_state()
+        {
+            return _states[1UL - _current_state];
+        }
+
+        /** \brief Makes dynamic_kafi::next_state() the current state, see kafi::swap_states()
+         */
+        void swap_states()
+        {
+            _current_state = 1UL - _current_state;
+        }
+
+        /** \brief Applying the prediction formulae, `P = F * P * trans(F) + Q` without temporaries
+         *
+         * In the large-state mode by util::blocked_propagation, otherwise by blaze
+         *
+         * Modifying:
+         *     * `_prediction_error`
+         *     * `_states`
+         *     * `_prediction_count`
+         */
+        void apply_prediction()
+        {
+            // F at the current state and f(state) in a single call if `_f` is fused
+            _f.evaluate(state(), next_state(), _f_jacobian_temp);
+            const view_t & F = _f_jacobian_temp;
+
+            if (_propagation)
+            {
+                (*_propagation)(F, _prediction_error, _process_noise, _f_product_temp);
+            }
+            else
+            {
+                _f_product_temp   = F * _prediction_error;
+                _prediction_error = _f_product_temp * blaze::trans(F);
+                _prediction_error += _process_noise;
+            }
+            swap_states();
+            _prediction_count++;
+        }
+
+        /** \brief Applying the update formulae, the same as kafi::apply_update() without temporaries
+         *
+         * **Invariant**:
+         *     * `_observation` has to be initialized, implemented through dynamic_kafi::new_data_available()
+         *
+         * Modifying:
+         *     * `_gain`
+         *     * `_states`
+         *     * `_prediction_error`
+         *     * `_update_count`
+         *     * the preallocated temporaries
+         */
+        void apply_update()
+        {
+            // h(state) and H in a single call if `_h` is fused
+            _h.evaluate(state(), _h_temp, _h_jacobian_temp);
+            const view_t & H = _h_jacobian_temp;
+            std::shared_ptr<mx1_vector> o = _observation.lock();
+
+            // P * H^T is shared by the innovation covariance and the gain
+            _h_trans_temp        = blaze::trans(H);
+            _gain_numerator_temp = _prediction_error * _h_trans_temp;
+
+            _innovation_covariance_temp  = H * _gain_numerator_temp;
+            _innovation_covariance_temp += _sensor_noise;
+            _innovation_work_temp        = _innovation_covariance_temp;
+            util::gauss_jordan_eliminate(_innovation_work_temp, _innovation_inverse_temp);
+            _gain = _gain_numerator_temp * _innovation_inverse_temp;
+
+            _innovation_temp  = *o;
+            _innovation_temp -= _h_temp;
+            _correction_temp  = _gain * _innovation_temp;
+            state()          += _correction_temp;
+
+            // (I - G * H) * P = P - G * (H * P), O(N^2 M) instead of O(N^3)
+            _h_p_temp          = H * _prediction_error;
+            _prediction_error -= _gain * _h_p_temp;
+            _update_count++;
+        }
+
+    // member
+    private:
+        //! state dimension
+        const size_t                        _n;
+        //! sensor dimension
+        const size_t                        _m;
+        //! state transition function
+        const dynamic_jacobian_function<T>  _f;
+        //! prediction scaling function
+        const dynamic_jacobian_function<T>  _h;
+        //! the only allocation of the filter, every following view points into it
+        util::arena<T>                      _arena;
+
+        //       matrices
+        //! `s_t` (at time `t`) and the preallocated output of `_f`, see dynamic_kafi::swap_states()
+        std::array<view_t, 2> _states;
+        //! index of `s_t` in `_states`
+        size_t                _current_state;
+        //! `P_t`
+        view_t _prediction_error;
+        //! `G_t`
+        view_t _gain;
+
+        // const matrices
+        //! `Q` (covariance of real world)
+        view_t _process_noise;
+        //! `cN` (covariance of sensors)
+        view_t _sensor_noise;
+
+        // preallocated temporaries
+        //! jacobian of `_f`
+        view_t _f_jacobian_temp;
+        //! `F * P`
+        view_t _f_product_temp;
+        //! `h(state)`
+        view_t _h_temp;
+        //! jacobian of `_h`
+        view_t _h_jacobian_temp;
+        //! `trans(H)`
+        view_t _h_trans_temp;
+        //! `P * trans(H)`
+        view_t _gain_numerator_temp;
+        //! `H * P * trans(H) + cN`
+        view_t _innovation_covariance_temp;
+        //! copy of the innovation covariance, destroyed by util::gauss_jordan_eliminate()
+        view_t _innovation_work_temp;
+        //! `inv(H * P * trans(H) + cN)`
+        view_t _innovation_inverse_temp;
+        //! `o - h(state)`
+        view_t _innovation_temp;
+        //! `G * (o - h(state))`
+        view_t _correction_temp;
+        //! `H * P`
+        view_t _h_p_temp;
+
+        //! the large-state mode, `nullptr` if the blaze products are used
+        std::unique_ptr< util::blocked_propagation<T> > _propagation;
+
+        //! `o_t` (reference, the caller is responsible for the allocation)
+        std::weak_ptr< mx1_vector >         _observation;
+        //! used to run the dynamic_kafi::apply_update() function, changed in dynamic_kafi::new_data_available()
+        bool                                _new_data_available;
+        // logging
+        //! used for logging purposes, tracks how often dynamic_kafi::apply_prediction() was run
+        size_t                              _prediction_count;
+        //! used for logging purposes, tracks how often dynamic_kafi::apply_update() was run
+        size_t                              _update_count;
+};
+
+} // namespace kafi
+
+/*! @} End of Doxygen Groups*/
+#endif // DYNAMIC_KAFI_H
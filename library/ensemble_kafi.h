@@ -0,0 +1,650 @@
+// Copyright 2018 municHMotorsport e.V. <info@munichmotorsport.de>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ENSEMBLE_KAFI_H
+#define ENSEMBLE_KAFI_H
+
+#include <array>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+#include "jacobian_function.h"
+#include "small_matrix.h"
+#include "tile_pool.h"
+#include "util.h"
+#include "autogen-KAFI-macros.h"
+
+/*!
+ *  \addtogroup kafi
+ *  @{
+ */
+
+namespace kafi {
+
+/** \brief An ensemble Kalman filter, the models are only the functions `f` and `h` of kafi::jacobian_function
+ *
+ * The state distribution is represented by `K` samples (members), which are propagated through `f` with a sample
+ * of the process noise each. The covariance is never formed or propagated, the analysis only needs the anomalies
+ * of the members and their images under `h`: the gain `Xa * trans(Ya) * inv(Ya * trans(Ya) + (K - 1) * cN)` is a
+ * rank `K` product and only an `M x M` matrix is inverted. Every member is updated with its own perturbed
+ * observation (stochastic EnKF), the perturbations are centered. The process noise samples are products with the
+ * dense root of `Q`, so a step costs `O(N^2 * K + N * K * M + M^3)` and `K` calls of `f` instead of the `O(N^3)`
+ * of kafi::kafi, which only pays off for `K` well below `N`.
+ *
+ * The members are stored structure of arrays, the `N x K` matrix has a row per state element, so the means,
+ * the anomalies and the sample covariances run over contiguous rows. The `N x K` and `N x N` matrices are
+ * allocated once on the heap in the constructor, like the ones of kafi::dynamic_kafi, so large states don't
+ * have to fit on the stack. The members are propagated in contiguous ranges on a util::tile_pool, which is
+ * started in the constructor. With more than one worker `f` and `h` are called concurrently and have to be safe
+ * to call from multiple threads. Every member draws from its own random number generator, the members see the
+ * same random draws for any number of workers and the results are equal up to rounding.
+ *
+ * Template arguments:
+ * * `N`  = state dimensions
+ * * `M`  = sensor dimensions
+ * * `K`  = ensemble size, at least `2`
+ * * `T`  = floating point scalar type (default: `double`)
+ *
+ * See examples at [tests/equivalence_tests.cc](../../tests/equivalence_tests.cc)
+ */
+template< size_t   N            // state  dimensions (N x 1)
+        , size_t   M            // sensor dimensions (M x 1)
+        , size_t   K            // ensemble size
+        , typename T = double > // scalar type
+class ensemble_kafi {
+
+    static_assert(K >= 2UL, "kafi::ensemble_kafi needs at least two members for a sample covariance");
+
+    // typenames
+    public:
+        //! self type for conciseness
+        using self_t     = ensemble_kafi<N,M,K,T>;
+        //! scalar type of the state, the models and the propagation
+        using value_t    = T;
+        //! copied typename for conciseness
+        using nx1_vector = typename jacobian_function<N,M,T>::nx1_vector;
+        //! copied typename for conciseness
+        using mx1_vector = typename jacobian_function<N,M,T>::mx1_vector;
+        //! copied typename for conciseness
+        using nxm_matrix = typename jacobian_function<N,M,T>::nxm_matrix;
+        //! copied typename for conciseness
+        using mxm_matrix = typename jacobian_function<N,M,T>::mxm_matrix;
+        //! copied typename for conciseness
+        using nxn_matrix = typename jacobian_function<N,M,T>::nxn_matrix;
+        //! heap allocated matrix of the large resources, e.g. the root of `Q`
+        using matrix_t   = blaze::DynamicMatrix<T, blaze::rowMajor>;
+        //! the members, `(N x K)` with a row per state element
+        using nxk_matrix = matrix_t;
+        //! the images of the members under `h`, `(M x K)` with a row per sensor
+        using mxk_matrix = matrix_t;
+        //! state transition `f`, the same type as the one of kafi::jacobian_function
+        using f_func     = typename jacobian_function<N,N,T>::func;
+        //! prediction scaling `h`, the same type as the one of kafi::jacobian_function
+        using h_func     = typename jacobian_function<N,M,T>::func;
+        /** \brief Shorthand for a useful return type for the kalman filter, references valid until the next step()
+         *  * `const nx1_vector & = std::get<0>(x)` = ensemble mean
+         *  * `const nxk_matrix & = std::get<1>(x)` = anomalies, the members minus the mean, see ensemble_kafi::prediction_error()
+         *  * `const nxm_matrix & = std::get<2>(x)` = gain
+         */
+        using return_t   = std::tuple<const nx1_vector &,
+                                      const nxk_matrix &,
+                                      const nxm_matrix &>;
+
+    // constructors
+    public:
+
+        /** \brief Default constructor
+         *
+         * Arguments:
+         * * `f_func f`: state transition function, e.g. `jacobian_function<N,N,T>::function()`
+         * * `h_func h`: prediction scaling function, e.g. `jacobian_function<N,M,T>::function()`
+         * * the state and the noise matrices are the same as the ones of kafi::kafi
+         * * `const size_t workers`: threads which propagate the members, including the calling thread
+         * * `const unsigned int seed`: seed of the random number generators of the members
+         *
+         * The members are drawn around `starting_state` with the identity as covariance
+         */
+        ensemble_kafi(      f_func       f
+                    ,       h_func       h
+                    , const nx1_vector & starting_state
+                    , const nxn_matrix & process_noise
+                    , const mxm_matrix & sensor_noise
+                    , const size_t       workers = 1UL
+                    , const unsigned int seed    = 0U)
+        : ensemble_kafi<N,M,K,T>(std::move(f)
+                               , std::move(h)
+                               , starting_state
+                               , cholesky_root(process_noise)
+                               , sensor_noise
+                               , matrix_t()
+                               , workers
+                               , seed)
+        { }
+
+        /**
+         * \brief The same as the default constructor, but the members are drawn with the covariance `prediction_error`
+         */
+        ensemble_kafi(      f_func       f
+                    ,       h_func       h
+                    , const nx1_vector & starting_state
+                    , const nxn_matrix & process_noise
+                    , const mxm_matrix & sensor_noise
+                    , const nxn_matrix & prediction_error
+                    , const size_t       workers = 1UL
+                    , const unsigned int seed    = 0U)
+        : ensemble_kafi<N,M,K,T>(std::move(f)
+                               , std::move(h)
+                               , starting_state
+                               , cholesky_root(process_noise)
+                               , sensor_noise
+                               , cholesky_root(prediction_error)
+                               , workers
+                               , seed)
+        { }
+
+        /**
+         * \brief The same as the default constructor, but `process_noise` is `(N x N)` on the heap, e.g. for large states
+         *
+         * Throws `std::invalid_argument` if `process_noise` is not `(N x N)`
+         */
+        ensemble_kafi(      f_func       f
+                    ,       h_func       h
+                    , const nx1_vector & starting_state
+                    , const matrix_t &   process_noise
+                    , const mxm_matrix & sensor_noise
+                    , const size_t       workers = 1UL
+                    , const unsigned int seed    = 0U)
+        : ensemble_kafi<N,M,K,T>(std::move(f)
+                               , std::move(h)
+                               , starting_state
+                               , cholesky_root(process_noise)
+                               , sensor_noise
+                               , matrix_t()
+                               , workers
+                               , seed)
+        { }
+
+        //! Copy constructor is deleted because ensemble_kafi owns multiple different potentially big matrices
+        ensemble_kafi(const self_t & other) = delete;
+        //! Move constructor is deleted like the one of kafi::kafi
+        ensemble_kafi(const self_t && other) = delete;
+
+    // methods
+    public:
+        /**
+         * The same as kafi::set_current_observation()
+         */
+        void set_current_observation(std::shared_ptr<mx1_vector> observation)
+        {
+            _observation = observation;
+            _new_data_available = true;
+        }
+
+        //! number of threads which propagate the members, including the calling thread
+        size_t workers() const
+        {
+            return _pool->workers();
+        }
+
+        /** \brief The sample covariance `Xa * trans(Xa) / (K - 1)` of the anomalies `Xa`
+         *
+         * Costs `O(N^2 * K)`, the filter itself never needs it.
+         */
+        matrix_t prediction_error() const
+        {
+            matrix_t P(N, N);
+            const T scale = T(1) / static_cast<T>(K - 1UL);
+            for (size_t row = 0UL; row < N; ++row)
+            {
+                for (size_t col = row; col < N; ++col)
+                {
+                    T sum = T(0);
+                    for (size_t member = 0UL; member < K; ++member)
+                    {
+                        sum += _anomalies(row, member) * _anomalies(col, member);
+                    }
+                    P(row, col) = sum * scale;
+                    P(col, row) = sum * scale;
+                }
+            }
+            return P;
+        }
+
+        //! the members, a column per member
+        const nxk_matrix & members() const
+        {
+            return _members;
+        }
+
+        /**\brief Main function that runs the Kalman Filter based on new or old observation, and apply the prediction and update step
+         *
+         * Modifying:
+         *     * `_gain`
+         *     * `_members`
+         *     * `_state`
+         *
+         * Return:
+         *     * tuple of references, valid until the next step()
+         *         - ensemble mean
+         *         - anomalies
+         *         - gain
+         */
+        return_t step()
+        {
+            apply_prediction();
+            if (new_data_available())
+            {
+                apply_update();
+            }
+
+            DEBUG_MSG_KAFI(*this);
+            return return_t(_state, _anomalies, _gain);
+        }
+
+        /** \brief Overloading stream operator for logging purposes, the same format as kafi::kafi
+         */
+        friend std::ostream & operator<<(std::ostream& stream, const self_t & rhs)
+        {
+            std::shared_ptr<mx1_vector> o = rhs._observation.lock();
+            const char * line = "============================\n";
+            stream << "Kafi (ensemble):\n"
+                   << "  Update      # calls: "   << rhs._update_count     << '\n'
+                   << "  Predictions # calls: "   << rhs._prediction_count << '\n'
+                   << " [S] _state:\n"            << rhs._state            << line;
+            if (o)
+            {
+                stream << " [O] _observation:\n"  << (*o)                  << line;
+            }
+            stream << " [P] _prediction_error:\n" << rhs.prediction_error() << line
+                   << " [G] _gain:\n"             << rhs._gain             << line;
+            return stream;
+        }
+
+        /** print helper for conciseness
+         */
+        void print_state_to(std::ostream & stream)
+        {
+            stream << *this;
+        }
+
+    //! Private methods
+    private:
+        /** \brief Allocates the resources, `process_root` and `prediction_root` are lower triangular roots
+         *
+         * An empty `prediction_root` draws the members with the identity as covariance.
+         */
+        ensemble_kafi(      f_func       f
+                    ,       h_func       h
+                    , const nx1_vector & starting_state
+                    ,       matrix_t     process_root
+                    , const mxm_matrix & sensor_noise
+                    , const matrix_t &   prediction_root
+                    , const size_t       workers
+                    , const unsigned int seed)
+        : _f(std::move(f))
+        , _h(std::move(h))
+        , _pool(new util::tile_pool(workers))
+        , _input_temp(_pool->workers())
+        , _f_output_temp(_pool->workers())
+        , _h_output_temp(_pool->workers())
+        , _sample_temp(_pool->workers())
+        , _noise_temp(_pool->workers())
+        , _process_root(std::move(process_root))
+        , _sensor_root(0)
+        , _sensor_noise(sensor_noise)
+        , _observed(M, K)
+        , _observed_anomalies(M, K)
+        , _innovations(M, K)
+        , _observed_mean_temp(0)
+        , _innovation_covariance_temp(0)
+        , _innovation_inverse_temp(0)
+        , _cross_covariance_temp(0)
+        , _members(N, K)
+        , _anomalies(N, K)
+        , _state(0)
+        , _gain(0)
+        , _new_data_available(false)
+        , _prediction_count(0)
+        , _update_count(0)
+        {
+            util::cholesky_factor(sensor_noise, _sensor_root);
+
+            // consecutive seeds of an LCG give linearly correlated streams, seed_seq scrambles `seed` and `member`
+            for (size_t member = 0UL; member < K; ++member)
+            {
+                std::seed_seq sequence{ seed, static_cast<unsigned int>(member) };
+                _generators[member].seed(sequence);
+            }
+
+            // s + root(P) * sample
+            nx1_vector & sample = _sample_temp[0];
+            for (size_t member = 0UL; member < K; ++member)
+            {
+                if (prediction_root.rows() == 0UL)
+                {
+                    draw_normal(member, sample);
+                }
+                else
+                {
+                    draw_sample(member, prediction_root, sample);
+                }
+                for (size_t row = 0UL; row < N; ++row)
+                {
+                    _members(row, member) = starting_state(row, 0) + sample(row, 0);
+                }
+            }
+            update_statistics();
+        }
+
+        /** \brief Lower triangular root of a symmetric positive semidefinite `(N x N)` matrix, allocated on the heap
+         *
+         * Throws `std::invalid_argument` if `input` is not `(N x N)` or not positive semidefinite
+         */
+        template< typename Matrix >
+        static matrix_t cholesky_root(const Matrix & input)
+        {
+            if (input.rows() != N || input.columns() != N)
+            {
+                throw std::invalid_argument("kafi::ensemble_kafi needs (N x N) covariance matrices");
+            }
+            matrix_t root(N, N);
+            util::cholesky_factor(input, root);
+            return root;
+        }
+
+        /** \brief A check if the flag `_new_data_available` is true and flips it
+         */
+        bool new_data_available()
+        {
+            if (_new_data_available) {
+                _new_data_available = false;
+                return true;
+            } else {
+                return false;
+            }
+        }
+
+        /** \brief Standard normal `z` from the generator of `member`
+         */
+        template< typename Vector >
+        void draw_normal(const size_t member, Vector & sample)
+        {
+            std::minstd_rand &           generator = _generators[member];
+            std::normal_distribution<T> & normal   = _normals[member];
+            for (size_t row = 0UL; row < sample.rows(); ++row)
+            {
+                sample(row, 0) = normal(generator);
+            }
+        }
+
+        /** \brief `sample = root * z` with standard normal `z` from the generator of `member`, `root` is lower triangular
+         */
+        template< typename Root
+                , typename Vector >
+        void draw_sample(const size_t member, const Root & root, Vector & sample)
+        {
+            draw_normal(member, sample);
+            const size_t rows = sample.rows();
+            // in place from the last row, every row only reads the rows above
+            for (size_t row = rows; row-- > 0UL; )
+            {
+                T value = T(0);
+                for (size_t col = 0UL; col <= row; ++col)
+                {
+                    value += root(row, col) * sample(col, 0);
+                }
+                sample(row, 0) = value;
+            }
+        }
+
+        /** \brief Runs `kernel(member, worker)` for all members, every worker takes a contiguous range
+         */
+        template< typename Kernel >
+        void for_each_member(const Kernel & member_kernel)
+        {
+            auto kernel = [&member_kernel](const size_t worker, const size_t workers)
+            {
+                const size_t begin = K * worker / workers;
+                const size_t end   = K * (worker + 1UL) / workers;
+                for (size_t member = begin; member < end; ++member)
+                {
+                    member_kernel(member, worker);
+                }
+            };
+            _pool->run(kernel);
+        }
+
+        /** \brief The mean `s` and the anomalies `Xa` of the members, row by row
+         *
+         * Modifying:
+         *     * `_state`
+         *     * `_anomalies`
+         */
+        void update_statistics()
+        {
+            for (size_t row = 0UL; row < N; ++row)
+            {
+                T sum = T(0);
+                for (size_t member = 0UL; member < K; ++member)
+                {
+                    sum += _members(row, member);
+                }
+                const T mean = sum / static_cast<T>(K);
+                _state(row, 0) = mean;
+                for (size_t member = 0UL; member < K; ++member)
+                {
+                    _anomalies(row, member) = _members(row, member) - mean;
+                }
+            }
+        }
+
+        /** \brief `x_k = f(x_k) + root(Q) * z_k` for every member
+         *
+         * Modifying:
+         *     * `_members`
+         *     * `_state`
+         *     * `_anomalies`
+         *     * `_prediction_count`
+         */
+        void apply_prediction()
+        {
+            for_each_member([this](const size_t member, const size_t worker)
+            {
+                nx1_vector & input  = _input_temp[worker];
+                nx1_vector & output = _f_output_temp[worker];
+                nx1_vector & sample = _sample_temp[worker];
+                for (size_t row = 0UL; row < N; ++row)
+                {
+                    input(row, 0) = _members(row, member);
+                }
+                _f(input, output);
+                draw_sample(member, _process_root, sample);
+                for (size_t row = 0UL; row < N; ++row)
+                {
+                    _members(row, member) = output(row, 0) + sample(row, 0);
+                }
+            });
+            update_statistics();
+            _prediction_count++;
+        }
+
+        /** \brief Updates every member with its perturbed observation and the gain of the anomalies
+         *
+         * **Invariant**:
+         *     * `_observation` has to be initialized, implemented through ensemble_kafi::new_data_available()
+         *
+         * Modifying:
+         *     * `_gain`
+         *     * `_members`
+         *     * `_state`
+         *     * `_anomalies`
+         *     * `_update_count`
+         *     * the preallocated temporaries
+         */
+        void apply_update()
+        {
+            std::shared_ptr<mx1_vector> o = _observation.lock();
+
+            // h(x_k) and o + root(cN) * z_k - h(x_k) for every member
+            for_each_member([this, &o](const size_t member, const size_t worker)
+            {
+                nx1_vector & input  = _input_temp[worker];
+                mx1_vector & output = _h_output_temp[worker];
+                mx1_vector & noise  = _noise_temp[worker];
+                for (size_t row = 0UL; row < N; ++row)
+                {
+                    input(row, 0) = _members(row, member);
+                }
+                _h(input, output);
+                draw_sample(member, _sensor_root, noise);
+                for (size_t row = 0UL; row < M; ++row)
+                {
+                    _observed(row, member)    = output(row, 0);
+                    _innovations(row, member) = (*o)(row, 0) + noise(row, 0) - output(row, 0);
+                }
+            });
+
+            // means of the images and of the perturbations, the innovations are centered on `o - mean(h)`
+            const T scale = T(1) / static_cast<T>(K);
+            for (size_t row = 0UL; row < M; ++row)
+            {
+                T observed_sum   = T(0);
+                T innovation_sum = T(0);
+                for (size_t member = 0UL; member < K; ++member)
+                {
+                    observed_sum   += _observed(row, member);
+                    innovation_sum += _innovations(row, member);
+                }
+                const T observed_mean = observed_sum * scale;
+                const T perturbation  = innovation_sum * scale - ((*o)(row, 0) - observed_mean);
+                _observed_mean_temp(row, 0) = observed_mean;
+                for (size_t member = 0UL; member < K; ++member)
+                {
+                    _observed_anomalies(row, member) = _observed(row, member) - observed_mean;
+                    _innovations(row, member)       -= perturbation;
+                }
+            }
+
+            // Ya * trans(Ya) / (K - 1) + cN and Xa * trans(Ya) / (K - 1), dot products of contiguous rows
+            const T sample_scale = T(1) / static_cast<T>(K - 1UL);
+            for (size_t row = 0UL; row < M; ++row)
+            {
+                for (size_t col = row; col < M; ++col)
+                {
+                    T sum = T(0);
+                    for (size_t member = 0UL; member < K; ++member)
+                    {
+                        sum += _observed_anomalies(row, member) * _observed_anomalies(col, member);
+                    }
+                    const T value = sum * sample_scale + _sensor_noise(row, col);
+                    _innovation_covariance_temp(row, col) = value;
+                    _innovation_covariance_temp(col, row) = value;
+                }
+            }
+            for (size_t row = 0UL; row < N; ++row)
+            {
+                for (size_t col = 0UL; col < M; ++col)
+                {
+                    T sum = T(0);
+                    for (size_t member = 0UL; member < K; ++member)
+                    {
+                        sum += _anomalies(row, member) * _observed_anomalies(col, member);
+                    }
+                    _cross_covariance_temp(row, col) = sum * sample_scale;
+                }
+            }
+
+            util::inverse(_innovation_covariance_temp, _innovation_inverse_temp);
+            _gain     = _cross_covariance_temp * _innovation_inverse_temp;
+            _members += _gain * _innovations;
+            update_statistics();
+            _update_count++;
+        }
+
+    // member
+    private:
+        // functions with their respective preallocated resources
+
+        //! state transition function
+        const f_func                   _f;
+        //! prediction scaling function
+        const h_func                   _h;
+        //! propagates the members, the threads are started in the constructor
+        std::unique_ptr< util::tile_pool > _pool;
+        //! a member as input of `f` and `h`, per worker
+        std::vector< nx1_vector >      _input_temp;
+        //! output of `f`, per worker
+        std::vector< nx1_vector >      _f_output_temp;
+        //! output of `h`, per worker
+        std::vector< mx1_vector >      _h_output_temp;
+        //! process noise sample, per worker
+        std::vector< nx1_vector >      _sample_temp;
+        //! sensor noise sample, per worker
+        std::vector< mx1_vector >      _noise_temp;
+        //! a random number generator per member seeded through `std::seed_seq`, the same draws per member for any number of workers
+        std::array< std::minstd_rand, K >            _generators;
+        //! a normal distribution per member, it caches every second sample
+        std::array< std::normal_distribution<T>, K > _normals;
+
+        // const matrices
+        //! lower triangular root of `Q`, `(N x N)`
+              matrix_t                 _process_root;
+        //! lower triangular root of `cN`
+              mxm_matrix               _sensor_root;
+        //! `cN` (covariance of sensors)
+        const mxm_matrix               _sensor_noise;
+
+        // preallocated resources of the analysis
+        //! `h(x_k)`, a row per sensor
+              mxk_matrix               _observed;
+        //! `Ya`, the images minus their mean
+              mxk_matrix               _observed_anomalies;
+        //! `o + root(cN) * z_k - h(x_k)`, the perturbations are centered
+              mxk_matrix               _innovations;
+        //! mean of the images
+              mx1_vector               _observed_mean_temp;
+        //! `Ya * trans(Ya) / (K - 1) + cN`
+              mxm_matrix               _innovation_covariance_temp;
+        //! inverse of the innovation covariance, see util::inverse()
+              mxm_matrix               _innovation_inverse_temp;
+        //! `Xa * trans(Ya) / (K - 1)`
+              nxm_matrix               _cross_covariance_temp;
+
+        //       matrices
+        //! `x_k`, a column per member
+              nxk_matrix               _members;
+        //! `Xa`, the members minus their mean
+              nxk_matrix               _anomalies;
+        //! `s_t`, mean of the members
+              nx1_vector               _state;
+        //! `o_t` (reference, the caller is responsible for the allocation)
+        std::weak_ptr< mx1_vector >    _observation;
+        //! `G_t`
+              nxm_matrix               _gain;
+        //! used to run the ensemble_kafi::apply_update() function, changed in ensemble_kafi::new_data_available()
+              bool                     _new_data_available;
+        // logging
+        //! used for logging purposes, tracks how often ensemble_kafi::apply_prediction() was run
+              size_t                   _prediction_count;
+        //! used for logging purposes, tracks how often ensemble_kafi::apply_update() was run
+              size_t                   _update_count;
+};
+
+} // namespace kafi
+
+/*! @} End of Doxygen Groups*/
+#endif // ENSEMBLE_KAFI_H
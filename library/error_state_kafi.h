@@ -0,0 +1,332 @@
+// Copyright 2018 municHMotorsport e.V. <info@munichmotorsport.de>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ERROR_STATE_KAFI_H
+#define ERROR_STATE_KAFI_H
+
+#include <array>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <tuple>
+#include "jacobian_function.h"
+#include "kafi.h"
+
+/*!
+ *  \addtogroup kafi
+ *  @{
+ */
+
+namespace kafi {
+
+/** \brief An error-state (indirect) extended Kalman filter, the nominal state is integrated at full rate
+ *
+ * The filter keeps the nominal state `x` with `N` dimensions and a kafi::kafi over its error `dx` with `E`
+ * dimensions, e.g. a quaternion attitude in `x` and a small rotation vector in `dx`. Every step integrates the
+ * nominal state with the integrator hook, e.g. a strapdown integration of an IMU sample. The error is zero
+ * between updates, so the error filter only propagates its covariance with the error dynamics `F`, with
+ * error_state_kafi::set_covariance_rate() every `K` steps, see kafi::set_covariance_rate().
+ *
+ * The error dynamics (`E -> E`) and the sensor model by the error (`E -> M`) are kafi::jacobian_function, only
+ * their jacobians `F` and `H` are used. Their partial derivatives are evaluated at the linearization point, an
+ * `E x 1` vector which the linearization hook derives from the nominal state, e.g. the attitude as angles.
+ * An update estimates `dx = G * (o - h(x))` in the error filter and composes it into the nominal state with
+ * the injection hook, e.g. rotates the attitude by `dx`; the error is reset to zero afterwards.
+ *
+ * Template arguments:
+ * * `N`  = nominal state dimensions
+ * * `E`  = error state dimensions
+ * * `M`  = sensor dimensions
+ * * `T`  = scalar type (default: `double`)
+ *
+ * See examples at [tests/equivalence_tests.cc](../../tests/equivalence_tests.cc)
+ */
+template< size_t   N            // nominal state dimensions (N x 1)
+        , size_t   E            // error state   dimensions (E x 1)
+        , size_t   M            // sensor        dimensions (M x 1)
+        , typename T = double > // scalar type
+class error_state_kafi {
+
+    // typenames
+    public:
+        //! self type for conciseness
+        using self_t         = error_state_kafi<N,E,M,T>;
+        //! scalar type of the states, the models and the propagation
+        using value_t        = T;
+        //! the filter of the error
+        using error_filter_t = kafi<E,M,T>;
+        //! nominal state
+        using nx1_vector     = blaze::StaticMatrix<T, N, 1UL, blaze::rowMajor>;
+        //! copied typename for conciseness, the error
+        using ex1_vector     = typename error_filter_t::nx1_vector;
+        //! copied typename for conciseness
+        using mx1_vector     = typename error_filter_t::mx1_vector;
+        //! copied typename for conciseness, `H` by the error
+        using mxe_matrix     = typename error_filter_t::mxn_matrix;
+        //! copied typename for conciseness, the gain
+        using exm_matrix     = typename error_filter_t::nxm_matrix;
+        //! copied typename for conciseness
+        using mxm_matrix     = typename error_filter_t::mxm_matrix;
+        //! copied typename for conciseness, the error covariance and `F`
+        using exe_matrix     = typename error_filter_t::nxn_matrix;
+        //! integrates the nominal state over a step, the input never aliases the output
+        using integrate_func = std::function<void(const nx1_vector & nominal, nx1_vector & next)>;
+        //! `h(x)`, the predicted observation of the nominal state
+        using measure_func   = std::function<void(const nx1_vector & nominal, mx1_vector & prediction)>;
+        //! the point of the partial derivatives of `F` and `H`, derived from the nominal state
+        using linearize_func = std::function<void(const nx1_vector & nominal, ex1_vector & point)>;
+        //! composes the nominal state with the estimated error, `nominal` is updated in place
+        using inject_func    = std::function<void(nx1_vector & nominal, const ex1_vector & error)>;
+        /** \brief Shorthand for a useful return type for the kalman filter, copies like kafi::kafi::return_t
+         *  * `const nx1_vector & = std::get<0>(x)` = nominal state
+         *  * `const exe_matrix & = std::get<1>(x)` = error covariance, as of the last propagation
+         *  * `const exm_matrix & = std::get<2>(x)` = gain
+         */
+        using return_t       = std::tuple<const nx1_vector,
+                                          const exe_matrix,
+                                          const exm_matrix>;
+
+    // constructors
+    public:
+
+        /** \brief Default constructor
+         *
+         * Arguments:
+         * * `integrate_func integrate`: integrates the nominal state over a step
+         * * `const jacobian_function< E, E, T > error_transition`: error dynamics with the jacobian `F`
+         * * `measure_func measure`: `h(x)`, the predicted observation of the nominal state
+         * * `const jacobian_function< E, M, T > error_measurement`: sensor model by the error with the jacobian `H`
+         * * `linearize_func linearize`: derives the linearization point of `F` and `H` from the nominal state
+         * * `inject_func inject`: composes the nominal state with the estimated error
+         * * `nx1_vector starting_state`: initial nominal state
+         * * `const exe_matrix & process_noise`: `Q` of the error over a single step
+         * * `const mxm_matrix & sensor_noise`: the sensor covariance noise matrix
+         *
+         * Initializing the error covariance to the identity matrix via util::create_identity<E, blaze::rowMajor, T>()
+         */
+        error_state_kafi(      integrate_func           integrate
+                       , const jacobian_function<E,E,T> error_transition
+                       ,       measure_func             measure
+                       , const jacobian_function<E,M,T> error_measurement
+                       ,       linearize_func           linearize
+                       ,       inject_func              inject
+                       ,       nx1_vector               starting_state
+                       , const exe_matrix             & process_noise
+                       , const mxm_matrix             & sensor_noise)
+        : error_state_kafi<N,E,M,T>(std::move(integrate)
+                                  , std::move(error_transition)
+                                  , std::move(measure)
+                                  , std::move(error_measurement)
+                                  , std::move(linearize)
+                                  , std::move(inject)
+                                  , starting_state
+                                  , process_noise
+                                  , sensor_noise
+                                  , util::create_identity<E, blaze::rowMajor, T>())
+        { }
+
+        /**
+         * \brief The same as the default constructor, but with custom error covariance initialization
+         */
+        error_state_kafi(      integrate_func           integrate
+                       , const jacobian_function<E,E,T> error_transition
+                       ,       measure_func             measure
+                       , const jacobian_function<E,M,T> error_measurement
+                       ,       linearize_func           linearize
+                       ,       inject_func              inject
+                       ,       nx1_vector               starting_state
+                       , const exe_matrix             & process_noise
+                       , const mxm_matrix             & sensor_noise
+                       , const exe_matrix             & prediction_error)
+        : _integrate(std::move(integrate))
+        , _error_transition(std::move(error_transition))
+        , _measure(std::move(measure))
+        , _error_measurement(std::move(error_measurement))
+        , _linearize(std::move(linearize))
+        , _inject(std::move(inject))
+        , _point_temp(0)
+        // the error is zero between updates, so is its transition; F and H are written by the fused functions
+        , _error_filter(jacobian_function<E,E,T>(
+                            [](const ex1_vector &, ex1_vector & next){ next = T(0); }
+                          , typename jacobian_function<E,E,T>::jacobi_func()
+                          , [this](const ex1_vector & error, ex1_vector & next, exe_matrix & F){ evaluate_transition(error, next, F); })
+                      , jacobian_function<E,M,T>(
+                            [this](const ex1_vector &, mx1_vector & prediction){ _measure(state(), prediction); }
+                          , typename jacobian_function<E,M,T>::jacobi_func()
+                          , [this](const ex1_vector & error, mx1_vector & prediction, mxe_matrix & H){ evaluate_measurement(error, prediction, H); })
+                      , ex1_vector(0)
+                      , process_noise
+                      , sensor_noise
+                      , prediction_error)
+        , _states{{starting_state, nx1_vector(0)}}
+        , _current_state(0UL)
+        , _update_pending(false)
+        { }
+
+        //! Copy constructor is deleted because error_state_kafi owns multiple different potentially big matrices
+        error_state_kafi(const self_t & other) = delete;
+        //! Move constructor is deleted, the error filter calls back into this object
+        error_state_kafi(const self_t && other) = delete;
+
+    // methods
+    public:
+        /**
+         * The same as kafi::set_current_observation()
+         */
+        void set_current_observation(std::shared_ptr<mx1_vector> observation)
+        {
+            _error_filter.set_current_observation(observation);
+            _update_pending = true;
+        }
+
+        /** \brief Propagates the error covariance every `steps` steps and before every update, see kafi::set_covariance_rate()
+         *
+         * `1` (default) propagates it every step. Use the ratio of the rates of the integration and the sensors,
+         * e.g. `10` for a 1 kHz IMU and 100 Hz measurements. `F` is held over the interval, the longer it is, the
+         * less it follows the nominal state.
+         */
+        void set_covariance_rate(const size_t steps)
+        {
+            _error_filter.set_covariance_rate(steps);
+        }
+
+        //! the filter of the error, e.g. for kafi::kafi::innovation()
+        const error_filter_t & error_filter() const
+        {
+            return _error_filter;
+        }
+
+        /**\brief Integrates the nominal state, steps the error filter and injects the estimated error
+         *
+         * Modifying:
+         *     * `_states`
+         *     * `_error_filter`
+         *     * `_update_pending`
+         *
+         * Return:
+         *     * tuple of
+         *         - nominal state
+         *         - error covariance
+         *         - gain
+         */
+        return_t step()
+        {
+            _integrate(state(), next_state());
+            _current_state = 1UL - _current_state;
+
+            const typename error_filter_t::return_t result = _error_filter.step();
+            if (_update_pending)
+            {
+                _update_pending = false;
+                _inject(state(), std::get<0>(result));
+                _error_filter.set_state(ex1_vector(0));
+            }
+            return std::make_tuple(state(), std::get<1>(result), std::get<2>(result));
+        }
+
+        /** \brief Overloading stream operator for logging purposes, the nominal state followed by the error filter
+         */
+        friend std::ostream & operator<<(std::ostream& stream, const self_t & rhs)
+        {
+            return stream << " [X] _nominal_state:\n" << rhs.state() << "============================\n"
+                          << rhs._error_filter;
+        }
+
+        /** print helper for conciseness
+         */
+        void print_state_to(std::ostream & stream)
+        {
+            stream << *this;
+        }
+
+    //! Private methods
+    private:
+        //! nominal state, the input of the hooks
+        nx1_vector & state()
+        {
+            return _states[_current_state];
+        }
+
+        //! nominal state, the input of the hooks
+        const nx1_vector & state() const
+        {
+            return _states[_current_state];
+        }
+
+        //! the buffer which is written by the integrator, the nominal state before the integration afterwards
+        nx1_vector & next_state()
+        {
+            return _states[1UL - _current_state];
+        }
+
+        /** \brief `F * dx` and `F` at the nominal state before the integration, the error filter calls it once per interval
+         *
+         * Modifying:
+         *     * `_point_temp`
+         */
+        void evaluate_transition(const ex1_vector & error, ex1_vector & next, exe_matrix & F)
+        {
+            _linearize(next_state(), _point_temp);
+            _error_transition.jacobian(_point_temp, F);
+            next = F * error;
+        }
+
+        /** \brief `h(x) + H * dx` and `H` at the integrated nominal state, the error filter calls it for the update
+         *
+         * Modifying:
+         *     * `_point_temp`
+         */
+        void evaluate_measurement(const ex1_vector & error, mx1_vector & prediction, mxe_matrix & H)
+        {
+            _linearize(state(), _point_temp);
+            _error_measurement.jacobian(_point_temp, H);
+            _measure(state(), prediction);
+            prediction += H * error;
+        }
+
+    // member
+    private:
+        // hooks and models of the error
+
+        //! integrates the nominal state
+        const integrate_func           _integrate;
+        //! error dynamics, its jacobian is `F`
+        const jacobian_function<E,E,T> _error_transition;
+        //! `h(x)`
+        const measure_func             _measure;
+        //! sensor model by the error, its jacobian is `H`
+        const jacobian_function<E,M,T> _error_measurement;
+        //! derives the linearization point from the nominal state
+        const linearize_func           _linearize;
+        //! composes the nominal state with `dx`
+        const inject_func              _inject;
+        //! the linearization point of the last evaluated jacobian
+              ex1_vector               _point_temp;
+
+        //! kafi::kafi over the error, which is zero between updates
+              error_filter_t           _error_filter;
+
+        //       matrices
+        //! nominal state and the preallocated output of the integrator
+              std::array<nx1_vector, 2> _states;
+        //! index of the nominal state in `_states`
+              size_t                   _current_state;
+        //! `true` from the observation until its error is injected
+              bool                     _update_pending;
+};
+
+} // namespace kafi
+
+/*! @} End of Doxygen Groups*/
+#endif // ERROR_STATE_KAFI_H
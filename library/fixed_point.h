@@ -0,0 +1,329 @@
+// Copyright 2018 municHMotorsport e.V. <info@munichmotorsport.de>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KAFI_FIXED_POINT_H
+#define KAFI_FIXED_POINT_H
+
+#include <cstdint>
+#include <limits>
+#include <ostream>
+
+namespace kafi {
+
+/** \brief Q-format fixed-point scalar for FPU-less microcontrollers
+ *
+ * Stores `value * 2^F` in the integer type `S`, every product and quotient is computed in the wider type `W`
+ * and rounded to nearest. Results which don't fit into `S` saturate instead of wrapping around.
+ *
+ * Template arguments:
+ * * `F` = number of fraction bits, e.g. `16` for Q15.16 in an `int32_t`
+ * * `S` = signed storage type (default: `int32_t`)
+ * * `W` = signed intermediate type with at least twice the bits of `S` (default: `int64_t`)
+ *
+ * Can be used as the scalar type `T` of kafi::jacobian_function and kafi::kafi. `sin`, `cos`, `sqrt` and `abs`
+ * are found by argument dependent lookup, so models should call them unqualified after `using std::cos;`.
+ *
+ * See examples in [tests/fixed_point_tests.cc](../../tests/fixed_point_tests.cc)
+ */
+template< unsigned F
+        , typename S = int32_t
+        , typename W = int64_t >
+class fixed {
+
+    static_assert(std::numeric_limits<S>::is_signed && std::numeric_limits<W>::is_signed, "fixed needs signed integers");
+    static_assert(sizeof(W) >= 2 * sizeof(S), "the intermediate type W needs at least twice the bits of S");
+    static_assert(F < sizeof(S) * 8 - 1, "too many fraction bits for the storage type S");
+
+    // typenames
+    public:
+        //! self type for conciseness
+        using self_t = fixed<F,S,W>;
+
+    // constants
+    public:
+        //! number of fraction bits
+        static constexpr unsigned fraction_bits = F;
+        //! raw representation of `1`
+        static constexpr W one = W(1) << F;
+
+    // constructors
+    public:
+        //! zero initialized, blaze relies on `T()` being zero
+        constexpr fixed()
+        : _raw(0) { }
+
+        //! implicit, so literals like `0` and `1` can be used in the models
+        constexpr fixed(const int value)
+        : _raw(saturate(W(value) * one)) { }
+
+        //! implicit, rounds to the nearest representable value and saturates
+        constexpr fixed(const double value)
+        : _raw(from_double(value)) { }
+
+        //! constructs from the raw `value * 2^F` representation
+        static constexpr self_t from_raw(const S raw)
+        {
+            self_t result;
+            result._raw = raw;
+            return result;
+        }
+
+    // methods
+    public:
+        //! raw `value * 2^F` representation
+        constexpr S raw() const
+        {
+            return _raw;
+        }
+
+        //! explicit, so no silent round trips through floating point happen in the filter
+        constexpr explicit operator double() const
+        {
+            return static_cast<double>(_raw) / static_cast<double>(one);
+        }
+
+        //! explicit, so no silent round trips through floating point happen in the filter
+        constexpr explicit operator float() const
+        {
+            return static_cast<float>(_raw) / static_cast<float>(one);
+        }
+
+        //! smallest representable step `2^-F`
+        static constexpr self_t epsilon()
+        {
+            return from_raw(1);
+        }
+
+        //! largest representable value
+        static constexpr self_t max()
+        {
+            return from_raw(std::numeric_limits<S>::max());
+        }
+
+        //! smallest representable value
+        static constexpr self_t lowest()
+        {
+            return from_raw(std::numeric_limits<S>::min());
+        }
+
+        // arithmetic
+
+        friend constexpr self_t operator+(const self_t lhs, const self_t rhs)
+        {
+            return from_raw(saturate(W(lhs._raw) + W(rhs._raw)));
+        }
+
+        friend constexpr self_t operator-(const self_t lhs, const self_t rhs)
+        {
+            return from_raw(saturate(W(lhs._raw) - W(rhs._raw)));
+        }
+
+        friend constexpr self_t operator-(const self_t value)
+        {
+            return from_raw(saturate(-W(value._raw)));
+        }
+
+        //! rounded to nearest
+        friend constexpr self_t operator*(const self_t lhs, const self_t rhs)
+        {
+            return from_raw(saturate(shift_round(W(lhs._raw) * W(rhs._raw))));
+        }
+
+        //! rounded to nearest, a division by zero saturates towards the sign of the dividend
+        friend constexpr self_t operator/(const self_t lhs, const self_t rhs)
+        {
+            return rhs._raw == 0 ? (lhs._raw < 0 ? lowest() : max())
+                                 : from_raw(saturate(divide_round(W(lhs._raw) * one, W(rhs._raw))));
+        }
+
+        self_t & operator+=(const self_t rhs) { return *this = *this + rhs; }
+        self_t & operator-=(const self_t rhs) { return *this = *this - rhs; }
+        self_t & operator*=(const self_t rhs) { return *this = *this * rhs; }
+        self_t & operator/=(const self_t rhs) { return *this = *this / rhs; }
+
+        // comparison
+
+        friend constexpr bool operator==(const self_t lhs, const self_t rhs) { return lhs._raw == rhs._raw; }
+        friend constexpr bool operator!=(const self_t lhs, const self_t rhs) { return lhs._raw != rhs._raw; }
+        friend constexpr bool operator< (const self_t lhs, const self_t rhs) { return lhs._raw <  rhs._raw; }
+        friend constexpr bool operator<=(const self_t lhs, const self_t rhs) { return lhs._raw <= rhs._raw; }
+        friend constexpr bool operator> (const self_t lhs, const self_t rhs) { return lhs._raw >  rhs._raw; }
+        friend constexpr bool operator>=(const self_t lhs, const self_t rhs) { return lhs._raw >= rhs._raw; }
+
+        /** \brief Overloading stream operator for logging purposes, prints the approximated decimal value
+         */
+        friend std::ostream & operator<<(std::ostream & stream, const self_t & rhs)
+        {
+            return stream << static_cast<double>(rhs);
+        }
+
+    //! Private methods
+    private:
+        //! clamps to the range of `S`
+        static constexpr S saturate(const W value)
+        {
+            return value > W(std::numeric_limits<S>::max()) ? std::numeric_limits<S>::max()
+                 : value < W(std::numeric_limits<S>::min()) ? std::numeric_limits<S>::min()
+                 : static_cast<S>(value);
+        }
+
+        //! `value / 2^F` rounded to nearest (ties away from zero)
+        static constexpr W shift_round(const W value)
+        {
+            return value >= 0 ?  ( ( value + one / 2) / one)
+                              : -( (-value + one / 2) / one);
+        }
+
+        //! `lhs / rhs` rounded to nearest (ties away from zero)
+        static constexpr W divide_round(const W lhs, const W rhs)
+        {
+            return (lhs < 0) == (rhs < 0) ? ( lhs + rhs / 2) / rhs
+                                          : ( lhs - rhs / 2) / rhs;
+        }
+
+        //! saturating conversion, the clamping happens in `double` to avoid an undefined cast
+        static constexpr S from_double(const double value)
+        {
+            return value * one >= static_cast<double>(std::numeric_limits<S>::max()) ? std::numeric_limits<S>::max()
+                 : value * one <= static_cast<double>(std::numeric_limits<S>::min()) ? std::numeric_limits<S>::min()
+                 : static_cast<S>(value >= 0 ? value * one + 0.5 : value * one - 0.5);
+        }
+
+    // member
+    private:
+        //! `value * 2^F`
+        S _raw;
+};
+
+template< unsigned F, typename S, typename W >
+constexpr W fixed<F,S,W>::one;
+
+/** \brief Absolute value
+ */
+template< unsigned F, typename S, typename W >
+constexpr fixed<F,S,W> abs(const fixed<F,S,W> value)
+{
+    return value < fixed<F,S,W>(0) ? -value : value;
+}
+
+/** \brief Square root with the integer Newton iteration, negative values return `0`
+ */
+template< unsigned F, typename S, typename W >
+fixed<F,S,W> sqrt(const fixed<F,S,W> value)
+{
+    if (value.raw() <= 0)
+    {
+        return fixed<F,S,W>(0);
+    }
+    // sqrt(raw * 2^F) = sqrt(value) * 2^F
+    const W radicand = W(value.raw()) * fixed<F,S,W>::one;
+    W root = radicand;
+    W next = (root + 1) / 2;
+    while (next < root)
+    {
+        root = next;
+        next = (root + radicand / root) / 2;
+    }
+    return fixed<F,S,W>::from_raw(static_cast<S>(root));
+}
+
+namespace detail {
+
+    /** \brief `sin(value)`, or `sin(value + pi/2)` with `phase`, see kafi::sin() and kafi::cos()
+     *
+     * The phase is added after the range reduction to `[-pi, pi]`, so the cosine of arguments near the top of
+     * the range doesn't saturate.
+     */
+    template< unsigned F, typename S, typename W >
+    fixed<F,S,W> sine(const fixed<F,S,W> value, const bool phase)
+    {
+        // internal precision, x^2 with |x| < 2 still fits into W
+        constexpr unsigned P   = sizeof(S) * 8 - 2;
+        static_assert(F <= P, "the argument is shifted by P - F fraction bits");
+        constexpr W        one = W(1) << P;
+        constexpr W pi         = W(3.14159265358979323846 * one);
+        constexpr W half_pi    = W(1.57079632679489661923 * one);
+        constexpr W two_pi     = W(6.28318530717958647692 * one);
+        constexpr W c3         = W(-one / 6.0);
+        constexpr W c5         = W( one / 120.0);
+        constexpr W c7         = W(-one / 5040.0);
+        constexpr W c9         = W( one / 362880.0);
+
+        // rounded to nearest (ties away from zero) Q(P) multiplication
+        const auto multiply = [](const W lhs, const W rhs) -> W
+        {
+            const W product = lhs * rhs;
+            return product >= 0 ? (product + one / 2) / one : -((-product + one / 2) / one);
+        };
+
+        // to [-pi, pi]
+        W x = W(value.raw()) * (W(1) << (P - F));
+        if (x > pi || x < -pi)
+        {
+            x -= ((x + (x < 0 ? -pi : pi)) / two_pi) * two_pi;
+        }
+        // cos(x) = sin(x + pi/2), within [-pi/2, 3pi/2]
+        if (phase)
+        {
+            x += half_pi;
+        }
+        // to [-pi/2, pi/2] with sin(pi - x) = sin(x)
+        if (x > half_pi)
+        {
+            x = pi - x;
+        }
+        else if (x < -half_pi)
+        {
+            x = -pi - x;
+        }
+
+        // x - x^3/3! + x^5/5! - x^7/7! + x^9/9! in horner form
+        const W x2 = multiply(x, x);
+        W result = c9;
+        result = c7  + multiply(x2, result);
+        result = c5  + multiply(x2, result);
+        result = c3  + multiply(x2, result);
+        result = one + multiply(x2, result);
+        result = multiply(x, result);
+
+        // back to F fraction bits
+        constexpr W shift = W(1) << (P - F);
+        result = result >= 0 ? (result + shift / 2) / shift : -((-result + shift / 2) / shift);
+        return fixed<F,S,W>::from_raw(static_cast<S>(result));
+    }
+
+} // namespace detail
+
+/** \brief Sine without floating point: range reduction to `[-pi/2, pi/2]` and a Taylor polynomial up to `x^9`
+ *
+ * Evaluated with `sizeof(S) * 8 - 2` fraction bits in `W`, so the result is limited by the resolution `2^-F` of
+ * the argument and not by the polynomial.
+ */
+template< unsigned F, typename S, typename W >
+fixed<F,S,W> sin(const fixed<F,S,W> value)
+{
+    return detail::sine(value, false);
+}
+
+/** \brief Cosine, `cos(x) = sin(x + pi/2)` with the phase added after the range reduction of kafi::sin()
+ */
+template< unsigned F, typename S, typename W >
+fixed<F,S,W> cos(const fixed<F,S,W> value)
+{
+    return detail::sine(value, true);
+}
+
+} // namespace kafi
+
+#endif // KAFI_FIXED_POINT_H
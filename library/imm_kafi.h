@@ -0,0 +1,492 @@
+// Copyright 2018 municHMotorsport e.V. <info@munichmotorsport.de>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef IMM_KAFI_H
+#define IMM_KAFI_H
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include "kafi.h"
+#include "small_matrix.h"
+#include "tile_pool.h"
+#include "util.h"
+#include "autogen-KAFI-macros.h"
+
+/*!
+ *  \addtogroup kafi
+ *  @{
+ */
+
+namespace kafi {
+
+/** \brief Interacting multiple model estimator, a bank of `R` kafi::kafi filters with their own models
+ *
+ * Every mode is a kafi::kafi with its own `f`, `h`, `Q` and `cN`, e.g. straight driving, cornering and braking.
+ * The modes switch according to a Markov chain, `transitions(i, j)` is the probability to switch from mode `i`
+ * to mode `j` within a step. A step
+ * 1. mixes the estimates of the modes with the mixing probabilities `transitions(i, j) * mu_i / c_j` into the
+ *    starting estimate of every mode, see kafi::kafi::set_estimate(),
+ * 2. steps every mode filter,
+ * 3. weights the predicted mode probabilities `c_j` with the likelihoods of the innovations of the modes, and
+ * 4. combines the estimates of the modes with the mode probabilities `mu_j`.
+ *
+ * The estimates of the modes are stored contiguously, one `nx1_vector` and one `nxn_matrix` after the other,
+ * the mixing works on them in place and never allocates. The mode filters are stepped in contiguous ranges on a
+ * util::tile_pool, which is started in the constructor. With more than one worker the models of different modes
+ * are called concurrently and have to be safe to call from multiple threads.
+ *
+ * Template arguments:
+ * * `N`  = state dimensions
+ * * `M`  = sensor dimensions
+ * * `R`  = number of modes
+ * * `T`  = floating point scalar type (default: `double`)
+ *
+ * See examples at [tests/equivalence_tests.cc](../../tests/equivalence_tests.cc)
+ */
+template< size_t   N            // state  dimensions (N x 1)
+        , size_t   M            // sensor dimensions (M x 1)
+        , size_t   R            // number of modes
+        , typename T = double > // scalar type
+class imm_kafi {
+
+    static_assert(R >= 1UL, "kafi::imm_kafi needs at least one mode");
+
+    // typenames
+    public:
+        //! self type for conciseness
+        using self_t     = imm_kafi<N,M,R,T>;
+        //! scalar type of the state, the models and the propagation
+        using value_t    = T;
+        //! filter of a single mode
+        using filter_t   = kafi<N,M,T>;
+        //! copied typename for conciseness
+        using nx1_vector = typename jacobian_function<N,M,T>::nx1_vector;
+        //! copied typename for conciseness
+        using mx1_vector = typename jacobian_function<N,M,T>::mx1_vector;
+        //! copied typename for conciseness
+        using mxm_matrix = typename jacobian_function<N,M,T>::mxm_matrix;
+        //! copied typename for conciseness
+        using nxn_matrix = typename jacobian_function<N,M,T>::nxn_matrix;
+        //! transition probabilities of the modes, the rows sum up to `1`
+        using rxr_matrix = blaze::StaticMatrix<T, R, R, blaze::rowMajor>;
+        //! a probability per mode
+        using probabilities_t = std::array<T, R>;
+        /** \brief Shorthand for a useful return type for the kalman filter, references valid until the next step()
+         *  * `const nx1_vector &      = std::get<0>(x)` = combined state
+         *  * `const nxn_matrix &      = std::get<1>(x)` = combined prediction error, including the spread of the modes
+         *  * `const probabilities_t & = std::get<2>(x)` = mode probabilities
+         */
+        using return_t   = std::tuple<const nx1_vector &,
+                                      const nxn_matrix &,
+                                      const probabilities_t &>;
+
+        /** \brief The models of a mode, the arguments of kafi::kafi without the estimate
+         */
+        struct mode
+        {
+            //! state transition function with its jacobian
+            jacobian_function<N,N,T> f;
+            //! prediction scaling function with its jacobian
+            jacobian_function<N,M,T> h;
+            //! `Q` of the mode
+            nxn_matrix               process_noise;
+            //! `cN` of the mode
+            mxm_matrix               sensor_noise;
+        };
+
+    // constructors
+    public:
+
+        /** \brief Default constructor
+         *
+         * Arguments:
+         * * `std::array<mode, R> modes`: models of the modes, the functions are moved into the filters
+         * * `const rxr_matrix & transitions`: `transitions(i, j)` is the probability of the switch from mode `i` to mode `j`
+         * * `nx1_vector starting_state`: initial state of every mode
+         * * `const size_t workers`: threads which step the modes, including the calling thread
+         *
+         * Every mode starts with the probability `1 / R` and the identity as prediction error.
+         * Throws `std::invalid_argument` if a row of `transitions` isn't a probability distribution.
+         */
+        imm_kafi(      std::array<mode, R>   modes
+               , const rxr_matrix          & transitions
+               ,       nx1_vector            starting_state
+               , const size_t                workers = 1UL)
+        : imm_kafi<N,M,R,T>(std::move(modes)
+                          , transitions
+                          , starting_state
+                          , util::create_identity<N, blaze::rowMajor, T>()
+                          , workers)
+        { }
+
+        /**
+         * \brief The same as the default constructor, but with custom `prediction error` initialization
+         */
+        imm_kafi(      std::array<mode, R>   modes
+               , const rxr_matrix          & transitions
+               ,       nx1_vector            starting_state
+               , const nxn_matrix          & prediction_error
+               , const size_t                workers = 1UL)
+        : _pool(new util::tile_pool(workers))
+        , _transitions(transitions)
+        , _mixed_state_temp(0)
+        , _mixed_error_temp(0)
+        , _deviation_temp(0)
+        , _state(starting_state)
+        , _prediction_error(prediction_error)
+        , _new_data_available(false)
+        , _step_count(0)
+        {
+            using std::abs;
+            for (size_t from = 0UL; from < R; ++from)
+            {
+                T sum = T(0);
+                for (size_t to = 0UL; to < R; ++to)
+                {
+                    if (transitions(from, to) < T(0))
+                    {
+                        throw std::invalid_argument("kafi::imm_kafi: negative transition probability");
+                    }
+                    sum += transitions(from, to);
+                }
+                if (abs(sum - T(1)) > T(1e-6))
+                {
+                    throw std::invalid_argument("kafi::imm_kafi: the transition probabilities of a mode don't sum up to 1");
+                }
+            }
+
+            for (size_t index = 0UL; index < R; ++index)
+            {
+                _filters[index].reset(new filter_t(std::move(modes[index].f)
+                                                 , std::move(modes[index].h)
+                                                 , starting_state
+                                                 , modes[index].process_noise
+                                                 , modes[index].sensor_noise
+                                                 , prediction_error));
+                _mode_states[index]             = starting_state;
+                _mode_errors[index]             = prediction_error;
+                _probabilities[index]           = T(1) / static_cast<T>(R);
+                _predicted_probabilities[index] = _probabilities[index];
+                _log_likelihoods[index]         = T(0);
+                _root_temp[index]               = T(0);
+                _whitened_temp[index]           = T(0);
+            }
+        }
+
+        //! Copy constructor is deleted because imm_kafi owns the filters of the modes
+        imm_kafi(const self_t & other) = delete;
+        //! Move constructor is deleted like the one of kafi::kafi
+        imm_kafi(const self_t && other) = delete;
+
+    // methods
+    public:
+        /**
+         * The same as kafi::set_current_observation(), every mode gets the same observation
+         */
+        void set_current_observation(std::shared_ptr<mx1_vector> observation)
+        {
+            for (std::unique_ptr<filter_t> & filter : _filters)
+            {
+                filter->set_current_observation(observation);
+            }
+            _new_data_available = true;
+        }
+
+        //! number of threads which step the modes, including the calling thread
+        size_t workers() const
+        {
+            return _pool->workers();
+        }
+
+        //! the filter of mode `index`, e.g. to configure its update, its estimate is replaced by the mixing
+        filter_t & mode_filter(const size_t index)
+        {
+            return *_filters[index];
+        }
+
+        //! probability of every mode after the last step()
+        const probabilities_t & mode_probabilities() const
+        {
+            return _probabilities;
+        }
+
+        /**\brief Main function that runs the mixing, the mode filters and the combination
+         *
+         * Modifying:
+         *     * the estimates and probabilities of the modes
+         *     * `_state`
+         *     * `_prediction_error`
+         *
+         * Return:
+         *     * tuple of references, valid until the next step()
+         *         - combined state
+         *         - combined prediction error
+         *         - mode probabilities
+         */
+        return_t step()
+        {
+            apply_mixing();
+            const bool update = new_data_available();
+
+            auto kernel = [this, update](const size_t worker, const size_t workers)
+            {
+                const size_t begin = R * worker / workers;
+                const size_t end   = R * (worker + 1UL) / workers;
+                for (size_t index = begin; index < end; ++index)
+                {
+                    const typename filter_t::return_t result = _filters[index]->step();
+                    _mode_states[index] = std::get<0>(result);
+                    _mode_errors[index] = std::get<1>(result);
+                    if (update)
+                    {
+                        _log_likelihoods[index] = log_likelihood(index);
+                    }
+                }
+            };
+            _pool->run(kernel);
+
+            apply_probabilities(update);
+            apply_combination();
+            _step_count++;
+
+            DEBUG_MSG_KAFI(*this);
+            return return_t(_state, _prediction_error, _probabilities);
+        }
+
+        /** \brief Overloading stream operator for logging purposes, the same format as kafi::kafi
+         */
+        friend std::ostream & operator<<(std::ostream& stream, const self_t & rhs)
+        {
+            const char * line = "============================\n";
+            stream << "Kafi (IMM):\n"
+                   << "  Steps       # calls: "   << rhs._step_count       << '\n'
+                   << " [S] _state:\n"            << rhs._state            << line
+                   << " [P] _prediction_error:\n" << rhs._prediction_error << line
+                   << " [mu] _probabilities:\n";
+            for (size_t index = 0UL; index < R; ++index)
+            {
+                stream << "( " << rhs._probabilities[index] << " )\n";
+            }
+            stream << line;
+            return stream;
+        }
+
+        /** print helper for conciseness
+         */
+        void print_state_to(std::ostream & stream)
+        {
+            stream << *this;
+        }
+
+    //! Private methods
+    private:
+        /** \brief A check if the flag `_new_data_available` is true and flips it
+         */
+        bool new_data_available()
+        {
+            if (_new_data_available) {
+                _new_data_available = false;
+                return true;
+            } else {
+                return false;
+            }
+        }
+
+        /** \brief Predicted mode probabilities `c_j` and the mixed estimate of every mode
+         *
+         * `s0_j = sum_i w_ij * s_i` and `P0_j = sum_i w_ij * (P_i + (s_i - s0_j) * trans(s_i - s0_j))` with the
+         * mixing probabilities `w_ij = transitions(i, j) * mu_i / c_j`.
+         *
+         * Modifying:
+         *     * `_predicted_probabilities`
+         *     * the estimates of the mode filters
+         *     * `_mixed_state_temp`, `_mixed_error_temp`, `_deviation_temp`
+         */
+        void apply_mixing()
+        {
+            for (size_t to = 0UL; to < R; ++to)
+            {
+                T predicted = T(0);
+                for (size_t from = 0UL; from < R; ++from)
+                {
+                    predicted += _transitions(from, to) * _probabilities[from];
+                }
+                _predicted_probabilities[to] = predicted;
+                // nothing switches into the mode, it keeps its own estimate
+                if (predicted <= T(0))
+                {
+                    continue;
+                }
+
+                _mixed_state_temp = T(0);
+                for (size_t from = 0UL; from < R; ++from)
+                {
+                    const T weight = _transitions(from, to) * _probabilities[from] / predicted;
+                    _mixed_state_temp += weight * _mode_states[from];
+                }
+                _mixed_error_temp = T(0);
+                for (size_t from = 0UL; from < R; ++from)
+                {
+                    const T weight = _transitions(from, to) * _probabilities[from] / predicted;
+                    if (weight == T(0)) continue;
+                    _deviation_temp    = _mode_states[from] - _mixed_state_temp;
+                    _mixed_error_temp += weight * (_mode_errors[from] + _deviation_temp * blaze::trans(_deviation_temp));
+                }
+                _filters[to]->set_estimate(_mixed_state_temp, _mixed_error_temp);
+            }
+        }
+
+        /** \brief `log N(v; 0, S)` of the innovation `v` of mode `index` without the constant `-M/2 * log(2 pi)`
+         *
+         * With the lower triangular root `L` of `S` it is `-|inv(L) * v|^2 / 2 - sum_i log(L(i, i))`. Only
+         * touches the temporaries of mode `index`, the modes are evaluated concurrently.
+         */
+        T log_likelihood(const size_t index)
+        {
+            using std::log;
+            const filter_t   & filter   = *_filters[index];
+            const mx1_vector & v        = filter.innovation();
+                  mxm_matrix & L        = _root_temp[index];
+                  mx1_vector & whitened = _whitened_temp[index];
+
+            util::cholesky_factor(filter.innovation_covariance(), L);
+            T distance    = T(0);
+            T determinant = T(0);
+            for (size_t row = 0UL; row < M; ++row)
+            {
+                T value = v(row, 0);
+                for (size_t col = 0UL; col < row; ++col)
+                {
+                    value -= L(row, col) * whitened(col, 0);
+                }
+                whitened(row, 0) = value / L(row, row);
+                distance    += whitened(row, 0) * whitened(row, 0);
+                determinant += log(L(row, row));
+            }
+            return - distance / T(2) - determinant;
+        }
+
+        /** \brief `mu_j = c_j * exp(l_j) / sum_i c_i * exp(l_i)` with the log-likelihoods `l_j`, or `c_j` without an update
+         *
+         * The largest log-likelihood is subtracted before `exp`, so a mode which is far off doesn't underflow
+         * all of them.
+         *
+         * Modifying:
+         *     * `_probabilities`
+         */
+        void apply_probabilities(const bool update)
+        {
+            using std::exp;
+            if (!update)
+            {
+                _probabilities = _predicted_probabilities;
+                return;
+            }
+
+            T largest = _log_likelihoods[0];
+            for (size_t index = 1UL; index < R; ++index)
+            {
+                largest = std::max(largest, _log_likelihoods[index]);
+            }
+            T sum = T(0);
+            for (size_t index = 0UL; index < R; ++index)
+            {
+                _probabilities[index] = _predicted_probabilities[index] * exp(_log_likelihoods[index] - largest);
+                sum += _probabilities[index];
+            }
+            for (size_t index = 0UL; index < R; ++index)
+            {
+                _probabilities[index] /= sum;
+            }
+        }
+
+        /** \brief `s = sum_j mu_j * s_j` and `P = sum_j mu_j * (P_j + (s_j - s) * trans(s_j - s))`
+         *
+         * Modifying:
+         *     * `_state`
+         *     * `_prediction_error`
+         *     * `_deviation_temp`
+         */
+        void apply_combination()
+        {
+            _state = T(0);
+            for (size_t index = 0UL; index < R; ++index)
+            {
+                _state += _probabilities[index] * _mode_states[index];
+            }
+            _prediction_error = T(0);
+            for (size_t index = 0UL; index < R; ++index)
+            {
+                _deviation_temp    = _mode_states[index] - _state;
+                _prediction_error += _probabilities[index] * (_mode_errors[index] + _deviation_temp * blaze::trans(_deviation_temp));
+            }
+        }
+
+    // member
+    private:
+        //! steps the modes, the threads are started in the constructor
+        std::unique_ptr< util::tile_pool > _pool;
+        //! the filters of the modes
+        std::array< std::unique_ptr<filter_t>, R > _filters;
+        //! `transitions(i, j)`, probability of the switch from mode `i` to mode `j`
+        const rxr_matrix               _transitions;
+
+        // estimates of the modes, contiguous
+
+        //! `s_j` after the last step
+        std::array< nx1_vector, R >    _mode_states;
+        //! `P_j` after the last step
+        std::array< nxn_matrix, R >    _mode_errors;
+        //! `mu_j`
+              probabilities_t          _probabilities;
+        //! `c_j`, the mode probabilities after the switch
+              probabilities_t          _predicted_probabilities;
+        //! log-likelihood of the innovation of every mode in the last update
+              probabilities_t          _log_likelihoods;
+
+        // preallocated resources
+
+        //! mixed state of a mode
+              nx1_vector               _mixed_state_temp;
+        //! mixed prediction error of a mode
+              nxn_matrix               _mixed_error_temp;
+        //! `s_i - s0_j` and `s_j - s`
+              nx1_vector               _deviation_temp;
+        //! lower triangular root of the innovation covariance, per mode
+        std::array< mxm_matrix, R >    _root_temp;
+        //! `inv(L) * v`, per mode
+        std::array< mx1_vector, R >    _whitened_temp;
+
+        //       matrices
+        //! combined state
+              nx1_vector               _state;
+        //! combined prediction error
+              nxn_matrix               _prediction_error;
+        //! set by imm_kafi::set_current_observation(), changed in imm_kafi::new_data_available()
+              bool                     _new_data_available;
+        // logging
+        //! used for logging purposes, tracks how often imm_kafi::step() was run
+              size_t                   _step_count;
+};
+
+} // namespace kafi
+
+/*! @} End of Doxygen Groups*/
+#endif // IMM_KAFI_H
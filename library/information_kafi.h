@@ -0,0 +1,701 @@
+// Copyright 2018 municHMotorsport e.V. <info@munichmotorsport.de>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef INFORMATION_KAFI_H
+#define INFORMATION_KAFI_H
+
+#include <cmath>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <tuple>
+#include "jacobian_function.h"
+#include "small_matrix.h"
+#include "sparse_cholesky.h"
+#include "sparse_matrix.h"
+#include "util.h"
+#include "autogen-KAFI-macros.h"
+
+/*!
+ *  \addtogroup kafi
+ *  @{
+ */
+
+namespace kafi {
+
+/** \brief An extended information filter with sparse storage, for large models with sparse jacobians
+ *
+ * Instead of the state and the covariance `P` the filter keeps the information matrix `Omega = inv(P)` in a
+ * `blaze::CompressedMatrix` and the information vector `xi = Omega * state`. Models whose states only interact with
+ * their neighbours, e.g. chains or grids, have a sparse information matrix while `P` is dense.
+ *
+ * * the jacobians are only evaluated at the structural non-zeros of the jacobian_function, the empty partial
+ *   derivatives
+ * * the prediction `Omega = inv(F * inv(Omega) * trans(F) + Q)` is solved with the Woodbury identity
+ *   `inv(Q) - W * inv(S) * trans(W)`, `W = inv(Q) * F` and `S = Omega + trans(F) * W`, so `Q` has to be positive
+ *   definite. `inv(S)` is only evaluated at the elements the computed ones need, see util::sparse_cholesky::invert()
+ * * the update `Omega += trans(H) * inv(cN) * H` is added into the factor of the predicted `Omega` by `M` sparse
+ *   rank-1 updates, see util::sparse_cholesky::update(), an update of few states costs proportionally little.
+ *   `xi += trans(H) * inv(cN) * (o - h(state) + H * state)` and the state is recovered by a solve with the factor
+ *
+ * The predicted information matrix is dense in general. By default (`sparsity_threshold > 0`, see
+ * information_kafi::default_sparsity_threshold) only its elements in the pattern of `inv(Q) + F * Omega * trans(F)`
+ * are computed, and the off-diagonal ones with `|Omega(i,j)| <= sparsity_threshold * sqrt(Omega(i,i) * Omega(j,j))`
+ * are dropped, like a sparse extended information filter does. The state stays exact for the kept matrix, but the
+ * filter is only an approximation of kafi::kafi. `sparsity_threshold = 0` computes every element and the filter is
+ * equivalent to kafi::kafi, but the predicted information matrix is dense and a step is slower than kafi::kafi.
+ *
+ * For a large `N` the models are passed on the heap and the noise matrices as `blaze::CompressedMatrix`, neither
+ * of them has to fit on the stack. The constructor inverts `Q` and the initial prediction error once through a
+ * dense matrix on the heap.
+ *
+ * Template arguments:
+ * * `N`  = state dimensions
+ * * `M`  = sensor dimensions
+ * * `T`  = scalar type (default: `double`)
+ *
+ * See examples at [tests/information_kafi_tests.cc](../../tests/information_kafi_tests.cc)
+ */
+template< size_t   N            // state  dimensions (N x 1)
+        , size_t   M            // sensor dimensions (M x 1)
+        , typename T = double > // scalar type
+class information_kafi {
+
+    // typenames
+    public:
+        //! self type for conciseness
+        using self_t          = information_kafi<N,M,T>;
+        //! scalar type of the state, the models and the information matrix
+        using value_t         = T;
+        //! copied typename for conciseness
+        using nx1_vector      = typename jacobian_function<N,M,T>::nx1_vector;
+        //! copied typename for conciseness
+        using mx1_vector      = typename jacobian_function<N,M,T>::mx1_vector;
+        //! copied typename for conciseness
+        using mxm_matrix      = typename jacobian_function<N,M,T>::mxm_matrix;
+        //! copied typename for conciseness
+        using nxn_matrix      = typename jacobian_function<N,M,T>::nxn_matrix;
+        //! row-major sparse matrix of the information matrix and the jacobians
+        using sparse_matrix_t = blaze::CompressedMatrix<T, blaze::rowMajor>;
+        //! runtime-sized dense `(N x N)`, a static one of a large `N` would exceed the stack
+        using dense_matrix_t  = blaze::DynamicMatrix<T, blaze::rowMajor>;
+        //! state transition with its jacobian on the heap
+        using f_pointer_t     = std::unique_ptr< const jacobian_function<N,N,T> >;
+        //! prediction scaling with its jacobian on the heap
+        using h_pointer_t     = std::unique_ptr< const jacobian_function<N,M,T> >;
+        /** \brief Shorthand for a useful return type for the kalman filter, references valid until the next step()
+         *  * `const nx1_vector      & = std::get<0>(x)` = state
+         *  * `const sparse_matrix_t & = std::get<1>(x)` = information matrix
+         *  * `const nx1_vector      & = std::get<2>(x)` = information vector
+         */
+        using return_t        = std::tuple<const nx1_vector &,
+                                           const sparse_matrix_t &,
+                                           const nx1_vector &>;
+
+    // constants
+    public:
+        //! relative threshold of the sparse extended information filter mode, the default of the constructors
+        static constexpr double default_sparsity_threshold = 1e-4;
+
+    // constructors
+    public:
+
+        /** \brief Default constructor, the same arguments as kafi::kafi plus the sparsification
+         *
+         * * `jacobian_function< N, N, T > f`: state transision function with their jacobian
+         * * `jacobian_function< N, M, T > h`: prediction scaling function with their jacobian
+         * * `const  nx1_vector &  starting_state`: initial state
+         * * `const  nxn_matrix &  process_noise`: the *real world* noise, positive definite
+         * * `const  mxm_matrix &   sensor_noise`: the sensor covariance noise matrix
+         * * `T  sparsity_threshold`: relative threshold of the sparsification of the information matrix, `0` for
+         *   the exact filter
+         *
+         * Initializing `prediction_error` to identity matrix, i.e. the information matrix as well
+         *
+         * Throws `std::invalid_argument` if a noise matrix is singular or `sensor_noise` isn't positive definite
+         */
+        information_kafi(      jacobian_function<N,N,T> f
+                       ,       jacobian_function<N,M,T> h
+                       , const nx1_vector             & starting_state
+                       , const nxn_matrix             & process_noise
+                       , const mxm_matrix             & sensor_noise
+                       , const T                        sparsity_threshold = T(default_sparsity_threshold))
+        : information_kafi<N,M,T>(f_pointer_t(new jacobian_function<N,N,T>(std::move(f)))
+                                , h_pointer_t(new jacobian_function<N,M,T>(std::move(h)))
+                                , starting_state
+                                , to_sparse(process_noise)
+                                , sensor_noise
+                                , sparse_identity()
+                                , sparsity_threshold)
+        { }
+
+        /**
+         * \brief The same as the default constructor, but with custom `prediction error` initialization
+         */
+        information_kafi(      jacobian_function<N,N,T> f
+                       ,       jacobian_function<N,M,T> h
+                       , const nx1_vector             & starting_state
+                       , const nxn_matrix             & process_noise
+                       , const mxm_matrix             & sensor_noise
+                       , const nxn_matrix             & prediction_error
+                       , const T                        sparsity_threshold = T(default_sparsity_threshold))
+        : information_kafi<N,M,T>(f_pointer_t(new jacobian_function<N,N,T>(std::move(f)))
+                                , h_pointer_t(new jacobian_function<N,M,T>(std::move(h)))
+                                , starting_state
+                                , to_sparse(process_noise)
+                                , sensor_noise
+                                , to_sparse(prediction_error)
+                                , sparsity_threshold)
+        { }
+
+        /**
+         * \brief The same as the default constructor for a large `N`, the models are on the heap and `process_noise` is sparse
+         */
+        information_kafi(      f_pointer_t              f
+                       ,       h_pointer_t              h
+                       , const nx1_vector             & starting_state
+                       , const sparse_matrix_t        & process_noise
+                       , const mxm_matrix             & sensor_noise
+                       , const T                        sparsity_threshold = T(default_sparsity_threshold))
+        : information_kafi<N,M,T>(std::move(f)
+                                , std::move(h)
+                                , starting_state
+                                , process_noise
+                                , sensor_noise
+                                , sparse_identity()
+                                , sparsity_threshold)
+        { }
+
+        /**
+         * \brief The same as the previous constructor, but with a sparse custom `prediction error` initialization
+         */
+        information_kafi(      f_pointer_t              f
+                       ,       h_pointer_t              h
+                       , const nx1_vector             & starting_state
+                       , const sparse_matrix_t        & process_noise
+                       , const mxm_matrix             & sensor_noise
+                       , const sparse_matrix_t        & prediction_error
+                       , const T                        sparsity_threshold = T(default_sparsity_threshold))
+        : _f(std::move(f))
+        , _diagonal_temp(0)
+        , _row_temp(0)
+        , _h(std::move(h))
+        , _h_temp(0)
+        , _innovation_temp(0)
+        , _sensor_information_temp(0)
+        , _product_temp(0)
+        , _predicted_state_temp(0)
+        , _state(starting_state)
+        , _information_vector(0)
+        , _sparsity_threshold(sparsity_threshold)
+        , _accumulator(N)
+        , _new_data_available(false)
+        , _prediction_count(0)
+        , _update_count(0)
+        {
+            if (process_noise.rows() != N || process_noise.columns() != N
+             || prediction_error.rows() != N || prediction_error.columns() != N)
+            {
+                throw std::invalid_argument("kafi::information_kafi needs (N x N) process noise and prediction error");
+            }
+            build_pattern(*_f, _f_jacobian_temp);
+            build_pattern(*_h, _h_jacobian_temp);
+            sparse_inverse(process_noise,    _process_information);
+            sparse_inverse(sensor_noise,     _sensor_information);
+            sparse_inverse(prediction_error, _information_matrix);
+            sparse_inverse_root(sensor_noise, _sensor_root);
+            util::sparse_multiply_vector(_information_matrix, _state, _information_vector);
+
+            // the structure of trans(H) * inv(cN) * H, the factor of the predicted information matrix is padded with it
+            util::sparse_multiply_pattern(_sensor_root, _h_jacobian_temp, _sensor_jacobian_temp, _accumulator, _builder);
+            util::sparse_transpose(_sensor_jacobian_temp, _sensor_jacobian_trans_temp, _builder);
+            util::sparse_multiply_pattern(_sensor_jacobian_trans_temp, _sensor_jacobian_temp, _sensor_pattern, _accumulator, _builder);
+
+            // the exact filter computes every element of the predicted information matrix
+            if (_sparsity_threshold <= T(0))
+            {
+                _builder.begin(N, N);
+                for (size_t row = 0UL; row < N; ++row)
+                {
+                    for (size_t col = 0UL; col < N; ++col)
+                    {
+                        _builder.push(col, T(0));
+                    }
+                    _builder.end_row();
+                }
+                _builder.finish(_candidates);
+            }
+        }
+
+        //! Copy constructor is deleted because information_kafi owns multiple different potentially big matrices
+        information_kafi(const self_t & other) = delete;
+        //! Move constructor is deleted like the one of kafi::kafi
+        information_kafi(const self_t && other) = delete;
+
+    // methods
+    public:
+        /**
+         * The same as kafi::set_current_observation()
+         */
+        void set_current_observation(std::shared_ptr<mx1_vector> observation)
+        {
+            _observation = observation;
+            _new_data_available = true;
+        }
+
+        /**\brief Main function that runs the Kalman Filter based on new or old observation, and apply the prediction and update step
+         *
+         * Modifying:
+         *     * `_state`
+         *     * `_information_matrix`
+         *     * `_information_vector`
+         *
+         * Return:
+         *     * tuple of references, valid until the next step()
+         *         - state
+         *         - information matrix
+         *         - information vector
+         */
+        return_t step()
+        {
+            apply_prediction();
+            if (new_data_available())
+            {
+                apply_update();
+            }
+
+            DEBUG_MSG_KAFI(*this);
+            return return_t(_state, _information_matrix, _information_vector);
+        }
+
+        //! non-zeros of the information matrix, e.g. to tune the `sparsity_threshold`
+        size_t information_non_zeros() const
+        {
+            return _information_matrix.nonZeros();
+        }
+
+        /** \brief Overloading stream operator for logging purposes, the same format as kafi::kafi
+         */
+        friend std::ostream & operator<<(std::ostream& stream, const self_t & rhs)
+        {
+            std::shared_ptr<mx1_vector> o = rhs._observation.lock();
+            const char * line = "============================\n";
+            stream << "Kafi (information form):\n"
+                   << "  Update      # calls: "     << rhs._update_count     << '\n'
+                   << "  Predictions # calls: "     << rhs._prediction_count << '\n'
+                   << "  Information non-zeros: "   << rhs.information_non_zeros() << '\n'
+                   << " [S] _state:\n"              << rhs._state            << line;
+            if (o)
+            {
+                stream << " [O] _observation:\n"    << (*o)                  << line;
+            }
+            stream << " [I] _information_vector:\n" << rhs._information_vector << line;
+            return stream;
+        }
+
+        /** print helper for conciseness
+         */
+        void print_state_to(std::ostream & stream)
+        {
+            stream << *this;
+        }
+
+    //! Private methods
+    private:
+        //! the non-zeros of a static `(N x N)` constructor argument
+        static sparse_matrix_t to_sparse(const nxn_matrix & matrix)
+        {
+            sparse_matrix_t sparse;
+            util::sparse_builder<T> builder;
+            util::sparsify(matrix, sparse, builder);
+            return sparse;
+        }
+
+        //! the default prediction error, never dense
+        static sparse_matrix_t sparse_identity()
+        {
+            sparse_matrix_t identity;
+            util::sparse_builder<T> builder;
+            builder.begin(N, N);
+            for (size_t row = 0UL; row < N; ++row)
+            {
+                builder.push(row, T(1));
+                builder.end_row();
+            }
+            builder.finish(identity);
+            return identity;
+        }
+
+        /** \brief The structural non-zeros of the jacobian of `function` as the pattern of `jacobian`
+         */
+        template< size_t I
+                , size_t O >
+        static void build_pattern(const jacobian_function<I,O,T> & function, sparse_matrix_t & jacobian)
+        {
+            util::sparse_builder<T> builder;
+            builder.begin(O, I);
+            for (size_t row = 0UL; row < O; ++row)
+            {
+                for (size_t col = 0UL; col < I; ++col)
+                {
+                    if (!function.structural_zero(row, col)) builder.push(col, T(0));
+                }
+                builder.end_row();
+            }
+            builder.finish(jacobian);
+        }
+
+        /** \brief Evaluates the partial derivatives of `function` at the pattern of `jacobian` only
+         */
+        template< size_t I
+                , size_t O >
+        static void evaluate_jacobian(const jacobian_function<I,O,T> & function, const nx1_vector & state, sparse_matrix_t & jacobian)
+        {
+            for (size_t row = 0UL; row < O; ++row)
+            {
+                for (auto element = jacobian.begin(row); element != jacobian.end(row); ++element)
+                {
+                    element->value() = function.partial_derivative(row, element->index())(state);
+                }
+            }
+        }
+
+        /** \brief `output = inv(matrix)` without its zeros, only used by the constructor
+         *
+         * Throws `std::invalid_argument` if `matrix` is singular
+         */
+        template< typename Matrix >
+        static void sparse_inverse(const Matrix & matrix, sparse_matrix_t & output)
+        {
+            // runtime-sized, a big N would exceed the stack
+            dense_matrix_t work(matrix.rows(), matrix.columns());
+            dense_matrix_t inverse(matrix.rows(), matrix.columns());
+            for (size_t row = 0UL; row < matrix.rows(); ++row)
+            {
+                for (size_t col = 0UL; col < matrix.columns(); ++col)
+                {
+                    work(row, col) = matrix(row, col);
+                }
+            }
+            util::gauss_jordan_eliminate(work, inverse);
+            util::sparse_builder<T> builder;
+            util::sparsify(inverse, output, builder);
+        }
+
+        /** \brief `output = inv(C)` with `matrix = C * trans(C)` and a lower triangular `C`, only used by the constructor
+         *
+         * Throws `std::invalid_argument` if `matrix` isn't positive definite
+         */
+        static void sparse_inverse_root(const mxm_matrix & matrix, sparse_matrix_t & output)
+        {
+            using std::sqrt;
+            dense_matrix_t root(M, M, T(0));
+            for (size_t col = 0UL; col < M; ++col)
+            {
+                T diagonal = matrix(col, col);
+                for (size_t k = 0UL; k < col; ++k)
+                {
+                    diagonal -= root(col, k) * root(col, k);
+                }
+                if (!(diagonal > T(0)))
+                {
+                    throw std::invalid_argument("Cholesky factorization of a not positive definite sensor noise failed");
+                }
+                root(col, col) = sqrt(diagonal);
+                for (size_t row = col + 1UL; row < M; ++row)
+                {
+                    T sum = matrix(row, col);
+                    for (size_t k = 0UL; k < col; ++k)
+                    {
+                        sum -= root(row, k) * root(col, k);
+                    }
+                    root(row, col) = sum / root(col, col);
+                }
+            }
+
+            // forward substitution of the unit vectors, the inverse is lower triangular too
+            dense_matrix_t inverse(M, M, T(0));
+            for (size_t col = 0UL; col < M; ++col)
+            {
+                for (size_t row = col; row < M; ++row)
+                {
+                    T sum = row == col ? T(1) : T(0);
+                    for (size_t k = col; k < row; ++k)
+                    {
+                        sum -= root(row, k) * inverse(k, col);
+                    }
+                    inverse(row, col) = sum / root(row, row);
+                }
+            }
+            util::sparse_builder<T> builder;
+            util::sparsify(inverse, output, builder);
+        }
+
+        //! `W(row, :) * inv(S) * trans(W(col, :))` with the elements of `inv(S)` of the last util::sparse_cholesky::invert()
+        T noise_correction(const size_t row, const size_t col) const
+        {
+            const sparse_matrix_t & W = _noise_jacobian_temp;
+            T sum = T(0);
+            for (auto left = W.cbegin(row); left != W.cend(row); ++left)
+            {
+                T inner = T(0);
+                for (auto right = W.cbegin(col); right != W.cend(col); ++right)
+                {
+                    inner += _sum_cholesky.inverse(left->index(), right->index()) * right->value();
+                }
+                sum += left->value() * inner;
+            }
+            return sum;
+        }
+
+        /** \brief A check if the flag `_new_data_available` is true and flips it
+         */
+        bool new_data_available()
+        {
+            if (_new_data_available) {
+                _new_data_available = false;
+                return true;
+            } else {
+                return false;
+            }
+        }
+
+        /** \brief Applying the prediction formulae in information form
+         *
+         * With `W = inv(Q) * F` and `S = Omega + trans(F) * W`:
+         * * `Omega(i,j) = inv(Q)(i,j) - W(i,:) * inv(S) * trans(W(j,:))` at the candidates, every element of the
+         *   exact filter, the pattern of `inv(Q) + F * Omega * trans(F)` of the sparsified one
+         * * `state = f(state)`
+         * * `xi = Omega * state`
+         *
+         * `inv(S)` is needed at the pattern of `trans(W) * candidates * W`, `S` is padded with it before the factorization.
+         *
+         * Modifying:
+         *     * `_information_matrix`
+         *     * `_information_vector`
+         *     * `_state`
+         *     * `_cholesky` (if an update follows)
+         *     * `_prediction_count`
+         */
+        void apply_prediction()
+        {
+            using std::abs;
+            using std::sqrt;
+            evaluate_jacobian(*_f, _state, _f_jacobian_temp);
+            const sparse_matrix_t & F = _f_jacobian_temp;
+                  sparse_matrix_t & W = _noise_jacobian_temp;
+
+            util::sparse_multiply(_process_information, F, W, _accumulator, _builder);
+            util::sparse_transpose(F, _f_trans_temp, _builder);
+            util::sparse_transpose(W, _noise_jacobian_trans_temp, _builder);
+            if (_sparsity_threshold > T(0))
+            {
+                util::sparse_multiply_pattern(F, _information_matrix, _pattern_temp, _accumulator, _builder);
+                util::sparse_multiply_pattern(_pattern_temp, _f_trans_temp, _information_sum_temp, _accumulator, _builder);
+                util::sparse_pad(_information_sum_temp, _process_information, _candidates, _builder);
+            }
+            util::sparse_multiply_pattern(_noise_jacobian_trans_temp, _candidates, _pattern_temp, _accumulator, _builder);
+            util::sparse_multiply_pattern(_pattern_temp, W, _needed_temp, _accumulator, _builder);
+            util::sparse_multiply_add(_f_trans_temp, W, _information_matrix, _information_sum_temp, _accumulator, _builder);
+            util::sparse_pad(_information_sum_temp, _needed_temp, _padded_temp, _builder);
+            _sum_cholesky.factorize(_padded_temp);
+            _sum_cholesky.invert();
+
+            // the diagonal first, the sparsification compares the off-diagonal elements with it
+            for (size_t row = 0UL; row < N; ++row)
+            {
+                T process_information = T(0);
+                for (auto element = _process_information.cbegin(row); element != _process_information.cend(row); ++element)
+                {
+                    if (element->index() == row) process_information = element->value();
+                }
+                _diagonal_temp(row, 0) = process_information - noise_correction(row, row);
+            }
+            _builder.begin(N, N);
+            for (size_t row = 0UL; row < N; ++row)
+            {
+                for (auto element = _process_information.cbegin(row); element != _process_information.cend(row); ++element)
+                {
+                    _row_temp(element->index(), 0) = element->value();
+                }
+                for (auto candidate = _candidates.cbegin(row); candidate != _candidates.cend(row); ++candidate)
+                {
+                    const size_t col   = candidate->index();
+                    const T      value = row == col ? _diagonal_temp(row, 0) : _row_temp(col, 0) - noise_correction(row, col);
+                    if (value == T(0)) continue;
+                    if (row != col && _sparsity_threshold > T(0)
+                     && abs(value) <= _sparsity_threshold * sqrt(abs(_diagonal_temp(row, 0) * _diagonal_temp(col, 0)))) continue;
+                    _builder.push(col, value);
+                }
+                for (auto element = _process_information.cbegin(row); element != _process_information.cend(row); ++element)
+                {
+                    _row_temp(element->index(), 0) = T(0);
+                }
+                _builder.end_row();
+            }
+            _builder.finish(_information_matrix);
+
+            (*_f)(_state, _predicted_state_temp);
+            _state = _predicted_state_temp;
+            util::sparse_multiply_vector(_information_matrix, _state, _information_vector);
+
+            // only the update needs the factor, padded so that its rank-1 updates don't leave the factorized pattern
+            if (_new_data_available)
+            {
+                util::sparse_pad(_information_matrix, _sensor_pattern, _padded_temp, _builder);
+                _cholesky.factorize(_padded_temp);
+            }
+            _prediction_count++;
+        }
+
+        /** \brief Applying the update formulae in information form
+         *
+         * **Invariant**:
+         *     * `_observation` has to be initialized, implemented through information_kafi::new_data_available()
+         *
+         * With `V = inv(C) * H` and `cN = C * trans(C)`:
+         * * `Omega += trans(V) * V`, added into the factor of the predicted `Omega` row by row of `V`
+         * * `xi += trans(H) * inv(cN) * (o - h(state) + H * state)`
+         * * `state = inv(Omega) * xi` with the updated factor
+         *
+         * Modifying:
+         *     * `_information_matrix`
+         *     * `_information_vector`
+         *     * `_state`
+         *     * `_update_count`
+         *     * the preallocated temporaries
+         */
+        void apply_update()
+        {
+            (*_h)(_state, _h_temp);
+            evaluate_jacobian(*_h, _state, _h_jacobian_temp);
+            const sparse_matrix_t & H = _h_jacobian_temp;
+            std::shared_ptr<mx1_vector> o = _observation.lock();
+
+            const sparse_matrix_t & V = _sensor_jacobian_temp;
+
+            util::sparse_multiply(_sensor_root, H, _sensor_jacobian_temp, _accumulator, _builder);
+            util::sparse_transpose(V, _sensor_jacobian_trans_temp, _builder);
+            util::sparse_multiply_add(_sensor_jacobian_trans_temp, V, _information_matrix, _information_sum_temp, _accumulator, _builder);
+            swap(_information_matrix, _information_sum_temp);
+            _cholesky.update(V);
+
+            // the linearized observation o - h(state) + H * state
+            util::sparse_transpose(H, _h_trans_temp, _builder);
+            util::sparse_multiply_vector(H, _state, _innovation_temp);
+            _innovation_temp += *o;
+            _innovation_temp -= _h_temp;
+            util::sparse_multiply_vector(_sensor_information, _innovation_temp, _sensor_information_temp);
+            util::sparse_multiply_vector(_h_trans_temp, _sensor_information_temp, _product_temp);
+            _information_vector += _product_temp;
+
+            _cholesky.solve(_information_vector, _state);
+            _update_count++;
+        }
+
+    // member
+    private:
+        // functions with their respective preallocated resources
+
+        //! state transition function, on the heap
+        const f_pointer_t              _f;
+        //! sparse jacobian of `_f`, the pattern are the structural non-zeros
+              sparse_matrix_t          _f_jacobian_temp;
+        //! `trans(F)`
+              sparse_matrix_t          _f_trans_temp;
+        //! `W = inv(Q) * F`
+              sparse_matrix_t          _noise_jacobian_temp;
+        //! `trans(W)`
+              sparse_matrix_t          _noise_jacobian_trans_temp;
+        //! `Omega + trans(F) * W` in the prediction, `Omega + trans(V) * V` in the update
+              sparse_matrix_t          _information_sum_temp;
+        //! elements of the predicted information matrix which are computed, see information_kafi::apply_prediction()
+              sparse_matrix_t          _candidates;
+        //! intermediate structure of the products of patterns
+              sparse_matrix_t          _pattern_temp;
+        //! elements of `inv(S)` which the candidates need
+              sparse_matrix_t          _needed_temp;
+        //! a matrix padded with explicit zeros before its factorization
+              sparse_matrix_t          _padded_temp;
+        //! diagonal of the predicted information matrix
+              nx1_vector               _diagonal_temp;
+        //! scattered row of `inv(Q)`, all zeros between two rows
+              nx1_vector               _row_temp;
+        //! prediction scaling function, on the heap
+        const h_pointer_t              _h;
+        //! preallocated vector space for `_h`
+              mx1_vector               _h_temp;
+        //! sparse jacobian of `_h`, the pattern are the structural non-zeros
+              sparse_matrix_t          _h_jacobian_temp;
+        //! `trans(H)`
+              sparse_matrix_t          _h_trans_temp;
+        //! `V = inv(C) * H`
+              sparse_matrix_t          _sensor_jacobian_temp;
+        //! `trans(V)`
+              sparse_matrix_t          _sensor_jacobian_trans_temp;
+        //! `o - h(state) + H * state`
+              mx1_vector               _innovation_temp;
+        //! `inv(cN) * (o - h(state) + H * state)`
+              mx1_vector               _sensor_information_temp;
+        //! `trans(H) * inv(cN) * (o - h(state) + H * state)`, `_h_trans_temp` times `_sensor_information_temp`, added to the information vector
+              nx1_vector               _product_temp;
+        //! preallocated output of `_f`, the input of `_f` never aliases its output
+              nx1_vector               _predicted_state_temp;
+
+        // const matrices
+        //! `inv(Q)`
+              sparse_matrix_t          _process_information;
+        //! `inv(cN)`
+              sparse_matrix_t          _sensor_information;
+        //! `inv(C)`, `cN = C * trans(C)`
+              sparse_matrix_t          _sensor_root;
+        //! structure of `trans(H) * inv(cN) * H`
+              sparse_matrix_t          _sensor_pattern;
+
+        //       matrices
+        //! `s_t` (at time `t`), the input of `_f`, which writes into `_predicted_state_temp`
+              nx1_vector               _state;
+        //! `o_t` (reference, the caller is responsible for the allocation)
+        std::weak_ptr< mx1_vector >    _observation;
+        //! `Omega_t = inv(P_t)`
+              sparse_matrix_t          _information_matrix;
+        //! `xi_t = Omega_t * s_t`
+              nx1_vector               _information_vector;
+        //! relative threshold of the sparsification, `0` computes every element
+        const T                        _sparsity_threshold;
+
+        // sparse kernels with their reused buffers
+        //! dense row of the sparse products
+        util::sparse_accumulator<T>    _accumulator;
+        //! collects the results of the sparse products
+        util::sparse_builder<T>        _builder;
+        //! factorization and partial inverse of the padded `S` of the prediction
+        util::sparse_cholesky<T>       _sum_cholesky;
+        //! factorization of the predicted `Omega`, updated with `trans(V) * V` in the update
+        util::sparse_cholesky<T>       _cholesky;
+
+        //! used to run the information_kafi::apply_update() function, changed in information_kafi::new_data_available()
+              bool                     _new_data_available;
+        // logging
+        //! used for logging purposes, tracks how often information_kafi::apply_prediction() was run
+              size_t                   _prediction_count;
+        //! used for logging purposes, tracks how often information_kafi::apply_update() was run
+              size_t                   _update_count;
+};
+
+} // namespace kafi
+
+/*! @} End of Doxygen Groups*/
+#endif // INFORMATION_KAFI_H
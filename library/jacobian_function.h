@@ -15,81 +15,140 @@
 #ifndef JACOBIAN_FUNCTION_H
 #define JACOBIAN_FUNCTION_H
 
+#include <array>
 #include <functional>
 #include <blaze/Math.h>
 
 namespace kafi {
 
+/**
+ * \brief A partial derivative which doesn't depend on the state, e.g. created by util::identity_derivative()
+ *
+ * A jacobian_function detects these partial derivatives through `std::function::target()`, evaluates them
+ * once at construction and never calls them in jacobian_function::jacobian().
+ *
+ * Template arguments:
+ * * `N`  = state dimensions
+ * * `T`  = scalar type (default: `double`)
+ */
+template< size_t   N
+        , typename T = double >
+struct constant_derivative
+{
+    //! the value of the partial derivative for every state
+    T value;
+
+    //! returns `value`, the state is ignored
+    T operator()(const blaze::StaticMatrix<T, N, 1UL, blaze::rowMajor> & state) const
+    {
+        (void)state;
+        return value;
+    }
+};
+
 /**
  * \brief A wrapper function that stores a function and its jacobian.
  * 
  * This is currently working with references of the return values so this class doesn't have any ownership over the stored data
  *
+ * An empty (default constructed) partial derivative marks a structural zero of the jacobian, it is never called and
+ * always evaluates to `0`. Sparse filters like kafi::information_kafi only evaluate the structural non-zeros.
+ *
+ * A kafi::constant_derivative is evaluated once at construction as well, jacobian_function::jacobian() only
+ * calls the partial derivatives which depend on the state.
+ *
  * Template arguments:
  * * `N`  = state dimensions
  * * `M`  = sensor dimensions
+ * * `T`  = scalar type of all vectors and matrices (default: `double`)
  *  
  * For examples, see [tests/jacobian_function_tests.cc](../../tests/jacobian_function_tests.cc)
  */
-template< size_t N  // input dimensions  (N x 1)
-        , size_t M> // output dimensions (M x 1)
+template< size_t   N           // input dimensions  (N x 1)
+        , size_t   M           // output dimensions (M x 1)
+        , typename T = double> // scalar type
 class jacobian_function {
 
     // typenames
     public:
         //! self type for conciseness
-        using self_t     = jacobian_function<N,M>;
+        using self_t     = jacobian_function<N,M,T>;
+        //! scalar type of all vectors and matrices
+        using value_t    = T;
 
         /** `N` rows, `1` column `(N x 1)` */
-        using nx1_vector = blaze::StaticMatrix<double, N, 1UL, blaze::rowMajor>; 
+        using nx1_vector = blaze::StaticMatrix<T, N, 1UL, blaze::rowMajor>; 
         /** `M` rows, `1` column `(M x 1)` */
-        using mx1_vector = blaze::StaticMatrix<double, M, 1UL, blaze::rowMajor>;
+        using mx1_vector = blaze::StaticMatrix<T, M, 1UL, blaze::rowMajor>;
         /** Return type of applied partial derivatives with `M` rows, `N` columns */
-        using mxn_matrix = blaze::StaticMatrix<double, M,   N, blaze::rowMajor>;
+        using mxn_matrix = blaze::StaticMatrix<T, M,   N, blaze::rowMajor>;
         /** defining this type here to have a single point of access */
-        using nxm_matrix = blaze::StaticMatrix<double, N,   M, blaze::rowMajor>;
+        using nxm_matrix = blaze::StaticMatrix<T, N,   M, blaze::rowMajor>;
         /** defining this type here to have a single point of access */
-        using mxm_matrix = blaze::StaticMatrix<double, M,   M, blaze::rowMajor>;
+        using mxm_matrix = blaze::StaticMatrix<T, M,   M, blaze::rowMajor>;
         /** defining this type here to have a single point of access */
-        using nxn_matrix = blaze::StaticMatrix<double, N,   N, blaze::rowMajor>;
-        /** function that takes `(N x 1)` and returns `(M x 1)` */
-        using func            = std::function<void(nx1_vector &, mx1_vector &)>;
+        using nxn_matrix = blaze::StaticMatrix<T, N,   N, blaze::rowMajor>;
+        /** function that takes `(N x 1)` and returns `(M x 1)`, the input never aliases the output */
+        using func            = std::function<void(const nx1_vector &, mx1_vector &)>;
         /** partial derivative of fun for a single dimension of `N` */
-        using par_jacobi_func = std::function<double(const nx1_vector &)>;
+        using par_jacobi_func = std::function<T(const nx1_vector &)>;
         /** full `M x N` matrix of partial derivatives of jacobian_function::func */
         using jacobi_func     = blaze::StaticMatrix<par_jacobi_func, M, N, blaze::rowMajor>;
+        /** function that takes `(N x 1)` and returns `(M x 1)` and its jacobian `(M x N)` in a single call */
+        using fused_func      = std::function<void(const nx1_vector &, mx1_vector &, mxn_matrix &)>;
 
     // constructors
     public:
-        //! Default constructor with the normal function `f` and its derivative `F`
+        //! Default constructor with the normal function `f` and its derivative `F`, see jacobian_function::cache_constant_entries()
         constexpr jacobian_function(func f, jacobi_func F)
+        : jacobian_function(f, F, fused_func())
+        { }
+
+        /**
+         * \brief The same as the default constructor, with the fused evaluation `fused` of `f` and `F`, see jacobian_function::evaluate()
+         *
+         * `f` and `F` are still needed by the filters which evaluate them separately, e.g. kafi::information_kafi.
+         */
+        constexpr jacobian_function(func f, jacobi_func F, fused_func fused)
         : _f(f)
-        , _F(F){ }
+        , _F(F)
+        , _fused(fused)
+        , _constant_jacobian(0)
+        , _variable_entries()
+        , _variable_count(0)
+        {
+            cache_constant_entries();
+        }
 
         //! copy constructor is deleted, because we want to disallow copying of matrices (which may be added to this class ownership)
         constexpr jacobian_function(const self_t & other) = delete;
         //! move constructor
         constexpr jacobian_function(const self_t && other)
         : _f(std::move(other._f))
-        , _F(std::move(other._F)) { }
+        , _F(std::move(other._F))
+        , _fused(std::move(other._fused))
+        , _constant_jacobian(other._constant_jacobian)
+        , _variable_entries(other._variable_entries)
+        , _variable_count(other._variable_count) { }
 
     // methods
     public:
         /**
          * \brief Forwarding to the 'f' function
-         * * `state` ~= input, **IMPORTANT**: state might be equal to output, so use a deep copy if you need the values
+         * * `state` ~= input, read-only and never the same object as `output`
          * * `output` is the return type, because we want a constant memory footprint
          *    - therefore the return type is preallocated and reused
+         *    - every row has to be written, the previous content of `output` is unspecified
          * 
          * \todo make a functional version of this call with `mx1_vector` as return type and test the performance decrease
          */
-        constexpr void operator()(nx1_vector & state, mx1_vector & output) const
+        constexpr void operator()(const nx1_vector & state, mx1_vector & output) const
         {
             return _f(state, output);
         }
 
         /**
-         * \brief Iterates over all partial derivatives of `_f` in `_F` and runs them with `state`
+         * \brief Copies the cached constant entries and runs the partial derivatives of `_f` in `_F` which depend on `state`
          * 
          * Saving the results in 'jacobi_temp' matrix to be fully functional and parallelizable
 
@@ -97,15 +156,103 @@ class jacobian_function {
          */
         constexpr mxn_matrix & jacobian(const nx1_vector & state, mxn_matrix & jacobi_temp) const
         {
-            for(size_t row = 0UL; row < _F.rows(); ++row)
+            jacobi_temp = _constant_jacobian;
+            for(size_t entry = 0UL; entry < _variable_count; ++entry)
             {
-                for(size_t col = 0UL; col < _F.columns(); ++col)
+                const size_t row = _variable_entries[entry] / N;
+                const size_t col = _variable_entries[entry] % N;
+                jacobi_temp(row, col) = _F(row, col)(state);
+            }
+            return jacobi_temp; 
+        }
+
+        /**
+         * \brief The function value and the jacobian at `state`, in a single call if a fused function was given
+         * * `state` is never the same object as `output`, like in jacobian_function::operator()
+         * * the fused function is called with the structural zeros and the constant entries already in `jacobi_temp`,
+         *   it only has to write the entries which depend on the state
+         *
+         * Without a fused function this is jacobian_function::jacobian() followed by jacobian_function::operator().
+         */
+        constexpr void evaluate(const nx1_vector & state, mx1_vector & output, mxn_matrix & jacobi_temp) const
+        {
+            if (_fused)
+            {
+                jacobi_temp = _constant_jacobian;
+                _fused(state, output, jacobi_temp);
+            }
+            else
+            {
+                jacobian(state, jacobi_temp);
+                _f(state, output);
+            }
+        }
+
+        //! `true` if jacobian_function::evaluate() runs a fused function
+        bool fused() const
+        {
+            return static_cast<bool>(_fused);
+        }
+
+        //! the wrapped function `_f`, e.g. to adapt it with kafi::make_dynamic()
+        const func & function() const
+        {
+            return _f;
+        }
+
+        //! the fused evaluation `_fused`, may be empty, see jacobian_function::evaluate()
+        const fused_func & fused_function() const
+        {
+            return _fused;
+        }
+
+        //! the partial derivative of the output dimension `row` by the input dimension `col`
+        const par_jacobi_func & partial_derivative(const size_t row, const size_t col) const
+        {
+            return _F(row, col);
+        }
+
+        //! `true` if the partial derivative of `row` by `col` is empty, i.e. the jacobian is always `0` there
+        bool structural_zero(const size_t row, const size_t col) const
+        {
+            return !_F(row, col);
+        }
+
+        //! number of partial derivatives which depend on the state and are called in every jacobian_function::jacobian()
+        size_t variable_entries() const
+        {
+            return _variable_count;
+        }
+
+    // private methods
+    private:
+        /**
+         * \brief Evaluates the structural zeros and every kafi::constant_derivative into `_constant_jacobian` once
+         *
+         * The indices `row * N + col` of the remaining partial derivatives are kept in `_variable_entries`.
+         */
+        void cache_constant_entries()
+        {
+            for(size_t row = 0UL; row < M; ++row)
+            {
+                for(size_t col = 0UL; col < N; ++col)
                 {
                     const par_jacobi_func & j_func = _F(row, col);
-                    jacobi_temp(row, col) = j_func(state);
+                    const constant_derivative<N,T> * constant = j_func.template target< constant_derivative<N,T> >();
+                    if (!j_func)
+                    {
+                        _constant_jacobian(row, col) = T(0);
+                    }
+                    else if (constant != nullptr)
+                    {
+                        _constant_jacobian(row, col) = constant->value;
+                    }
+                    else
+                    {
+                        _variable_entries[_variable_count++] = row * N + col;
+                    }
                 }
             }
-            return jacobi_temp; 
         }
 
     // member
@@ -117,6 +264,14 @@ class jacobian_function {
         const func        _f;
         //! jacobian function `_F :: nx1_vector -> mxn_matrix`
         const jacobi_func _F;
+        //! `_f` and `_F` in a single call, may be empty
+        const fused_func  _fused;
+        //! the structural zeros and the constant partial derivatives, the other entries are overwritten
+              mxn_matrix  _constant_jacobian;
+        //! `row * N + col` of the partial derivatives which depend on the state
+              std::array<size_t, M * N> _variable_entries;
+        //! used entries of `_variable_entries`
+              size_t      _variable_count;
 };
 
 } // namespace jacobian_function
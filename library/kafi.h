@@ -15,10 +15,15 @@
 #ifndef KAFI_H
 #define KAFI_H
 
+#include <algorithm>
+#include <array>
+#include <cmath>
 #include <functional>
 #include <iostream>
 #include <memory>
 #include "jacobian_function.h"
+#include "small_matrix.h"
+#include "transition_power.h"
 #include "util.h"
 #include "autogen-KAFI-macros.h"
 
@@ -31,35 +36,69 @@
  *
  */
 namespace kafi {
+
+/** \brief Form of the covariance update in kafi::apply_update(), see kafi::set_covariance_update()
+ *
+ * * `standard`: `P = P - G * (H * P)`, the cheapest form, but rounding errors are not damped and `P`
+ *   slowly drifts from symmetry, which hurts most in `float` and fixed-point
+ * * `joseph`: `P = (I - G * H) * P * trans(I - G * H) + G * cN * trans(G)`, symmetric by construction
+ *   and positive semidefinite for any gain, at the cost of an additional `N x N x M` product
+ */
+enum class covariance_update
+{
+    standard,
+    joseph
+};
  
 /** \brief A templated EKF class with static matrix sizes
  * 
  * Template arguments:
  * * `N`  = state dimensions
  * * `M`  = sensor dimensions
+ * * `T`  = scalar type of the state, the models and the propagation (default: `double`)
+ * * `TI` = scalar type of the innovation solve in kafi::apply_update() (default: `T`)
+ *
+ * A mixed precision filter, e.g. `kafi<N, M, float, double>`, keeps the state and the covariance
+ * propagation in `float` (half the memory bandwidth, double the SIMD width), but inverts the
+ * innovation covariance in `double`, where the precision matters most.
+ *
+ * `float` and `double` are inverted by LAPACK, every other scalar type, e.g. the fixed-point kafi::fixed,
+ * by the built-in util::gauss_jordan_inverse().
  * 
  * See examples at [tests/kafi_tests.cc](../../tests/kafi_tests.cc)
  */
-template<size_t N  // state  dimensions (N x 1)
-       , size_t M> // sensor dimensions (M x 1)
+template<size_t   N       // state  dimensions (N x 1)
+       , size_t   M       // sensor dimensions (M x 1)
+       , typename T  = double  // scalar type
+       , typename TI = T>      // scalar type of the innovation solve
 class kafi {
 
     // typenames
     public:
         //! self type for conciseness
-        using self_t     = kafi<N,M>;
+        using self_t     = kafi<N,M,T,TI>;
+        //! scalar type of the state, the models and the propagation
+        using value_t    = T;
+        //! scalar type of the innovation solve
+        using innovation_value_t = TI;
         //! copied typename for conciseness
-        using nx1_vector = typename jacobian_function<N,M>::nx1_vector;
+        using nx1_vector = typename jacobian_function<N,M,T>::nx1_vector;
         //! copied typename for conciseness
-        using mx1_vector = typename jacobian_function<N,M>::mx1_vector;
+        using mx1_vector = typename jacobian_function<N,M,T>::mx1_vector;
         //! copied typename for conciseness
-        using mxn_matrix = typename jacobian_function<N,M>::mxn_matrix;
+        using mxn_matrix = typename jacobian_function<N,M,T>::mxn_matrix;
         //! copied typename for conciseness
-        using nxm_matrix = typename jacobian_function<N,M>::nxm_matrix;
+        using nxm_matrix = typename jacobian_function<N,M,T>::nxm_matrix;
         //! copied typename for conciseness
-        using mxm_matrix = typename jacobian_function<N,M>::mxm_matrix;
+        using mxm_matrix = typename jacobian_function<N,M,T>::mxm_matrix;
         //! copied typename for conciseness
-        using nxn_matrix = typename jacobian_function<N,M>::nxn_matrix;
+        using nxn_matrix = typename jacobian_function<N,M,T>::nxn_matrix;
+        //! copied typename for conciseness, in the scalar type of the innovation solve
+        using mxn_innovation_matrix = typename jacobian_function<N,M,TI>::mxn_matrix;
+        //! copied typename for conciseness, in the scalar type of the innovation solve
+        using nxm_innovation_matrix = typename jacobian_function<N,M,TI>::nxm_matrix;
+        //! copied typename for conciseness, in the scalar type of the innovation solve
+        using mxm_innovation_matrix = typename jacobian_function<N,M,TI>::mxm_matrix;
         //! copied typename for conciseness
         /** \brief Shorthand for a useful return type for the kalman filter
          *  * `const nx1_vector & = std::get<0>(x)` = state              
@@ -78,53 +117,75 @@ class kafi {
          * Template arguments:
          * * `N`  = state dimensions
          * * `M`  = sensor dimensions
+         * * `T`  = scalar type
+         * * `TI` = scalar type of the innovation solve
          * 
          * Arguments:
-         * * `const  jacobian_function< N, N > f`: state transision function with their jacobian
-         * * `const  jacobian_function< N, M > h`: prediction scaling function with their jacobian
+         * * `const  jacobian_function< N, N, T > f`: state transision function with their jacobian
+         * * `const  jacobian_function< N, M, T > h`: prediction scaling function with their jacobian
          * *        `nx1_vector   starting_state`: initial state can be copied (kafi is owner)
          * *        `mx1_vector &    observation`: design decision, we need to explicitly initialize the observation, even if this will not be used in the first step(). Use `set_current_observation()`
          * * `const  nxn_matrix &  process_noise`: the *real world* noise
          * * `const  mxm_matrix &   sensor_noise`: the sensor covariance noise matrix
          *
-         *  Initializing `prediction_error` to identity matrix via util::create_identity<N, blaze::rowMajor>()
+         *  Initializing `prediction_error` to identity matrix via util::create_identity<N, blaze::rowMajor, T>()
          */
-        kafi(const jacobian_function<N,N>   f
-           , const jacobian_function<N,M>   h
+        kafi(const jacobian_function<N,N,T> f
+           , const jacobian_function<N,M,T> h
            ,       nx1_vector               starting_state
            , const nxn_matrix             & process_noise
            , const mxm_matrix             & sensor_noise)
-        : kafi<N,M> (std::move(f)
-                   , std::move(h)
-                   , starting_state
-                   , process_noise
-                   , sensor_noise
-                   , util::create_identity<N, blaze::rowMajor>())
+        : kafi<N,M,T,TI> (std::move(f)
+                        , std::move(h)
+                        , starting_state
+                        , process_noise
+                        , sensor_noise
+                        , util::create_identity<N, blaze::rowMajor, T>())
         { }
 
         /**
          * \brief The same as the default constructor, but with custom `prediction error` initialization
          */ 
-        kafi(const jacobian_function<N,N>   f
-           , const jacobian_function<N,M>   h
+        kafi(const jacobian_function<N,N,T> f
+           , const jacobian_function<N,M,T> h
            ,       nx1_vector               starting_state 
            , const nxn_matrix             & process_noise
            , const mxm_matrix             & sensor_noise
            , const nxn_matrix             & prediction_error)
         : _f(std::move(f))
+        , _f_jacobian_temp(0)
         , _h(std::move(h))
+        , _h_temp(0)
+        , _h_jacobian_temp(0)
+        , _h_trans_temp(0)
+        , _gain_numerator_temp(0)
+        , _innovation_temp(0)
+        , _innovation_h_temp(0)
+        , _innovation_numerator_temp(0)
+        , _innovation_covariance_temp(0)
+        , _innovation_inverse_temp(0)
+        , _innovation_gain_temp(0)
+        , _h_covariance_temp(0)
+        , _joseph_temp(0)
+        , _covariance_update(covariance_update::standard)
+        , _steady_state_tolerance(0)
+        , _steady_state(false)
+        , _iterated_step_temp(0)
+        , _max_update_iterations(1UL)
+        , _update_tolerance(0)
+        , _update_iterations(0UL)
+        , _covariance_rate(1UL)
+        , _pending_steps(0UL)
         , _process_noise(process_noise)
         , _sensor_noise(sensor_noise)
-        , _state(starting_state)
-        , _f_jacobian_temp(0)
-        , _h_jacobian_temp(0)
-        , _h_temp(0)
-        , _prediction_count(0)
-        , _update_count(0)
-        , _gain(0)
+        , _innovation_sensor_noise(sensor_noise)
+        , _states{{starting_state, nx1_vector(0)}}
+        , _current_state(0UL)
         , _prediction_error(prediction_error)
-        , _identity(util::create_identity<N, blaze::rowMajor>())
+        , _gain(0)
         , _new_data_available(false)
+        , _prediction_count(0)
+        , _update_count(0)
         { }
 
         //! Copy constructor is deleted because kafi owns multiple different potentially big matrices
@@ -152,11 +213,159 @@ class kafi {
             _new_data_available = true;
         }
 
+        /** \brief Selects the form of the covariance update, kafi::covariance_update::standard by default
+         *
+         * Modifying:
+         *     * `_covariance_update`
+         */
+        void set_covariance_update(const covariance_update form)
+        {
+            _covariance_update = form;
+        }
+
+        //! the form of the covariance update of the next kafi::apply_update()
+        covariance_update get_covariance_update() const
+        {
+            return _covariance_update;
+        }
+
+        /** \brief Freezes the gain as soon as no element changes by more than `tolerance` between two updates
+         *
+         * Only for linear time-invariant models: constant jacobians, `Q` and `cN`, and an observation every step.
+         * Once frozen, kafi::step() neither propagates the covariance nor solves the innovation, the update is
+         * `s + G * (o - h(s))` in `O(N * M)`. `0` (default) never freezes the gain, neither does the iterated
+         * update, see kafi::set_iterated_update().
+         *
+         * Modifying:
+         *     * `_steady_state_tolerance`
+         */
+        void set_steady_state_tolerance(const T tolerance)
+        {
+            _steady_state_tolerance = tolerance;
+        }
+
+        /** \brief Relinearizes `_h` around the updated state up to `max_iterations` times per update
+         *
+         * The iterated update repeats `s_i+1 = s + G_i * (o - h(s_i) - H_i * (s - s_i))` with `H_i` and `G_i` at
+         * `s_i`, starting at the predicted state `s`, and updates the prediction error with the last `H_i` and `G_i`.
+         * It stops early as soon as no element of the state changes by more than `tolerance`. This is more accurate
+         * for strongly nonlinear sensor models, e.g. range and bearing, at the cost of an innovation solve per iteration.
+         * `1` (default) is the extended Kalman filter update. The gain is never frozen while the iterated update is
+         * enabled, see kafi::set_steady_state_tolerance().
+         *
+         * Modifying:
+         *     * `_max_update_iterations`
+         *     * `_update_tolerance`
+         */
+        void set_iterated_update(const size_t max_iterations, const T tolerance = T(0))
+        {
+            _max_update_iterations = std::max<size_t>(1UL, max_iterations);
+            _update_tolerance      = tolerance;
+        }
+
+        //! number of linearizations of `_h` in the last kafi::apply_update()
+        size_t update_iterations() const
+        {
+            return _update_iterations;
+        }
+
+        /** \brief Propagates the prediction error every `steps` steps and before every update, the state every step
+         *
+         * The jacobian `F` is evaluated at the first step of an interval and held over the `k <= steps` steps until
+         * the propagation, `P = F^k * P * trans(F^k) + sum_i F^i * Q * trans(F^i)`, `i < k`, see util::transition_power.
+         * This is exactly `k` single steps for a constant `F`, the other steps only run `f`. A nonlinear `f` is
+         * linearized once per interval, which is the only approximation: the error grows with the change of `F`
+         * over the interval, e.g. a few tenths of a meter for a car turning by `0.15` rad per interval, see
+         * tests/equivalence_tests.cc. `1` (default) propagates it every step. Between propagations step() returns
+         * the prediction error of the last propagation.
+         *
+         * Modifying:
+         *     * `_covariance_rate`
+         *     * `_prediction_error`, if steps are pending
+         */
+        void set_covariance_rate(const size_t steps)
+        {
+            apply_covariance_propagation();
+            _covariance_rate = std::max<size_t>(1UL, steps);
+        }
+
+        /** \brief Replaces the state and the prediction error, e.g. with the mixed estimate of kafi::imm_kafi
+         *
+         * A frozen gain belongs to the old prediction error and is released, see kafi::set_steady_state_tolerance().
+         * Pending steps of kafi::set_covariance_rate() are kept and propagate `prediction_error` at the next
+         * propagation, like the one step() returned, which is the one of the last propagation.
+         *
+         * Modifying:
+         *     * `_states`
+         *     * `_prediction_error`
+         *     * `_steady_state`
+         */
+        void set_estimate(const nx1_vector & state_estimate, const nxn_matrix & prediction_error)
+        {
+            state()           = state_estimate;
+            _prediction_error = prediction_error;
+            _steady_state     = false;
+        }
+
+        /** \brief Replaces the state only, e.g. the reset of the error in kafi::error_state_kafi
+         *
+         * The prediction error, a frozen gain and pending steps of kafi::set_covariance_rate() are kept.
+         *
+         * Modifying:
+         *     * `_states`
+         */
+        void set_state(const nx1_vector & state_estimate)
+        {
+            state() = state_estimate;
+        }
+
+        /** \brief `o - h(s)` of the last update with the predicted state `s`
+         *
+         * With the iterated update it is `o - h(s_i) - H_i * (s - s_i)` of the last linearization, the same one as
+         * kafi::innovation_covariance(), e.g. for the likelihood of kafi::imm_kafi.
+         */
+        const mx1_vector & innovation() const
+        {
+            return _innovation_temp;
+        }
+
+        /** \brief `H * P * trans(H) + cN` of the last computed gain
+         *
+         * With the iterated update `H` is the one of the last linearization, with a frozen gain the one which froze it.
+         */
+        const mxm_innovation_matrix & innovation_covariance() const
+        {
+            return _innovation_covariance_temp;
+        }
+
+        /** \brief Iterates the Riccati recursion from the current prediction error until the gain is frozen, see kafi::set_steady_state_tolerance()
+         *
+         * Solves the discrete algebraic Riccati equation by fixed-point iteration with the jacobians at the
+         * current state, the state itself is not changed. Call it right after the construction to run
+         * the filter with the steady-state gain from the first step.
+         *
+         * Modifying:
+         *     * `_steady_state_tolerance`
+         *     * `_prediction_error`
+         *     * `_gain`
+         *
+         * Return:
+         *     * `true` if the gain converged within `max_iterations`
+         *     * `false` without touching the filter if `tolerance <= 0` or the iterated update is enabled, the gain can't freeze then
+         */
+        bool solve_steady_state(const T tolerance, const size_t max_iterations = 10000UL);
+
+        //! `true` if the gain is frozen
+        bool steady_state() const
+        {
+            return _steady_state;
+        }
+
         /**\brief Main function that runs the Kalman Filter based on new or old observation, and apply the prediction and update step
          *
          * Modifying:
          *     * `_gain`
-         *     * `_state`
+         *     * `_states`
          *     * `_prediction_error`
          *
          * Return:
@@ -165,18 +374,8 @@ class kafi {
          *         - prediction_error
          *         - gain
          */
-        return_t step()
-        {
-            apply_prediction();
-            if (new_data_available())
-            {
-                apply_update();
-            }
-            
-            //print_state_to(std::cerr);
-            DEBUG_MSG_KAFI(*this);
-            return std::make_tuple(_state, _prediction_error, _gain);
-        }
+        return_t step();
+
         /** \brief Overloading stream operator for logging purposes
          *
          * Might look like this:
@@ -206,7 +405,7 @@ class kafi {
             stream << "Kafi:\n"
                    << "  Update      # calls: "   << rhs._update_count     << '\n'
                    << "  Predictions # calls: "   << rhs._prediction_count << '\n'
-                   << " [S] _state:\n"            << rhs._state            << line
+                   << " [S] _state:\n"            << rhs.state()           << line
                    << " [O] _observation:\n"      << (*o)                  << line
                    << " [P] _prediction_error:\n" << rhs._prediction_error << line
                    << " [G] _gain:\n"             << rhs._gain             << line; 
@@ -234,24 +433,51 @@ class kafi {
             }
         }
 
+        //! `s_t`, the input of `_f` and `_h`
+        nx1_vector & state()
+        {
+            return _states[_current_state];
+        }
+
+        //! `s_t`, the input of `_f` and `_h`
+        const nx1_vector & state() const
+        {
+            return _states[_current_state];
+        }
+
+        //! the buffer which is written by `_f` and the state update, it never aliases kafi::state()
+        nx1_vector & next_state()
+        {
+            return _states[1UL - _current_state];
+        }
+
+        /** \brief Makes kafi::next_state() the current state
+         *
+         * The state is double-buffered so `_f` gets a read-only input and a distinct output without a copy.
+         */
+        void swap_states()
+        {
+            _current_state = 1UL - _current_state;
+        }
+
         /** \brief Applying the prediction formulae
          * 
          * Modifying:
-         *     * `_prediction_error`
-         *     * `_state`
+         *     * `_prediction_error` (unless the gain is frozen, or the propagation is pending, see kafi::set_covariance_rate())
+         *     * `_states`
+         *     * `_pending_steps`
          *     * `_prediction_count`
          */ 
-        void apply_prediction()
-        {   
-            // Using some zero cost abstraction renaming for mathematical understanding
-            const nxn_matrix & P = _prediction_error;
-            const nxn_matrix & Q = _process_noise;
-            const nxn_matrix & F = _f.jacobian(_state, _f_jacobian_temp);
-
-            _prediction_error = F * P * blaze::trans(F) + Q; 
-            _f(_state, _state);
-            _prediction_count++;
-        }
+        void apply_prediction();
+
+        /** \brief Propagates the prediction error over the pending steps with the held `F`, see kafi::set_covariance_rate()
+         *
+         * Modifying:
+         *     * `_prediction_error`
+         *     * `_transition_power`
+         *     * `_pending_steps`
+         */
+        void apply_covariance_propagation();
 
         /** \brief Applying the update formulae
          * 
@@ -260,58 +486,136 @@ class kafi {
          *
          * Modifying:
          *     * `_gain `
-         *     * `_state`
+         *     * `_states`
          *     * `_prediction_error`
          *     * `_update_count`
          *     * `_h_temp`
+         *     * `_innovation_temp`
+         *     * the preallocated temporaries of the innovation solve
          *
-         * \todo cache `trans(H)`
+         * With a frozen gain only the state is updated. The iterated update continues in kafi::apply_iterations().
          */
-        void apply_update()
-        {
-            // Using zero cost abstraction renaming for mathematical understanding
-            _h(_state, _h_temp);
-            const mx1_vector & h  = _h_temp;
-            const mxn_matrix & H  = _h.jacobian(_state, _h_jacobian_temp);
-            const nxn_matrix & P  = _prediction_error;
-            const mxm_matrix & cN = _sensor_noise;
-            const nxn_matrix & I  = _identity;
-            const nx1_vector & s  = _state;
-            std::shared_ptr<mx1_vector> o  = _observation.lock();
-                  nxm_matrix & G  = _gain;
-
-            _gain  = P * blaze::trans(H) * blaze::inv(H * P * blaze::trans(H) + cN);
-            _state = s + G * (*o - h);
-            _prediction_error = (I - G * H) * P;
-            _update_count++;
-        }
+        void apply_update();
+
+        /** \brief Computes the gain `P * trans(H) * inv(H * P * trans(H) + cN)` and freezes it once it converged
+         *
+         * Modifying:
+         *     * `_gain`
+         *     * `_steady_state`
+         *     * the preallocated temporaries of the innovation solve
+         *
+         * The innovation covariance is built and inverted in `TI`, everything else stays in `T`.
+         */
+        void apply_gain(const mxn_matrix & H);
+
+        /** \brief The iterations of the iterated update, see kafi::set_iterated_update()
+         *
+         * Starts with the first iteration in kafi::next_state() and leaves the last one there, kafi::state() is
+         * the predicted state throughout.
+         *
+         * Modifying:
+         *     * `_gain`
+         *     * `_h_temp`
+         *     * `_h_jacobian_temp`
+         *     * `_innovation_temp`
+         *     * `_update_iterations`
+         *     * the preallocated temporaries of the innovation solve and of the iterations
+         */
+        void apply_iterations(const mx1_vector & o);
+
+        /** \brief Updates `_prediction_error` with the gain `_gain`, without forming `I - G * H`
+         *
+         * Both forms start with `A = P - G * (H * P) = (I - G * H) * P`. The Joseph form continues with
+         * `A * trans(I - G * H) + G * cN * trans(G) = A - (A * trans(H) - G * cN) * trans(G)`, which is
+         * evaluated for the upper triangle only and mirrored into the lower one.
+         *
+         * Modifying:
+         *     * `_prediction_error`
+         *     * `_h_covariance_temp`
+         *     * `_joseph_temp`
+         */
+        void apply_covariance_update(const mxn_matrix & H);
 
     // member
     public:
         // functions with their respective preallocated resources
 
         //! state transition function
-        const jacobian_function<N,N> _f;
+        const jacobian_function<N,N,T> _f;
         //! preallocated jacobian matrix space for `_f`
               nxn_matrix _f_jacobian_temp;
         //! prediction scaling function
-        const jacobian_function<N,M> _h;
+        const jacobian_function<N,M,T> _h;
         //! preallocated vector space for `_h`
               mx1_vector _h_temp;
         //! preallocated jacobian matrix space for `_h`
               mxn_matrix _h_jacobian_temp;
+        //! preallocated space for `trans(H)`
+              nxm_matrix _h_trans_temp;
+        //! preallocated space for `P * trans(H)`
+              nxm_matrix _gain_numerator_temp;
+        //! `o - h(s)` of the last update, `o - h(s_i) - H_i * (s - s_i)` of the iterated update, see kafi::innovation()
+              mx1_vector _innovation_temp;
+
+        // preallocated resources of the innovation solve (in `TI`)
+
+        //! `H` in `TI`
+              mxn_innovation_matrix _innovation_h_temp;
+        //! `P * trans(H)` in `TI`
+              nxm_innovation_matrix _innovation_numerator_temp;
+        //! `H * P * trans(H) + cN`
+              mxm_innovation_matrix _innovation_covariance_temp;
+        //! `inv(H * P * trans(H) + cN)`, see util::inverse()
+              mxm_innovation_matrix _innovation_inverse_temp;
+        //! `G` in `TI`
+              nxm_innovation_matrix _innovation_gain_temp;
+
+        // preallocated resources of the covariance update
+
+        //! `H * P`
+              mxn_matrix _h_covariance_temp;
+        //! `A * trans(H) - G * cN` of the Joseph form, see kafi::apply_covariance_update()
+              nxm_matrix _joseph_temp;
+        //! form of the covariance update, see kafi::set_covariance_update()
+              covariance_update _covariance_update;
+        //! largest change of the gain between two updates which freezes it, see kafi::set_steady_state_tolerance()
+              T                 _steady_state_tolerance;
+        //! `true` once the gain is frozen
+              bool              _steady_state;
+
+        // preallocated resources of the iterated update
+
+        //! `s - s_i` and `s_i+1` of kafi::apply_iterations()
+              nx1_vector        _iterated_step_temp;
+        //! linearizations per update, see kafi::set_iterated_update()
+              size_t            _max_update_iterations;
+        //! largest change of the state which stops the iterations early
+              T                 _update_tolerance;
+        //! linearizations in the last update
+              size_t            _update_iterations;
+
+        // preallocated resources of the decoupled covariance propagation
+
+        //! propagation over the pending steps
+              util::transition_power<N,T> _transition_power;
+        //! steps per propagation of the prediction error, see kafi::set_covariance_rate()
+              size_t            _covariance_rate;
+        //! steps since the last propagation
+              size_t            _pending_steps;
 
         // const matrices
         //! `Q` (covariance of real world)
         const nxn_matrix               _process_noise;
         //! `cN` (covariance of sensors)
         const mxm_matrix               _sensor_noise;
-        //! `I` (identity matrix)
-        const nxn_matrix               _identity;
+        //! `cN` in `TI`
+        const mxm_innovation_matrix    _innovation_sensor_noise;
 
         //       matrices
-        //! `s_t` (at time `t`), used as the preallocated vector space of `_f`
-              nx1_vector               _state;
+        //! `s_t` (at time `t`) and the preallocated output of `_f`, see kafi::swap_states()
+              std::array<nx1_vector, 2> _states;
+        //! index of `s_t` in `_states`
+              size_t                   _current_state;
         //! `o_t` (reference, the caller is responsible for the allocation)
         std::weak_ptr< mx1_vector >    _observation;
         //! `P_t` 
@@ -327,7 +631,254 @@ class kafi {
               size_t                   _update_count;
 };
 
+/* the filter steps are defined out of the class body, so they are not implicitly inline and the
+ * `extern template` declarations below really keep them out of every translation unit but libkafi
+ */
+
+template<size_t N, size_t M, typename T, typename TI>
+bool kafi<N,M,T,TI>::solve_steady_state(const T tolerance, const size_t max_iterations)
+{
+    if (tolerance <= T(0) || _max_update_iterations > 1UL)
+    {
+        return false;
+    }
+    apply_covariance_propagation();
+    _steady_state_tolerance = tolerance;
+
+    const nxn_matrix & Q = _process_noise;
+    const nxn_matrix & F = _f.jacobian(state(), _f_jacobian_temp);
+    const mxn_matrix & H = _h.jacobian(state(), _h_jacobian_temp);
+    for (size_t iteration = 0UL; iteration < max_iterations && !_steady_state; ++iteration)
+    {
+        _prediction_error = F * _prediction_error * blaze::trans(F) + Q;
+        apply_gain(H);
+        apply_covariance_update(H);
+    }
+    return _steady_state;
+}
+
+template<size_t N, size_t M, typename T, typename TI>
+typename kafi<N,M,T,TI>::return_t kafi<N,M,T,TI>::step()
+{
+    apply_prediction();
+    if (new_data_available())
+    {
+        apply_update();
+    }
+    
+    //print_state_to(std::cerr);
+    DEBUG_MSG_KAFI(*this);
+    return std::make_tuple(state(), _prediction_error, _gain);
+}
+
+template<size_t N, size_t M, typename T, typename TI>
+void kafi<N,M,T,TI>::apply_prediction()
+{
+    if (!_steady_state)
+    {
+        // Using some zero cost abstraction renaming for mathematical understanding
+        const nxn_matrix & P = _prediction_error;
+        const nxn_matrix & Q = _process_noise;
+        const nxn_matrix & F = _f_jacobian_temp;
+
+        if (_covariance_rate == 1UL)
+        {
+            // F at the current state and f(state) in a single call if `_f` is fused
+            _f.evaluate(state(), next_state(), _f_jacobian_temp);
+            _prediction_error = F * P * blaze::trans(F) + Q;
+        }
+        else
+        {
+            // F is held from the first step of the interval, see kafi::set_covariance_rate()
+            if (_pending_steps == 0UL)
+            {
+                _f.evaluate(state(), next_state(), _f_jacobian_temp);
+            }
+            else
+            {
+                _f(state(), next_state());
+            }
+            _pending_steps++;
+            if (_pending_steps >= _covariance_rate)
+            {
+                apply_covariance_propagation();
+            }
+        }
+    }
+    else
+    {
+        _f(state(), next_state());
+    }
+    swap_states();
+    _prediction_count++;
+}
+
+template<size_t N, size_t M, typename T, typename TI>
+void kafi<N,M,T,TI>::apply_covariance_propagation()
+{
+    _transition_power(_f_jacobian_temp, _process_noise, _pending_steps, _prediction_error);
+    _pending_steps = 0UL;
+}
+
+template<size_t N, size_t M, typename T, typename TI>
+void kafi<N,M,T,TI>::apply_update()
+{
+    // Using zero cost abstraction renaming for mathematical understanding
+    const mx1_vector & h  = _h_temp;
+    const mxn_matrix & H  = _h_jacobian_temp;
+    const nx1_vector & s  = state();
+    std::shared_ptr<mx1_vector> o  = _observation.lock();
+    const nxm_matrix & G  = _gain;
+
+    if (_steady_state)
+    {
+        _h(s, _h_temp);
+        _innovation_temp = *o - h;
+        next_state() = s + G * _innovation_temp;
+        swap_states();
+        _update_count++;
+        return;
+    }
+
+    // the gain needs the prediction error of the current step
+    apply_covariance_propagation();
+
+    // h(state) and H in a single call if `_h` is fused
+    _h.evaluate(s, _h_temp, _h_jacobian_temp);
+    apply_gain(H);
+    _innovation_temp = *o - h;
+    next_state() = s + G * _innovation_temp;
+    _update_iterations = 1UL;
+    if (_max_update_iterations > 1UL)
+    {
+        apply_iterations(*o);
+    }
+    swap_states();
+    apply_covariance_update(H);
+    _update_count++;
+}
+
+template<size_t N, size_t M, typename T, typename TI>
+void kafi<N,M,T,TI>::apply_gain(const mxn_matrix & H)
+{
+    const nxn_matrix & P  = _prediction_error;
+
+    // P * H^T is shared by the innovation covariance and the gain
+    _h_trans_temp        = blaze::trans(H);
+    _gain_numerator_temp = P * _h_trans_temp;
+
+    // innovation solve in TI (a plain copy if `T == TI`)
+    _innovation_h_temp          = H;
+    _innovation_numerator_temp  = _gain_numerator_temp;
+    const mxn_innovation_matrix & iH  = _innovation_h_temp;
+    const nxm_innovation_matrix & iPH = _innovation_numerator_temp;
+    const mxm_innovation_matrix & icN = _innovation_sensor_noise;
+
+    _innovation_covariance_temp = iH * iPH + icN;
+    util::inverse(_innovation_covariance_temp, _innovation_inverse_temp);
+    _innovation_gain_temp       = iPH * _innovation_inverse_temp;
+
+    if (_steady_state_tolerance > T(0) && _max_update_iterations == 1UL)
+    {
+        using std::abs;
+        T change = T(0);
+        for (size_t row = 0UL; row < N; ++row)
+        {
+            for (size_t col = 0UL; col < M; ++col)
+            {
+                const T current = static_cast<T>(_innovation_gain_temp(row, col));
+                change = std::max(change, abs(current - _gain(row, col)));
+            }
+        }
+        _steady_state = change <= _steady_state_tolerance;
+    }
+    _gain = _innovation_gain_temp;
+}
+
+template<size_t N, size_t M, typename T, typename TI>
+void kafi<N,M,T,TI>::apply_iterations(const mx1_vector & o)
+{
+    using std::abs;
+    // Using zero cost abstraction renaming for mathematical understanding
+    const mx1_vector & h  = _h_temp;
+    const mxn_matrix & H  = _h_jacobian_temp;
+    const nx1_vector & s  = state();
+    const nxm_matrix & G  = _gain;
+          nx1_vector & si = next_state();
+
+    while (_update_iterations < _max_update_iterations)
+    {
+        _h.evaluate(si, _h_temp, _h_jacobian_temp);
+        apply_gain(H);
+
+        // o - h(s_i) - H_i * (s - s_i)
+        _iterated_step_temp = s - si;
+        _innovation_temp    = o - h - H * _iterated_step_temp;
+        _iterated_step_temp = s + G * _innovation_temp;
+        _update_iterations++;
+
+        T change = T(0);
+        for (size_t row = 0UL; row < N; ++row)
+        {
+            change = std::max(change, static_cast<T>(abs(_iterated_step_temp(row, 0) - si(row, 0))));
+        }
+        si = _iterated_step_temp;
+        if (change <= _update_tolerance)
+        {
+            break;
+        }
+    }
+}
+
+template<size_t N, size_t M, typename T, typename TI>
+void kafi<N,M,T,TI>::apply_covariance_update(const mxn_matrix & H)
+{
+    const nxm_matrix & G  = _gain;
+    const mxm_matrix & cN = _sensor_noise;
+          nxn_matrix & P  = _prediction_error;
+
+    _h_covariance_temp = H * P;
+    P -= G * _h_covariance_temp;
+    if (_covariance_update == covariance_update::standard)
+    {
+        return;
+    }
+
+    _joseph_temp  = P * _h_trans_temp;
+    _joseph_temp -= G * cN;
+    for (size_t row = 0UL; row < N; ++row)
+    {
+        for (size_t col = row; col < N; ++col)
+        {
+            T sum = P(row, col);
+            for (size_t k = 0UL; k < M; ++k)
+            {
+                sum -= _joseph_temp(row, k) * G(col, k);
+            }
+            // the lower triangle is not read anymore
+            P(row, col) = sum;
+            P(col, row) = sum;
+        }
+    }
+}
+
 } // namespace kafi
 
+/* explicit instantiations of libkafi, see INSTANTIATIONS_KAFI in CMakeLists.txt
+ *
+ * library/instantiations.cc defines KAFI_INSTANTIATION_DEFINITIONS and compiles the instantiations once,
+ * every other translation unit only sees the `extern template` declarations and links against libkafi
+ */
+#ifdef KAFI_INSTANTIATION_DEFINITIONS
+    #define KAFI_INSTANTIATE_JACOBIAN_FUNCTION(N, M, T) template class kafi::jacobian_function<N, M, T>;
+    #define KAFI_INSTANTIATE_KAFI(N, M, T)              template class kafi::kafi<N, M, T>;
+#else
+    #define KAFI_INSTANTIATE_JACOBIAN_FUNCTION(N, M, T) extern template class kafi::jacobian_function<N, M, T>;
+    #define KAFI_INSTANTIATE_KAFI(N, M, T)              extern template class kafi::kafi<N, M, T>;
+#endif
+#include "autogen-KAFI-instantiations.h"
+#undef KAFI_INSTANTIATE_JACOBIAN_FUNCTION
+#undef KAFI_INSTANTIATE_KAFI
+
 /*! @} End of Doxygen Groups*/
 #endif // KAFI_H
@@ -0,0 +1,330 @@
+// Copyright 2018 municHMotorsport e.V. <info@munichmotorsport.de>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef LINEAR_KAFI_H
+#define LINEAR_KAFI_H
+
+#include <iostream>
+#include <memory>
+#include <tuple>
+#include "jacobian_function.h"
+#include "small_matrix.h"
+#include "util.h"
+#include "autogen-KAFI-macros.h"
+
+/*!
+ *  \addtogroup kafi
+ *  @{
+ */
+
+namespace kafi {
+
+/** \brief A linear Kalman filter, the models are the matrices `F` and `H` instead of kafi::jacobian_function
+ *
+ * The same results as kafi::kafi with `f(s) = F * s` and `h(s) = H * s`, but there are no `std::function`
+ * calls and no jacobian evaluation. `trans(F)` and `trans(H)` are computed once at construction, and the
+ * symmetry of `P` turns `H * P` of the covariance update into `trans(P * trans(H))`, which is already
+ * computed for the gain. Only the upper triangle of the updated `P` is computed and mirrored.
+ *
+ * Template arguments:
+ * * `N`  = state dimensions
+ * * `M`  = sensor dimensions
+ * * `T`  = scalar type (default: `double`)
+ *
+ * See examples at [tests/equivalence_tests.cc](../../tests/equivalence_tests.cc)
+ */
+template< size_t   N            // state  dimensions (N x 1)
+        , size_t   M            // sensor dimensions (M x 1)
+        , typename T = double > // scalar type
+class linear_kafi {
+
+    // typenames
+    public:
+        //! self type for conciseness
+        using self_t     = linear_kafi<N,M,T>;
+        //! scalar type of the state, the models and the propagation
+        using value_t    = T;
+        //! copied typename for conciseness
+        using nx1_vector = typename jacobian_function<N,M,T>::nx1_vector;
+        //! copied typename for conciseness
+        using mx1_vector = typename jacobian_function<N,M,T>::mx1_vector;
+        //! copied typename for conciseness
+        using mxn_matrix = typename jacobian_function<N,M,T>::mxn_matrix;
+        //! copied typename for conciseness
+        using nxm_matrix = typename jacobian_function<N,M,T>::nxm_matrix;
+        //! copied typename for conciseness
+        using mxm_matrix = typename jacobian_function<N,M,T>::mxm_matrix;
+        //! copied typename for conciseness
+        using nxn_matrix = typename jacobian_function<N,M,T>::nxn_matrix;
+        /** \brief Shorthand for a useful return type for the kalman filter, references valid until the next step()
+         *  * `const nx1_vector & = std::get<0>(x)` = state
+         *  * `const nxn_matrix & = std::get<1>(x)` = prediction error
+         *  * `const nxm_matrix & = std::get<2>(x)` = gain
+         */
+        using return_t   = std::tuple<const nx1_vector &,
+                                      const nxn_matrix &,
+                                      const nxm_matrix &>;
+
+    // constructors
+    public:
+
+        /** \brief Default constructor
+         *
+         * Arguments:
+         * * `const nxn_matrix & transition`: `F` of the state transition `f(s) = F * s`
+         * * `const mxn_matrix & prediction_scaling`: `H` of the prediction scaling `h(s) = H * s`
+         * * the remaining arguments are the same as the ones of kafi::kafi
+         *
+         * Initializing `prediction_error` to identity matrix via util::create_identity<N, blaze::rowMajor, T>()
+         */
+        linear_kafi(const nxn_matrix & transition
+                  , const mxn_matrix & prediction_scaling
+                  ,       nx1_vector   starting_state
+                  , const nxn_matrix & process_noise
+                  , const mxm_matrix & sensor_noise)
+        : linear_kafi<N,M,T>(transition
+                           , prediction_scaling
+                           , starting_state
+                           , process_noise
+                           , sensor_noise
+                           , util::create_identity<N, blaze::rowMajor, T>())
+        { }
+
+        /**
+         * \brief The same as the default constructor, but with custom `prediction error` initialization
+         */
+        linear_kafi(const nxn_matrix & transition
+                  , const mxn_matrix & prediction_scaling
+                  ,       nx1_vector   starting_state
+                  , const nxn_matrix & process_noise
+                  , const mxm_matrix & sensor_noise
+                  , const nxn_matrix & prediction_error)
+        : _transition(transition)
+        , _transition_trans(blaze::trans(transition))
+        , _prediction_scaling(prediction_scaling)
+        , _prediction_scaling_trans(blaze::trans(prediction_scaling))
+        , _process_noise(process_noise)
+        , _sensor_noise(sensor_noise)
+        , _propagation_temp(0)
+        , _state_temp(0)
+        , _gain_numerator_temp(0)
+        , _innovation_covariance_temp(0)
+        , _innovation_inverse_temp(0)
+        , _innovation_temp(0)
+        , _state(starting_state)
+        , _prediction_error(prediction_error)
+        , _gain(0)
+        , _new_data_available(false)
+        , _prediction_count(0)
+        , _update_count(0)
+        { }
+
+        //! Copy constructor is deleted because linear_kafi owns multiple different potentially big matrices
+        linear_kafi(const self_t & other) = delete;
+        //! Move constructor is deleted like the one of kafi::kafi
+        linear_kafi(const self_t && other) = delete;
+
+    // methods
+    public:
+        /**
+         * The same as kafi::set_current_observation()
+         */
+        void set_current_observation(std::shared_ptr<mx1_vector> observation)
+        {
+            _observation = observation;
+            _new_data_available = true;
+        }
+
+        /**\brief Main function that runs the Kalman Filter based on new or old observation, and apply the prediction and update step
+         *
+         * Modifying:
+         *     * `_gain`
+         *     * `_state`
+         *     * `_prediction_error`
+         *
+         * Return:
+         *     * tuple of references, valid until the next step()
+         *         - state
+         *         - prediction_error
+         *         - gain
+         */
+        return_t step()
+        {
+            apply_prediction();
+            if (new_data_available())
+            {
+                apply_update();
+            }
+
+            DEBUG_MSG_KAFI(*this);
+            return return_t(_state, _prediction_error, _gain);
+        }
+
+        /** \brief Overloading stream operator for logging purposes, the same format as kafi::kafi
+         */
+        friend std::ostream & operator<<(std::ostream& stream, const self_t & rhs)
+        {
+            std::shared_ptr<mx1_vector> o = rhs._observation.lock();
+            const char * line = "============================\n";
+            stream << "Kafi (linear):\n"
+                   << "  Update      # calls: "   << rhs._update_count     << '\n'
+                   << "  Predictions # calls: "   << rhs._prediction_count << '\n'
+                   << " [S] _state:\n"            << rhs._state            << line;
+            if (o)
+            {
+                stream << " [O] _observation:\n"  << (*o)                  << line;
+            }
+            stream << " [P] _prediction_error:\n" << rhs._prediction_error << line
+                   << " [G] _gain:\n"             << rhs._gain             << line;
+            return stream;
+        }
+
+        /** print helper for conciseness
+         */
+        void print_state_to(std::ostream & stream)
+        {
+            stream << *this;
+        }
+
+    //! Private methods
+    private:
+        /** \brief A check if the flag `_new_data_available` is true and flips it
+         */
+        bool new_data_available()
+        {
+            if (_new_data_available) {
+                _new_data_available = false;
+                return true;
+            } else {
+                return false;
+            }
+        }
+
+        /** \brief Applying the prediction formulae with the precomputed `trans(F)`
+         *
+         * Modifying:
+         *     * `_prediction_error`
+         *     * `_state`
+         *     * `_prediction_count`
+         */
+        void apply_prediction()
+        {
+            const nxn_matrix & F = _transition;
+            const nxn_matrix & Q = _process_noise;
+
+            _propagation_temp = F * _prediction_error;
+            _prediction_error = _propagation_temp * _transition_trans + Q;
+            _state_temp       = F * _state;
+            _state            = _state_temp;
+            _prediction_count++;
+        }
+
+        /** \brief Applying the update formulae with the precomputed `trans(H)`
+         *
+         * **Invariant**:
+         *     * `_observation` has to be initialized, implemented through linear_kafi::new_data_available()
+         *
+         * Modifying:
+         *     * `_gain`
+         *     * `_state`
+         *     * `_prediction_error`
+         *     * `_update_count`
+         *     * the preallocated temporaries
+         */
+        void apply_update()
+        {
+            const mxn_matrix & H  = _prediction_scaling;
+            const mxm_matrix & cN = _sensor_noise;
+                  nxn_matrix & P  = _prediction_error;
+            std::shared_ptr<mx1_vector> o = _observation.lock();
+
+            // P * H^T is shared by the innovation covariance, the gain and the covariance update
+            _gain_numerator_temp        = P * _prediction_scaling_trans;
+            _innovation_covariance_temp = H * _gain_numerator_temp + cN;
+            util::inverse(_innovation_covariance_temp, _innovation_inverse_temp);
+            _gain                       = _gain_numerator_temp * _innovation_inverse_temp;
+
+            _innovation_temp  = *o - H * _state;
+            _state           += _gain * _innovation_temp;
+
+            // P - G * H * P with H * P = trans(P * H^T), the upper triangle is mirrored to keep P exactly
+            // symmetric, otherwise the rounding errors of the asymmetric part grow in every step
+            for (size_t row = 0UL; row < N; ++row)
+            {
+                for (size_t col = row; col < N; ++col)
+                {
+                    T sum = P(row, col);
+                    for (size_t k = 0UL; k < M; ++k)
+                    {
+                        sum -= _gain(row, k) * _gain_numerator_temp(col, k);
+                    }
+                    P(row, col) = sum;
+                    P(col, row) = sum;
+                }
+            }
+            _update_count++;
+        }
+
+    // member
+    private:
+        // const matrices
+        //! `F` of `f(s) = F * s`
+        const nxn_matrix               _transition;
+        //! `trans(F)`
+        const nxn_matrix               _transition_trans;
+        //! `H` of `h(s) = H * s`
+        const mxn_matrix               _prediction_scaling;
+        //! `trans(H)`
+        const nxm_matrix               _prediction_scaling_trans;
+        //! `Q` (covariance of real world)
+        const nxn_matrix               _process_noise;
+        //! `cN` (covariance of sensors)
+        const mxm_matrix               _sensor_noise;
+
+        // preallocated resources
+        //! `F * P`
+              nxn_matrix               _propagation_temp;
+        //! `F * s`
+              nx1_vector               _state_temp;
+        //! `P * trans(H)`
+              nxm_matrix               _gain_numerator_temp;
+        //! `H * P * trans(H) + cN`
+              mxm_matrix               _innovation_covariance_temp;
+        //! `inv(H * P * trans(H) + cN)`, see util::inverse()
+              mxm_matrix               _innovation_inverse_temp;
+        //! `o - H * s`
+              mx1_vector               _innovation_temp;
+
+        //       matrices
+        //! `s_t` (at time `t`)
+              nx1_vector               _state;
+        //! `o_t` (reference, the caller is responsible for the allocation)
+        std::weak_ptr< mx1_vector >    _observation;
+        //! `P_t`
+              nxn_matrix               _prediction_error;
+        //! `G_t`
+              nxm_matrix               _gain;
+        //! used to run the linear_kafi::apply_update() function, changed in linear_kafi::new_data_available()
+              bool                     _new_data_available;
+        // logging
+        //! used for logging purposes, tracks how often linear_kafi::apply_prediction() was run
+              size_t                   _prediction_count;
+        //! used for logging purposes, tracks how often linear_kafi::apply_update() was run
+              size_t                   _update_count;
+};
+
+} // namespace kafi
+
+/*! @} End of Doxygen Groups*/
+#endif // LINEAR_KAFI_H
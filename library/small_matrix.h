@@ -0,0 +1,430 @@
+// Copyright 2018 municHMotorsport e.V. <info@munichmotorsport.de>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KAFI_SMALL_MATRIX_H
+#define KAFI_SMALL_MATRIX_H
+
+/*!
+ *  \addtogroup kafi::util
+ *  @{
+ */
+
+#include <blaze/Math.h>
+#include <cmath>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include "util.h"
+
+namespace kafi
+{
+    namespace util {
+
+        /** \brief Whether `blaze::inv` (and therefore LAPACK) can invert matrices of the scalar type `T`
+         *
+         * Every other scalar type, e.g. kafi::fixed, uses the built-in util::gauss_jordan_inverse().
+         * Always `false` if `KAFI_NO_LAPACK` is defined (cmake: `-DENABLE_HEADER_ONLY_KAFI=ON`).
+         */
+        template< typename T >
+        struct uses_lapack : std::integral_constant<bool,
+#ifdef KAFI_NO_LAPACK
+                                                       false
+#else
+                                                       std::is_same<T, float>::value
+                                                    || std::is_same<T, double>::value
+#endif
+                                                   > { };
+
+        //! dimensions up to which util::inverse() of floating point matrices never calls LAPACK, a function call costs more than the kernel
+        const size_t max_closed_form_dimension = 3UL;
+
+        /** \brief Gauss-Jordan elimination with partial pivoting of `work` into `output = inv(work)`
+         *
+         * Works on any dense matrix type with runtime or compile-time dimensions, e.g. the views of
+         * kafi::dynamic_kafi. `work` has to hold a copy of the matrix to invert and is overwritten, so
+         * the caller decides where the only temporary lives. Never allocates.
+         *
+         * Throws `std::invalid_argument` if `work` is singular, like `blaze::inv`
+         */
+        template< typename Work
+                , typename Output >
+        void gauss_jordan_eliminate(Work & work, Output & output)
+        {
+            using T = typename Work::ElementType;
+            const size_t M = work.rows();
+
+            for (size_t row = 0UL; row < M; ++row)
+            {
+                for (size_t col = 0UL; col < M; ++col)
+                {
+                    output(row, col) = row == col ? T(1) : T(0);
+                }
+            }
+
+            for (size_t col = 0UL; col < M; ++col)
+            {
+                // largest absolute value as pivot
+                size_t pivot     = col;
+                T      pivot_abs = work(col, col) < T(0) ? -work(col, col) : work(col, col);
+                for (size_t row = col + 1UL; row < M; ++row)
+                {
+                    const T candidate = work(row, col) < T(0) ? -work(row, col) : work(row, col);
+                    if (pivot_abs < candidate)
+                    {
+                        pivot     = row;
+                        pivot_abs = candidate;
+                    }
+                }
+                if (pivot_abs == T(0))
+                {
+                    throw std::invalid_argument("Inversion of singular matrix failed");
+                }
+                if (pivot != col)
+                {
+                    for (size_t k = 0UL; k < M; ++k)
+                    {
+                        std::swap(work(col, k),   work(pivot, k));
+                        std::swap(output(col, k), output(pivot, k));
+                    }
+                }
+
+                // divides instead of multiplying with the reciprocal, which loses precision in fixed-point
+                const T diagonal = work(col, col);
+                for (size_t k = 0UL; k < M; ++k)
+                {
+                    work(col, k)   = work(col, k)   / diagonal;
+                    output(col, k) = output(col, k) / diagonal;
+                }
+
+                for (size_t row = 0UL; row < M; ++row)
+                {
+                    if (row == col) continue;
+                    const T factor = work(row, col);
+                    if (factor == T(0)) continue;
+                    for (size_t k = 0UL; k < M; ++k)
+                    {
+                        work(row, k)   -= factor * work(col, k);
+                        output(row, k) -= factor * output(col, k);
+                    }
+                }
+            }
+        }
+
+        /** \brief Gauss-Jordan inversion with partial pivoting for small static matrices of any scalar type
+         *
+         * Needs only `+`, `-`, `*`, `/` and `<` of `T`, so it works without LAPACK and without floating point.
+         * No heap allocation, the only temporary is a copy of `input` on the stack. All loop bounds are the
+         * compile-time `M`, so the compiler can unroll them for the small `M <= 8` of the innovation covariance.
+         *
+         * Throws `std::invalid_argument` if `input` is singular, like `blaze::inv`
+         */
+        template< typename T
+                , size_t   M
+                , bool     SO >
+        void gauss_jordan_inverse(const blaze::StaticMatrix<T, M, M, SO> & input
+                                ,       blaze::StaticMatrix<T, M, M, SO> & output)
+        {
+            blaze::StaticMatrix<T, M, M, SO> work(input);
+            gauss_jordan_eliminate(work, output);
+        }
+
+        /** \brief Closed form inverse of a 1x1 matrix
+         *
+         * Throws `std::invalid_argument` if `input` is singular, like `blaze::inv`
+         */
+        template< typename T
+                , bool     SO >
+        void closed_form_inverse(const blaze::StaticMatrix<T, 1, 1, SO> & input
+                               ,       blaze::StaticMatrix<T, 1, 1, SO> & output)
+        {
+            if (input(0, 0) == T(0))
+            {
+                throw std::invalid_argument("Inversion of singular matrix failed");
+            }
+            output(0, 0) = T(1) / input(0, 0);
+        }
+
+        /** \brief Closed form inverse of a 2x2 matrix, adjugate divided by the determinant
+         *
+         * Throws `std::invalid_argument` if `input` is singular, like `blaze::inv`
+         */
+        template< typename T
+                , bool     SO >
+        void closed_form_inverse(const blaze::StaticMatrix<T, 2, 2, SO> & input
+                               ,       blaze::StaticMatrix<T, 2, 2, SO> & output)
+        {
+            const T a = input(0, 0), b = input(0, 1);
+            const T c = input(1, 0), d = input(1, 1);
+
+            const T det = a * d - b * c;
+            if (det == T(0))
+            {
+                throw std::invalid_argument("Inversion of singular matrix failed");
+            }
+            // divides instead of multiplying with the reciprocal, which loses precision in fixed-point
+            output(0, 0) =  d / det;  output(0, 1) = -b / det;
+            output(1, 0) = -c / det;  output(1, 1) =  a / det;
+        }
+
+        /** \brief Closed form inverse of a 3x3 matrix, adjugate divided by the determinant
+         *
+         * Throws `std::invalid_argument` if `input` is singular, like `blaze::inv`
+         */
+        template< typename T
+                , bool     SO >
+        void closed_form_inverse(const blaze::StaticMatrix<T, 3, 3, SO> & input
+                               ,       blaze::StaticMatrix<T, 3, 3, SO> & output)
+        {
+            const T a = input(0, 0), b = input(0, 1), c = input(0, 2);
+            const T d = input(1, 0), e = input(1, 1), f = input(1, 2);
+            const T g = input(2, 0), h = input(2, 1), i = input(2, 2);
+
+            // cofactors of the first row are reused by the determinant
+            const T A = e * i - f * h;
+            const T B = f * g - d * i;
+            const T C = d * h - e * g;
+
+            const T det = a * A + b * B + c * C;
+            if (det == T(0))
+            {
+                throw std::invalid_argument("Inversion of singular matrix failed");
+            }
+            output(0, 0) = A / det;  output(0, 1) = (c * h - b * i) / det;  output(0, 2) = (b * f - c * e) / det;
+            output(1, 0) = B / det;  output(1, 1) = (a * i - c * g) / det;  output(1, 2) = (c * d - a * f) / det;
+            output(2, 0) = C / det;  output(2, 1) = (b * g - a * h) / det;  output(2, 2) = (a * e - b * d) / det;
+        }
+
+        //! which kernel util::inverse() uses
+        enum class inverse_kernel { closed_form, lapack, gauss_jordan };
+
+        //! selects the kernel of util::inverse() at compile time
+        template< typename T
+                , size_t   M >
+        using inverse_kernel_t = std::integral_constant<inverse_kernel,
+                                      std::is_floating_point<T>::value
+                                   && M <= max_closed_form_dimension ? inverse_kernel::closed_form
+                                    : uses_lapack<T>::value          ? inverse_kernel::lapack
+                                    :                                  inverse_kernel::gauss_jordan>;
+
+        //! closed form for tiny matrices
+        template< typename T
+                , size_t   M
+                , bool     SO >
+        void inverse(const blaze::StaticMatrix<T, M, M, SO> & input
+                   ,       blaze::StaticMatrix<T, M, M, SO> & output
+                   , std::integral_constant<inverse_kernel, inverse_kernel::closed_form>)
+        {
+            closed_form_inverse(input, output);
+        }
+
+        //! LAPACK backed inversion
+        template< typename T
+                , size_t   M
+                , bool     SO >
+        void inverse(const blaze::StaticMatrix<T, M, M, SO> & input
+                   ,       blaze::StaticMatrix<T, M, M, SO> & output
+                   , std::integral_constant<inverse_kernel, inverse_kernel::lapack>)
+        {
+            output = blaze::inv(input);
+        }
+
+        //! built-in inversion for scalar types LAPACK doesn't know and for builds without LAPACK
+        template< typename T
+                , size_t   M
+                , bool     SO >
+        void inverse(const blaze::StaticMatrix<T, M, M, SO> & input
+                   ,       blaze::StaticMatrix<T, M, M, SO> & output
+                   , std::integral_constant<inverse_kernel, inverse_kernel::gauss_jordan>)
+        {
+            gauss_jordan_inverse(input, output);
+        }
+
+        /** \brief `output = inv(input)` with the cheapest kernel for `T` and `M`
+         *
+         * * floating point and `M <= 3`: closed form, the call overhead of LAPACK is larger than the kernel
+         * * `float` and `double`: `blaze::inv` (LAPACK)
+         * * fixed point always eliminates with pivoting, the determinant of a small covariance underflows in Q16
+         * * otherwise, or without LAPACK (`KAFI_NO_LAPACK`): util::gauss_jordan_inverse()
+         *
+         * Template arguments:
+         * * `T`  = scalar type
+         * * `M`  = number of rows and columns
+         * * `SO` = Storage order, e.g `blaze::rowMajor`
+         */
+        template< typename T
+                , size_t   M
+                , bool     SO >
+        void inverse(const blaze::StaticMatrix<T, M, M, SO> & input
+                   ,       blaze::StaticMatrix<T, M, M, SO> & output)
+        {
+            inverse(input, output, inverse_kernel_t<T, M>());
+        }
+
+        /** \brief Lower triangular `output` with `input = output * trans(output)` of a symmetric positive semidefinite `input`
+         *
+         * A zero pivot, e.g. a state without process noise, leaves a zero column, so semidefinite noise matrices
+         * have a root as well. Only the lower triangle of `input` is read, the upper triangle of `output` is `0`.
+         *
+         * Throws `std::invalid_argument` if `input` has a negative pivot, i.e. is not positive semidefinite
+         */
+        template< typename Input
+                , typename Output >
+        void cholesky_factor(const Input & input, Output & output)
+        {
+            using T = typename Output::ElementType;
+            using std::sqrt;
+            const size_t M = input.rows();
+
+            for (size_t col = 0UL; col < M; ++col)
+            {
+                for (size_t row = 0UL; row < col; ++row)
+                {
+                    output(row, col) = T(0);
+                }
+
+                T diagonal = input(col, col);
+                for (size_t k = 0UL; k < col; ++k)
+                {
+                    diagonal -= output(col, k) * output(col, k);
+                }
+                if (diagonal < T(0))
+                {
+                    throw std::invalid_argument("Cholesky factorization of a not positive semidefinite matrix failed");
+                }
+                output(col, col) = sqrt(diagonal);
+
+                for (size_t row = col + 1UL; row < M; ++row)
+                {
+                    T value = input(row, col);
+                    for (size_t k = 0UL; k < col; ++k)
+                    {
+                        value -= output(row, k) * output(col, k);
+                    }
+                    output(row, col) = output(col, col) == T(0) ? T(0) : value / output(col, col);
+                }
+            }
+        }
+
+        /** \brief Unit upper triangular `U` and diagonal `d` with `input = U * diag(d) * trans(U)` of a symmetric positive semidefinite `input`
+         *
+         * No square roots, `d` is a `(M x 1)` vector. A zero element of `d` leaves the column of `U` above the
+         * diagonal `0`. Only the upper triangle of `input` is read, the lower triangle of `U` is `0`.
+         *
+         * Throws `std::invalid_argument` if an element of `d` is negative, i.e. `input` is not positive semidefinite
+         */
+        template< typename Input
+                , typename Factor
+                , typename Diagonal >
+        void ud_factor(const Input & input, Factor & U, Diagonal & d)
+        {
+            using T = typename Factor::ElementType;
+            const size_t M = input.rows();
+
+            for (size_t col = M; col-- > 0UL; )
+            {
+                T diagonal = input(col, col);
+                for (size_t k = col + 1UL; k < M; ++k)
+                {
+                    diagonal -= d(k, 0) * U(col, k) * U(col, k);
+                }
+                if (diagonal < T(0))
+                {
+                    throw std::invalid_argument("UD factorization of a not positive semidefinite matrix failed");
+                }
+                d(col, 0)   = diagonal;
+                U(col, col) = T(1);
+
+                for (size_t row = 0UL; row < col; ++row)
+                {
+                    T value = input(row, col);
+                    for (size_t k = col + 1UL; k < M; ++k)
+                    {
+                        value -= d(k, 0) * U(row, k) * U(col, k);
+                    }
+                    U(row, col) = diagonal == T(0) ? T(0) : value / diagonal;
+                }
+                for (size_t row = col + 1UL; row < M; ++row)
+                {
+                    U(row, col) = T(0);
+                }
+            }
+        }
+
+        /** \brief Householder QR of `work` in place, keeps only `R`
+         *
+         * `work` has at least as many rows as columns. Afterwards its first `columns()` rows are the upper
+         * triangular `R` with a non-negative diagonal and the remaining rows are `0`, so that
+         * `trans(R) * R == trans(work) * work`. `Q` is never formed, the square-root filters only need `R`.
+         */
+        template< typename Work >
+        void householder_triangularize(Work & work)
+        {
+            using T = typename Work::ElementType;
+            using std::sqrt;
+            const size_t rows    = work.rows();
+            const size_t columns = work.columns();
+
+            for (size_t col = 0UL; col < columns; ++col)
+            {
+                T norm = T(0);
+                for (size_t row = col; row < rows; ++row)
+                {
+                    norm += work(row, col) * work(row, col);
+                }
+                norm = sqrt(norm);
+                if (norm == T(0)) continue;
+
+                // reflects the column onto -sign(x_0) * |x| * e_0, the reflector v is stored in the column itself
+                const T alpha = work(col, col) < T(0) ? norm : -norm;
+                // |v|^2 = |x|^2 - 2 * alpha * x_0 + alpha^2
+                const T v_squared = T(2) * (norm * norm - alpha * work(col, col));
+                work(col, col) -= alpha;
+
+                for (size_t k = col + 1UL; k < columns; ++k)
+                {
+                    T dot = T(0);
+                    for (size_t row = col; row < rows; ++row)
+                    {
+                        dot += work(row, col) * work(row, k);
+                    }
+                    const T factor = T(2) * dot / v_squared;
+                    for (size_t row = col; row < rows; ++row)
+                    {
+                        work(row, k) -= factor * work(row, col);
+                    }
+                }
+
+                work(col, col) = alpha;
+                for (size_t row = col + 1UL; row < rows; ++row)
+                {
+                    work(row, col) = T(0);
+                }
+            }
+
+            // R is unique up to the signs of its rows
+            for (size_t row = 0UL; row < columns; ++row)
+            {
+                if (!(work(row, row) < T(0))) continue;
+                for (size_t col = row; col < columns; ++col)
+                {
+                    work(row, col) = -work(row, col);
+                }
+            }
+        }
+
+    } // namespace util
+} // namespace kafi
+
+/*! @} End of Doxygen Groups*/
+#endif // KAFI_SMALL_MATRIX_H
@@ -0,0 +1,341 @@
+// Copyright 2018 municHMotorsport e.V. <info@munichmotorsport.de>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KAFI_SPARSE_CHOLESKY_H
+#define KAFI_SPARSE_CHOLESKY_H
+
+/*!
+ *  \addtogroup kafi::util
+ *  @{
+ */
+
+#include <blaze/Math.h>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+namespace kafi
+{
+    namespace util {
+
+        /** \brief Sparse Cholesky factorization `A = L * trans(L)` of a symmetric positive definite `blaze::CompressedMatrix`
+         *
+         * Up-looking factorization: the pattern of every row of `L` is the reach of the row of `A` in the elimination
+         * tree, so only the structural non-zeros of `L` are touched. The rows are eliminated in their natural order,
+         * there is no fill-reducing permutation, banded matrices like the information matrix of a chain don't fill in.
+         *
+         * `L` is stored column-wise, the diagonal is the first element of every column. The buffers are kept
+         * between two factorizations and only grow. An existing factorization can be updated with sparse rank-1
+         * terms, see sparse_cholesky::update(), and inverted at its own pattern, see sparse_cholesky::invert().
+         *
+         * Template arguments:
+         * * `T`  = scalar type (default: `double`)
+         */
+        template< typename T = double >
+        class sparse_cholesky {
+
+            public:
+                //! the row-major sparse matrix type of the input
+                using sparse_matrix_t = blaze::CompressedMatrix<T, blaze::rowMajor>;
+
+            public:
+                /** \brief Factorizes the symmetric `A`, only its lower triangle is read
+                 *
+                 * Throws `std::invalid_argument` if `A` isn't positive definite.
+                 */
+                void factorize(const sparse_matrix_t & A)
+                {
+                    analyze(A);
+
+                    const size_t n = A.rows();
+                    _x.assign(n, T(0));
+                    _next.assign(_column_begin.begin(), _column_begin.end() - 1);
+                    for (size_t k = 0UL; k < n; ++k)
+                    {
+                        // scatter the lower triangle of row k of A
+                        const size_t top = reach(A, k);
+                        T diagonal = T(0);
+                        for (auto element = A.cbegin(k); element != A.cend(k) && element->index() <= k; ++element)
+                        {
+                            if (element->index() == k) diagonal = element->value();
+                            else _x[element->index()] = element->value();
+                        }
+
+                        // row k of L by a sparse triangular solve with the rows above
+                        for (size_t position = top; position < n; ++position)
+                        {
+                            const size_t i   = _stack[position];
+                            const T      lki = _x[i] / _values[_column_begin[i]];
+                            _x[i] = T(0);
+                            for (size_t p = _column_begin[i] + 1UL; p < _next[i]; ++p)
+                            {
+                                _x[_indices[p]] -= _values[p] * lki;
+                            }
+                            diagonal -= lki * lki;
+                            const size_t p = _next[i]++;
+                            _indices[p] = k;
+                            _values[p]  = lki;
+                        }
+
+                        if (!(diagonal > T(0)))
+                        {
+                            throw std::invalid_argument("Sparse cholesky factorization of a not positive definite matrix failed");
+                        }
+                        using std::sqrt;
+                        const size_t p = _next[k]++;
+                        _indices[p] = k;
+                        _values[p]  = sqrt(diagonal);
+                    }
+                }
+
+                /** \brief Solves `A * x = b` with the last factorization, `b` and `x` are `(N x 1)` and may be the same
+                 */
+                template< typename Input
+                        , typename Output >
+                void solve(const Input & b, Output & x)
+                {
+                    const size_t n = _column_begin.size() - 1UL;
+                    for (size_t row = 0UL; row < n; ++row)
+                    {
+                        _x[row] = b(row, 0);
+                    }
+                    // L * y = b
+                    for (size_t col = 0UL; col < n; ++col)
+                    {
+                        _x[col] /= _values[_column_begin[col]];
+                        for (size_t p = _column_begin[col] + 1UL; p < _column_begin[col + 1UL]; ++p)
+                        {
+                            _x[_indices[p]] -= _values[p] * _x[col];
+                        }
+                    }
+                    // trans(L) * x = y
+                    for (size_t col = n; col-- > 0UL; )
+                    {
+                        for (size_t p = _column_begin[col] + 1UL; p < _column_begin[col + 1UL]; ++p)
+                        {
+                            _x[col] -= _values[p] * _x[_indices[p]];
+                        }
+                        _x[col] /= _values[_column_begin[col]];
+                    }
+                    for (size_t row = 0UL; row < n; ++row)
+                    {
+                        x(row, 0) = _x[row];
+                        _x[row]   = T(0);
+                    }
+                }
+
+                /** \brief Factorization of `A + trans(V) * V` in place of the last one, a rank-1 update per row of `V`
+                 *
+                 * The pattern of `trans(V) * V` has to be a part of the factorized pattern, pad `A` with it before
+                 * factorize(). Every row only touches the columns on the path from its first non-zero to the root of
+                 * the elimination tree, an update of few states costs proportionally little.
+                 */
+                void update(const sparse_matrix_t & V)
+                {
+                    using std::sqrt;
+                    for (size_t row = 0UL; row < V.rows(); ++row)
+                    {
+                        if (V.cbegin(row) == V.cend(row)) continue;
+                        for (auto element = V.cbegin(row); element != V.cend(row); ++element)
+                        {
+                            _x[element->index()] = element->value();
+                        }
+                        // the non-zeros of the row are ancestors of its first one, the path clears _x again
+                        for (size_t j = V.cbegin(row)->index(); j != none; j = _parent[j])
+                        {
+                            const T wj = _x[j];
+                            _x[j] = T(0);
+                            if (wj == T(0)) continue;
+                            const size_t diagonal = _column_begin[j];
+                            const T      ljj      = _values[diagonal];
+                            const T      updated  = sqrt(ljj * ljj + wj * wj);
+                            const T      c        = updated / ljj;
+                            const T      s        = wj / ljj;
+                            _values[diagonal] = updated;
+                            for (size_t p = diagonal + 1UL; p < _column_begin[j + 1UL]; ++p)
+                            {
+                                const size_t i = _indices[p];
+                                _values[p] = (_values[p] + s * _x[i]) / c;
+                                _x[i]      = c * _x[i] - s * _values[p];
+                            }
+                        }
+                    }
+                }
+
+                /** \brief The elements of `inv(A)` at the pattern of `L` of the last factorization, see sparse_cholesky::inverse()
+                 *
+                 * Takahashi's recursion `Z(i,j) = (delta(i,j) / L(j,j) - sum_k Z(i,k) * L(k,j)) / L(j,j)`, `k > j` in the
+                 * pattern of column `j`, from the last column to the first. Costs `O(sum of the squared column counts)`,
+                 * the dense inverse is never formed. Pad `A` with the elements that are needed.
+                 */
+                void invert()
+                {
+                    const size_t n = _column_begin.size() - 1UL;
+                    _inverse.resize(_values.size());
+                    for (size_t j = n; j-- > 0UL; )
+                    {
+                        const size_t diagonal = _column_begin[j];
+                        const size_t end      = _column_begin[j + 1UL];
+                        const T      ljj      = _values[diagonal];
+                        // the sums of the rows of column j in _x, every pair of them is visited once
+                        for (size_t q = diagonal + 1UL; q < end; ++q)
+                        {
+                            const size_t k = _indices[q];
+                            _x[k] += _inverse[_column_begin[k]] * _values[q];
+                            // the rows of column j below k are a subset of column k, which is already inverted
+                            size_t r = _column_begin[k] + 1UL;
+                            for (size_t p = q + 1UL; p < end; ++p, ++r)
+                            {
+                                while (_indices[r] < _indices[p]) ++r;
+                                _x[_indices[p]] += _inverse[r] * _values[q];
+                                _x[k]           += _inverse[r] * _values[p];
+                            }
+                        }
+                        T sum = T(0);
+                        for (size_t p = diagonal + 1UL; p < end; ++p)
+                        {
+                            _inverse[p]      = -_x[_indices[p]] / ljj;
+                            _x[_indices[p]]  = T(0);
+                            sum             += _inverse[p] * _values[p];
+                        }
+                        _inverse[diagonal] = (T(1) / ljj - sum) / ljj;
+                    }
+                }
+
+                /** \brief `inv(A)(row, col)` of the last invert()
+                 *
+                 * Throws `std::out_of_range` if the element isn't in the pattern of `L`
+                 */
+                T inverse(const size_t row, const size_t col) const
+                {
+                    // the lower triangle is stored, the columns are sorted
+                    const size_t column = std::min(row, col);
+                    const auto   begin  = _indices.begin() + _column_begin[column];
+                    const auto   end    = _indices.begin() + _column_begin[column + 1UL];
+                    const auto   found  = std::lower_bound(begin, end, std::max(row, col));
+                    if (found == end || *found != std::max(row, col))
+                    {
+                        throw std::out_of_range("Element of the inverse outside of the factorized pattern");
+                    }
+                    return _inverse[found - _indices.begin()];
+                }
+
+                //! non-zeros of `L` of the last factorization, including the diagonal
+                size_t nonZeros() const
+                {
+                    return _column_begin.empty() ? 0UL : _column_begin.back();
+                }
+
+            private:
+                //! marks an empty parent in the elimination tree
+                static const size_t none = static_cast<size_t>(-1);
+
+                /** \brief Elimination tree and column counts of `L`, the columns are laid out in `_indices` and `_values`
+                 */
+                void analyze(const sparse_matrix_t & A)
+                {
+                    const size_t n = A.rows();
+                    _parent.assign(n, none);
+                    _ancestor.assign(n, none);
+                    _stack.resize(n);
+                    _marker.assign(n, none);
+
+                    for (size_t k = 0UL; k < n; ++k)
+                    {
+                        for (auto element = A.cbegin(k); element != A.cend(k) && element->index() < k; ++element)
+                        {
+                            // path compression with the ancestors
+                            for (size_t i = element->index(); i != none && i < k; )
+                            {
+                                const size_t next = _ancestor[i];
+                                _ancestor[i] = k;
+                                if (next == none) _parent[i] = k;
+                                i = next;
+                            }
+                        }
+                    }
+
+                    // every index of the reach of row k is a non-zero of its column
+                    _column_begin.assign(n + 1UL, 0UL);
+                    for (size_t k = 0UL; k < n; ++k)
+                    {
+                        for (size_t position = reach(A, k); position < n; ++position)
+                        {
+                            ++_column_begin[_stack[position] + 1UL];
+                        }
+                        ++_column_begin[k + 1UL];
+                    }
+                    for (size_t k = 0UL; k < n; ++k)
+                    {
+                        _column_begin[k + 1UL] += _column_begin[k];
+                    }
+                    _indices.resize(_column_begin[n]);
+                    _values.resize(_column_begin[n]);
+                }
+
+                /** \brief The pattern of row `k` of `L` in topological order in `_stack[top, n)`, returns `top`
+                 */
+                size_t reach(const sparse_matrix_t & A, const size_t k)
+                {
+                    const size_t n = A.rows();
+                    size_t top = n;
+                    _marker[k] = k;
+                    for (auto element = A.cbegin(k); element != A.cend(k) && element->index() < k; ++element)
+                    {
+                        // walk up the tree until a visited node, the path is collected at the front of the stack
+                        size_t length = 0UL;
+                        for (size_t i = element->index(); _marker[i] != k; i = _parent[i])
+                        {
+                            _stack[length++] = i;
+                            _marker[i] = k;
+                        }
+                        while (length > 0UL)
+                        {
+                            _stack[--top] = _stack[--length];
+                        }
+                    }
+                    return top;
+                }
+
+                //! parent of every row in the elimination tree
+                std::vector<size_t> _parent;
+                //! path compressed ancestors while building the elimination tree
+                std::vector<size_t> _ancestor;
+                //! pattern of the current row of `L`
+                std::vector<size_t> _stack;
+                //! last row that visited a node in util::sparse_cholesky::reach()
+                std::vector<size_t> _marker;
+                //! beginning of every column of `L` in `_indices` and `_values`, `N + 1` elements
+                std::vector<size_t> _column_begin;
+                //! next free position of every column while factorizing
+                std::vector<size_t> _next;
+                //! row indices of `L`
+                std::vector<size_t> _indices;
+                //! values of `L`
+                std::vector<T>      _values;
+                //! dense scratch row, all zeros between two calls
+                std::vector<T>      _x;
+                //! elements of `inv(A)` at the positions of `_values`, see sparse_cholesky::invert()
+                std::vector<T>      _inverse;
+        };
+
+        template< typename T >
+        const size_t sparse_cholesky<T>::none;
+
+    } // namespace util
+} // namespace kafi
+
+/*! @} End of Doxygen Groups*/
+#endif // KAFI_SPARSE_CHOLESKY_H
@@ -0,0 +1,353 @@
+// Copyright 2018 municHMotorsport e.V. <info@munichmotorsport.de>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KAFI_SPARSE_MATRIX_H
+#define KAFI_SPARSE_MATRIX_H
+
+/*!
+ *  \addtogroup kafi::util
+ *  @{
+ */
+
+#include <blaze/Math.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace kafi
+{
+    namespace util {
+
+        /** \brief Collects a row-major sparse matrix row by row and writes it into a `blaze::CompressedMatrix`
+         *
+         * blaze needs the number of non-zeros before `append()`, the builder counts them first. The buffers are
+         * kept between two builds, so rebuilding a matrix of the same structure doesn't allocate in the builder.
+         */
+        template< typename T = double >
+        class sparse_builder {
+
+            public:
+                //! starts a `rows x columns` matrix
+                void begin(const size_t rows, const size_t columns)
+                {
+                    _rows    = rows;
+                    _columns = columns;
+                    _row_end.clear();
+                    _indices.clear();
+                    _values.clear();
+                }
+
+                //! appends `value` at `column` to the current row, the columns have to be strictly increasing
+                void push(const size_t column, const T & value)
+                {
+                    _indices.push_back(column);
+                    _values.push_back(value);
+                }
+
+                //! closes the current row
+                void end_row()
+                {
+                    _row_end.push_back(_indices.size());
+                }
+
+                //! writes the collected rows into `matrix`
+                void finish(blaze::CompressedMatrix<T, blaze::rowMajor> & matrix) const
+                {
+                    matrix.reset();
+                    matrix.resize(_rows, _columns, false);
+                    matrix.reserve(_indices.size());
+                    size_t element = 0UL;
+                    for (size_t row = 0UL; row < _rows; ++row)
+                    {
+                        for (; element < _row_end[row]; ++element)
+                        {
+                            matrix.append(row, _indices[element], _values[element]);
+                        }
+                        matrix.finalize(row);
+                    }
+                }
+
+                //! collects `trans(input)`, the rows of the transposed are filled in increasing column order of `input`
+                void transpose(const blaze::CompressedMatrix<T, blaze::rowMajor> & input)
+                {
+                    _rows    = input.columns();
+                    _columns = input.rows();
+                    _row_end.assign(_rows, 0UL);
+                    _indices.resize(input.nonZeros());
+                    _values.resize(input.nonZeros());
+                    for (size_t row = 0UL; row < input.rows(); ++row)
+                    {
+                        for (auto element = input.cbegin(row); element != input.cend(row); ++element)
+                        {
+                            ++_row_end[element->index()];
+                        }
+                    }
+                    // _row_end holds the beginning of every row while scattering and the end afterwards
+                    size_t begin = 0UL;
+                    for (size_t & end : _row_end)
+                    {
+                        const size_t count = end;
+                        end    = begin;
+                        begin += count;
+                    }
+                    for (size_t row = 0UL; row < input.rows(); ++row)
+                    {
+                        for (auto element = input.cbegin(row); element != input.cend(row); ++element)
+                        {
+                            const size_t position = _row_end[element->index()]++;
+                            _indices[position] = row;
+                            _values[position]  = element->value();
+                        }
+                    }
+                }
+
+            private:
+                size_t              _rows    = 0UL;
+                size_t              _columns = 0UL;
+                //! one past the last element of every row
+                std::vector<size_t> _row_end;
+                std::vector<size_t> _indices;
+                std::vector<T>      _values;
+        };
+
+        /** \brief Dense accumulator of a single sparse row (Gustavson), used by the sparse products
+         */
+        template< typename T = double >
+        class sparse_accumulator {
+
+            public:
+                //! a row of `columns` elements
+                explicit sparse_accumulator(const size_t columns)
+                : _values(columns, T(0))
+                , _occupied(columns, false)
+                { }
+
+                //! `row(column) += value`
+                void add(const size_t column, const T & value)
+                {
+                    if (!_occupied[column])
+                    {
+                        _occupied[column] = true;
+                        _pattern.push_back(column);
+                        _values[column] = value;
+                    }
+                    else
+                    {
+                        _values[column] += value;
+                    }
+                }
+
+                /** \brief Appends the row to `builder` in increasing column order, drops exact zeros and resets the accumulator
+                 */
+                void flush(sparse_builder<T> & builder)
+                {
+                    std::sort(_pattern.begin(), _pattern.end());
+                    for (const size_t column : _pattern)
+                    {
+                        if (_values[column] != T(0))
+                        {
+                            builder.push(column, _values[column]);
+                        }
+                        _values[column]   = T(0);
+                        _occupied[column] = false;
+                    }
+                    _pattern.clear();
+                    builder.end_row();
+                }
+
+            private:
+                std::vector<T>      _values;
+                std::vector<bool>   _occupied;
+                std::vector<size_t> _pattern;
+        };
+
+        //! `output = trans(input)` of row-major sparse matrices, a counting sort of the elements by their column
+        template< typename T >
+        void sparse_transpose(const blaze::CompressedMatrix<T, blaze::rowMajor> & input
+                            ,       blaze::CompressedMatrix<T, blaze::rowMajor> & output
+                            ,       sparse_builder<T>                           & builder)
+        {
+            builder.transpose(input);
+            builder.finish(output);
+        }
+
+        namespace detail {
+
+            //! `output = lhs * rhs`, plus `*addend` if it isn't `nullptr`
+            template< typename T >
+            void sparse_product(const blaze::CompressedMatrix<T, blaze::rowMajor> & lhs
+                              , const blaze::CompressedMatrix<T, blaze::rowMajor> & rhs
+                              , const blaze::CompressedMatrix<T, blaze::rowMajor> * addend
+                              ,       blaze::CompressedMatrix<T, blaze::rowMajor> & output
+                              ,       sparse_accumulator<T>                       & accumulator
+                              ,       sparse_builder<T>                           & builder
+                              , const bool                                          pattern = false)
+            {
+                builder.begin(lhs.rows(), rhs.columns());
+                for (size_t row = 0UL; row < lhs.rows(); ++row)
+                {
+                    if (addend != nullptr)
+                    {
+                        for (auto element = addend->cbegin(row); element != addend->cend(row); ++element)
+                        {
+                            accumulator.add(element->index(), element->value());
+                        }
+                    }
+                    for (auto left = lhs.cbegin(row); left != lhs.cend(row); ++left)
+                    {
+                        const T factor = left->value();
+                        for (auto right = rhs.cbegin(left->index()); right != rhs.cend(left->index()); ++right)
+                        {
+                            // the count of the products can't cancel, only the structure of the operands matters
+                            accumulator.add(right->index(), pattern ? T(1) : factor * right->value());
+                        }
+                    }
+                    accumulator.flush(builder);
+                }
+                builder.finish(output);
+            }
+
+        } // namespace detail
+
+        /** \brief `output = lhs * rhs` of row-major sparse matrices (Gustavson)
+         *
+         * Costs `O(sum of the non-zeros of rhs in the rows selected by lhs)`, never touches zeros. `output` must not
+         * be an operand, the accumulator needs `rhs.columns()` columns.
+         */
+        template< typename T >
+        void sparse_multiply(const blaze::CompressedMatrix<T, blaze::rowMajor> & lhs
+                           , const blaze::CompressedMatrix<T, blaze::rowMajor> & rhs
+                           ,       blaze::CompressedMatrix<T, blaze::rowMajor> & output
+                           ,       sparse_accumulator<T>                       & accumulator
+                           ,       sparse_builder<T>                           & builder)
+        {
+            detail::sparse_product<T>(lhs, rhs, nullptr, output, accumulator, builder);
+        }
+
+        //! `output = addend + lhs * rhs`, the same as util::sparse_multiply()
+        template< typename T >
+        void sparse_multiply_add(const blaze::CompressedMatrix<T, blaze::rowMajor> & lhs
+                               , const blaze::CompressedMatrix<T, blaze::rowMajor> & rhs
+                               , const blaze::CompressedMatrix<T, blaze::rowMajor> & addend
+                               ,       blaze::CompressedMatrix<T, blaze::rowMajor> & output
+                               ,       sparse_accumulator<T>                       & accumulator
+                               ,       sparse_builder<T>                           & builder)
+        {
+            detail::sparse_product<T>(lhs, rhs, &addend, output, accumulator, builder);
+        }
+
+        /** \brief The structure of `lhs * rhs`, every element is the number of products of stored elements
+         *
+         * Explicit zeros of the operands count like non-zeros, used to predict fill-in. The same as util::sparse_multiply().
+         */
+        template< typename T >
+        void sparse_multiply_pattern(const blaze::CompressedMatrix<T, blaze::rowMajor> & lhs
+                                   , const blaze::CompressedMatrix<T, blaze::rowMajor> & rhs
+                                   ,       blaze::CompressedMatrix<T, blaze::rowMajor> & output
+                                   ,       sparse_accumulator<T>                       & accumulator
+                                   ,       sparse_builder<T>                           & builder)
+        {
+            detail::sparse_product<T>(lhs, rhs, nullptr, output, accumulator, builder, true);
+        }
+
+        /** \brief `output = matrix` with explicit zeros at the elements of `pattern` which `matrix` doesn't store
+         *
+         * Makes them a part of the structure, e.g. of a util::sparse_cholesky factorization. `output` must not be an operand.
+         */
+        template< typename T >
+        void sparse_pad(const blaze::CompressedMatrix<T, blaze::rowMajor> & matrix
+                      , const blaze::CompressedMatrix<T, blaze::rowMajor> & pattern
+                      ,       blaze::CompressedMatrix<T, blaze::rowMajor> & output
+                      ,       sparse_builder<T>                           & builder)
+        {
+            builder.begin(matrix.rows(), matrix.columns());
+            for (size_t row = 0UL; row < matrix.rows(); ++row)
+            {
+                // merge of the sorted rows
+                auto element = matrix.cbegin(row);
+                auto padding = pattern.cbegin(row);
+                while (element != matrix.cend(row) || padding != pattern.cend(row))
+                {
+                    if (padding == pattern.cend(row) || (element != matrix.cend(row) && element->index() <= padding->index()))
+                    {
+                        if (padding != pattern.cend(row) && padding->index() == element->index()) ++padding;
+                        builder.push(element->index(), element->value());
+                        ++element;
+                    }
+                    else
+                    {
+                        builder.push(padding->index(), T(0));
+                        ++padding;
+                    }
+                }
+                builder.end_row();
+            }
+            builder.finish(output);
+        }
+
+        /** \brief `output = matrix * vector` of a row-major sparse matrix and a dense `(N x 1)` vector
+         */
+        template< typename T
+                , typename Vector
+                , typename Output >
+        void sparse_multiply_vector(const blaze::CompressedMatrix<T, blaze::rowMajor> & matrix
+                                  , const Vector                                      & vector
+                                  ,       Output                                      & output)
+        {
+            for (size_t row = 0UL; row < matrix.rows(); ++row)
+            {
+                T sum = T(0);
+                for (auto element = matrix.cbegin(row); element != matrix.cend(row); ++element)
+                {
+                    sum += element->value() * vector(element->index(), 0);
+                }
+                output(row, 0) = sum;
+            }
+        }
+
+        /** \brief Stores the non-zeros of the dense `input` in `output`
+         *
+         * With `threshold > 0` the off-diagonal elements with `|a(i,j)| <= threshold * sqrt(|a(i,i) * a(j,j)|)` are
+         * dropped too, the sparsification of sparse extended information filters.
+         */
+        template< typename Dense
+                , typename T >
+        void sparsify(const Dense                                       & input
+                    ,       blaze::CompressedMatrix<T, blaze::rowMajor> & output
+                    ,       sparse_builder<T>                           & builder
+                    , const T                                           & threshold = T(0))
+        {
+            using std::abs;
+            using std::sqrt;
+            builder.begin(input.rows(), input.columns());
+            for (size_t row = 0UL; row < input.rows(); ++row)
+            {
+                for (size_t col = 0UL; col < input.columns(); ++col)
+                {
+                    const T value = input(row, col);
+                    if (value == T(0)) continue;
+                    if (row != col && threshold > T(0)
+                     && abs(value) <= threshold * sqrt(abs(input(row, row) * input(col, col)))) continue;
+                    builder.push(col, value);
+                }
+                builder.end_row();
+            }
+            builder.finish(output);
+        }
+
+    } // namespace util
+} // namespace kafi
+
+/*! @} End of Doxygen Groups*/
+#endif // KAFI_SPARSE_MATRIX_H
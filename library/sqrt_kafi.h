@@ -0,0 +1,417 @@
+// Copyright 2018 municHMotorsport e.V. <info@munichmotorsport.de>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SQRT_KAFI_H
+#define SQRT_KAFI_H
+
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <tuple>
+#include "jacobian_function.h"
+#include "small_matrix.h"
+#include "util.h"
+#include "autogen-KAFI-macros.h"
+
+/*!
+ *  \addtogroup kafi
+ *  @{
+ */
+
+namespace kafi {
+
+/** \brief A square-root EKF, propagates the lower triangular root `S` of the prediction error `P = S * trans(S)`
+ *
+ * The same models and results as kafi::kafi, but `P` is never formed:
+ * * prediction: `[F * S, sqrt(Q)]` is triangularized by util::householder_triangularize()
+ * * update: the array `[[sqrt(cN), H * S], [0, S]]` is triangularized to `[[sqrt(HPH^T + cN), 0], [G', S']]`,
+ *   the gain is `G' * inv(sqrt(HPH^T + cN))`, a triangular solve instead of an inversion
+ *
+ * `S * trans(S)` is symmetric and positive semidefinite by construction, so the filter never loses these
+ * properties over long runs, doesn't need to re-symmetrize `P` or to inflate `Q` and works in `float`, where
+ * `(I - G * H) * P` of kafi::kafi drifts. The noise matrices only need to be positive semidefinite.
+ *
+ * Template arguments:
+ * * `N`  = state dimensions
+ * * `M`  = sensor dimensions
+ * * `T`  = scalar type (default: `double`), needs `sqrt`
+ *
+ * See examples at [tests/equivalence_tests.cc](../../tests/equivalence_tests.cc)
+ */
+template< size_t   N            // state  dimensions (N x 1)
+        , size_t   M            // sensor dimensions (M x 1)
+        , typename T = double > // scalar type
+class sqrt_kafi {
+
+    // typenames
+    public:
+        //! self type for conciseness
+        using self_t     = sqrt_kafi<N,M,T>;
+        //! scalar type of the state, the models and the factors
+        using value_t    = T;
+        //! copied typename for conciseness
+        using nx1_vector = typename jacobian_function<N,M,T>::nx1_vector;
+        //! copied typename for conciseness
+        using mx1_vector = typename jacobian_function<N,M,T>::mx1_vector;
+        //! copied typename for conciseness
+        using mxn_matrix = typename jacobian_function<N,M,T>::mxn_matrix;
+        //! copied typename for conciseness
+        using nxm_matrix = typename jacobian_function<N,M,T>::nxm_matrix;
+        //! copied typename for conciseness
+        using mxm_matrix = typename jacobian_function<N,M,T>::mxm_matrix;
+        //! copied typename for conciseness
+        using nxn_matrix = typename jacobian_function<N,M,T>::nxn_matrix;
+        //! `[F * S, sqrt(Q)]` transposed, `(2N x N)`
+        using prediction_array_t = blaze::StaticMatrix<T, 2UL * N, N, blaze::rowMajor>;
+        //! `[[sqrt(cN), H * S], [0, S]]` transposed, `(M + N x M + N)`
+        using update_array_t     = blaze::StaticMatrix<T, M + N, M + N, blaze::rowMajor>;
+        /** \brief Shorthand for a useful return type for the kalman filter, references valid until the next step()
+         *  * `const nx1_vector & = std::get<0>(x)` = state
+         *  * `const nxn_matrix & = std::get<1>(x)` = lower triangular root of the prediction error
+         *  * `const nxm_matrix & = std::get<2>(x)` = gain
+         */
+        using return_t   = std::tuple<const nx1_vector &,
+                                      const nxn_matrix &,
+                                      const nxm_matrix &>;
+
+    // constructors
+    public:
+
+        /** \brief Default constructor, the same arguments as kafi::kafi
+         *
+         * Initializing `prediction_error` to identity matrix, i.e. its root as well
+         *
+         * Throws `std::invalid_argument` if a noise matrix is not positive semidefinite
+         */
+        sqrt_kafi(const jacobian_function<N,N,T> f
+                , const jacobian_function<N,M,T> h
+                ,       nx1_vector               starting_state
+                , const nxn_matrix             & process_noise
+                , const mxm_matrix             & sensor_noise)
+        : sqrt_kafi<N,M,T>(std::move(f)
+                         , std::move(h)
+                         , starting_state
+                         , process_noise
+                         , sensor_noise
+                         , util::create_identity<N, blaze::rowMajor, T>())
+        { }
+
+        /**
+         * \brief The same as the default constructor, but with custom `prediction error` initialization
+         */
+        sqrt_kafi(const jacobian_function<N,N,T> f
+                , const jacobian_function<N,M,T> h
+                ,       nx1_vector               starting_state
+                , const nxn_matrix             & process_noise
+                , const mxm_matrix             & sensor_noise
+                , const nxn_matrix             & prediction_error)
+        : _f(std::move(f))
+        , _f_jacobian_temp(0)
+        , _predicted_state_temp(0)
+        , _f_root_temp(0)
+        , _prediction_array(0)
+        , _h(std::move(h))
+        , _h_temp(0)
+        , _h_jacobian_temp(0)
+        , _h_root_temp(0)
+        , _update_array(0)
+        , _innovation_root_temp(0)
+        , _gain_root_temp(0)
+        , _innovation_temp(0)
+        , _state(starting_state)
+        , _prediction_error_root(0)
+        , _gain(0)
+        , _new_data_available(false)
+        , _prediction_count(0)
+        , _update_count(0)
+        {
+            util::cholesky_factor(process_noise,    _process_noise_root);
+            util::cholesky_factor(sensor_noise,     _sensor_noise_root);
+            util::cholesky_factor(prediction_error, _prediction_error_root);
+        }
+
+        //! Copy constructor is deleted because sqrt_kafi owns multiple different potentially big matrices
+        sqrt_kafi(const self_t & other) = delete;
+        //! Move constructor is deleted like the one of kafi::kafi
+        sqrt_kafi(const self_t && other) = delete;
+
+    // methods
+    public:
+        /**
+         * The same as kafi::set_current_observation()
+         */
+        void set_current_observation(std::shared_ptr<mx1_vector> observation)
+        {
+            _observation = observation;
+            _new_data_available = true;
+        }
+
+        /**\brief Main function that runs the Kalman Filter based on new or old observation, and apply the prediction and update step
+         *
+         * Modifying:
+         *     * `_gain`
+         *     * `_state`
+         *     * `_prediction_error_root`
+         *
+         * Return:
+         *     * tuple of references, valid until the next step()
+         *         - state
+         *         - lower triangular root of the prediction error
+         *         - gain
+         */
+        return_t step()
+        {
+            apply_prediction();
+            if (new_data_available())
+            {
+                apply_update();
+            }
+
+            DEBUG_MSG_KAFI(*this);
+            return return_t(_state, _prediction_error_root, _gain);
+        }
+
+        //! `P = S * trans(S)`, e.g. to compare with kafi::kafi
+        nxn_matrix prediction_error() const
+        {
+            return _prediction_error_root * blaze::trans(_prediction_error_root);
+        }
+
+        /** \brief Overloading stream operator for logging purposes, the same format as kafi::kafi
+         */
+        friend std::ostream & operator<<(std::ostream& stream, const self_t & rhs)
+        {
+            std::shared_ptr<mx1_vector> o = rhs._observation.lock();
+            const char * line = "============================\n";
+            stream << "Kafi (square-root):\n"
+                   << "  Update      # calls: "        << rhs._update_count          << '\n'
+                   << "  Predictions # calls: "        << rhs._prediction_count      << '\n'
+                   << " [S] _state:\n"                 << rhs._state                 << line;
+            if (o)
+            {
+                stream << " [O] _observation:\n"       << (*o)                       << line;
+            }
+            stream << " [P] _prediction_error_root:\n" << rhs._prediction_error_root << line
+                   << " [G] _gain:\n"                  << rhs._gain                  << line;
+            return stream;
+        }
+
+        /** print helper for conciseness
+         */
+        void print_state_to(std::ostream & stream)
+        {
+            stream << *this;
+        }
+
+    //! Private methods
+    private:
+        /** \brief A check if the flag `_new_data_available` is true and flips it
+         */
+        bool new_data_available()
+        {
+            if (_new_data_available) {
+                _new_data_available = false;
+                return true;
+            } else {
+                return false;
+            }
+        }
+
+        /** \brief Applying the prediction formulae, `S = triangularize([F * S, sqrt(Q)])`
+         *
+         * Modifying:
+         *     * `_prediction_error_root`
+         *     * `_state`
+         *     * `_prediction_count`
+         */
+        void apply_prediction()
+        {
+            // F at the current state and f(state) in a single call if `_f` is fused
+            _f.evaluate(_state, _predicted_state_temp, _f_jacobian_temp);
+            _state = _predicted_state_temp;
+            const nxn_matrix & F = _f_jacobian_temp;
+            _f_root_temp = F * _prediction_error_root;
+
+            // trans(array) * array = F * P * trans(F) + Q
+            for (size_t row = 0UL; row < N; ++row)
+            {
+                for (size_t col = 0UL; col < N; ++col)
+                {
+                    _prediction_array(row,     col) = _f_root_temp(col, row);
+                    _prediction_array(N + row, col) = _process_noise_root(col, row);
+                }
+            }
+            util::householder_triangularize(_prediction_array);
+            for (size_t row = 0UL; row < N; ++row)
+            {
+                for (size_t col = 0UL; col < N; ++col)
+                {
+                    _prediction_error_root(row, col) = _prediction_array(col, row);
+                }
+            }
+
+            _prediction_count++;
+        }
+
+        /** \brief Applying the update formulae in square-root form
+         *
+         * **Invariant**:
+         *     * `_observation` has to be initialized, implemented through sqrt_kafi::new_data_available()
+         *
+         * The lower triangular post-array of `[[sqrt(cN), H * S], [0, S]]` is `[[sqrt(HPH^T + cN), 0], [G', S']]`
+         * with the updated root `S'` and `G = G' * inv(sqrt(HPH^T + cN))`.
+         *
+         * Modifying:
+         *     * `_gain`
+         *     * `_state`
+         *     * `_prediction_error_root`
+         *     * `_update_count`
+         *     * the preallocated temporaries
+         *
+         * Throws `std::invalid_argument` if the innovation covariance is singular
+         */
+        void apply_update()
+        {
+            _h.evaluate(_state, _h_temp, _h_jacobian_temp);
+            const mxn_matrix & H = _h_jacobian_temp;
+            const nxn_matrix & S = _prediction_error_root;
+            std::shared_ptr<mx1_vector> o = _observation.lock();
+
+            _h_root_temp = H * S;
+
+            // the transposed pre-array, the upper right block stays 0
+            _update_array = T(0);
+            for (size_t row = 0UL; row < M; ++row)
+            {
+                for (size_t col = 0UL; col < M; ++col)
+                {
+                    _update_array(row, col) = _sensor_noise_root(col, row);
+                }
+            }
+            for (size_t row = 0UL; row < N; ++row)
+            {
+                for (size_t col = 0UL; col < M; ++col)
+                {
+                    _update_array(M + row, col) = _h_root_temp(col, row);
+                }
+                for (size_t col = 0UL; col < N; ++col)
+                {
+                    _update_array(M + row, M + col) = S(col, row);
+                }
+            }
+            util::householder_triangularize(_update_array);
+
+            // blocks of the lower triangular post-array, trans(_update_array)
+            for (size_t row = 0UL; row < M; ++row)
+            {
+                for (size_t col = 0UL; col < M; ++col)
+                {
+                    _innovation_root_temp(row, col) = _update_array(col, row);
+                }
+            }
+            for (size_t row = 0UL; row < N; ++row)
+            {
+                for (size_t col = 0UL; col < M; ++col)
+                {
+                    _gain_root_temp(row, col) = _update_array(col, M + row);
+                }
+                for (size_t col = 0UL; col < N; ++col)
+                {
+                    _prediction_error_root(row, col) = _update_array(M + col, M + row);
+                }
+            }
+
+            // G * sqrt(HPH^T + cN) = G', back substitution with the lower triangular root
+            for (size_t col = M; col-- > 0UL; )
+            {
+                if (_innovation_root_temp(col, col) == T(0))
+                {
+                    throw std::invalid_argument("kafi::sqrt_kafi: singular innovation covariance");
+                }
+                for (size_t row = 0UL; row < N; ++row)
+                {
+                    T value = _gain_root_temp(row, col);
+                    for (size_t k = col + 1UL; k < M; ++k)
+                    {
+                        value -= _gain(row, k) * _innovation_root_temp(k, col);
+                    }
+                    _gain(row, col) = value / _innovation_root_temp(col, col);
+                }
+            }
+
+            _innovation_temp = *o - _h_temp;
+            _state += _gain * _innovation_temp;
+            _update_count++;
+        }
+
+    // member
+    private:
+        // functions with their respective preallocated resources
+
+        //! state transition function
+        const jacobian_function<N,N,T> _f;
+        //! preallocated jacobian matrix space for `_f`
+              nxn_matrix               _f_jacobian_temp;
+        //! preallocated output of `_f`, the input of `_f` never aliases its output
+              nx1_vector               _predicted_state_temp;
+        //! `F * S`
+              nxn_matrix               _f_root_temp;
+        //! work of the QR in the prediction
+              prediction_array_t       _prediction_array;
+        //! prediction scaling function
+        const jacobian_function<N,M,T> _h;
+        //! preallocated vector space for `_h`
+              mx1_vector               _h_temp;
+        //! preallocated jacobian matrix space for `_h`
+              mxn_matrix               _h_jacobian_temp;
+        //! `H * S`
+              mxn_matrix               _h_root_temp;
+        //! work of the QR in the update
+              update_array_t           _update_array;
+        //! `sqrt(H * P * trans(H) + cN)`, lower triangular
+              mxm_matrix               _innovation_root_temp;
+        //! `G * sqrt(H * P * trans(H) + cN)`
+              nxm_matrix               _gain_root_temp;
+        //! `o - h(state)`
+              mx1_vector               _innovation_temp;
+
+        // const matrices
+        //! `sqrt(Q)`, lower triangular
+              nxn_matrix               _process_noise_root;
+        //! `sqrt(cN)`, lower triangular
+              mxm_matrix               _sensor_noise_root;
+
+        //       matrices
+        //! `s_t` (at time `t`), the input of `_f`, which writes into `_predicted_state_temp`
+              nx1_vector               _state;
+        //! `o_t` (reference, the caller is responsible for the allocation)
+        std::weak_ptr< mx1_vector >    _observation;
+        //! `S_t` with `P_t = S_t * trans(S_t)`, lower triangular
+              nxn_matrix               _prediction_error_root;
+        //! `G_t`
+              nxm_matrix               _gain;
+        //! used to run the sqrt_kafi::apply_update() function, changed in sqrt_kafi::new_data_available()
+              bool                     _new_data_available;
+        // logging
+        //! used for logging purposes, tracks how often sqrt_kafi::apply_prediction() was run
+              size_t                   _prediction_count;
+        //! used for logging purposes, tracks how often sqrt_kafi::apply_update() was run
+              size_t                   _update_count;
+};
+
+} // namespace kafi
+
+/*! @} End of Doxygen Groups*/
+#endif // SQRT_KAFI_H
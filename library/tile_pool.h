@@ -0,0 +1,222 @@
+// Copyright 2018 municHMotorsport e.V. <info@munichmotorsport.de>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KAFI_TILE_POOL_H
+#define KAFI_TILE_POOL_H
+
+/*!
+ *  \addtogroup kafi::util
+ *  @{
+ */
+
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace kafi
+{
+    namespace util {
+
+        /** \brief A fixed set of worker threads which run the same kernel on disjoint tiles
+         *
+         * The threads are started once in the constructor and wait for work, tile_pool::run() only wakes them,
+         * so it neither spawns threads nor allocates. The calling thread is the worker `0` and takes part in
+         * the work, a pool of `1` worker runs everything on the calling thread.
+         *
+         * Used by util::blocked_propagation for the large-state mode of kafi::dynamic_kafi
+         */
+        class tile_pool {
+
+            // typenames
+            public:
+                //! self type for conciseness
+                using self_t = tile_pool;
+
+            // constructors
+            public:
+                //! Starts `workers - 1` threads, `0` is treated as `1`
+                explicit tile_pool(const size_t workers)
+                : _workers(workers == 0UL ? 1UL : workers)
+                , _kernel(nullptr)
+                , _context(nullptr)
+                , _generation(0UL)
+                , _pending(0UL)
+                , _stop(false)
+                , _exception(nullptr)
+                {
+                    _threads.reserve(_workers - 1UL);
+                    for (size_t worker = 1UL; worker < _workers; ++worker)
+                    {
+                        _threads.emplace_back([this, worker](){ work(worker); });
+                    }
+                }
+
+                //! Copy constructor is deleted, the threads point to this pool
+                tile_pool(const self_t & other) = delete;
+                //! Move constructor is deleted, the threads point to this pool
+                tile_pool(const self_t && other) = delete;
+
+                //! Stops and joins all threads
+                ~tile_pool()
+                {
+                    {
+                        std::lock_guard<std::mutex> lock(_mutex);
+                        _stop = true;
+                    }
+                    _start.notify_all();
+                    for (std::thread & thread : _threads)
+                    {
+                        thread.join();
+                    }
+                }
+
+            // methods
+            public:
+                //! number of workers including the calling thread
+                size_t workers() const
+                {
+                    return _workers;
+                }
+
+                /** \brief Runs `kernel(worker, workers)` on every worker and returns when all of them are done
+                 *
+                 * `Kernel` is called by reference, it has to split the work by `worker` itself. If workers throw,
+                 * run() still waits for all of them, so none of them touches `kernel` afterwards, and rethrows the
+                 * first exception on the calling thread. The pool stays usable.
+                 */
+                template< typename Kernel >
+                void run(Kernel & kernel)
+                {
+                    if (_workers == 1UL)
+                    {
+                        kernel(0UL, 1UL);
+                        return;
+                    }
+                    {
+                        std::lock_guard<std::mutex> lock(_mutex);
+                        _kernel  = &invoke<Kernel>;
+                        _context = &kernel;
+                        _pending = _workers - 1UL;
+                        _generation++;
+                    }
+                    _start.notify_all();
+
+                    try
+                    {
+                        kernel(0UL, _workers);
+                    }
+                    catch (...)
+                    {
+                        keep_exception();
+                    }
+
+                    std::exception_ptr exception;
+                    {
+                        std::unique_lock<std::mutex> lock(_mutex);
+                        _done.wait(lock, [this](){ return _pending == 0UL; });
+                        std::swap(exception, _exception);
+                    }
+                    if (exception)
+                    {
+                        std::rethrow_exception(exception);
+                    }
+                }
+
+            //! Private methods
+            private:
+                //! calls the type-erased kernel without std::function, which might allocate
+                template< typename Kernel >
+                static void invoke(void * context, const size_t worker, const size_t workers)
+                {
+                    (*static_cast<Kernel *>(context))(worker, workers);
+                }
+
+                //! keeps the current exception for tile_pool::run() unless a worker threw before
+                void keep_exception()
+                {
+                    std::lock_guard<std::mutex> lock(_mutex);
+                    if (!_exception)
+                    {
+                        _exception = std::current_exception();
+                    }
+                }
+
+                //! main loop of the thread of `worker`
+                void work(const size_t worker)
+                {
+                    size_t generation = 0UL;
+                    while (true)
+                    {
+                        void (*kernel)(void *, size_t, size_t);
+                        void * context;
+                        {
+                            std::unique_lock<std::mutex> lock(_mutex);
+                            _start.wait(lock, [this, generation](){ return _stop || _generation != generation; });
+                            if (_stop) return;
+                            generation = _generation;
+                            kernel     = _kernel;
+                            context    = _context;
+                        }
+
+                        try
+                        {
+                            kernel(context, worker, _workers);
+                        }
+                        catch (...)
+                        {
+                            keep_exception();
+                        }
+
+                        std::lock_guard<std::mutex> lock(_mutex);
+                        if (--_pending == 0UL)
+                        {
+                            _done.notify_one();
+                        }
+                    }
+                }
+
+            // member
+            private:
+                //! number of workers including the calling thread
+                const size_t             _workers;
+                //! the threads of the workers `1..workers-1`
+                std::vector<std::thread> _threads;
+                //! guards everything below
+                std::mutex               _mutex;
+                //! wakes the workers for a new generation
+                std::condition_variable  _start;
+                //! wakes tile_pool::run() when all workers are done
+                std::condition_variable  _done;
+                //! the current kernel
+                void                   (*_kernel)(void *, size_t, size_t);
+                //! the argument of `_kernel`
+                void *                   _context;
+                //! counts the calls of tile_pool::run()
+                size_t                   _generation;
+                //! workers which haven't finished the current generation
+                size_t                   _pending;
+                //! set by the destructor
+                bool                     _stop;
+                //! the first exception of the current generation, rethrown by tile_pool::run()
+                std::exception_ptr       _exception;
+        };
+
+    } // namespace util
+} // namespace kafi
+
+/*! @} End of Doxygen Groups*/
+#endif // KAFI_TILE_POOL_H
@@ -0,0 +1,137 @@
+// Copyright 2018 municHMotorsport e.V. <info@munichmotorsport.de>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KAFI_TRANSITION_POWER_H
+#define KAFI_TRANSITION_POWER_H
+
+/*!
+ *  \addtogroup kafi::util
+ *  @{
+ */
+
+#include <blaze/Math.h>
+
+namespace kafi
+{
+    namespace util {
+
+        /** \brief Covariance propagation over `k` steps of a constant transition, `O(N^3 * log(k))` instead of `O(N^3 * k)`
+         *
+         * `P = F^k * P * trans(F^k) + sum_i F^i * Q * trans(F^i)`, `i < k`, is exactly `k` times `P = F * P * trans(F) + Q`.
+         * The transition and the noise of `2^j` steps are doubled for every bit of `k` and composed for every set bit,
+         * see transition_power::compose(). Used by kafi::set_covariance_rate(), the temporaries are preallocated.
+         *
+         * Template arguments:
+         * * `N` = state dimensions
+         * * `T` = scalar type (default: `double`)
+         */
+        template< size_t   N
+                , typename T = double >
+        class transition_power {
+
+            // typenames
+            public:
+                //! `(N x N)`
+                using nxn_matrix = blaze::StaticMatrix<T, N, N, blaze::rowMajor>;
+
+            // constructors
+            public:
+                //! Preallocates the temporaries
+                transition_power()
+                : _transition_temp(0)
+                , _noise_temp(0)
+                , _power_temp(0)
+                , _power_noise_temp(0)
+                , _product_temp(0)
+                { }
+
+            // methods
+            public:
+                /** \brief `(A1, B1) = (A2 * A1, A2 * B1 * trans(A2) + B2)`, the transition and the noise of two consecutive intervals
+                 *
+                 * The first interval is overwritten with both, the second one is read-only and must not alias it.
+                 */
+                void compose(nxn_matrix & first_transition, nxn_matrix & first_noise
+                           , const nxn_matrix & second_transition, const nxn_matrix & second_noise)
+                {
+                    _product_temp    = second_transition * first_transition;
+                    first_transition = _product_temp;
+                    first_noise      = second_transition * first_noise * blaze::trans(second_transition) + second_noise;
+                }
+
+                /** \brief `P = F^k * P * trans(F^k) + sum_i F^i * Q * trans(F^i)`, `i < k`
+                 *
+                 * `k = 1` is `F * P * trans(F) + Q` without any composition, `k = 0` doesn't change `P`.
+                 */
+                void operator()(const nxn_matrix & F, const nxn_matrix & Q, const size_t steps, nxn_matrix & P)
+                {
+                    if (steps == 0UL)
+                    {
+                        return;
+                    }
+                    if (steps == 1UL)
+                    {
+                        P = F * P * blaze::trans(F) + Q;
+                        return;
+                    }
+
+                    bool empty        = true;
+                    _power_temp       = F;
+                    _power_noise_temp = Q;
+                    for (size_t remaining = steps; ; remaining >>= 1UL)
+                    {
+                        if (remaining & 1UL)
+                        {
+                            if (empty)
+                            {
+                                _transition_temp = _power_temp;
+                                _noise_temp      = _power_noise_temp;
+                                empty            = false;
+                            }
+                            else
+                            {
+                                compose(_transition_temp, _noise_temp, _power_temp, _power_noise_temp);
+                            }
+                        }
+                        if (remaining == 1UL)
+                        {
+                            break;
+                        }
+                        // `2^(j+1)` steps are two intervals of `2^j` steps, the noise still needs `F^(2^j)`
+                        _product_temp     = _power_temp * _power_temp;
+                        _power_noise_temp = _power_temp * _power_noise_temp * blaze::trans(_power_temp) + _power_noise_temp;
+                        _power_temp       = _product_temp;
+                    }
+                    P = _transition_temp * P * blaze::trans(_transition_temp) + _noise_temp;
+                }
+
+            // member
+            private:
+                //! transition of the composed bits
+                nxn_matrix _transition_temp;
+                //! process noise of the composed bits
+                nxn_matrix _noise_temp;
+                //! `F^(2^j)`
+                nxn_matrix _power_temp;
+                //! process noise of `2^j` steps
+                nxn_matrix _power_noise_temp;
+                //! product of two transitions, blaze doesn't multiply in place
+                nxn_matrix _product_temp;
+        };
+
+    } // namespace util
+} // namespace kafi
+
+/*! @} End of Doxygen Groups*/
+#endif // KAFI_TRANSITION_POWER_H
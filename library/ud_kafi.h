@@ -0,0 +1,499 @@
+// Copyright 2018 municHMotorsport e.V. <info@munichmotorsport.de>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef UD_KAFI_H
+#define UD_KAFI_H
+
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <tuple>
+#include "jacobian_function.h"
+#include "small_matrix.h"
+#include "util.h"
+#include "autogen-KAFI-macros.h"
+
+/*!
+ *  \addtogroup kafi
+ *  @{
+ */
+
+namespace kafi {
+
+/** \brief A UD-factorized EKF (Bierman-Thornton), propagates `P = U * diag(D) * trans(U)` without square roots
+ *
+ * The same models and results as kafi::kafi:
+ * * prediction: Thornton's modified weighted Gram-Schmidt of `[F * U, Uq]` with the weights `[D, Dq]`,
+ *   where `Q = Uq * diag(Dq) * trans(Uq)`
+ * * update: Bierman's sequential scalar updates, one per sensor, linearized once at the predicted state.
+ *   Correlated sensors are decorrelated with `cN = Ur * diag(Dr) * trans(Ur)` first, uncorrelated sensors
+ *   (a diagonal `cN`) skip that step
+ *
+ * There is no matrix inversion and no square root, only a few divisions per sensor, which is the classic choice
+ * for embedded targets, e.g. with the fixed-point kafi::fixed. `U * diag(D) * trans(U)` stays symmetric and
+ * positive semidefinite by construction like the root of kafi::sqrt_kafi.
+ *
+ * Template arguments:
+ * * `N`  = state dimensions
+ * * `M`  = sensor dimensions
+ * * `T`  = scalar type (default: `double`)
+ *
+ * See examples at [tests/equivalence_tests.cc](../../tests/equivalence_tests.cc)
+ */
+template< size_t   N            // state  dimensions (N x 1)
+        , size_t   M            // sensor dimensions (M x 1)
+        , typename T = double > // scalar type
+class ud_kafi {
+
+    // typenames
+    public:
+        //! self type for conciseness
+        using self_t     = ud_kafi<N,M,T>;
+        //! scalar type of the state, the models and the factors
+        using value_t    = T;
+        //! copied typename for conciseness
+        using nx1_vector = typename jacobian_function<N,M,T>::nx1_vector;
+        //! copied typename for conciseness
+        using mx1_vector = typename jacobian_function<N,M,T>::mx1_vector;
+        //! copied typename for conciseness
+        using mxn_matrix = typename jacobian_function<N,M,T>::mxn_matrix;
+        //! copied typename for conciseness
+        using mxm_matrix = typename jacobian_function<N,M,T>::mxm_matrix;
+        //! copied typename for conciseness
+        using nxn_matrix = typename jacobian_function<N,M,T>::nxn_matrix;
+        //! `[F * U, Uq]`, `(N x 2N)`
+        using propagation_array_t = blaze::StaticMatrix<T, N, 2UL * N, blaze::rowMajor>;
+        //! `[D, Dq]`, `(2N x 1)`
+        using propagation_weights_t = blaze::StaticMatrix<T, 2UL * N, 1UL, blaze::rowMajor>;
+        /** \brief Shorthand for a useful return type for the kalman filter, references valid until the next step()
+         *  * `const nx1_vector & = std::get<0>(x)` = state
+         *  * `const nxn_matrix & = std::get<1>(x)` = unit upper triangular `U` of the prediction error
+         *  * `const nx1_vector & = std::get<2>(x)` = diagonal `D` of the prediction error
+         */
+        using return_t   = std::tuple<const nx1_vector &,
+                                      const nxn_matrix &,
+                                      const nx1_vector &>;
+
+    // constructors
+    public:
+
+        /** \brief Default constructor, the same arguments as kafi::kafi
+         *
+         * Initializing `prediction_error` to identity matrix, i.e. `U` and `D` as well
+         *
+         * Throws `std::invalid_argument` if a noise matrix is not positive semidefinite
+         */
+        ud_kafi(const jacobian_function<N,N,T> f
+              , const jacobian_function<N,M,T> h
+              ,       nx1_vector               starting_state
+              , const nxn_matrix             & process_noise
+              , const mxm_matrix             & sensor_noise)
+        : ud_kafi<N,M,T>(std::move(f)
+                       , std::move(h)
+                       , starting_state
+                       , process_noise
+                       , sensor_noise
+                       , util::create_identity<N, blaze::rowMajor, T>())
+        { }
+
+        /**
+         * \brief The same as the default constructor, but with custom `prediction error` initialization
+         */
+        ud_kafi(const jacobian_function<N,N,T> f
+              , const jacobian_function<N,M,T> h
+              ,       nx1_vector               starting_state
+              , const nxn_matrix             & process_noise
+              , const mxm_matrix             & sensor_noise
+              , const nxn_matrix             & prediction_error)
+        : _f(std::move(f))
+        , _f_jacobian_temp(0)
+        , _predicted_state_temp(0)
+        , _propagation_array(0)
+        , _propagation_weights(0)
+        , _h(std::move(h))
+        , _h_temp(0)
+        , _h_jacobian_temp(0)
+        , _innovation_temp(0)
+        , _scalar_jacobian_temp(0)
+        , _scalar_weighted_temp(0)
+        , _scalar_gain_temp(0)
+        , _correction_temp(0)
+        , _correlated_sensors(!blaze::isDiagonal(sensor_noise))
+        , _state(starting_state)
+        , _new_data_available(false)
+        , _prediction_count(0)
+        , _update_count(0)
+        {
+            util::ud_factor(process_noise,    _process_noise_u, _process_noise_d);
+            util::ud_factor(sensor_noise,     _sensor_noise_u,  _sensor_noise_d);
+            util::ud_factor(prediction_error, _prediction_error_u, _prediction_error_d);
+        }
+
+        //! Copy constructor is deleted because ud_kafi owns multiple different potentially big matrices
+        ud_kafi(const self_t & other) = delete;
+        //! Move constructor is deleted like the one of kafi::kafi
+        ud_kafi(const self_t && other) = delete;
+
+    // methods
+    public:
+        /**
+         * The same as kafi::set_current_observation()
+         */
+        void set_current_observation(std::shared_ptr<mx1_vector> observation)
+        {
+            _observation = observation;
+            _new_data_available = true;
+        }
+
+        /**\brief Main function that runs the Kalman Filter based on new or old observation, and apply the prediction and update step
+         *
+         * Modifying:
+         *     * `_state`
+         *     * `_prediction_error_u`
+         *     * `_prediction_error_d`
+         *
+         * Return:
+         *     * tuple of references, valid until the next step()
+         *         - state
+         *         - `U` of the prediction error
+         *         - `D` of the prediction error
+         */
+        return_t step()
+        {
+            apply_prediction();
+            if (new_data_available())
+            {
+                apply_update();
+            }
+
+            DEBUG_MSG_KAFI(*this);
+            return return_t(_state, _prediction_error_u, _prediction_error_d);
+        }
+
+        //! `P = U * diag(D) * trans(U)`, e.g. to compare with kafi::kafi
+        nxn_matrix prediction_error() const
+        {
+            nxn_matrix P(0);
+            for (size_t row = 0UL; row < N; ++row)
+            {
+                for (size_t col = row; col < N; ++col)
+                {
+                    T value = T(0);
+                    for (size_t k = col; k < N; ++k)
+                    {
+                        value += _prediction_error_u(row, k) * _prediction_error_d(k, 0) * _prediction_error_u(col, k);
+                    }
+                    P(row, col) = value;
+                    P(col, row) = value;
+                }
+            }
+            return P;
+        }
+
+        /** \brief Overloading stream operator for logging purposes, the same format as kafi::kafi
+         */
+        friend std::ostream & operator<<(std::ostream& stream, const self_t & rhs)
+        {
+            std::shared_ptr<mx1_vector> o = rhs._observation.lock();
+            const char * line = "============================\n";
+            stream << "Kafi (UD):\n"
+                   << "  Update      # calls: "     << rhs._update_count       << '\n'
+                   << "  Predictions # calls: "     << rhs._prediction_count   << '\n'
+                   << " [S] _state:\n"              << rhs._state              << line;
+            if (o)
+            {
+                stream << " [O] _observation:\n"    << (*o)                    << line;
+            }
+            stream << " [U] _prediction_error_u:\n" << rhs._prediction_error_u << line
+                   << " [D] _prediction_error_d:\n" << rhs._prediction_error_d << line;
+            return stream;
+        }
+
+        /** print helper for conciseness
+         */
+        void print_state_to(std::ostream & stream)
+        {
+            stream << *this;
+        }
+
+    //! Private methods
+    private:
+        /** \brief A check if the flag `_new_data_available` is true and flips it
+         */
+        bool new_data_available()
+        {
+            if (_new_data_available) {
+                _new_data_available = false;
+                return true;
+            } else {
+                return false;
+            }
+        }
+
+        /** \brief Applying the prediction formulae, Thornton's modified weighted Gram-Schmidt
+         *
+         * The rows of `W = [F * U, Uq]` are orthogonalized with the weights `[D, Dq]` from the last to the first,
+         * so that `W * diag([D, Dq]) * trans(W) = U' * diag(D') * trans(U')`
+         *
+         * Modifying:
+         *     * `_prediction_error_u`
+         *     * `_prediction_error_d`
+         *     * `_state`
+         *     * `_prediction_count`
+         */
+        void apply_prediction()
+        {
+            // F at the current state and f(state) in a single call if `_f` is fused
+            _f.evaluate(_state, _predicted_state_temp, _f_jacobian_temp);
+            _state = _predicted_state_temp;
+            const nxn_matrix & F = _f_jacobian_temp;
+                  nxn_matrix & U = _prediction_error_u;
+                  nx1_vector & D = _prediction_error_d;
+            propagation_array_t   & W = _propagation_array;
+            propagation_weights_t & w = _propagation_weights;
+
+            // W = [F * U, Uq], U is unit upper triangular
+            for (size_t row = 0UL; row < N; ++row)
+            {
+                for (size_t col = 0UL; col < N; ++col)
+                {
+                    T value = F(row, col);
+                    for (size_t k = 0UL; k < col; ++k)
+                    {
+                        value += F(row, k) * U(k, col);
+                    }
+                    W(row, col)     = value;
+                    W(row, N + col) = _process_noise_u(row, col);
+                }
+                w(row, 0)     = D(row, 0);
+                w(N + row, 0) = _process_noise_d(row, 0);
+            }
+
+            for (size_t j = N; j-- > 0UL; )
+            {
+                T diagonal = T(0);
+                for (size_t k = 0UL; k < 2UL * N; ++k)
+                {
+                    diagonal += W(j, k) * w(k, 0) * W(j, k);
+                }
+                D(j, 0) = diagonal;
+                U(j, j) = T(1);
+                for (size_t i = j + 1UL; i < N; ++i)
+                {
+                    U(i, j) = T(0);
+                }
+
+                for (size_t i = 0UL; i < j; ++i)
+                {
+                    if (diagonal == T(0))
+                    {
+                        U(i, j) = T(0);
+                        continue;
+                    }
+                    T value = T(0);
+                    for (size_t k = 0UL; k < 2UL * N; ++k)
+                    {
+                        value += W(i, k) * w(k, 0) * W(j, k);
+                    }
+                    // divides instead of multiplying with the reciprocal, which loses precision in fixed-point
+                    const T factor = value / diagonal;
+                    U(i, j) = factor;
+                    for (size_t k = 0UL; k < 2UL * N; ++k)
+                    {
+                        W(i, k) -= factor * W(j, k);
+                    }
+                }
+            }
+
+            _prediction_count++;
+        }
+
+        /** \brief Applying the update formulae, Bierman's sequential scalar updates
+         *
+         * **Invariant**:
+         *     * `_observation` has to be initialized, implemented through ud_kafi::new_data_available()
+         *
+         * `h` and `H` are evaluated once at the predicted state, every scalar update corrects the innovation of its
+         * sensor by the corrections of the previous ones, which gives the result of the batch update of kafi::kafi.
+         *
+         * Modifying:
+         *     * `_state`
+         *     * `_prediction_error_u`
+         *     * `_prediction_error_d`
+         *     * `_update_count`
+         *     * the preallocated temporaries
+         *
+         * Throws `std::invalid_argument` if the variance of an innovation is `0`
+         */
+        void apply_update()
+        {
+            _h.evaluate(_state, _h_temp, _h_jacobian_temp);
+            std::shared_ptr<mx1_vector> o = _observation.lock();
+            mxn_matrix & H = _h_jacobian_temp;
+            mx1_vector & y = _innovation_temp;
+
+            y = *o - _h_temp;
+            if (_correlated_sensors)
+            {
+                // Ur * y' = y and Ur * H' = H, Ur is unit upper triangular
+                for (size_t row = M; row-- > 0UL; )
+                {
+                    for (size_t k = row + 1UL; k < M; ++k)
+                    {
+                        const T factor = _sensor_noise_u(row, k);
+                        y(row, 0) -= factor * y(k, 0);
+                        for (size_t col = 0UL; col < N; ++col)
+                        {
+                            H(row, col) -= factor * H(k, col);
+                        }
+                    }
+                }
+            }
+
+            _correction_temp = T(0);
+            for (size_t sensor = 0UL; sensor < M; ++sensor)
+            {
+                T residual = y(sensor, 0);
+                for (size_t col = 0UL; col < N; ++col)
+                {
+                    residual -= H(sensor, col) * _correction_temp(col, 0);
+                }
+                bierman(sensor, _sensor_noise_d(sensor, 0));
+                for (size_t row = 0UL; row < N; ++row)
+                {
+                    _correction_temp(row, 0) += _scalar_gain_temp(row, 0) * residual;
+                }
+            }
+            _state += _correction_temp;
+            _update_count++;
+        }
+
+        /** \brief Bierman's scalar update of `U` and `D` with the row `sensor` of the (decorrelated) `H` and its `variance`
+         *
+         * Writes the gain of the scalar measurement into `_scalar_gain_temp`
+         */
+        void bierman(const size_t sensor, const T variance)
+        {
+                  nxn_matrix & U = _prediction_error_u;
+                  nx1_vector & D = _prediction_error_d;
+            const mxn_matrix & H = _h_jacobian_temp;
+                  nx1_vector & f = _scalar_jacobian_temp;
+                  nx1_vector & g = _scalar_weighted_temp;
+                  nx1_vector & b = _scalar_gain_temp;
+
+            // f = trans(U) * h, g = D * f
+            for (size_t col = 0UL; col < N; ++col)
+            {
+                T value = H(sensor, col);
+                for (size_t k = 0UL; k < col; ++k)
+                {
+                    value += U(k, col) * H(sensor, k);
+                }
+                f(col, 0) = value;
+                g(col, 0) = D(col, 0) * value;
+            }
+
+            T alpha = variance + f(0, 0) * g(0, 0);
+            if (alpha == T(0))
+            {
+                throw std::invalid_argument("kafi::ud_kafi: innovation without variance");
+            }
+            D(0, 0) = D(0, 0) * variance / alpha;
+            b(0, 0) = g(0, 0);
+            for (size_t j = 1UL; j < N; ++j)
+            {
+                const T beta = alpha;
+                alpha += f(j, 0) * g(j, 0);
+                const T lambda = -f(j, 0) / beta;
+                D(j, 0) = D(j, 0) * beta / alpha;
+                for (size_t i = 0UL; i < j; ++i)
+                {
+                    const T u = U(i, j);
+                    U(i, j)  = u + b(i, 0) * lambda;
+                    b(i, 0) += g(j, 0) * u;
+                }
+                b(j, 0) = g(j, 0);
+            }
+            for (size_t row = 0UL; row < N; ++row)
+            {
+                b(row, 0) = b(row, 0) / alpha;
+            }
+        }
+
+    // member
+    private:
+        // functions with their respective preallocated resources
+
+        //! state transition function
+        const jacobian_function<N,N,T> _f;
+        //! preallocated jacobian matrix space for `_f`
+              nxn_matrix               _f_jacobian_temp;
+        //! preallocated output of `_f`, the input of `_f` never aliases its output
+              nx1_vector               _predicted_state_temp;
+        //! `W = [F * U, Uq]` of the prediction
+              propagation_array_t      _propagation_array;
+        //! `[D, Dq]` of the prediction
+              propagation_weights_t    _propagation_weights;
+        //! prediction scaling function
+        const jacobian_function<N,M,T> _h;
+        //! preallocated vector space for `_h`
+              mx1_vector               _h_temp;
+        //! preallocated jacobian matrix space for `_h`, decorrelated in place
+              mxn_matrix               _h_jacobian_temp;
+        //! `o - h(state)`, decorrelated in place
+              mx1_vector               _innovation_temp;
+        //! `f = trans(U) * h` of a scalar update
+              nx1_vector               _scalar_jacobian_temp;
+        //! `g = D * f` of a scalar update
+              nx1_vector               _scalar_weighted_temp;
+        //! gain of a scalar update
+              nx1_vector               _scalar_gain_temp;
+        //! sum of the corrections of the scalar updates
+              nx1_vector               _correction_temp;
+
+        // const matrices
+        //! `Uq` of `Q`
+              nxn_matrix               _process_noise_u;
+        //! `Dq` of `Q`
+              nx1_vector               _process_noise_d;
+        //! `Ur` of `cN`
+              mxm_matrix               _sensor_noise_u;
+        //! `Dr` of `cN`, the variances of the decorrelated sensors
+              mx1_vector               _sensor_noise_d;
+        //! `false` if `cN` is diagonal and the decorrelation is skipped
+        const bool                     _correlated_sensors;
+
+        //       matrices
+        //! `s_t` (at time `t`), the input of `_f`, which writes into `_predicted_state_temp`
+              nx1_vector               _state;
+        //! `o_t` (reference, the caller is responsible for the allocation)
+        std::weak_ptr< mx1_vector >    _observation;
+        //! `U_t` with `P_t = U_t * diag(D_t) * trans(U_t)`, unit upper triangular
+              nxn_matrix               _prediction_error_u;
+        //! `D_t`
+              nx1_vector               _prediction_error_d;
+        //! used to run the ud_kafi::apply_update() function, changed in ud_kafi::new_data_available()
+              bool                     _new_data_available;
+        // logging
+        //! used for logging purposes, tracks how often ud_kafi::apply_prediction() was run
+              size_t                   _prediction_count;
+        //! used for logging purposes, tracks how often ud_kafi::apply_update() was run
+              size_t                   _update_count;
+};
+
+} // namespace kafi
+
+/*! @} End of Doxygen Groups*/
+#endif // UD_KAFI_H
@@ -0,0 +1,500 @@
+// Copyright 2018 municHMotorsport e.V. <info@munichmotorsport.de>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef UNSCENTED_KAFI_H
+#define UNSCENTED_KAFI_H
+
+#include <array>
+#include <cmath>
+#include <iostream>
+#include <memory>
+#include <tuple>
+#include "jacobian_function.h"
+#include "small_matrix.h"
+#include "tile_pool.h"
+#include "util.h"
+#include "autogen-KAFI-macros.h"
+
+/*!
+ *  \addtogroup kafi
+ *  @{
+ */
+
+namespace kafi {
+
+/** \brief An unscented Kalman filter, the models are only the functions `f` and `h` of kafi::jacobian_function
+ *
+ * Instead of linearizing the models with their jacobians, the `2N + 1` sigma points `s`, `s +- c * S_i` (`S_i` are
+ * the columns of the lower triangular root of `P`) are propagated through `f` and `h`. The mean and the
+ * covariance are the weighted sums of the results, so there is no derivative table to write. For linear models
+ * the results are the ones of kafi::kafi.
+ *
+ * The sigma points and their images under `f` and `h` are stored contiguously, one `nx1_vector` or `mx1_vector`
+ * after the other. The evaluation of the sigma points is split in contiguous ranges on a util::tile_pool, which is
+ * started in the constructor. With more than one worker `f` and `h` are called concurrently and have to be safe
+ * to call from multiple threads, the calls write to distinct outputs.
+ *
+ * Template arguments:
+ * * `N`  = state dimensions
+ * * `M`  = sensor dimensions
+ * * `T`  = scalar type (default: `double`)
+ *
+ * See examples at [tests/equivalence_tests.cc](../../tests/equivalence_tests.cc)
+ */
+template< size_t   N            // state  dimensions (N x 1)
+        , size_t   M            // sensor dimensions (M x 1)
+        , typename T = double > // scalar type
+class unscented_kafi {
+
+    // typenames
+    public:
+        //! self type for conciseness
+        using self_t     = unscented_kafi<N,M,T>;
+        //! scalar type of the state, the models and the propagation
+        using value_t    = T;
+        //! copied typename for conciseness
+        using nx1_vector = typename jacobian_function<N,M,T>::nx1_vector;
+        //! copied typename for conciseness
+        using mx1_vector = typename jacobian_function<N,M,T>::mx1_vector;
+        //! copied typename for conciseness
+        using nxm_matrix = typename jacobian_function<N,M,T>::nxm_matrix;
+        //! copied typename for conciseness
+        using mxm_matrix = typename jacobian_function<N,M,T>::mxm_matrix;
+        //! copied typename for conciseness
+        using nxn_matrix = typename jacobian_function<N,M,T>::nxn_matrix;
+        //! state transition `f`, the same type as the one of kafi::jacobian_function
+        using f_func     = typename jacobian_function<N,N,T>::func;
+        //! prediction scaling `h`, the same type as the one of kafi::jacobian_function
+        using h_func     = typename jacobian_function<N,M,T>::func;
+        /** \brief Shorthand for a useful return type for the kalman filter, references valid until the next step()
+         *  * `const nx1_vector & = std::get<0>(x)` = state
+         *  * `const nxn_matrix & = std::get<1>(x)` = prediction error
+         *  * `const nxm_matrix & = std::get<2>(x)` = gain
+         */
+        using return_t   = std::tuple<const nx1_vector &,
+                                      const nxn_matrix &,
+                                      const nxm_matrix &>;
+
+        //! number of sigma points
+        static constexpr size_t sigma_points = 2UL * N + 1UL;
+
+    // constructors
+    public:
+
+        /** \brief Default constructor
+         *
+         * Arguments:
+         * * `f_func f`: state transition function, e.g. `jacobian_function<N,N,T>::function()`
+         * * `h_func h`: prediction scaling function, e.g. `jacobian_function<N,M,T>::function()`
+         * * the state and the noise matrices are the same as the ones of kafi::kafi
+         * * `const size_t workers`: threads which evaluate the sigma points, including the calling thread
+         *
+         * Initializing `prediction_error` to identity matrix via util::create_identity<N, blaze::rowMajor, T>()
+         */
+        unscented_kafi(      f_func       f
+                     ,       h_func       h
+                     ,       nx1_vector   starting_state
+                     , const nxn_matrix & process_noise
+                     , const mxm_matrix & sensor_noise
+                     , const size_t       workers = 1UL)
+        : unscented_kafi<N,M,T>(std::move(f)
+                              , std::move(h)
+                              , starting_state
+                              , process_noise
+                              , sensor_noise
+                              , util::create_identity<N, blaze::rowMajor, T>()
+                              , workers)
+        { }
+
+        /**
+         * \brief The same as the default constructor, but with custom `prediction error` initialization
+         */
+        unscented_kafi(      f_func       f
+                     ,       h_func       h
+                     ,       nx1_vector   starting_state
+                     , const nxn_matrix & process_noise
+                     , const mxm_matrix & sensor_noise
+                     , const nxn_matrix & prediction_error
+                     , const size_t       workers = 1UL)
+        : _f(std::move(f))
+        , _h(std::move(h))
+        , _pool(new util::tile_pool(workers))
+        , _process_noise(process_noise)
+        , _sensor_noise(sensor_noise)
+        , _root_temp(0)
+        , _observed_mean_temp(0)
+        , _innovation_covariance_temp(0)
+        , _innovation_inverse_temp(0)
+        , _cross_covariance_temp(0)
+        , _innovation_temp(0)
+        , _state(starting_state)
+        , _prediction_error(prediction_error)
+        , _gain(0)
+        , _new_data_available(false)
+        , _prediction_count(0)
+        , _update_count(0)
+        {
+            set_sigma_point_spread(T(1), T(2), T(0));
+        }
+
+        //! Copy constructor is deleted because unscented_kafi owns multiple different potentially big matrices
+        unscented_kafi(const self_t & other) = delete;
+        //! Move constructor is deleted like the one of kafi::kafi
+        unscented_kafi(const self_t && other) = delete;
+
+    // methods
+    public:
+        /**
+         * The same as kafi::set_current_observation()
+         */
+        void set_current_observation(std::shared_ptr<mx1_vector> observation)
+        {
+            _observation = observation;
+            _new_data_available = true;
+        }
+
+        /** \brief Selects the sigma points and their weights, `alpha = 1`, `beta = 2`, `kappa = 0` by default
+         *
+         * With `lambda = alpha^2 * (N + kappa) - N` the sigma points are `s +- sqrt(N + lambda) * S_i`, the
+         * mean weights `lambda / (N + lambda)` for `s` and `1 / (2 * (N + lambda))` for the others. `beta`
+         * is added to the covariance weight of `s`, `2` is optimal for gaussian distributions. A small `alpha`
+         * keeps the sigma points close to the state, but weights `s` with a large negative number.
+         *
+         * Modifying:
+         *     * the weights and the spread of the sigma points
+         */
+        void set_sigma_point_spread(const T alpha, const T beta, const T kappa)
+        {
+            using std::sqrt;
+            const T n      = static_cast<T>(N);
+            const T lambda = alpha * alpha * (n + kappa) - n;
+            _spread            = sqrt(n + lambda);
+            _weight            = T(1) / (T(2) * (n + lambda));
+            _mean_weight       = lambda / (n + lambda);
+            _covariance_weight = _mean_weight + T(1) - alpha * alpha + beta;
+        }
+
+        //! number of threads which evaluate the sigma points, including the calling thread
+        size_t workers() const
+        {
+            return _pool->workers();
+        }
+
+        /**\brief Main function that runs the Kalman Filter based on new or old observation, and apply the prediction and update step
+         *
+         * Modifying:
+         *     * `_gain`
+         *     * `_state`
+         *     * `_prediction_error`
+         *
+         * Return:
+         *     * tuple of references, valid until the next step()
+         *         - state
+         *         - prediction_error
+         *         - gain
+         */
+        return_t step()
+        {
+            apply_prediction();
+            if (new_data_available())
+            {
+                apply_update();
+            }
+
+            DEBUG_MSG_KAFI(*this);
+            return return_t(_state, _prediction_error, _gain);
+        }
+
+        /** \brief Overloading stream operator for logging purposes, the same format as kafi::kafi
+         */
+        friend std::ostream & operator<<(std::ostream& stream, const self_t & rhs)
+        {
+            std::shared_ptr<mx1_vector> o = rhs._observation.lock();
+            const char * line = "============================\n";
+            stream << "Kafi (unscented):\n"
+                   << "  Update      # calls: "   << rhs._update_count     << '\n'
+                   << "  Predictions # calls: "   << rhs._prediction_count << '\n'
+                   << " [S] _state:\n"            << rhs._state            << line;
+            if (o)
+            {
+                stream << " [O] _observation:\n"  << (*o)                  << line;
+            }
+            stream << " [P] _prediction_error:\n" << rhs._prediction_error << line
+                   << " [G] _gain:\n"             << rhs._gain             << line;
+            return stream;
+        }
+
+        /** print helper for conciseness
+         */
+        void print_state_to(std::ostream & stream)
+        {
+            stream << *this;
+        }
+
+    //! Private methods
+    private:
+        /** \brief A check if the flag `_new_data_available` is true and flips it
+         */
+        bool new_data_available()
+        {
+            if (_new_data_available) {
+                _new_data_available = false;
+                return true;
+            } else {
+                return false;
+            }
+        }
+
+        /** \brief `s`, `s + c * S_i` and `s - c * S_i` with the lower triangular root `S` of `P`
+         *
+         * Modifying:
+         *     * `_root_temp`
+         *     * `_sigma_points`
+         */
+        void draw_sigma_points()
+        {
+            util::cholesky_factor(_prediction_error, _root_temp);
+            _sigma_points[0] = _state;
+            for (size_t point = 1UL; point <= N; ++point)
+            {
+                nx1_vector & plus  = _sigma_points[point];
+                nx1_vector & minus = _sigma_points[point + N];
+                for (size_t row = 0UL; row < N; ++row)
+                {
+                    const T offset = _spread * _root_temp(row, point - 1UL);
+                    plus(row, 0)  = _state(row, 0) + offset;
+                    minus(row, 0) = _state(row, 0) - offset;
+                }
+            }
+        }
+
+        /** \brief `output[i] = func(input[i])` for all sigma points, every worker takes a contiguous range
+         */
+        template< typename Func
+                , typename Input
+                , typename Output >
+        void evaluate_sigma_points(const Func & func, const Input & input, Output & output)
+        {
+            auto kernel = [&func, &input, &output](const size_t worker, const size_t workers)
+            {
+                const size_t begin = sigma_points * worker / workers;
+                const size_t end   = sigma_points * (worker + 1UL) / workers;
+                for (size_t point = begin; point < end; ++point)
+                {
+                    func(input[point], output[point]);
+                }
+            };
+            _pool->run(kernel);
+        }
+
+        /** \brief Weighted mean of the images of the sigma points, which are replaced by their deviation from the mean
+         */
+        template< typename Points
+                , typename Vector >
+        void mean_and_deviations(Points & points, Vector & mean) const
+        {
+            const size_t rows = mean.rows();
+            for (size_t row = 0UL; row < rows; ++row)
+            {
+                T sum = T(0);
+                for (size_t point = 1UL; point < sigma_points; ++point)
+                {
+                    sum += points[point](row, 0);
+                }
+                mean(row, 0) = _mean_weight * points[0](row, 0) + _weight * sum;
+            }
+            for (size_t point = 0UL; point < sigma_points; ++point)
+            {
+                for (size_t row = 0UL; row < rows; ++row)
+                {
+                    points[point](row, 0) -= mean(row, 0);
+                }
+            }
+        }
+
+        /** \brief `result = noise + sum(w_i * d_i * trans(d_i))` of the deviations `d_i`, the upper triangle is mirrored
+         */
+        template< typename Points
+                , typename Matrix >
+        void covariance(const Points & deviations, const Matrix & noise, Matrix & result) const
+        {
+            const size_t rows = result.rows();
+            for (size_t row = 0UL; row < rows; ++row)
+            {
+                for (size_t col = row; col < rows; ++col)
+                {
+                    T sum = T(0);
+                    for (size_t point = 1UL; point < sigma_points; ++point)
+                    {
+                        sum += deviations[point](row, 0) * deviations[point](col, 0);
+                    }
+                    const T value = noise(row, col)
+                                  + _covariance_weight * deviations[0](row, 0) * deviations[0](col, 0)
+                                  + _weight * sum;
+                    result(row, col) = value;
+                    result(col, row) = value;
+                }
+            }
+        }
+
+        /** \brief Applying the prediction formulae with the sigma points of `s` and `P`
+         *
+         * Modifying:
+         *     * `_prediction_error`
+         *     * `_state`
+         *     * `_prediction_count`
+         *     * the sigma points and their images
+         */
+        void apply_prediction()
+        {
+            draw_sigma_points();
+            evaluate_sigma_points(_f, _sigma_points, _propagated_points);
+            mean_and_deviations(_propagated_points, _state);
+            covariance(_propagated_points, _process_noise, _prediction_error);
+            _prediction_count++;
+        }
+
+        /** \brief Applying the update formulae with the sigma points of the predicted `s` and `P`
+         *
+         * **Invariant**:
+         *     * `_observation` has to be initialized, implemented through unscented_kafi::new_data_available()
+         *
+         * Modifying:
+         *     * `_gain`
+         *     * `_state`
+         *     * `_prediction_error`
+         *     * `_update_count`
+         *     * the preallocated temporaries
+         */
+        void apply_update()
+        {
+                  nxn_matrix & P = _prediction_error;
+            std::shared_ptr<mx1_vector> o = _observation.lock();
+
+            draw_sigma_points();
+            evaluate_sigma_points(_h, _sigma_points, _observed_points);
+            mean_and_deviations(_observed_points, _observed_mean_temp);
+            covariance(_observed_points, _sensor_noise, _innovation_covariance_temp);
+
+            // cross covariance of the state and the observation, the sigma points deviate by `+- c * S_i` from `s`
+            for (size_t row = 0UL; row < N; ++row)
+            {
+                for (size_t col = 0UL; col < M; ++col)
+                {
+                    T sum = T(0);
+                    for (size_t point = 1UL; point <= N; ++point)
+                    {
+                        const T offset = _spread * _root_temp(row, point - 1UL);
+                        sum += offset * (_observed_points[point](col, 0) - _observed_points[point + N](col, 0));
+                    }
+                    _cross_covariance_temp(row, col) = _weight * sum;
+                }
+            }
+
+            util::inverse(_innovation_covariance_temp, _innovation_inverse_temp);
+            _gain = _cross_covariance_temp * _innovation_inverse_temp;
+
+            _innovation_temp  = *o - _observed_mean_temp;
+            _state           += _gain * _innovation_temp;
+
+            // P - G * S * trans(G) = P - G * trans(Pxz), the upper triangle is mirrored to keep P exactly symmetric
+            for (size_t row = 0UL; row < N; ++row)
+            {
+                for (size_t col = row; col < N; ++col)
+                {
+                    T sum = P(row, col);
+                    for (size_t k = 0UL; k < M; ++k)
+                    {
+                        sum -= _gain(row, k) * _cross_covariance_temp(col, k);
+                    }
+                    P(row, col) = sum;
+                    P(col, row) = sum;
+                }
+            }
+            _update_count++;
+        }
+
+    // member
+    private:
+        // functions with their respective preallocated resources
+
+        //! state transition function
+        const f_func                   _f;
+        //! prediction scaling function
+        const h_func                   _h;
+        //! evaluates the sigma points, the threads are started in the constructor
+        std::unique_ptr< util::tile_pool > _pool;
+        //! `2N + 1` sigma points, `s`, `s + c * S_i`, `s - c * S_i`
+        std::array< nx1_vector, sigma_points > _sigma_points;
+        //! `f` of the sigma points, replaced by their deviations from the mean
+        std::array< nx1_vector, sigma_points > _propagated_points;
+        //! `h` of the sigma points, replaced by their deviations from the mean
+        std::array< mx1_vector, sigma_points > _observed_points;
+
+        // weights of the sigma points, see unscented_kafi::set_sigma_point_spread()
+        //! `c = sqrt(N + lambda)`
+              T                        _spread;
+        //! mean and covariance weight of all sigma points but `s`
+              T                        _weight;
+        //! mean weight of `s`
+              T                        _mean_weight;
+        //! covariance weight of `s`
+              T                        _covariance_weight;
+
+        // const matrices
+        //! `Q` (covariance of real world)
+        const nxn_matrix               _process_noise;
+        //! `cN` (covariance of sensors)
+        const mxm_matrix               _sensor_noise;
+
+        // preallocated resources
+        //! lower triangular root `S` of `P`
+              nxn_matrix               _root_temp;
+        //! weighted mean of `h` of the sigma points
+              mx1_vector               _observed_mean_temp;
+        //! innovation covariance
+              mxm_matrix               _innovation_covariance_temp;
+        //! inverse of the innovation covariance, see util::inverse()
+              mxm_matrix               _innovation_inverse_temp;
+        //! `Pxz`, cross covariance of the state and the observation
+              nxm_matrix               _cross_covariance_temp;
+        //! `o - mean(h)`
+              mx1_vector               _innovation_temp;
+
+        //       matrices
+        //! `s_t` (at time `t`)
+              nx1_vector               _state;
+        //! `o_t` (reference, the caller is responsible for the allocation)
+        std::weak_ptr< mx1_vector >    _observation;
+        //! `P_t`
+              nxn_matrix               _prediction_error;
+        //! `G_t`
+              nxm_matrix               _gain;
+        //! used to run the unscented_kafi::apply_update() function, changed in unscented_kafi::new_data_available()
+              bool                     _new_data_available;
+        // logging
+        //! used for logging purposes, tracks how often unscented_kafi::apply_prediction() was run
+              size_t                   _prediction_count;
+        //! used for logging purposes, tracks how often unscented_kafi::apply_update() was run
+              size_t                   _update_count;
+};
+
+//! definition of the static member, needed before C++17 if it's odr-used
+template< size_t N, size_t M, typename T >
+constexpr size_t unscented_kafi<N,M,T>::sigma_points;
+
+} // namespace kafi
+
+/*! @} End of Doxygen Groups*/
+#endif // UNSCENTED_KAFI_H
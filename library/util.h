@@ -32,19 +32,19 @@ namespace kafi
       */
     namespace util {
         /**
-         * \brief Static allocated identity matrix specialized for doubles
+         * \brief Static allocated identity matrix
          *
          * Template arguments:
          * * `N`  = Number of rows and columns
          * * `SO` = Storage order, e.g `blaze::rowMajor`
-         * 
-         * \todo make generic with SFINAE and `is_integral` check on inner type `T` (currently `double`) 
+         * * `T`  = scalar type, has to be constructible from `0` and `1` (default: `double`)
          */ 
         template< size_t   N   
-                , bool     SO >
-        constexpr blaze::StaticMatrix<double, N, N, SO> create_identity()
+                , bool     SO
+                , typename T = double >
+        constexpr blaze::StaticMatrix<T, N, N, SO> create_identity()
         {
-            blaze::StaticMatrix<double, N, N, SO> matrix(0);
+            blaze::StaticMatrix<T, N, N, SO> matrix(0);
             for (size_t row = 0UL; row < matrix.rows(); ++row)
             {
                 for (size_t col = 0UL; col < matrix.columns(); ++col)
@@ -68,22 +68,24 @@ namespace kafi
          * Template arguments:
          * * `N` = state dimensions
          * * `M` = sensor dimensions
+         * * `T` = scalar type (default: `double`)
          *
          * Return type:
          * * std::function( `nx1_vector`, `mx1_vector` ) -> *void*
          *
          * See more examples in [tests/util_tests.cc](../../tests/util_tests.cc)
          */
-        template< size_t N
-                , size_t M >
-        std::function<void(blaze::StaticMatrix<double, N, 1UL, blaze::rowMajor> &    // aka nx1_vector
-                         , blaze::StaticMatrix<double, M, 1UL, blaze::rowMajor> &)>  // aka mx1_vector
+        template< size_t   N
+                , size_t   M
+                , typename T = double >
+        std::function<void(const blaze::StaticMatrix<T, N, 1UL, blaze::rowMajor> &    // aka nx1_vector
+                         ,       blaze::StaticMatrix<T, M, 1UL, blaze::rowMajor> &)>  // aka mx1_vector
         identity_broadcast_function()
         {
-            using nx1_vector = typename kafi::jacobian_function<N,M>::nx1_vector;
-            using mx1_vector = typename kafi::jacobian_function<N,M>::mx1_vector;
+            using nx1_vector = typename kafi::jacobian_function<N,M,T>::nx1_vector;
+            using mx1_vector = typename kafi::jacobian_function<N,M,T>::mx1_vector;
 
-            const auto f = [&](nx1_vector & input, mx1_vector & output)
+            const auto f = [&](const nx1_vector & input, mx1_vector & output)
             {
                 for (size_t m = 0; m < M; ++m)
                 {
@@ -97,28 +99,24 @@ namespace kafi
         /*!
          * \brief Derivative function of util::identity_broadcast_function
          *
-         * Used to create a partial derivative, parametrizable with the return type, mostly 0 or 1
+         * Used to create a partial derivative, parametrizable with the return type, mostly 0 or 1. It is a
+         * kafi::constant_derivative, so kafi::jacobian_function evaluates it only once
          *
          * Template arguments:
          * * `N` = state dimensions
+         * * `T` = scalar type (default: `double`), `ret` is converted once
          *
          * Return type:
-         * * std::function( `const nx1_vector` ) -> *double*
+         * * std::function( `const nx1_vector` ) -> *T*
          *
          * See examples in [tests/util_tests.cc](../../tests/util_tests.cc)
          */
-        template< size_t N >
-        const std::function<double(const blaze::StaticMatrix<double, N, 1UL, blaze::rowMajor> &)> // aka par_jacobi_func
+        template< size_t   N
+                , typename T = double >
+        const std::function<T(const blaze::StaticMatrix<T, N, 1UL, blaze::rowMajor> &)> // aka par_jacobi_func
         identity_derivative(double ret)
         {
-            using nx1_vector      = typename kafi::jacobian_function<N,1UL>::nx1_vector;
-            using par_jacobi_func = typename kafi::jacobian_function<N,1UL>::par_jacobi_func;
-
-            const par_jacobi_func f_ = [ret](const nx1_vector & in){
-                UNUSED(in);
-                return ret;
-            };
-            return f_;
+            return kafi::constant_derivative<N,T>{ static_cast<T>(ret) };
         }
         
         /*! \brief Helper function to create a broadcasting identity function for easier tests on multiple dimensions
@@ -126,6 +124,7 @@ namespace kafi
          * Template arguments:
          * * `N`  = state dimensions
          * * `M`  = sensor dimensions
+         * * `T`  = scalar type (default: `double`)
          *
          * See examples in [tests/jacobian_function_tests.cc](../../tests/jacobian_function_tests.cc)
          *
@@ -161,24 +160,25 @@ namespace kafi
          *
          * ```
          */
-        template< size_t N
-                , size_t M >
-        jacobian_function<N,M> create_identity_jacobian()
+        template< size_t   N
+                , size_t   M
+                , typename T = double >
+        jacobian_function<N,M,T> create_identity_jacobian()
         {
-            using func            = typename kafi::jacobian_function<N,M>::func;
-            using par_jacobi_func = typename kafi::jacobian_function<N,M>::par_jacobi_func;
-            using jacobi_func     = typename kafi::jacobian_function<N,M>::jacobi_func;
+            using func            = typename kafi::jacobian_function<N,M,T>::func;
+            using par_jacobi_func = typename kafi::jacobian_function<N,M,T>::par_jacobi_func;
+            using jacobi_func     = typename kafi::jacobian_function<N,M,T>::jacobi_func;
 
-                  func            f      = identity_broadcast_function<N,M>();
-            const par_jacobi_func f_one  = identity_derivative<N>(1);
-            const par_jacobi_func f_zero = identity_derivative<N>(0);
+                  func            f      = identity_broadcast_function<N,M,T>();
+            const par_jacobi_func f_one  = identity_derivative<N,T>(1);
+            const par_jacobi_func f_zero = identity_derivative<N,T>(0);
             jacobi_func F(f_zero);
 
             for (size_t row = 0UL; row < M; ++row)
             {
                 F(row, 0) = f_one;
             }
-            return jacobian_function<N, M>(f, F);
+            return jacobian_function<N, M, T>(f, F);
         }
     } // namespace util
 } // namespace kafi
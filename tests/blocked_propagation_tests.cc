@@ -0,0 +1,124 @@
+// Copyright 2018 municHMotorsport e.V. <info@munichmotorsport.de>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <blaze/Math.h>
+#include <atomic>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "catch.h"
+
+#include "../library/blocked_propagation.h"
+
+/** \brief util::blocked_propagation with `workers` threads against `F * P * trans(F) + Q` of blaze
+ */
+void test_blocked_propagation(const size_t N, const size_t workers)
+{
+    using matrix_t = blaze::DynamicMatrix<double, blaze::rowMajor>;
+
+    std::string description = "N = ";
+    description.append(std::to_string(N));
+    description.append(", workers = ");
+    description.append(std::to_string(workers));
+    SECTION(description){
+        std::mt19937 generator(static_cast<unsigned int>(N));
+        std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+
+        matrix_t F(N, N), root(N, N), Q(N, N, 0.0);
+        for (size_t row = 0UL; row < N; ++row)
+        {
+            for (size_t col = 0UL; col < N; ++col)
+            {
+                F(row, col)    = uniform(generator);
+                root(row, col) = uniform(generator);
+            }
+            Q(row, row) = 0.5;
+        }
+        // symmetric like every covariance
+        matrix_t P(root * blaze::trans(root));
+        matrix_t FP(N, N);
+        const matrix_t FPF(F * P);
+        const matrix_t expected(FPF * blaze::trans(F) + Q);
+
+        kafi::util::blocked_propagation<double> propagation(workers);
+        REQUIRE(propagation.workers() == workers);
+        propagation(F, P, Q, FP);
+
+        for (size_t row = 0UL; row < N; ++row)
+        {
+            for (size_t col = 0UL; col < N; ++col)
+            {
+                REQUIRE(P(row, col) == Approx(expected(row, col)).margin(1e-9));
+                REQUIRE(P(row, col) == P(col, row));
+            }
+        }
+    }
+}
+
+TEST_CASE("blocked_propagation.h", "[blocked]") {
+
+    SECTION("tile_pool runs every worker once per run()") {
+        kafi::util::tile_pool pool(4UL);
+        REQUIRE(pool.workers() == 4UL);
+
+        // Catch isn't thread safe, the workers only count
+        std::vector< std::atomic<size_t> > calls(4UL);
+        std::atomic<size_t> wrong_workers(0UL);
+        for (std::atomic<size_t> & count : calls) count = 0UL;
+        auto kernel = [&calls, &wrong_workers](const size_t worker, const size_t workers)
+        {
+            if (workers != 4UL) wrong_workers++;
+            calls[worker]++;
+        };
+        for (size_t run = 0UL; run < 100UL; ++run)
+        {
+            pool.run(kernel);
+        }
+        REQUIRE(wrong_workers == 0UL);
+        for (const std::atomic<size_t> & count : calls)
+        {
+            REQUIRE(count == 100UL);
+        }
+    }
+
+    SECTION("tile_pool rethrows the exception of a worker after all workers are done") {
+        kafi::util::tile_pool pool(4UL);
+
+        std::atomic<size_t> finished(0UL);
+        auto kernel = [&finished](const size_t worker, const size_t)
+        {
+            if (worker == 2UL) throw std::runtime_error("worker 2");
+            finished++;
+        };
+        REQUIRE_THROWS_AS(pool.run(kernel), std::runtime_error);
+        REQUIRE(finished == 3UL);
+
+        // the pool keeps working and forgets the exception
+        finished = 0UL;
+        auto counter = [&finished](const size_t, const size_t){ finished++; };
+        pool.run(counter);
+        REQUIRE(finished == 4UL);
+    }
+
+    SECTION("F * P * trans(F) + Q", "N = 1,63,64,65,150 with 1, 2 and 4 workers") {
+        test_blocked_propagation(1UL,   1UL);
+        test_blocked_propagation(1UL,   4UL);
+        test_blocked_propagation(63UL,  2UL);
+        test_blocked_propagation(64UL,  2UL);
+        test_blocked_propagation(65UL,  4UL);
+        test_blocked_propagation(150UL, 1UL);
+        test_blocked_propagation(150UL, 4UL);
+    }
+}
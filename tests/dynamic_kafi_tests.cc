@@ -0,0 +1,270 @@
+// Copyright 2018 municHMotorsport e.V. <info@munichmotorsport.de>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <blaze/Math.h>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#include "catch.h"
+
+#include "../library/kafi.h"
+#include "../library/dynamic_kafi.h"
+#include "equivalence.h"
+#include "models.h"
+
+//! counts every heap allocation of the test binary, see "step() doesn't allocate"
+static std::atomic<size_t> allocation_count(0);
+
+void * operator new(size_t size)
+{
+    allocation_count++;
+    void * memory = std::malloc(size == 0 ? 1 : size);
+    if (memory == nullptr) throw std::bad_alloc();
+    return memory;
+}
+
+void operator delete(void * memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void * memory, size_t) noexcept
+{
+    std::free(memory);
+}
+
+/** \brief The temperature example of tests/kafi_tests.cc, written directly against the runtime-sized interface
+ */
+std::unique_ptr< kafi::dynamic_kafi<> > make_temperature_filter()
+{
+    using jacobian_t = kafi::dynamic_jacobian_function<>;
+    using view_t     = jacobian_t::view_t;
+    using matrix_t   = kafi::dynamic_kafi<>::matrix_t;
+
+    const size_t N = 1UL;
+    const size_t M = 2UL;
+
+    // state transition, the identity
+    jacobian_t::jacobi_func F(N, N);
+    F(0, 0) = [](const view_t &){ return 1.0; };
+    jacobian_t f(N, N, [](const view_t & state, view_t & output){ output(0, 0) = state(0, 0); }, F);
+
+    // prediction scaling, both sensors measure the state
+    jacobian_t::jacobi_func H(M, N);
+    H(0, 0) = [](const view_t &){ return 1.0; };
+    H(1, 0) = [](const view_t &){ return 1.0; };
+    jacobian_t h(N, M, [](const view_t & state, view_t & output){ output(0, 0) = state(0, 0);
+                                                                  output(1, 0) = state(0, 0); }, H);
+
+    matrix_t starting_state(N, 1UL, 20.64);
+    matrix_t process_noise(N, N, 0.05);
+    matrix_t sensor_noise(M, M, 0.0);
+    sensor_noise(0, 0) = 0.64;
+    sensor_noise(1, 1) = 0.64;
+
+    return std::unique_ptr< kafi::dynamic_kafi<> >(
+        new kafi::dynamic_kafi<>(std::move(f), std::move(h), starting_state, process_noise, sensor_noise));
+}
+
+//! the filter of a randomized linear model of runtime size, in the large-state mode if `workers > 0`
+std::unique_ptr< kafi::dynamic_kafi<> > make_runtime_linear_filter(const models::linear::runtime_model & model, const size_t workers)
+{
+    return std::unique_ptr< kafi::dynamic_kafi<> >(
+        new kafi::dynamic_kafi<>(model.transition()
+                               , model.prediction_scaling()
+                               , model.starting_state
+                               , model.process_noise
+                               , model.sensor_noise
+                               , workers));
+}
+
+TEST_CASE("runtime-sized kalman filter", "[dynamic]") {
+
+    using matrix_t = kafi::dynamic_kafi<>::matrix_t;
+
+    SECTION("temperature test, N = 1, M = 2") {
+        auto filter = make_temperature_filter();
+        REQUIRE(filter->state_dimension()  == 1UL);
+        REQUIRE(filter->sensor_dimension() == 2UL);
+
+        std::shared_ptr< matrix_t > first_observation = std::make_shared< matrix_t >(2UL, 1UL);
+        (*first_observation)(0, 0) = 18.625;
+        (*first_observation)(1, 0) = 20;
+        filter->set_current_observation(first_observation);
+
+        const auto result = filter->step();
+        // the same ground truth and tolerance as the static example
+        REQUIRE(19.62 == Approx(std::get<0>(result)(0, 0)).epsilon(0.01));
+    }
+
+    SECTION("dimensions are checked at construction") {
+        using jacobian_t = kafi::dynamic_jacobian_function<>;
+        using view_t     = jacobian_t::view_t;
+        const auto f = [](const view_t &, view_t &){ };
+
+        REQUIRE_THROWS_AS(jacobian_t(2UL, 3UL, f, jacobian_t::jacobi_func(2UL, 3UL)), std::invalid_argument);
+
+        const matrix_t state(2UL, 1UL, 0.0);
+        const matrix_t process_noise(2UL, 2UL, 0.0);
+        const matrix_t wrong_sensor_noise(2UL, 2UL, 0.0);
+        REQUIRE_THROWS_AS(kafi::dynamic_kafi<>(jacobian_t(2UL, 2UL, f, jacobian_t::jacobi_func(2UL, 2UL))
+                                             , jacobian_t(2UL, 1UL, f, jacobian_t::jacobi_func(1UL, 2UL))
+                                             , state
+                                             , process_noise
+                                             , wrong_sensor_noise)
+                        , std::invalid_argument);
+
+        auto filter = make_temperature_filter();
+        REQUIRE_THROWS_AS(filter->set_current_observation(std::make_shared< matrix_t >(3UL, 1UL)), std::invalid_argument);
+    }
+
+    SECTION("arena alignment and size") {
+        using arena_t = kafi::util::arena<double>;
+        arena_t arena(arena_t::padded_size(3UL, 3UL) + arena_t::padded_size(1UL, 1UL));
+        const arena_t::view_t first  = arena.allocate(3UL, 3UL);
+        const arena_t::view_t second = arena.allocate(1UL, 1UL);
+        REQUIRE(reinterpret_cast<std::uintptr_t>(first.data())  % arena_t::cache_line_size == 0UL);
+        REQUIRE(reinterpret_cast<std::uintptr_t>(second.data()) % arena_t::cache_line_size == 0UL);
+        REQUIRE(arena.used() == arena.capacity());
+        REQUIRE_THROWS_AS(arena.allocate(1UL, 1UL), std::length_error);
+
+        // N = 1, M = 2: 18 views, each rounded up to a cache line of 8 doubles
+        REQUIRE(kafi::dynamic_kafi<>::required_capacity(1UL, 2UL) == 18UL * 8UL);
+    }
+
+    SECTION("make_dynamic evaluates the static function once per call, N = 7, M = 5") {
+        using namespace models::correvit;
+        using view_t = kafi::dynamic_jacobian_function<>::view_t;
+
+        const kafi::jacobian_function<N,N> f = transition();
+        const kafi::dynamic_jacobian_function<> dynamic_f = kafi::make_dynamic(f);
+
+        const std::vector< mx1_vector > observations = read_log(wemding_log);
+        nx1_vector state = starting_state(observations[0]);
+        state(6, 0) = 0.3;
+        nx1_vector static_output;
+        nxn_matrix static_jacobian;
+        f.evaluate(state, static_output, static_jacobian);
+
+        matrix_t input(state);
+        matrix_t output(N, 1UL);
+        matrix_t jacobian(N, N);
+        const view_t input_view(input.data(), N, 1UL, input.spacing());
+        view_t output_view(output.data(), N, 1UL, output.spacing());
+        view_t jacobian_view(jacobian.data(), N, N, jacobian.spacing());
+        dynamic_f.evaluate(input_view, output_view, jacobian_view);
+        REQUIRE(equivalence::max_deviation(static_output,   output)   == 0.0);
+        REQUIRE(equivalence::max_deviation(static_jacobian, jacobian) == 0.0);
+
+        // the single partial derivatives are still available
+        dynamic_f.jacobian(input_view, jacobian_view);
+        REQUIRE(equivalence::max_deviation(static_jacobian, jacobian) == 0.0);
+    }
+
+    SECTION("large-state mode, N = 150, M = 10") {
+        const models::linear::runtime_model model(150UL, 10UL, 1, 20UL);
+
+        auto reference = make_runtime_linear_filter(model, 0UL);
+        auto candidate = make_runtime_linear_filter(model, 3UL);
+        REQUIRE(reference->propagation_workers() == 0UL);
+        REQUIRE(candidate->propagation_workers() == 3UL);
+
+        equivalence::report report = equivalence::compare(*reference, *candidate, model.observations);
+        REQUIRE(report.max_state      < 1e-9);
+        REQUIRE(report.max_covariance < 1e-9);
+    }
+
+    SECTION("the state transition never writes into its input, N = 2, M = 1") {
+        using jacobian_t = kafi::dynamic_jacobian_function<>;
+        using view_t     = jacobian_t::view_t;
+
+        // constant velocity
+        size_t aliased = 0UL;
+        jacobian_t::jacobi_func F(2UL, 2UL);
+        F(0, 0) = [](const view_t &){ return 1.0; };
+        F(0, 1) = [](const view_t &){ return 0.1; };
+        F(1, 1) = [](const view_t &){ return 1.0; };
+        jacobian_t f(2UL, 2UL, [&](const view_t & input, view_t & output){
+            if (input.data() == output.data()) aliased++;
+            output(0, 0) = input(0, 0) + 0.1 * input(1, 0);
+            output(1, 0) = input(1, 0);
+        }, F);
+
+        jacobian_t::jacobi_func H(1UL, 2UL);
+        H(0, 0) = [](const view_t &){ return 1.0; };
+        jacobian_t h(2UL, 1UL, [](const view_t & input, view_t & output){ output(0, 0) = input(0, 0); }, H);
+
+        matrix_t state(2UL, 1UL, 0.0);
+        state(1, 0) = 1.0;
+        matrix_t process_noise(2UL, 2UL, 0.0);
+        process_noise(0, 0) = 0.01;
+        process_noise(1, 1) = 0.01;
+        kafi::dynamic_kafi<> filter(std::move(f), std::move(h), state, process_noise, matrix_t(1UL, 1UL, 0.1));
+
+        std::shared_ptr< matrix_t > observation = std::make_shared< matrix_t >(1UL, 1UL);
+        for (size_t step = 1UL; step <= 20UL; ++step)
+        {
+            // every other step only predicts
+            if (step % 2UL == 1UL)
+            {
+                (*observation)(0, 0) = 0.1 * step;
+                filter.set_current_observation(observation);
+            }
+            const matrix_t estimate(std::get<0>(filter.step()));
+            REQUIRE(estimate(0, 0) == Approx(0.1 * step).margin(1e-9));
+            REQUIRE(estimate(1, 0) == Approx(1.0).margin(1e-9));
+        }
+        REQUIRE(aliased == 0UL);
+    }
+
+    SECTION("step() doesn't allocate, N = 7, M = 5") {
+        using namespace models::correvit;
+        const std::vector< mx1_vector > observations = read_log(wemding_log);
+        const size_t steps = 100UL;
+
+        std::vector< std::shared_ptr< matrix_t > > inputs;
+        for (size_t step = 0UL; step < steps; ++step)
+        {
+            inputs.push_back(std::make_shared< matrix_t >(observations[step]));
+        }
+
+        const matrix_t state(starting_state(observations[0]));
+        const matrix_t Q(process_noise());
+        const matrix_t R(sensor_noise());
+
+        // blaze products and the large-state mode
+        for (const size_t workers : { 0UL, 3UL })
+        {
+            kafi::dynamic_kafi<> filter(kafi::make_dynamic(transition())
+                                      , kafi::make_dynamic(prediction_scaling())
+                                      , state
+                                      , Q
+                                      , R
+                                      , workers);
+
+            const size_t before = allocation_count;
+            for (const std::shared_ptr< matrix_t > & input : inputs)
+            {
+                filter.set_current_observation(input);
+                filter.step();
+            }
+            // read before REQUIRE, which allocates itself
+            const size_t after = allocation_count;
+            REQUIRE(after == before);
+        }
+    }
+}
@@ -0,0 +1,212 @@
+// Copyright 2018 municHMotorsport e.V. <info@munichmotorsport.de>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KAFI_TESTS_EQUIVALENCE_H
+#define KAFI_TESTS_EQUIVALENCE_H
+
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <ostream>
+#include <tuple>
+#include <vector>
+
+/** \brief Golden-output harness which runs a reference filter and a candidate side by side
+ *
+ * Every filter variant has to provide the `kafi::kafi` interface:
+ * * `typename mx1_vector`
+ * * `set_current_observation(std::shared_ptr<mx1_vector>)`
+ * * `step()` which returns a tuple of state, prediction error and gain
+ *
+ * A filter which returns a factor of the prediction error instead, e.g. kafi::sqrt_kafi, provides
+ * `prediction_error()` to reconstruct it.
+ *
+ * The candidate may use a different element type (e.g. `float`), its values are compared as `double`.
+ */
+namespace equivalence {
+
+    //! maximum absolute deviation of a single step
+    struct step_deviation
+    {
+        double state;
+        double covariance;
+    };
+
+    /** \brief Deviations of the candidate from the reference over all steps
+     */
+    struct report
+    {
+        //! deviation of every step
+        std::vector<step_deviation> steps;
+        double max_state       = 0;
+        double mean_state      = 0;
+        double max_covariance  = 0;
+        double mean_covariance = 0;
+
+        /** \brief Overloading stream operator for logging purposes
+         */
+        friend std::ostream & operator<<(std::ostream & stream, const report & rhs)
+        {
+            stream << "steps: "           << rhs.steps.size()
+                   << ", state max/mean: " << rhs.max_state      << " / " << rhs.mean_state
+                   << ", covariance max/mean: " << rhs.max_covariance << " / " << rhs.mean_covariance << '\n';
+            return stream;
+        }
+
+        /** \brief Writes the deviations per step as csv `step,state,covariance`
+         */
+        void write_csv(std::ostream & stream) const
+        {
+            stream << "step,state,covariance\n";
+            for (size_t step = 0; step < steps.size(); ++step)
+            {
+                stream << step << ',' << steps[step].state << ',' << steps[step].covariance << '\n';
+            }
+        }
+    };
+
+    //! runtime-sized targets, e.g. of kafi::dynamic_kafi, are resized to the source
+    template< typename Target >
+    auto resize(Target & target, const size_t rows, const size_t columns, int)
+        -> decltype(target.resize(rows, columns), void())
+    {
+        target.resize(rows, columns);
+    }
+
+    //! static targets already have the dimensions of the source
+    template< typename Target >
+    void resize(Target &, const size_t, const size_t, long) { }
+
+    /** \brief Element-wise conversion between matrices of the same dimensions but different element types
+     */
+    template< typename Target
+            , typename Source >
+    Target convert(const Source & source)
+    {
+        Target target;
+        resize(target, source.rows(), source.columns(), 0);
+        for (size_t row = 0UL; row < source.rows(); ++row)
+        {
+            for (size_t col = 0UL; col < source.columns(); ++col)
+            {
+                target(row, col) = static_cast<typename Target::ElementType>(source(row, col));
+            }
+        }
+        return target;
+    }
+
+    //! maximum that keeps NaNs, so a diverged candidate can never pass
+    inline double worst(const double lhs, const double rhs)
+    {
+        return (std::isnan(rhs) || rhs > lhs) ? rhs : lhs;
+    }
+
+    /** \brief Maximum absolute element-wise difference of two matrices of the same dimensions
+     */
+    template< typename Lhs
+            , typename Rhs >
+    double max_deviation(const Lhs & lhs, const Rhs & rhs)
+    {
+        double deviation = 0;
+        for (size_t row = 0UL; row < lhs.rows(); ++row)
+        {
+            for (size_t col = 0UL; col < lhs.columns(); ++col)
+            {
+                const double difference = std::abs(static_cast<double>(lhs(row, col))
+                                                 - static_cast<double>(rhs(row, col)));
+                deviation = worst(deviation, difference);
+            }
+        }
+        return deviation;
+    }
+
+    //! factored filters, e.g. kafi::sqrt_kafi, return a factor of the covariance and reconstruct it with `prediction_error()`
+    template< typename Filter
+            , typename Result >
+    auto covariance(const Filter & filter, const Result &, int)
+        -> decltype(filter.prediction_error())
+    {
+        return filter.prediction_error();
+    }
+
+    //! every other filter returns the covariance itself
+    template< typename Filter
+            , typename Result >
+    auto covariance(const Filter &, const Result & result, long)
+        -> decltype(std::get<1>(result))
+    {
+        return std::get<1>(result);
+    }
+
+    /** \brief Runs both filters over the same `observations` and compares state and covariance after every `step()`
+     *
+     * Arguments:
+     * * `reference`:    usually `kafi::kafi<N,M>`
+     * * `candidate`:    the filter that is validated
+     * * `observations`: observations of the reference type, converted for the candidate
+     * * `stride`:       only every `stride`-th step has an observation, the steps in between are predicted and
+     *                   their covariance isn't compared, e.g. for a covariance which is propagated at the updates
+     */
+    template< typename Reference
+            , typename Candidate
+            , typename Observation >
+    report compare(Reference & reference, Candidate & candidate, const std::vector<Observation> & observations
+                 , const size_t stride = 1UL)
+    {
+        using reference_observation = typename Reference::mx1_vector;
+        using candidate_observation = typename Candidate::mx1_vector;
+
+        report result;
+        result.steps.reserve(observations.size());
+
+        // the filters don't own the observations, the last ones have to outlive the predicted steps too
+        std::shared_ptr<reference_observation> reference_input;
+        std::shared_ptr<candidate_observation> candidate_input;
+        for (size_t step = 0UL; step < observations.size(); ++step)
+        {
+            const bool observed = step % stride == 0UL;
+            if (observed)
+            {
+                reference_input = std::make_shared<reference_observation>(convert<reference_observation>(observations[step]));
+                candidate_input = std::make_shared<candidate_observation>(convert<candidate_observation>(observations[step]));
+                reference.set_current_observation(reference_input);
+                candidate.set_current_observation(candidate_input);
+            }
+
+            const auto reference_result = reference.step();
+            const auto candidate_result = candidate.step();
+
+            step_deviation deviation;
+            deviation.state      = max_deviation(std::get<0>(reference_result), std::get<0>(candidate_result));
+            deviation.covariance = !observed ? 0.0 : max_deviation(covariance(reference, reference_result, 0)
+                                                                 , covariance(candidate, candidate_result, 0));
+            result.steps.push_back(deviation);
+
+            result.max_state       = worst(result.max_state,      deviation.state);
+            result.max_covariance  = worst(result.max_covariance, deviation.covariance);
+            result.mean_state      += deviation.state;
+            result.mean_covariance += deviation.covariance;
+        }
+
+        if (!result.steps.empty())
+        {
+            result.mean_state      /= result.steps.size();
+            result.mean_covariance /= result.steps.size();
+        }
+        return result;
+    }
+
+} // namespace equivalence
+
+#endif // KAFI_TESTS_EQUIVALENCE_H
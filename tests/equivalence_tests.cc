@@ -0,0 +1,1207 @@
+// Copyright 2018 municHMotorsport e.V. <info@munichmotorsport.de>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <blaze/Math.h>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include <memory>
+#include <utility>
+#include "catch.h"
+
+#include "../library/kafi.h"
+#include "../library/fixed_point.h"
+#include "../library/dynamic_kafi.h"
+#include "../library/sqrt_kafi.h"
+#include "../library/ud_kafi.h"
+#include "../library/linear_kafi.h"
+#include "../library/unscented_kafi.h"
+#include "../library/ensemble_kafi.h"
+#include "../library/imm_kafi.h"
+#include "../library/error_state_kafi.h"
+#include "equivalence.h"
+#include "models.h"
+
+//! samples of the wemding log which are replayed, the full log is covered by the "[replay]" test
+const size_t replayed_samples = 10000UL;
+
+//! reference filter for the correvit model
+std::unique_ptr< kafi::kafi<models::correvit::N, models::correvit::M> >
+make_correvit_reference(const models::correvit::mx1_vector & first_observation)
+{
+    using namespace models::correvit;
+    return std::unique_ptr< kafi::kafi<N,M> >(
+        new kafi::kafi<N,M>(transition()
+                          , prediction_scaling()
+                          , starting_state(first_observation)
+                          , process_noise()
+                          , sensor_noise()));
+}
+
+//! the correvit model with the scalar type `T` and the innovation solve in `TI`
+template< typename T
+        , typename TI >
+std::unique_ptr< kafi::kafi<models::correvit::N, models::correvit::M, T, TI> >
+make_correvit_precision(const models::correvit::mx1_vector & first_observation)
+{
+    using namespace models::correvit;
+    return std::unique_ptr< kafi::kafi<N,M,T,TI> >(
+        new kafi::kafi<N,M,T,TI>(transition<T>()
+                               , prediction_scaling<T>()
+                               , starting_state<T>(first_observation)
+                               , process_noise<T>()
+                               , sensor_noise<T>()));
+}
+
+/** \brief How the filter `Variant` is created from a randomized linear model, see make_linear()
+ *
+ * By default with the jacobian functions and the matrices of the model like kafi::kafi, in the scalar type of the
+ * filter. Specialized for the filters which take the model differently and for the modes of a filter, e.g.
+ * joseph_form.
+ */
+template< typename Variant >
+struct linear_variant
+{
+    using filter_t = Variant;
+
+    template< size_t N
+            , size_t M >
+    static std::unique_ptr<filter_t> create(const models::linear::random_model<N,M> & model, const size_t)
+    {
+        using T = typename filter_t::value_t;
+        return std::unique_ptr<filter_t>(
+            new filter_t(model.template transition<T>()
+                       , model.template prediction_scaling<T>()
+                       , typename filter_t::nx1_vector(model.starting_state)
+                       , typename filter_t::nxn_matrix(model.process_noise)
+                       , typename filter_t::mxm_matrix(model.sensor_noise)));
+    }
+};
+
+/** \brief The filter `Variant` of a randomized linear model, `W` workers for the filters on a util::tile_pool
+ *
+ * E.g. `make_linear<kafi::sqrt_kafi<N,M>, N, M>(model)`, see linear_variant
+ */
+template< typename Variant
+        , size_t   N
+        , size_t   M
+        , size_t   W = 1UL >
+std::unique_ptr< typename linear_variant<Variant>::filter_t > make_linear(const models::linear::random_model<N,M> & model)
+{
+    return linear_variant<Variant>::create(model, W);
+}
+
+/** \brief Compares the reference with the filter created by `make_candidate(model)` on a randomized linear model
+ *
+ * Only every `stride`-th step has an observation, see equivalence::compare()
+ */
+template< size_t N
+        , size_t M
+        , typename Factory >
+equivalence::report compare_on_linear_model(const unsigned int seed, Factory make_candidate, const size_t stride = 1UL)
+{
+    const size_t steps = 200UL;
+    models::linear::random_model<N,M> model(seed, steps);
+
+    auto reference = make_linear< kafi::kafi<N,M>, N, M >(model);
+    auto candidate = make_candidate(model);
+    return equivalence::compare(*reference, *candidate, model.observations, stride);
+}
+
+//! another filter variant with the interface of kafi::kafi for the correvit model, e.g. kafi::sqrt_kafi<N,M,T>
+template< typename Filter >
+std::unique_ptr<Filter> make_correvit_variant(const models::correvit::mx1_vector & first_observation)
+{
+    using namespace models::correvit;
+    using T = typename Filter::value_t;
+    return std::unique_ptr<Filter>(
+        new Filter(transition<T>()
+                 , prediction_scaling<T>()
+                 , starting_state<T>(first_observation)
+                 , process_noise<T>()
+                 , sensor_noise<T>()));
+}
+
+//! `N = 7, M = 5, seed = 3`, the name of the section of a randomized linear model
+template< size_t N
+        , size_t M >
+std::string describe_linear_model(const unsigned int seed)
+{
+    std::string description = "N = ";
+    description.append(std::to_string(N));
+    description.append(", M = ");
+    description.append(std::to_string(M));
+    description.append(", seed = ");
+    description.append(std::to_string(seed));
+    return description;
+}
+
+/** \brief Compares the reference with the filter created by `make_candidate(model)` within `eps`
+ *
+ * E.g. `test_on_linear_model<N,M>(seed, eps, make_linear<kafi::sqrt_kafi<N,M>, N, M>)`, `eps = 0` requires
+ * identical results. Only every `stride`-th step has an observation, see equivalence::compare()
+ */
+template< size_t   N
+        , size_t   M
+        , typename Factory >
+void test_on_linear_model(const unsigned int seed, const double eps, Factory make_candidate, const size_t stride = 1UL)
+{
+    std::string description = describe_linear_model<N,M>(seed);
+    if (stride > 1UL)
+    {
+        description.append(", observation every ");
+        description.append(std::to_string(stride));
+    }
+    SECTION(description){
+        equivalence::report report = compare_on_linear_model<N,M>(seed, make_candidate, stride);
+
+        REQUIRE(report.steps.size() == 200UL);
+        REQUIRE(report.max_state      <= eps);
+        REQUIRE(report.max_covariance <= eps);
+    }
+}
+
+/** \brief The filters created by `make_serial(model)` and `make_parallel(model)` give the same results up to rounding
+ *
+ * E.g. `test_workers<N,M>(seed, make_linear<kafi::unscented_kafi<N,M>,N,M>, make_linear<kafi::unscented_kafi<N,M>,N,M,3>)`.
+ * The kernel of the calling worker and the one of the threads are separate copies, which the compiler may contract
+ * into fused multiply-adds differently.
+ */
+template< size_t   N
+        , size_t   M
+        , typename Serial
+        , typename Parallel >
+void test_workers(const unsigned int seed, Serial make_serial, Parallel make_parallel)
+{
+    SECTION(describe_linear_model<N,M>(seed)){
+        models::linear::random_model<N,M> model(seed, 200UL);
+        auto serial   = make_serial(model);
+        auto parallel = make_parallel(model);
+        REQUIRE(parallel->workers() > serial->workers());
+
+        equivalence::report workers = equivalence::compare(*serial, *parallel, model.observations);
+        REQUIRE(workers.max_state      < 1e-12);
+        REQUIRE(workers.max_covariance < 1e-12);
+    }
+}
+
+/** \brief test_on_linear_model() of the filter `Variant<N,M>` within `eps` for `N, M = 1, 1  3, 2  7, 5  12, 4` with the seeds `1` to `4`
+ *
+ * `Variant` is a template of the dimensions, e.g. `template< size_t N, size_t M > using float_kafi = kafi::kafi<N,M,float>;`
+ */
+template< template< size_t, size_t > class Variant
+        , size_t W = 1UL >
+void test_on_linear_models(const double eps)
+{
+    test_on_linear_model<1,1>(1, eps,  make_linear< Variant<1,1>,   1,  1, W >);
+    test_on_linear_model<3,2>(2, eps,  make_linear< Variant<3,2>,   3,  2, W >);
+    test_on_linear_model<7,5>(3, eps,  make_linear< Variant<7,5>,   7,  5, W >);
+    test_on_linear_model<12,4>(4, eps, make_linear< Variant<12,4>, 12,  4, W >);
+}
+
+//! test_workers() of the filter `Variant<N,M>` on a single and on `W` workers, the models of test_on_linear_models()
+template< template< size_t, size_t > class Variant
+        , size_t W >
+void test_workers_on_linear_models()
+{
+    test_workers<1,1>(1,  make_linear< Variant<1,1>,   1,  1 >, make_linear< Variant<1,1>,   1,  1, W >);
+    test_workers<3,2>(2,  make_linear< Variant<3,2>,   3,  2 >, make_linear< Variant<3,2>,   3,  2, W >);
+    test_workers<7,5>(3,  make_linear< Variant<7,5>,   7,  5 >, make_linear< Variant<7,5>,   7,  5, W >);
+    test_workers<12,4>(4, make_linear< Variant<12,4>, 12,  4 >, make_linear< Variant<12,4>, 12,  4, W >);
+}
+
+//! kafi::kafi, the reference of every comparison
+template< size_t N
+        , size_t M >
+using reference_kafi = kafi::kafi<N,M>;
+
+TEST_CASE("equivalence harness", "[equivalence]") {
+
+    std::vector< models::correvit::mx1_vector > observations = models::correvit::read_log(models::correvit::wemding_log);
+    observations.resize(std::min(observations.size(), replayed_samples));
+
+    SECTION("reference against itself on the wemding log") {
+        auto reference = make_correvit_reference(observations[0]);
+        auto candidate = make_correvit_reference(observations[0]);
+
+        equivalence::report report = equivalence::compare(*reference, *candidate, observations);
+        INFO("wemding, reference: " << report);
+
+        REQUIRE(report.steps.size() == observations.size());
+        REQUIRE(report.max_state      == 0.0);
+        REQUIRE(report.max_covariance == 0.0);
+    }
+
+    SECTION("detects a deviating candidate") {
+        using namespace models::correvit;
+        auto reference = make_correvit_reference(observations[0]);
+        // trusts the sensors a bit more than the reference
+        kafi::kafi<N,M> candidate(transition()
+                                , prediction_scaling()
+                                , starting_state(observations[0])
+                                , process_noise()
+                                , mxm_matrix(0.9 * sensor_noise()));
+
+        equivalence::report report = equivalence::compare(*reference, candidate, observations);
+
+        REQUIRE(report.max_state       > 0.0);
+        REQUIRE(report.max_covariance  > 0.0);
+        REQUIRE(report.mean_state     <= report.max_state);
+    }
+
+    // the fused transition evaluates the same expressions, only once, the two lambdas only differ by rounding
+    // where the compiler contracts them into fused multiply-adds differently
+    SECTION("fused transition on the wemding log") {
+        using namespace models::correvit;
+        auto reference = make_correvit_reference(observations[0]);
+        kafi::kafi<N,M> candidate(transition(sample_time, false)
+                                , prediction_scaling()
+                                , starting_state(observations[0])
+                                , process_noise()
+                                , sensor_noise());
+
+        equivalence::report report = equivalence::compare(*reference, candidate, observations);
+        INFO("wemding, separate transition: " << report);
+
+        REQUIRE(report.max_state      < 1e-12);
+        REQUIRE(report.max_covariance < 1e-12);
+    }
+
+    SECTION("reference against itself on randomized linear models") {
+        test_on_linear_models<reference_kafi>(0.0);
+    }
+}
+
+//! kafi::kafi in single precision
+template< size_t N
+        , size_t M >
+using float_kafi = kafi::kafi<N,M,float,float>;
+
+//! kafi::kafi in single precision with the innovation solve in double precision
+template< size_t N
+        , size_t M >
+using mixed_kafi = kafi::kafi<N,M,float,double>;
+
+TEST_CASE("single and mixed precision", "[equivalence][precision]") {
+
+    std::vector< models::correvit::mx1_vector > observations = models::correvit::read_log(models::correvit::wemding_log);
+    observations.resize(std::min(observations.size(), replayed_samples));
+
+    SECTION("float on the wemding log") {
+        auto reference = make_correvit_reference(observations[0]);
+        auto candidate = make_correvit_precision<float, float>(observations[0]);
+
+        equivalence::report report = equivalence::compare(*reference, *candidate, observations);
+        INFO("wemding, float: " << report);
+
+        REQUIRE(report.max_state      < 1e-2);
+        REQUIRE(report.max_covariance < 1e-2);
+    }
+
+    SECTION("float with the innovation solve in double on the wemding log") {
+        auto reference = make_correvit_reference(observations[0]);
+        auto candidate = make_correvit_precision<float, double>(observations[0]);
+
+        equivalence::report report = equivalence::compare(*reference, *candidate, observations);
+        INFO("wemding, mixed: " << report);
+
+        REQUIRE(report.max_state      < 1e-2);
+        REQUIRE(report.max_covariance < 1e-2);
+    }
+
+    SECTION("float on randomized linear models") {
+        test_on_linear_models<float_kafi>(1e-4);
+    }
+
+    SECTION("mixed precision on randomized linear models") {
+        test_on_linear_models<mixed_kafi>(1e-4);
+    }
+}
+
+//! kafi::kafi in Q15.16
+template< size_t N
+        , size_t M >
+using q16_kafi = kafi::kafi<N,M,kafi::fixed<16>,kafi::fixed<16>>;
+
+TEST_CASE("fixed-point", "[equivalence][fixed]") {
+
+    using q20 = kafi::fixed<20>;
+
+    std::vector< models::correvit::mx1_vector > observations = models::correvit::read_log(models::correvit::wemding_log);
+    observations.resize(std::min(observations.size(), replayed_samples));
+
+    // the sample time 0.001 is 0.7% off in Q15.16, which adds up in the integrated positions
+    SECTION("Q11.20 on the wemding log") {
+        auto reference = make_correvit_reference(observations[0]);
+        auto candidate = make_correvit_precision<q20, q20>(observations[0]);
+
+        equivalence::report report = equivalence::compare(*reference, *candidate, observations);
+        INFO("wemding, Q11.20: " << report);
+
+        REQUIRE(report.max_state      < 5e-2);
+        REQUIRE(report.max_covariance < 1e-2);
+    }
+
+    SECTION("Q15.16 on randomized linear models") {
+        test_on_linear_models<q16_kafi>(1e-2);
+    }
+}
+
+//! the runtime-sized filter with the models of kafi::make_dynamic()
+template<>
+struct linear_variant< kafi::dynamic_kafi<> >
+{
+    using filter_t = kafi::dynamic_kafi<>;
+
+    template< size_t N
+            , size_t M >
+    static std::unique_ptr<filter_t> create(const models::linear::random_model<N,M> & model, const size_t)
+    {
+        using matrix_t = filter_t::matrix_t;
+        return std::unique_ptr<filter_t>(
+            new filter_t(kafi::make_dynamic(model.transition())
+                       , kafi::make_dynamic(model.prediction_scaling())
+                       , matrix_t(model.starting_state)
+                       , matrix_t(model.process_noise)
+                       , matrix_t(model.sensor_noise)));
+    }
+};
+
+//! kafi::dynamic_kafi, the dimensions are only known at runtime
+template< size_t N
+        , size_t M >
+using runtime_kafi = kafi::dynamic_kafi<>;
+
+TEST_CASE("runtime-sized", "[equivalence][dynamic]") {
+
+    std::vector< models::correvit::mx1_vector > observations = models::correvit::read_log(models::correvit::wemding_log);
+    observations.resize(std::min(observations.size(), replayed_samples));
+
+    // only the kernel of the innovation solve differs, Gauss-Jordan instead of LAPACK or the closed form
+    SECTION("dynamic_kafi on the wemding log") {
+        using namespace models::correvit;
+        using matrix_t = kafi::dynamic_kafi<>::matrix_t;
+
+        auto reference = make_correvit_reference(observations[0]);
+        kafi::dynamic_kafi<> candidate(kafi::make_dynamic(transition())
+                                     , kafi::make_dynamic(prediction_scaling())
+                                     , matrix_t(starting_state(observations[0]))
+                                     , matrix_t(process_noise())
+                                     , matrix_t(sensor_noise()));
+
+        equivalence::report report = equivalence::compare(*reference, candidate, observations);
+        INFO("wemding, dynamic_kafi: " << report);
+
+        REQUIRE(report.max_state      < 1e-9);
+        REQUIRE(report.max_covariance < 1e-9);
+    }
+
+    SECTION("dynamic_kafi on randomized linear models") {
+        test_on_linear_models<runtime_kafi>(1e-12);
+    }
+}
+
+//! kafi::sqrt_kafi in double precision
+template< size_t N
+        , size_t M >
+using double_sqrt_kafi = kafi::sqrt_kafi<N,M>;
+
+//! kafi::sqrt_kafi in single precision
+template< size_t N
+        , size_t M >
+using float_sqrt_kafi = kafi::sqrt_kafi<N,M,float>;
+
+TEST_CASE("square-root", "[equivalence][sqrt]") {
+
+    using namespace models::correvit;
+
+    std::vector< mx1_vector > observations = read_log(wemding_log);
+    observations.resize(std::min(observations.size(), replayed_samples));
+
+    SECTION("sqrt_kafi on the wemding log") {
+        auto reference = make_correvit_reference(observations[0]);
+        auto candidate = make_correvit_variant< kafi::sqrt_kafi<N,M> >(observations[0]);
+
+        equivalence::report report = equivalence::compare(*reference, *candidate, observations);
+        INFO("wemding, sqrt_kafi: " << report);
+
+        REQUIRE(report.max_state      < 1e-9);
+        REQUIRE(report.max_covariance < 1e-9);
+    }
+
+    // the same bounds as kafi::kafi<float>, but the root keeps the covariance symmetric and positive semidefinite
+    SECTION("float sqrt_kafi on the wemding log") {
+        auto reference = make_correvit_reference(observations[0]);
+        auto candidate = make_correvit_variant< kafi::sqrt_kafi<N,M,float> >(observations[0]);
+
+        equivalence::report report = equivalence::compare(*reference, *candidate, observations);
+        INFO("wemding, float sqrt_kafi: " << report);
+
+        REQUIRE(report.max_state      < 1e-2);
+        REQUIRE(report.max_covariance < 1e-2);
+
+        const auto P = candidate->prediction_error();
+        for (size_t row = 0UL; row < N; ++row)
+        {
+            REQUIRE(P(row, row) >= 0.0f);
+            for (size_t col = 0UL; col < row; ++col)
+            {
+                REQUIRE(P(row, col) == Approx(P(col, row)));
+            }
+        }
+    }
+
+    SECTION("sqrt_kafi on randomized linear models") {
+        test_on_linear_models<double_sqrt_kafi>(1e-12);
+    }
+
+    SECTION("float sqrt_kafi on randomized linear models") {
+        test_on_linear_models<float_sqrt_kafi>(1e-4);
+    }
+}
+
+//! kafi::ud_kafi in double precision
+template< size_t N
+        , size_t M >
+using double_ud_kafi = kafi::ud_kafi<N,M>;
+
+//! kafi::ud_kafi in single precision
+template< size_t N
+        , size_t M >
+using float_ud_kafi = kafi::ud_kafi<N,M,float>;
+
+TEST_CASE("UD-factorized", "[equivalence][ud]") {
+
+    using namespace models::correvit;
+
+    std::vector< mx1_vector > observations = read_log(wemding_log);
+    observations.resize(std::min(observations.size(), replayed_samples));
+
+    SECTION("ud_kafi on the wemding log") {
+        auto reference = make_correvit_reference(observations[0]);
+        auto candidate = make_correvit_variant< kafi::ud_kafi<N,M> >(observations[0]);
+
+        equivalence::report report = equivalence::compare(*reference, *candidate, observations);
+        INFO("wemding, ud_kafi: " << report);
+
+        REQUIRE(report.max_state      < 1e-9);
+        REQUIRE(report.max_covariance < 1e-9);
+    }
+
+    SECTION("float ud_kafi on the wemding log") {
+        auto reference = make_correvit_reference(observations[0]);
+        auto candidate = make_correvit_variant< kafi::ud_kafi<N,M,float> >(observations[0]);
+
+        equivalence::report report = equivalence::compare(*reference, *candidate, observations);
+        INFO("wemding, float ud_kafi: " << report);
+
+        REQUIRE(report.max_state      < 1e-2);
+        REQUIRE(report.max_covariance < 1e-2);
+    }
+
+    SECTION("Q11.20 ud_kafi on the wemding log") {
+        auto reference = make_correvit_reference(observations[0]);
+        auto candidate = make_correvit_variant< kafi::ud_kafi<N,M,kafi::fixed<20>> >(observations[0]);
+
+        equivalence::report report = equivalence::compare(*reference, *candidate, observations);
+        INFO("wemding, Q11.20 ud_kafi: " << report);
+
+        REQUIRE(report.max_state      < 5e-2);
+        REQUIRE(report.max_covariance < 1e-2);
+    }
+
+    // correlated sensors are decorrelated before the scalar updates
+    SECTION("ud_kafi on randomized linear models") {
+        test_on_linear_models<double_ud_kafi>(1e-12);
+    }
+
+    SECTION("float ud_kafi on randomized linear models") {
+        test_on_linear_models<float_ud_kafi>(1e-4);
+    }
+}
+
+//! `Filter` with the Joseph form covariance update, see kafi::kafi::set_covariance_update()
+template< typename Filter >
+struct joseph_form { };
+
+template< typename Filter >
+struct linear_variant< joseph_form<Filter> >
+{
+    using filter_t = typename linear_variant<Filter>::filter_t;
+
+    template< size_t N
+            , size_t M >
+    static std::unique_ptr<filter_t> create(const models::linear::random_model<N,M> & model, const size_t workers)
+    {
+        std::unique_ptr<filter_t> filter = linear_variant<Filter>::create(model, workers);
+        filter->set_covariance_update(kafi::covariance_update::joseph);
+        return filter;
+    }
+};
+
+//! kafi::kafi with the Joseph form covariance update
+template< size_t N
+        , size_t M >
+using joseph_kafi = joseph_form< kafi::kafi<N,M> >;
+
+TEST_CASE("Joseph form", "[equivalence][joseph]") {
+
+    using namespace models::correvit;
+
+    std::vector< mx1_vector > observations = read_log(wemding_log);
+    observations.resize(std::min(observations.size(), replayed_samples));
+
+    SECTION("Joseph form on the wemding log") {
+        auto reference = make_correvit_reference(observations[0]);
+        auto candidate = make_correvit_reference(observations[0]);
+        REQUIRE(candidate->get_covariance_update() == kafi::covariance_update::standard);
+        candidate->set_covariance_update(kafi::covariance_update::joseph);
+
+        equivalence::report report = equivalence::compare(*reference, *candidate, observations);
+        INFO("wemding, Joseph form: " << report);
+
+        REQUIRE(report.max_state      < 1e-9);
+        REQUIRE(report.max_covariance < 1e-9);
+    }
+
+    // the upper triangle is mirrored, the covariance is exactly symmetric in every scalar type
+    SECTION("float Joseph form on the wemding log") {
+        auto reference = make_correvit_reference(observations[0]);
+        auto candidate = make_correvit_precision<float, float>(observations[0]);
+        candidate->set_covariance_update(kafi::covariance_update::joseph);
+
+        equivalence::report report = equivalence::compare(*reference, *candidate, observations);
+        INFO("wemding, float Joseph form: " << report);
+
+        REQUIRE(report.max_state      < 1e-2);
+        REQUIRE(report.max_covariance < 1e-2);
+
+        const auto & P = candidate->_prediction_error;
+        for (size_t row = 0UL; row < N; ++row)
+        {
+            REQUIRE(P(row, row) >= 0.0f);
+            for (size_t col = 0UL; col < row; ++col)
+            {
+                REQUIRE(P(row, col) == P(col, row));
+            }
+        }
+    }
+
+    SECTION("Q11.20 Joseph form on the wemding log") {
+        auto reference = make_correvit_reference(observations[0]);
+        auto candidate = make_correvit_precision<kafi::fixed<20>, kafi::fixed<20>>(observations[0]);
+        candidate->set_covariance_update(kafi::covariance_update::joseph);
+
+        equivalence::report report = equivalence::compare(*reference, *candidate, observations);
+        INFO("wemding, Q11.20 Joseph form: " << report);
+
+        REQUIRE(report.max_state      < 5e-2);
+        REQUIRE(report.max_covariance < 1e-2);
+    }
+
+    SECTION("Joseph form on randomized linear models") {
+        test_on_linear_models<joseph_kafi>(1e-12);
+    }
+}
+
+//! kafi::linear_kafi with the matrices of the model
+template< size_t N
+        , size_t M >
+struct linear_variant< kafi::linear_kafi<N,M> >
+{
+    using filter_t = kafi::linear_kafi<N,M>;
+
+    static std::unique_ptr<filter_t> create(const models::linear::random_model<N,M> & model, const size_t)
+    {
+        return std::unique_ptr<filter_t>(
+            new filter_t(model.A
+                       , model.C
+                       , model.starting_state
+                       , model.process_noise
+                       , model.sensor_noise));
+    }
+};
+
+//! kafi::linear_kafi, the template of its dimensions
+template< size_t N
+        , size_t M >
+using matrix_kafi = kafi::linear_kafi<N,M>;
+
+TEST_CASE("linear", "[equivalence][linear]") {
+
+    SECTION("linear_kafi on randomized linear models") {
+        test_on_linear_models<matrix_kafi>(1e-12);
+        test_on_linear_model<32,8>(5, 1e-12, make_linear< kafi::linear_kafi<32,8>, 32, 8 >);
+    }
+}
+
+//! `Filter` with at most `5` linearizations per update and the tolerance `1e-9`, see kafi::kafi::set_iterated_update()
+template< typename Filter >
+struct iterated_update { };
+
+template< typename Filter >
+struct linear_variant< iterated_update<Filter> >
+{
+    using filter_t = typename linear_variant<Filter>::filter_t;
+
+    template< size_t N
+            , size_t M >
+    static std::unique_ptr<filter_t> create(const models::linear::random_model<N,M> & model, const size_t workers)
+    {
+        std::unique_ptr<filter_t> filter = linear_variant<Filter>::create(model, workers);
+        filter->set_iterated_update(5UL, 1e-9);
+        return filter;
+    }
+};
+
+//! kafi::kafi with the iterated update
+template< size_t N
+        , size_t M >
+using iterated_kafi = iterated_update< kafi::kafi<N,M> >;
+
+/** \brief Largest position error of a pass of the cone with `iterations` linearizations per update
+ *
+ * `linearizations` is the number of linearizations of all updates
+ */
+double cone_position_error(const unsigned int seed, const size_t iterations, size_t & linearizations
+                         , const double lateral_offset = 2.0)
+{
+    using namespace models::cone;
+
+    const drive pass(seed, 100UL, lateral_offset);
+    kafi::kafi<N,M> filter(transition()
+                         , prediction_scaling()
+                         , pass.starting_state
+                         , pass.process_noise
+                         , pass.sensor_noise
+                         , pass.prediction_error);
+    filter.set_iterated_update(iterations, 1e-6);
+
+    double error = 0;
+    std::shared_ptr< mx1_vector > observation = std::make_shared< mx1_vector >();
+    for (size_t step = 0UL; step < pass.observations.size(); ++step)
+    {
+        *observation = pass.observations[step];
+        filter.set_current_observation(observation);
+        const nx1_vector state = std::get<0>(filter.step());
+        REQUIRE(filter.update_iterations() >= 1UL);
+        REQUIRE(filter.update_iterations() <= iterations);
+        linearizations += filter.update_iterations();
+        error = std::max(error, std::hypot(state(0, 0) - pass.states[step](0, 0)
+                                         , state(1, 0) - pass.states[step](1, 0)));
+    }
+    return error;
+}
+
+TEST_CASE("iterated update", "[equivalence][iterated]") {
+
+    // with a linear `h` the second linearization doesn't move the state and the iterations stop
+    SECTION("iterated update on randomized linear models") {
+        test_on_linear_models<iterated_kafi>(1e-12);
+    }
+
+    SECTION("iterated update stops after the second linearization of a linear model") {
+        const models::linear::random_model<7,5> model(3, 200UL);
+        auto filter = make_linear< iterated_kafi<7,5>, 7, 5 >(model);
+
+        auto observation = std::make_shared< models::linear::random_model<7,5>::mx1_vector >();
+        for (const auto & sample : model.observations)
+        {
+            *observation = sample;
+            filter->set_current_observation(observation);
+            filter->step();
+            REQUIRE(filter->update_iterations() <= 2UL);
+        }
+    }
+
+    SECTION("iterated update on range and bearing to a cone") {
+        const size_t passes = 20UL;
+        double extended = 0;
+        double iterated = 0;
+        size_t extended_linearizations = 0UL;
+        size_t iterated_linearizations = 0UL;
+        for (unsigned int seed = 0U; seed < passes; ++seed)
+        {
+            extended = std::max(extended, cone_position_error(seed, 1UL,  extended_linearizations));
+            iterated = std::max(iterated, cone_position_error(seed, 10UL, iterated_linearizations));
+        }
+        INFO("cone, largest position error: " << extended << " m (extended), "
+             << iterated << " m (iterated, "
+             << static_cast<double>(iterated_linearizations) / extended_linearizations << " linearizations per update)");
+
+        REQUIRE(extended_linearizations == passes * 100UL);
+        REQUIRE(iterated < 0.5 * extended);
+        // the tolerance stops the iterations long before the limit
+        REQUIRE(iterated_linearizations < 5UL * extended_linearizations);
+    }
+}
+
+//! kafi::unscented_kafi with the functions of the model
+template< size_t N
+        , size_t M >
+struct linear_variant< kafi::unscented_kafi<N,M> >
+{
+    using filter_t = kafi::unscented_kafi<N,M>;
+
+    static std::unique_ptr<filter_t> create(const models::linear::random_model<N,M> & model, const size_t workers)
+    {
+        return std::unique_ptr<filter_t>(
+            new filter_t(model.transition().function()
+                       , model.prediction_scaling().function()
+                       , model.starting_state
+                       , model.process_noise
+                       , model.sensor_noise
+                       , workers));
+    }
+};
+
+//! kafi::unscented_kafi, the template of its dimensions
+template< size_t N
+        , size_t M >
+using unscented = kafi::unscented_kafi<N,M>;
+
+/** \brief Largest position error of a pass of the cone with the unscented filter
+ */
+double cone_unscented_position_error(const unsigned int seed, const double lateral_offset = 2.0)
+{
+    using namespace models::cone;
+
+    const drive pass(seed, 100UL, lateral_offset);
+    kafi::unscented_kafi<N,M> filter(transition().function()
+                                   , prediction_scaling().function()
+                                   , pass.starting_state
+                                   , pass.process_noise
+                                   , pass.sensor_noise
+                                   , pass.prediction_error);
+
+    double error = 0;
+    std::shared_ptr< mx1_vector > observation = std::make_shared< mx1_vector >();
+    for (size_t step = 0UL; step < pass.observations.size(); ++step)
+    {
+        *observation = pass.observations[step];
+        filter.set_current_observation(observation);
+        const nx1_vector state = std::get<0>(filter.step());
+        error = std::max(error, std::hypot(state(0, 0) - pass.states[step](0, 0)
+                                         , state(1, 0) - pass.states[step](1, 0)));
+    }
+    return error;
+}
+
+TEST_CASE("unscented", "[equivalence][unscented]") {
+
+    // the unscented transform is exact for linear models
+    SECTION("unscented_kafi on randomized linear models") {
+        test_on_linear_models<unscented>(1e-9);
+    }
+
+    // the sigma points are evaluated independently, the sums are equal up to rounding for any number of workers
+    SECTION("unscented_kafi on more workers") {
+        test_workers_on_linear_models<unscented, 3>();
+    }
+
+    // passing within a quarter meter the cone lies inside the position uncertainty, the bearing is far from linear
+    // around the estimate and the extended filter diverges where the sigma points still cover the curvature
+    SECTION("unscented_kafi on range and bearing to a close cone") {
+        const size_t passes = 20UL;
+        const double lateral_offset = 0.25;
+        double extended  = 0;
+        double unscented = 0;
+        size_t linearizations = 0UL;
+        for (unsigned int seed = 0U; seed < passes; ++seed)
+        {
+            extended  = std::max(extended,  cone_position_error(seed, 1UL, linearizations, lateral_offset));
+            unscented = std::max(unscented, cone_unscented_position_error(seed, lateral_offset));
+        }
+        INFO("close cone, largest position error: " << extended << " m (extended), "
+             << unscented << " m (unscented)");
+
+        REQUIRE(unscented < extended);
+    }
+}
+
+//! kafi::ensemble_kafi with the functions of the model
+template< size_t N
+        , size_t M
+        , size_t K >
+struct linear_variant< kafi::ensemble_kafi<N,M,K> >
+{
+    using filter_t = kafi::ensemble_kafi<N,M,K>;
+
+    static std::unique_ptr<filter_t> create(const models::linear::random_model<N,M> & model, const size_t workers)
+    {
+        return std::unique_ptr<filter_t>(
+            new filter_t(model.transition().function()
+                       , model.prediction_scaling().function()
+                       , model.starting_state
+                       , model.process_noise
+                       , model.sensor_noise
+                       , workers));
+    }
+};
+
+//! kafi::ensemble_kafi with enough members to compare its statistics with kafi::kafi
+template< size_t N
+        , size_t M >
+using large_ensemble = kafi::ensemble_kafi<N,M,2000>;
+
+//! kafi::ensemble_kafi with a few members to compare the workers
+template< size_t N
+        , size_t M >
+using small_ensemble = kafi::ensemble_kafi<N,M,50>;
+
+TEST_CASE("ensemble", "[equivalence][ensemble]") {
+
+    // the sample statistics of the members are noisy estimates of the ones of kafi::kafi, a few percent at `K = 2000`
+    SECTION("ensemble_kafi on randomized linear models") {
+        test_on_linear_models<large_ensemble>(0.2);
+    }
+
+    // every member draws from its own generator, the same draws per member for any number of workers
+    SECTION("ensemble_kafi on more workers") {
+        test_workers_on_linear_models<small_ensemble, 3>();
+    }
+}
+
+//! `R` modes made by `make_mode`, the functions of a mode can't be copied
+template< size_t   R
+        , typename Make
+        , size_t... Index >
+auto repeat_mode(const Make & make_mode, std::index_sequence<Index...>) -> std::array< decltype(make_mode()), R >
+{
+    return std::array< decltype(make_mode()), R >{ { (static_cast<void>(Index), make_mode())... } };
+}
+
+/** \brief kafi::imm_kafi with `R` copies of the model as modes
+ *
+ * The modes stay in their mode with probability `0.9`, the mixing combines identical estimates.
+ */
+template< size_t N
+        , size_t M
+        , size_t R >
+struct linear_variant< kafi::imm_kafi<N,M,R> >
+{
+    using filter_t = kafi::imm_kafi<N,M,R>;
+
+    static std::unique_ptr<filter_t> create(const models::linear::random_model<N,M> & model, const size_t workers)
+    {
+        auto make_mode = [&model]()
+        {
+            return typename filter_t::mode{ model.transition(), model.prediction_scaling(), model.process_noise, model.sensor_noise };
+        };
+        typename filter_t::rxr_matrix transitions;
+        for (size_t from = 0UL; from < R; ++from)
+        {
+            for (size_t to = 0UL; to < R; ++to)
+            {
+                transitions(from, to) = R == 1UL ? 1.0 : (from == to ? 0.9 : 0.1 / (R - 1UL));
+            }
+        }
+        return std::unique_ptr<filter_t>(new filter_t(repeat_mode<R>(make_mode, std::make_index_sequence<R>())
+                                                    , transitions
+                                                    , model.starting_state
+                                                    , workers));
+    }
+};
+
+//! kafi::imm_kafi with a single mode, which is kafi::kafi
+template< size_t N
+        , size_t M >
+using single_mode_imm = kafi::imm_kafi<N,M,1>;
+
+//! kafi::imm_kafi with three identical modes
+template< size_t N
+        , size_t M >
+using three_mode_imm = kafi::imm_kafi<N,M,3>;
+
+/** \brief Root mean square error of the velocity over the drive `seed`, see models::braking
+ */
+template< typename Filter >
+double braking_velocity_error(Filter & filter, const models::braking::drive & pass)
+{
+    using namespace models::braking;
+
+    double squared_error = 0;
+    std::shared_ptr< mx1_vector > observation = std::make_shared< mx1_vector >();
+    for (size_t step = 0UL; step < pass.observations.size(); ++step)
+    {
+        *observation = pass.observations[step];
+        filter.set_current_observation(observation);
+        const nx1_vector state = std::get<0>(filter.step());
+        const double error = state(1, 0) - pass.states[step](1, 0);
+        squared_error += error * error;
+    }
+    return std::sqrt(squared_error / pass.observations.size());
+}
+
+TEST_CASE("interacting multiple models", "[equivalence][imm]") {
+
+    // a single mode is kafi::kafi
+    SECTION("imm_kafi with a single mode on randomized linear models") {
+        test_on_linear_models<single_mode_imm>(0.0);
+    }
+
+    // identical modes only differ by the rounding of the mixing
+    SECTION("imm_kafi with identical modes on randomized linear models") {
+        test_on_linear_models<three_mode_imm>(1e-9);
+    }
+
+    // every mode is stepped by a single worker, the results are equal up to rounding for any number of workers
+    SECTION("imm_kafi on more workers") {
+        test_workers_on_linear_models<three_mode_imm, 3>();
+    }
+
+    SECTION("imm_kafi on a braking car") {
+        using namespace models::braking;
+        using imm_t = kafi::imm_kafi<N,M,2>;
+
+        const imm_t::rxr_matrix transitions( { { 0.95, 0.05 }
+                                             , { 0.05, 0.95 } } );
+        const size_t passes = 20UL;
+        double cruising = 0;
+        double braking  = 0;
+        double imm      = 0;
+        for (unsigned int seed = 0U; seed < passes; ++seed)
+        {
+            const drive pass(seed);
+            kafi::kafi<N,M> cruising_filter(transition(true),  prediction_scaling(), pass.starting_state, process_noise(true),  sensor_noise());
+            kafi::kafi<N,M> braking_filter (transition(false), prediction_scaling(), pass.starting_state, process_noise(false), sensor_noise());
+            imm_t imm_filter({ { imm_t::mode{ transition(true),  prediction_scaling(), process_noise(true),  sensor_noise() }
+                               , imm_t::mode{ transition(false), prediction_scaling(), process_noise(false), sensor_noise() } } }
+                           , transitions
+                           , pass.starting_state);
+            cruising += braking_velocity_error(cruising_filter, pass) / passes;
+            braking  += braking_velocity_error(braking_filter,  pass) / passes;
+            imm      += braking_velocity_error(imm_filter,      pass) / passes;
+        }
+        INFO("braking car, velocity rmse: " << cruising << " m/s (cruising), "
+             << braking << " m/s (braking), " << imm << " m/s (imm)");
+
+        REQUIRE(imm < cruising);
+        REQUIRE(imm < braking);
+    }
+}
+
+//! kafi::error_state_kafi with an additive error of the model, see models::additive_error_state()
+template< size_t N
+        , size_t M >
+struct linear_variant< kafi::error_state_kafi<N,N,M> >
+{
+    using filter_t = kafi::error_state_kafi<N,N,M>;
+
+    static std::unique_ptr<filter_t> create(const models::linear::random_model<N,M> & model, const size_t)
+    {
+        return models::additive_error_state<N,M>(model.transition()
+                                               , model.prediction_scaling()
+                                               , model.starting_state
+                                               , model.process_noise
+                                               , model.sensor_noise);
+    }
+};
+
+//! `Filter` with the prediction error propagated every `R` steps, see kafi::kafi::set_covariance_rate()
+template< typename Filter
+        , size_t   R >
+struct covariance_rate { };
+
+template< typename Filter
+        , size_t   R >
+struct linear_variant< covariance_rate<Filter,R> >
+{
+    using filter_t = typename linear_variant<Filter>::filter_t;
+
+    template< size_t N
+            , size_t M >
+    static std::unique_ptr<filter_t> create(const models::linear::random_model<N,M> & model, const size_t workers)
+    {
+        std::unique_ptr<filter_t> filter = linear_variant<Filter>::create(model, workers);
+        filter->set_covariance_rate(R);
+        return filter;
+    }
+};
+
+//! kafi::error_state_kafi, the error has the dimensions of the state
+template< size_t N
+        , size_t M >
+using error_state = kafi::error_state_kafi<N,N,M>;
+
+/** \brief Deviation of kafi::error_state_kafi with the heading as a unit vector from kafi::kafi with the heading as an angle
+ *
+ * Both propagate the covariance every `rate` steps with an observation every `stride` steps. The rotation of
+ * the unit vector and the sum of the angles differ by rounding only.
+ */
+void test_unicycle(const size_t rate, const size_t stride)
+{
+    using namespace models::unicycle;
+
+    std::string description = "rate = ";
+    description.append(std::to_string(rate));
+    description.append(", observation every ");
+    description.append(std::to_string(stride));
+    description.append(" steps");
+    SECTION(description){
+        const drive circle(0U);
+        kafi::kafi<E,M> reference(transition(), prediction_scaling(), circle.starting_state, process_noise(), sensor_noise());
+        kafi::error_state_kafi<N,E,M> filter(integrate
+                                           , transition()
+                                           , measure
+                                           , prediction_scaling()
+                                           , linearize
+                                           , inject
+                                           , circle.starting_nominal()
+                                           , process_noise()
+                                           , sensor_noise());
+        reference.set_covariance_rate(rate);
+        filter.set_covariance_rate(rate);
+
+        double max_state      = 0;
+        double max_covariance = 0;
+        std::shared_ptr< mx1_vector > observation = std::make_shared< mx1_vector >();
+        for (size_t step = 0UL; step < circle.observations.size(); ++step)
+        {
+            if (step % stride == 0UL)
+            {
+                *observation = circle.observations[step];
+                reference.set_current_observation(observation);
+                filter.set_current_observation(observation);
+            }
+            const auto reference_result = reference.step();
+            const auto filter_result    = filter.step();
+            const ex1_vector & angle    = std::get<0>(reference_result);
+            const nx1_vector expected( { { angle(0, 0) }, { angle(1, 0) }, { std::cos(angle(2, 0)) }, { std::sin(angle(2, 0)) }
+                                       , { angle(3, 0) }, { angle(4, 0) } } );
+            max_state = std::max(max_state, equivalence::max_deviation(expected, std::get<0>(filter_result)));
+            if (step % stride == 0UL)
+            {
+                max_covariance = std::max(max_covariance, equivalence::max_deviation(std::get<1>(reference_result), std::get<1>(filter_result)));
+            }
+        }
+
+        REQUIRE(max_state      < 1e-9);
+        REQUIRE(max_covariance < 1e-9);
+    }
+}
+
+TEST_CASE("error-state", "[equivalence][error_state]") {
+
+    // the jacobian of a linear model is constant, holding it over the interval of the covariance rate is exact
+    SECTION("error_state_kafi on randomized linear models") {
+        test_on_linear_models<error_state>(1e-12);
+        test_on_linear_model<3,2>(2, 1e-9,  make_linear< covariance_rate<error_state<3,2>,10>,   3, 2 >, 10UL);
+        test_on_linear_model<7,5>(3, 1e-9,  make_linear< covariance_rate<error_state<7,5>,10>,   7, 5 >, 10UL);
+        test_on_linear_model<12,4>(4, 1e-9, make_linear< covariance_rate<error_state<12,4>,7>,  12, 4 >, 7UL);
+    }
+
+    SECTION("the error has one dimension less than the nominal state") {
+        test_unicycle(1UL, 1UL);
+        test_unicycle(1UL, 5UL);
+        test_unicycle(5UL, 5UL);
+        test_unicycle(10UL, 7UL);
+    }
+
+    SECTION("the error is injected with the hook") {
+        using namespace models::braking;
+
+        const drive pass(0U);
+        size_t injections = 0UL;
+        auto filter = models::additive_error_state<N,M>(transition(false)
+                                                      , prediction_scaling()
+                                                      , pass.starting_state
+                                                      , process_noise(false)
+                                                      , sensor_noise()
+                                                      , [&injections](nx1_vector & nominal, const nx1_vector & error)
+                                                        {
+                                                            nominal += error;
+                                                            injections++;
+                                                        });
+        kafi::kafi<N,M> reference(transition(false), prediction_scaling(), pass.starting_state, process_noise(false), sensor_noise());
+
+        std::shared_ptr< mx1_vector > observation = std::make_shared< mx1_vector >();
+        for (size_t step = 0UL; step < pass.observations.size(); ++step)
+        {
+            // only every other step has an observation to inject
+            if (step % 2UL == 0UL)
+            {
+                *observation = pass.observations[step];
+                filter->set_current_observation(observation);
+                reference.set_current_observation(observation);
+            }
+            const nx1_vector state = std::get<0>(filter->step());
+            // an error which isn't reset after the injection would be injected again
+            REQUIRE(equivalence::max_deviation(std::get<0>(reference.step()), state) < 1e-12);
+        }
+        REQUIRE(injections == pass.observations.size() / 2UL);
+    }
+}
+
+TEST_CASE("decoupled covariance rate", "[equivalence][covariance_rate]") {
+
+    SECTION("every step is kafi::kafi") {
+        test_on_linear_model<7,5>(3, 0.0, make_linear< covariance_rate<reference_kafi<7,5>,1>, 7, 5 >);
+    }
+
+    // F is constant, holding it over the interval is exact
+    SECTION("randomized linear models") {
+        test_on_linear_model<3,2>(2, 1e-9,  make_linear< covariance_rate<reference_kafi<3,2>,10>, 3, 2 >, 10UL);
+        test_on_linear_model<7,5>(3, 1e-9,  make_linear< covariance_rate<reference_kafi<7,5>,10>, 7, 5 >, 10UL);
+        test_on_linear_model<12,4>(4, 1e-9, make_linear< covariance_rate<reference_kafi<12,4>,5>, 12, 4 >, 5UL);
+    }
+
+    SECTION("updates between two propagations flush the pending steps") {
+        test_on_linear_model<7,5>(5, 1e-9,  make_linear< covariance_rate<reference_kafi<7,5>,10>, 7, 5 >, 7UL);
+        test_on_linear_model<12,4>(6, 1e-9, make_linear< covariance_rate<reference_kafi<12,4>,16>, 12, 4 >, 23UL);
+    }
+
+    // the prediction error of the last propagation with the pending steps is the one of an untouched filter
+    SECTION("the pending steps propagate a replaced estimate") {
+        const models::linear::random_model<7,5> model(3, 200UL);
+        auto filter    = make_linear< covariance_rate<reference_kafi<7,5>,10>, 7, 5 >(model);
+        auto untouched = make_linear< covariance_rate<reference_kafi<7,5>,10>, 7, 5 >(model);
+
+        auto observation = std::make_shared< models::linear::random_model<7,5>::mx1_vector >();
+        for (size_t step = 0UL; step < model.observations.size(); ++step)
+        {
+            if (step % 13UL == 0UL)
+            {
+                *observation = model.observations[step];
+                filter->set_current_observation(observation);
+                untouched->set_current_observation(observation);
+            }
+            const auto result = filter->step();
+            filter->set_estimate(std::get<0>(result), std::get<1>(result));
+            const auto expected = untouched->step();
+            REQUIRE(equivalence::max_deviation(std::get<0>(expected), std::get<0>(result)) == 0.0);
+            REQUIRE(equivalence::max_deviation(std::get<1>(expected), std::get<1>(result)) == 0.0);
+        }
+    }
+
+    // the turning unicycle changes `F` within the interval, holding it is an approximation. A simulation of both
+    // filters over 100 drives stays below `0.5` m of the state and `0.02` of the prediction error, the bounds
+    // leave twice the margin
+    SECTION("a nonlinear model with a time-varying jacobian") {
+        using namespace models::unicycle;
+
+        const size_t rate = 5UL;
+        const drive circle(0U);
+        kafi::kafi<E,M> reference(transition(), prediction_scaling(), circle.starting_state, process_noise(), sensor_noise());
+        kafi::kafi<E,M> held     (transition(), prediction_scaling(), circle.starting_state, process_noise(), sensor_noise());
+        held.set_covariance_rate(rate);
+
+        const equivalence::report report = equivalence::compare(reference, held, circle.observations, rate);
+        INFO("unicycle, rate " << rate << ": " << report);
+
+        REQUIRE(report.steps.size() == circle.observations.size());
+        REQUIRE(report.max_state      < 2.0 * position_deviation);
+        REQUIRE(report.max_covariance < 0.05);
+    }
+}
@@ -0,0 +1,195 @@
+// Copyright 2018 municHMotorsport e.V. <info@munichmotorsport.de>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <blaze/Math.h>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include "catch.h"
+
+#include "../library/fixed_point.h"
+#include "../library/small_matrix.h"
+
+//! Q15.16, the default for the filters
+using q16 = kafi::fixed<16>;
+
+/** \brief Compares the Q16 inverse of a small, well conditioned `(M x M)` innovation covariance with the one in `double`
+ *
+ * The covariance is `scale * (root * trans(root) + I)`, its determinant is about `scale^M` and would lose most of
+ * its fraction bits in Q16.
+ */
+template< size_t M >
+void test_small_fixed_inverse(const unsigned int seed, const double scale)
+{
+    using matrix_t = blaze::StaticMatrix<double, M, M, blaze::rowMajor>;
+    using fixed_t  = blaze::StaticMatrix<q16,    M, M, blaze::rowMajor>;
+
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+    matrix_t root;
+    for (size_t row = 0UL; row < M; ++row)
+    {
+        for (size_t col = 0UL; col < M; ++col)
+        {
+            root(row, col) = uniform(generator);
+        }
+    }
+    const matrix_t S = scale * (root * blaze::trans(root) + kafi::util::create_identity<M, blaze::rowMajor>());
+
+    matrix_t reference;
+    kafi::util::gauss_jordan_inverse(S, reference);
+
+    fixed_t fixed_S;
+    fixed_t fixed_inverse;
+    for (size_t row = 0UL; row < M; ++row)
+    {
+        for (size_t col = 0UL; col < M; ++col)
+        {
+            fixed_S(row, col) = S(row, col);
+        }
+    }
+    kafi::util::inverse(fixed_S, fixed_inverse);
+
+    for (size_t row = 0UL; row < M; ++row)
+    {
+        for (size_t col = 0UL; col < M; ++col)
+        {
+            REQUIRE(static_cast<double>(fixed_inverse(row, col)) == Approx(reference(row, col)).epsilon(1e-2).margin(1e-2));
+        }
+    }
+}
+
+TEST_CASE("fixed_point.h", "[fixed]") {
+
+    SECTION("conversion and rounding") {
+        REQUIRE(q16(1).raw()    == 65536);
+        REQUIRE(q16(-2).raw()   == -131072);
+        REQUIRE(q16(0.5).raw()  == 32768);
+        REQUIRE(q16(-0.5).raw() == -32768);
+        // rounded to the nearest step
+        REQUIRE(q16(0.001).raw() == 66);
+        REQUIRE(static_cast<double>(q16(20.64)) == Approx(20.64).epsilon(1e-5));
+        REQUIRE(static_cast<double>(q16::epsilon()) == std::ldexp(1.0, -16));
+    }
+
+    SECTION("arithmetic") {
+        const q16 a(3.25);
+        const q16 b(-1.5);
+
+        REQUIRE(a + b == q16(1.75));
+        REQUIRE(a - b == q16(4.75));
+        REQUIRE(a * b == q16(-4.875));
+        REQUIRE(a / b == q16(-3.25 / 1.5));
+        REQUIRE(-a    == q16(-3.25));
+
+        q16 c(a);
+        c += b;
+        c *= q16(2);
+        REQUIRE(c == q16(3.5));
+
+        REQUIRE(b < a);
+        REQUIRE(a >= a);
+        REQUIRE(a != b);
+    }
+
+    SECTION("saturation instead of overflow") {
+        REQUIRE(q16(40000)           == q16::max());
+        REQUIRE(q16(-1e9)            == q16::lowest());
+        REQUIRE(q16(30000) + q16(30000) == q16::max());
+        REQUIRE(q16(300)   * q16(-300)  == q16::lowest());
+        REQUIRE(q16(1)  / q16(0)  == q16::max());
+        REQUIRE(q16(-1) / q16(0)  == q16::lowest());
+    }
+
+    SECTION("sqrt, sin and cos without floating point") {
+        const double eps = 1e-4;
+        for (double x : { 0.0, 0.001, 0.25, 2.0, 20.64, 1000.0 })
+        {
+            REQUIRE(static_cast<double>(sqrt(q16(x))) == Approx(std::sqrt(x)).epsilon(eps).margin(eps));
+        }
+        REQUIRE(sqrt(q16(-1)) == q16(0));
+
+        for (double x = -10.0; x <= 10.0; x += 0.37)
+        {
+            REQUIRE(static_cast<double>(sin(q16(x))) == Approx(std::sin(x)).margin(eps));
+            REQUIRE(static_cast<double>(cos(q16(x))) == Approx(std::cos(x)).margin(eps));
+        }
+        // x + pi/2 would saturate, the phase is added after the range reduction
+        for (const q16 x : { q16::max(), q16::lowest() })
+        {
+            REQUIRE(static_cast<double>(cos(x)) == Approx(std::cos(static_cast<double>(x))).margin(eps));
+        }
+        REQUIRE(abs(q16(-2.5)) == q16(2.5));
+    }
+
+    SECTION("small_matrix.h inversion") {
+        const size_t M = 5UL;
+        using matrix_t = blaze::StaticMatrix<double, M, M, blaze::rowMajor>;
+        using fixed_t  = blaze::StaticMatrix<q16,    M, M, blaze::rowMajor>;
+
+        std::mt19937 generator(42);
+        std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+        matrix_t root;
+        for (size_t row = 0UL; row < M; ++row)
+        {
+            for (size_t col = 0UL; col < M; ++col)
+            {
+                root(row, col) = uniform(generator);
+            }
+        }
+        // a well conditioned innovation covariance
+        const matrix_t S = root * blaze::trans(root) + kafi::util::create_identity<M, blaze::rowMajor>();
+
+        matrix_t lapack;
+        matrix_t built_in;
+        kafi::util::inverse(S, lapack);
+        kafi::util::gauss_jordan_inverse(S, built_in);
+
+        fixed_t fixed_S;
+        fixed_t fixed_inverse;
+        for (size_t row = 0UL; row < M; ++row)
+        {
+            for (size_t col = 0UL; col < M; ++col)
+            {
+                fixed_S(row, col) = S(row, col);
+            }
+        }
+        kafi::util::inverse(fixed_S, fixed_inverse);
+
+        for (size_t row = 0UL; row < M; ++row)
+        {
+            for (size_t col = 0UL; col < M; ++col)
+            {
+                REQUIRE(built_in(row, col) == Approx(lapack(row, col)).margin(1e-12));
+                REQUIRE(static_cast<double>(fixed_inverse(row, col)) == Approx(lapack(row, col)).margin(1e-3));
+            }
+        }
+
+        fixed_t singular(0);
+        REQUIRE_THROWS_AS(kafi::util::inverse(singular, fixed_inverse), std::invalid_argument);
+    }
+
+    // the closed form divides by the determinant, which underflows for small covariances in fixed point
+    SECTION("small_matrix.h inversion of small matrices") {
+        using kafi::util::inverse_kernel;
+        REQUIRE(kafi::util::inverse_kernel_t<q16, 2>::value    == inverse_kernel::gauss_jordan);
+        REQUIRE(kafi::util::inverse_kernel_t<q16, 3>::value    == inverse_kernel::gauss_jordan);
+        REQUIRE(kafi::util::inverse_kernel_t<double, 3>::value == inverse_kernel::closed_form);
+
+        test_small_fixed_inverse<2>(1, 0.1);
+        test_small_fixed_inverse<2>(2, 1.0);
+        test_small_fixed_inverse<3>(3, 0.1);
+        test_small_fixed_inverse<3>(4, 1.0);
+    }
+}
@@ -0,0 +1,286 @@
+// Copyright 2018 municHMotorsport e.V. <info@munichmotorsport.de>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <blaze/Math.h>
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <vector>
+#include "catch.h"
+
+#include "../library/information_kafi.h"
+#include "equivalence.h"
+#include "models.h"
+
+using sparse_t = blaze::CompressedMatrix<double, blaze::rowMajor>;
+using dense_t  = blaze::DynamicMatrix<double, blaze::rowMajor>;
+
+//! a random `rows x columns` matrix, every element is a non-zero with probability `density`
+dense_t random_sparse(const size_t rows, const size_t columns, const double density, const unsigned int seed)
+{
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+    std::uniform_real_distribution<double> coin(0.0, 1.0);
+    dense_t matrix(rows, columns, 0.0);
+    for (size_t row = 0UL; row < rows; ++row)
+    {
+        for (size_t col = 0UL; col < columns; ++col)
+        {
+            if (coin(generator) < density) matrix(row, col) = uniform(generator);
+        }
+    }
+    return matrix;
+}
+
+//! a banded symmetric positive definite matrix with `bandwidth` off-diagonals
+dense_t random_banded_covariance(const size_t n, const size_t bandwidth, const unsigned int seed)
+{
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+    dense_t matrix(n, n, 0.0);
+    for (size_t row = 0UL; row < n; ++row)
+    {
+        matrix(row, row) = 2.0 * bandwidth + 1.0;
+        for (size_t col = row + 1UL; col < n && col <= row + bandwidth; ++col)
+        {
+            matrix(row, col) = uniform(generator);
+            matrix(col, row) = matrix(row, col);
+        }
+    }
+    return matrix;
+}
+
+//! the sparse storage of `dense` and back
+sparse_t to_sparse(const dense_t & dense)
+{
+    sparse_t sparse;
+    kafi::util::sparse_builder<double> builder;
+    kafi::util::sparsify(dense, sparse, builder);
+    return sparse;
+}
+
+dense_t to_dense(const sparse_t & sparse)
+{
+    dense_t dense(sparse.rows(), sparse.columns(), 0.0);
+    for (size_t row = 0UL; row < sparse.rows(); ++row)
+    {
+        for (auto element = sparse.cbegin(row); element != sparse.cend(row); ++element)
+        {
+            dense(row, element->index()) = element->value();
+        }
+    }
+    return dense;
+}
+
+/** \brief Runs kafi::kafi and kafi::information_kafi on the same chain and returns the maximum state deviation
+ */
+template< size_t N
+        , size_t M >
+double chain_state_deviation(const double sparsity_threshold, size_t & information_non_zeros)
+{
+    std::unique_ptr< models::linear::chain_model<N,M> > model(new models::linear::chain_model<N,M>(N, 200));
+    std::unique_ptr< kafi::kafi<N,M> > reference(
+        new kafi::kafi<N,M>(model->transition()
+                          , model->prediction_scaling()
+                          , model->starting_state
+                          , model->process_noise
+                          , model->sensor_noise));
+    std::unique_ptr< kafi::information_kafi<N,M> > candidate(
+        new kafi::information_kafi<N,M>(model->transition()
+                                      , model->prediction_scaling()
+                                      , model->starting_state
+                                      , model->process_noise
+                                      , model->sensor_noise
+                                      , sparsity_threshold));
+
+    double deviation = 0;
+    for (const auto & observation : model->observations)
+    {
+        std::shared_ptr< typename kafi::kafi<N,M>::mx1_vector > input =
+            std::make_shared< typename kafi::kafi<N,M>::mx1_vector >(observation);
+        reference->set_current_observation(input);
+        candidate->set_current_observation(input);
+        const auto reference_result = reference->step();
+        const auto candidate_result = candidate->step();
+        deviation = equivalence::worst(deviation, equivalence::max_deviation(std::get<0>(reference_result), std::get<0>(candidate_result)));
+    }
+    information_non_zeros = candidate->information_non_zeros();
+    return deviation;
+}
+
+TEST_CASE("sparse information filter", "[information]") {
+
+    SECTION("sparse products") {
+        const dense_t A = random_sparse(13, 9, 0.3, 1);
+        const dense_t B = random_sparse(9, 11, 0.3, 2);
+        const dense_t C = random_sparse(13, 11, 0.3, 3);
+        const dense_t x = random_sparse(9, 1, 1.0, 4);
+
+        kafi::util::sparse_builder<double>     builder;
+        kafi::util::sparse_accumulator<double> accumulator(11);
+        sparse_t product;
+        sparse_t transposed;
+        dense_t  vector(13, 1UL);
+
+        kafi::util::sparse_multiply(to_sparse(A), to_sparse(B), product, accumulator, builder);
+        REQUIRE(equivalence::max_deviation(to_dense(product), dense_t(A * B)) < 1e-14);
+        kafi::util::sparse_multiply_add(to_sparse(A), to_sparse(B), to_sparse(C), product, accumulator, builder);
+        REQUIRE(equivalence::max_deviation(to_dense(product), dense_t(C + A * B)) < 1e-14);
+        kafi::util::sparse_transpose(to_sparse(A), transposed, builder);
+        REQUIRE(equivalence::max_deviation(to_dense(transposed), dense_t(blaze::trans(A))) == 0);
+        kafi::util::sparse_multiply_vector(to_sparse(A), x, vector);
+        REQUIRE(equivalence::max_deviation(vector, dense_t(A * x)) < 1e-14);
+
+        // the structure counts the products, explicit zeros included
+        sparse_t padded;
+        kafi::util::sparse_pad(to_sparse(C), to_sparse(A * B), padded, builder);
+        REQUIRE(equivalence::max_deviation(to_dense(padded), C) == 0);
+        kafi::util::sparse_multiply_pattern(to_sparse(A), to_sparse(B), product, accumulator, builder);
+        sparse_t structure;
+        kafi::util::sparse_pad(to_sparse(C), product, structure, builder);
+        REQUIRE(padded.nonZeros() == structure.nonZeros());
+        REQUIRE(product.nonZeros() >= to_sparse(A * B).nonZeros());
+    }
+
+    SECTION("sparsification") {
+        dense_t matrix(2UL, 2UL, 0.0);
+        matrix(0, 0) = 4.0;
+        matrix(1, 1) = 1.0;
+        matrix(0, 1) = matrix(1, 0) = 0.1;
+        sparse_t sparse;
+        kafi::util::sparse_builder<double> builder;
+        kafi::util::sparsify(matrix, sparse, builder);
+        REQUIRE(sparse.nonZeros() == 4UL);
+        // |0.1| > 0.04 * sqrt(4 * 1)
+        kafi::util::sparsify(matrix, sparse, builder, 0.04);
+        REQUIRE(sparse.nonZeros() == 4UL);
+        // |0.1| <= 0.06 * sqrt(4 * 1), the diagonal is always kept
+        kafi::util::sparsify(matrix, sparse, builder, 0.06);
+        REQUIRE(sparse.nonZeros() == 2UL);
+    }
+
+    SECTION("sparse cholesky") {
+        kafi::util::sparse_cholesky<double> cholesky;
+        for (const size_t bandwidth : { 0UL, 1UL, 3UL })
+        {
+            const dense_t A = random_banded_covariance(40, bandwidth, 5);
+            const dense_t b = random_sparse(40, 1, 1.0, 6);
+            dense_t x(40, 1UL);
+
+            cholesky.factorize(to_sparse(A));
+            cholesky.solve(b, x);
+            REQUIRE(equivalence::max_deviation(dense_t(A * x), b) < 1e-12);
+            // a banded matrix doesn't fill in
+            REQUIRE(cholesky.nonZeros() == 40UL * (bandwidth + 1UL) - bandwidth * (bandwidth + 1UL) / 2UL);
+        }
+
+        // a scattered pattern with fill-in
+        dense_t A = random_sparse(30, 30, 0.1, 7);
+        A = A * blaze::trans(A);
+        for (size_t i = 0UL; i < 30UL; ++i) A(i, i) += 1.0;
+        const dense_t b = random_sparse(30, 1, 1.0, 8);
+        dense_t x(30, 1UL);
+        cholesky.factorize(to_sparse(A));
+        cholesky.solve(b, x);
+        REQUIRE(equivalence::max_deviation(dense_t(A * x), b) < 1e-12);
+
+        // inverse at the pattern of the factor, the padding adds the first row and column
+        dense_t pattern(30, 30, 0.0);
+        for (size_t i = 0UL; i < 30UL; ++i) pattern(i, 0) = pattern(0, i) = 1.0;
+        sparse_t padded;
+        kafi::util::sparse_builder<double> builder;
+        kafi::util::sparse_pad(to_sparse(A), to_sparse(pattern), padded, builder);
+        cholesky.factorize(padded);
+        cholesky.invert();
+        dense_t work(A);
+        dense_t inverse(30, 30);
+        kafi::util::gauss_jordan_eliminate(work, inverse);
+        double deviation = 0;
+        for (size_t i = 0UL; i < 30UL; ++i)
+        {
+            deviation = std::max(deviation, std::abs(cholesky.inverse(i, 0) - inverse(i, 0)));
+            deviation = std::max(deviation, std::abs(cholesky.inverse(0, i) - inverse(0, i)));
+            deviation = std::max(deviation, std::abs(cholesky.inverse(i, i) - inverse(i, i)));
+            for (size_t j = 0UL; j < i; ++j)
+            {
+                if (A(i, j) != 0.0) deviation = std::max(deviation, std::abs(cholesky.inverse(i, j) - inverse(i, j)));
+            }
+        }
+        REQUIRE(deviation < 1e-12);
+
+        // rank-1 updates with the rows of V, inside the padded pattern
+        dense_t V(2, 30, 0.0);
+        V(0, 0) = 0.5; V(0, 7)  = -1.0;
+        V(1, 3) = 2.0; V(1, 0)  = 0.25;
+        cholesky.update(to_sparse(V));
+        cholesky.solve(b, x);
+        REQUIRE(equivalence::max_deviation(dense_t((A + blaze::trans(V) * V) * x), b) < 1e-12);
+
+        // not positive definite
+        A(3, 3) = -1.0;
+        REQUIRE_THROWS_AS(cholesky.factorize(to_sparse(A)), std::invalid_argument);
+    }
+
+    SECTION("equivalent to kafi::kafi on a chain", "N = 30, M = 6") {
+        size_t non_zeros = 0UL;
+        const double deviation = chain_state_deviation<30,6>(0.0, non_zeros);
+        CAPTURE(deviation);
+        REQUIRE(deviation < 1e-9);
+    }
+
+    SECTION("sparsified information matrix", "N = 60, M = 10") {
+        size_t non_zeros = 0UL;
+        const double deviation = chain_state_deviation<60,10>(1e-4, non_zeros);
+        CAPTURE(deviation);
+        CAPTURE(non_zeros);
+        REQUIRE(deviation < 1e-2);
+        REQUIRE(non_zeros < 60UL * 60UL / 2UL);
+    }
+
+    // the constructors of a large N take the same models on the heap and the noise as sparse matrices
+    SECTION("models on the heap and sparse noise", "N = 30, M = 6") {
+        const size_t N = 30UL;
+        const size_t M = 6UL;
+        using filter_t = kafi::information_kafi<N,M>;
+
+        std::unique_ptr< models::linear::chain_model<N,M> > model(new models::linear::chain_model<N,M>(N, 200));
+        std::unique_ptr< filter_t > from_static(
+            new filter_t(model->transition()
+                       , model->prediction_scaling()
+                       , model->starting_state
+                       , model->process_noise
+                       , model->sensor_noise));
+        std::unique_ptr< filter_t > from_heap(
+            new filter_t(typename filter_t::f_pointer_t(new kafi::jacobian_function<N,N>(model->transition()))
+                       , typename filter_t::h_pointer_t(new kafi::jacobian_function<N,M>(model->prediction_scaling()))
+                       , model->starting_state
+                       , to_sparse(dense_t(model->process_noise))
+                       , model->sensor_noise));
+
+        double deviation = 0;
+        for (const auto & observation : model->observations)
+        {
+            std::shared_ptr< typename filter_t::mx1_vector > input = std::make_shared< typename filter_t::mx1_vector >(observation);
+            from_static->set_current_observation(input);
+            from_heap->set_current_observation(input);
+            const auto static_result = from_static->step();
+            const auto heap_result   = from_heap->step();
+            deviation = equivalence::worst(deviation, equivalence::max_deviation(std::get<0>(static_result), std::get<0>(heap_result)));
+        }
+        REQUIRE(deviation == 0.0);
+        REQUIRE(from_heap->information_non_zeros() < N * N / 2UL);
+    }
+}
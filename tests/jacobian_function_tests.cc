@@ -15,6 +15,7 @@
 #include <blaze/Math.h>
 #include <vector>
 #include <iostream>
+#include <type_traits>
 #include "catch.h"
 
 #include "../library/jacobian_function.h"
@@ -23,8 +24,9 @@
 #define UNUSED(x) (void)(x)
 
 
-template< size_t N
-        , size_t M >
+template< size_t   N
+        , size_t   M
+        , typename T = double >
 void test_create_identity_jacobian()
 {
 
@@ -32,17 +34,18 @@ void test_create_identity_jacobian()
     description.append(std::to_string(N));
     description.append(", M = ");
     description.append(std::to_string(M));
+    description.append(std::is_same<T, float>::value ? ", float" : "");
     SECTION(description){
 
-    using nx1_vector = typename kafi::jacobian_function<N,M>::nx1_vector;
-    using mx1_vector = typename kafi::jacobian_function<N,M>::mx1_vector;
-    using mxn_matrix = typename kafi::jacobian_function<N,M>::mxn_matrix;
+    using nx1_vector = typename kafi::jacobian_function<N,M,T>::nx1_vector;
+    using mx1_vector = typename kafi::jacobian_function<N,M,T>::mx1_vector;
+    using mxn_matrix = typename kafi::jacobian_function<N,M,T>::mxn_matrix;
 
-    kafi::jacobian_function<N,M> prediction_scaling(
-        std::move(kafi::util::create_identity_jacobian<N,M>()));
+    kafi::jacobian_function<N,M,T> prediction_scaling(
+        std::move(kafi::util::create_identity_jacobian<N,M,T>()));
 
 
-    double x = 1.5;
+    T x = 1.5;
     // test
     nx1_vector input(x);
     // preallocating resources for inner computation
@@ -86,7 +89,7 @@ TEST_CASE("basic functionality of jacobian", "[jacobian]") {
 
         // copy the 1x1 state to both rows of 2x1
         const func h =
-             [&](nx1_vector & input, mx1_vector & output){
+             [&](const nx1_vector & input, mx1_vector & output){
                 output(0, 0) = input(0,0);
                 output(1, 0) = input(0,0);
         };
@@ -141,4 +144,137 @@ TEST_CASE("basic functionality of jacobian", "[jacobian]") {
         // test_create_identity_jacobian<200,300>(); // SIGSEV (probably because of StaticMatrix size)
         // test_create_identity_jacobian<400,350>(); // SIGSEV (probably because of StaticMatrix size)
     }
+
+    SECTION("structural zeros") {
+        const size_t N = 3;
+        const size_t M = 2;
+
+        using nx1_vector      = kafi::jacobian_function<N,M>::nx1_vector;
+        using mx1_vector      = kafi::jacobian_function<N,M>::mx1_vector;
+        using mxn_matrix      = kafi::jacobian_function<N,M>::mxn_matrix;
+        using func            = kafi::jacobian_function<N,M>::func;
+        using jacobi_func     = kafi::jacobian_function<N,M>::jacobi_func;
+
+        // [ 2 * s_0; s_2 ], the empty partial derivatives are never called
+        const func h =
+             [&](const nx1_vector & input, mx1_vector & output){
+                output(0, 0) = 2 * input(0, 0);
+                output(1, 0) = input(2, 0);
+        };
+        jacobi_func H;
+        H(0, 0) = kafi::util::identity_derivative<N>(2);
+        H(1, 2) = kafi::util::identity_derivative<N>(1);
+
+        kafi::jacobian_function<N,M> prediction_scaling(h, H);
+        REQUIRE(!prediction_scaling.structural_zero(0, 0));
+        REQUIRE( prediction_scaling.structural_zero(0, 1));
+        REQUIRE( prediction_scaling.structural_zero(1, 0));
+        REQUIRE(!prediction_scaling.structural_zero(1, 2));
+
+        nx1_vector input({ { 1.0 }, { 2.0 }, { 3.0 } });
+        mxn_matrix H_result(7);
+        prediction_scaling.jacobian(input, H_result);
+
+        mxn_matrix H_ground_truth({ { 2, 0, 0 }
+                                  , { 0, 0, 1 } });
+        REQUIRE((H_result == H_ground_truth));
+    }
+
+    SECTION("constant entries") {
+        const size_t N = 2;
+        const size_t M = 2;
+
+        using nx1_vector      = kafi::jacobian_function<N,M>::nx1_vector;
+        using mx1_vector      = kafi::jacobian_function<N,M>::mx1_vector;
+        using mxn_matrix      = kafi::jacobian_function<N,M>::mxn_matrix;
+        using func            = kafi::jacobian_function<N,M>::func;
+        using jacobi_func     = kafi::jacobian_function<N,M>::jacobi_func;
+
+        // [ 3 * s_0; s_0 * s_1 ], only the derivatives of the product depend on the state
+        const func h =
+             [&](const nx1_vector & input, mx1_vector & output){
+                output(0, 0) = 3 * input(0, 0);
+                output(1, 0) = input(0, 0) * input(1, 0);
+        };
+        size_t calls = 0;
+        jacobi_func H;
+        H(0, 0) = kafi::util::identity_derivative<N>(3);
+        H(0, 1) = kafi::constant_derivative<N>{ 0.0 };
+        H(1, 0) = [&calls](const nx1_vector & in){ ++calls; return in(1, 0); };
+        H(1, 1) = [&calls](const nx1_vector & in){ ++calls; return in(0, 0); };
+
+        kafi::jacobian_function<N,M> prediction_scaling(h, H);
+        REQUIRE(prediction_scaling.variable_entries() == 2UL);
+
+        nx1_vector input({ { 2.0 }, { 5.0 } });
+        mxn_matrix H_result(7);
+        prediction_scaling.jacobian(input, H_result);
+        prediction_scaling.jacobian(input, H_result);
+        REQUIRE(calls == 4UL);
+
+        mxn_matrix H_ground_truth({ { 3, 0 }
+                                  , { 5, 2 } });
+        REQUIRE((H_result == H_ground_truth));
+
+        // the cache is moved with the function
+        kafi::jacobian_function<N,M> moved(std::move(prediction_scaling));
+        REQUIRE(moved.variable_entries() == 2UL);
+        H_result = 7;
+        moved.jacobian(input, H_result);
+        REQUIRE((H_result == H_ground_truth));
+    }
+
+    SECTION("fused evaluation") {
+        const size_t N = 2;
+        const size_t M = 1;
+
+        using nx1_vector      = kafi::jacobian_function<N,M>::nx1_vector;
+        using mx1_vector      = kafi::jacobian_function<N,M>::mx1_vector;
+        using mxn_matrix      = kafi::jacobian_function<N,M>::mxn_matrix;
+        using func            = kafi::jacobian_function<N,M>::func;
+        using fused_func      = kafi::jacobian_function<N,M>::fused_func;
+        using jacobi_func     = kafi::jacobian_function<N,M>::jacobi_func;
+
+        // [ s_0 * s_0 + 4 * s_1 ]
+        const func h =
+             [&](const nx1_vector & input, mx1_vector & output){
+                output(0, 0) = input(0, 0) * input(0, 0) + 4 * input(1, 0);
+        };
+        jacobi_func H;
+        H(0, 0) = [](const nx1_vector & in){ return 2 * in(0, 0); };
+        H(0, 1) = kafi::util::identity_derivative<N>(4);
+
+        size_t calls = 0;
+        // only writes the entry which depends on the state
+        const fused_func h_fused =
+             [&calls](const nx1_vector & input, mx1_vector & output, mxn_matrix & jacobian){
+                ++calls;
+                const double s0 = input(0, 0);
+                output(0, 0)   = s0 * s0 + 4 * input(1, 0);
+                jacobian(0, 0) = 2 * s0;
+        };
+
+        kafi::jacobian_function<N,M> separate(h, H);
+        kafi::jacobian_function<N,M> fused(h, H, h_fused);
+        REQUIRE(!separate.fused());
+        REQUIRE( fused.fused());
+
+        nx1_vector input({ { 3.0 }, { 0.5 } });
+        mx1_vector separate_output, fused_output;
+        mxn_matrix separate_jacobian, fused_jacobian(7);
+        separate.evaluate(input, separate_output, separate_jacobian);
+        fused.evaluate(input, fused_output, fused_jacobian);
+
+        REQUIRE(calls == 1UL);
+        REQUIRE(fused_output(0, 0) == 11.0);
+        REQUIRE((fused_output == separate_output));
+        REQUIRE((fused_jacobian == separate_jacobian));
+        REQUIRE(fused_jacobian(0, 1) == 4.0);
+    }
+
+    SECTION("jacobian with float") {
+        test_create_identity_jacobian<1,4,float>();
+        test_create_identity_jacobian<7,5,float>();
+        test_create_identity_jacobian<20,50,float>();
+    }
 }
\ No newline at end of file
@@ -15,15 +15,70 @@
 #include <blaze/Math.h>
 #include <vector>
 #include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <chrono>
+#include <cstdlib>
 #include <math.h>
 #include <memory>
 #include "catch.h"
 #include "csv.h"
 
 #include "../library/kafi.h"
+#include "../library/fixed_point.h"
+#include "models.h"
 
 #define UNUSED(x) (void)(x)
 
+/** \brief The temperature example with the scalar type `T` and the innovation solve in `TI`
+ */
+template< typename T
+        , typename TI >
+void test_temperature_precision()
+{
+    const size_t N = 1UL;
+    const size_t M = 2UL;
+
+    using mx1_vector = typename kafi::kafi<N,M,T,TI>::mx1_vector;
+    using nx1_vector = typename kafi::kafi<N,M,T,TI>::nx1_vector;
+    using mxm_matrix = typename kafi::kafi<N,M,T,TI>::mxm_matrix;
+    using nxn_matrix = typename kafi::kafi<N,M,T,TI>::nxn_matrix;
+    using return_t   = typename kafi::kafi<N,M,T,TI>::return_t;
+
+    kafi::kafi<N,M,T,TI> filter(kafi::util::create_identity_jacobian<N,N,T>()
+                              , kafi::util::create_identity_jacobian<N,M,T>()
+                              , nx1_vector( { { T(20.64) } } )
+                              , nxn_matrix( { { T(0.05) } } )
+                              , mxm_matrix( { { T(0.64), T(0)    }
+                                            , { T(0),    T(0.64) } }));
+
+    std::shared_ptr< mx1_vector > first_observation = std::make_shared< mx1_vector >(
+                          mx1_vector({ { T(18.625) }
+                                     , { T(20)     } }));
+    filter.set_current_observation(first_observation);
+
+    return_t result = filter.step();
+    // same ground truth and tolerance as the double example
+    REQUIRE(19.62 == Approx(static_cast<double>(std::get<0>(result)(0,0))).epsilon(0.01));
+}
+
+/** \brief The temperature example in double, only the models and the noise
+ */
+std::unique_ptr< kafi::kafi<1,2> > make_temperature_kafi()
+{
+    using nx1_vector = typename kafi::kafi<1,2>::nx1_vector;
+    using mxm_matrix = typename kafi::kafi<1,2>::mxm_matrix;
+    using nxn_matrix = typename kafi::kafi<1,2>::nxn_matrix;
+
+    return std::unique_ptr< kafi::kafi<1,2> >(
+        new kafi::kafi<1,2>(kafi::util::create_identity_jacobian<1,1>()
+                          , kafi::util::create_identity_jacobian<1,2>()
+                          , nx1_vector( { { 20.64 } } )
+                          , nxn_matrix( { { 0.05 } } )
+                          , mxm_matrix( { { 0.64, 0    }
+                                        , { 0,    0.64 } })));
+}
+
 TEST_CASE("kalman filter examples", "[kafi]") {
 
     SECTION("temperature test, N = 1, M = 2") {
@@ -80,250 +135,221 @@ TEST_CASE("kalman filter examples", "[kafi]") {
         REQUIRE(ground_truth == Approx(estimated_state(0,0)).epsilon(eps));
     }
 
-    SECTION("acceleration / correvit test, N = 7, M = 5") {
-                              // 0  1   2   3   4   5   6
-        const size_t N = 7UL; // x, y, ax, ay, vx, vy, phi
-        const size_t M = 5UL; //     , ax, ay, vx, vy, phi
-                              //        0   1   2   3   4
+    SECTION("temperature test in single precision, N = 1, M = 2") {
+        test_temperature_precision<float, float>();
+    }
 
-        using mx1_vector = typename kafi::jacobian_function<N,M>::mx1_vector;
-        using nx1_vector = typename kafi::jacobian_function<N,M>::nx1_vector;
-        using mxm_matrix = typename kafi::jacobian_function<N,M>::mxm_matrix;
-        using nxn_matrix = typename kafi::jacobian_function<N,M>::nxn_matrix;
-        using return_t   = typename kafi::kafi<N,M>::return_t;
+    SECTION("temperature test in mixed precision, N = 1, M = 2") {
+        test_temperature_precision<float, double>();
+    }
 
-        using f_func          = std::function<void(nx1_vector &, nx1_vector &)>;
-        using h_func          = std::function<void(nx1_vector &, mx1_vector &)>;
-        using par_jacobi_func = std::function<double(const nx1_vector &)>;
-        using f_jacobi_func   = kafi::jacobian_function<N,N>::jacobi_func;
-        using h_jacobi_func   = kafi::jacobian_function<N,M>::jacobi_func;
-
-        // we have a sample rate of 0.001 second, or 1 millisecond, or 1000Hz
-        const double t  = 0.001;
-        // t squared precomputed
-        const double t2 = 0.000001;
-
-        // state transition model with updates to x,y from the a(x,y), v(x,y) and phi
-        const f_func _f =
-             [t,t2](nx1_vector & input, nx1_vector & output){
-
-                double x   = input(0, 0);
-                double y   = input(1, 0);
-                double ax  = input(2, 0);
-                double ay  = input(3, 0);
-                double vx  = input(4, 0);
-                double vy  = input(5, 0);
-                double phi = input(6, 0);
-                
-                // x update
-                output(0, 0) = (0.5 * ax * t2 + vx*t) * std::cos(phi) \
-                             + (0.5 * ay * t2 + vy*t) * std::sin(phi) \
-                             + x;
-                // y update
-                output(1, 0) = - (0.5 * ax * t2 + vx*t) * std::sin(phi) \
-                             + (0.5 * ay * t2 + vy*t) * std::cos(phi) \
-                             + y;
-                // vx update
-                output(4, 0) = vx + ax*t;
-                // vy update
-                output(5, 0) = vy + ay*t;
+    SECTION("temperature test in Q15.16 fixed-point, N = 1, M = 2") {
+        test_temperature_precision<kafi::fixed<16>, kafi::fixed<16>>();
+    }
 
-        };
-        // jacobian of `f`
-        
-        // first row of the jacobian, derivative of f0 (the output(0,0), x update)
-        const par_jacobi_func df0_dx  = [](const nx1_vector & in){ UNUSED(in); return 1; };
-        const par_jacobi_func df0_dy  = [](const nx1_vector & in){ UNUSED(in); return 0; };
-        const par_jacobi_func df0_dax = [t2](const nx1_vector & in)
-        {
-             double phi = in(6, 0);
-             return 0.5*t2*std::cos(phi);
-        };
-        const par_jacobi_func df0_day = [t2](const nx1_vector & in)
-        {
-            double phi = in(6, 0);
-            return 0.5*t2*std::sin(phi);
-        };
-        const par_jacobi_func df0_dvx = [t](const nx1_vector & in)
-        {
-            double phi = in(6, 0);
-            return t*std::cos(phi);
-        };
-        const par_jacobi_func df0_dvy = [t](const nx1_vector & in)
-        {
-            double phi = in(6, 0);
-            return t*std::sin(phi);
-        };
-        const par_jacobi_func df0_dphi = [t,t2](const nx1_vector & in)
-        {
-            double ax  = in(2, 0);
-            double ay  = in(3, 0);
-            double vx  = in(4, 0);
-            double vy  = in(5, 0);
-            double phi = in(6, 0);
-            return std::cos(phi)*(0.5*ay*t2 + vy*t) - std::sin(phi)*(0.5*ax*t2+vx*t);
-        };
+    SECTION("temperature test with the steady-state gain, N = 1, M = 2") {
+        using mx1_vector = typename kafi::kafi<1,2>::mx1_vector;
 
-        // second row of the jacobian, derivative of f1 (the output(1,0), y update)
-        const par_jacobi_func df1_dx  = [](const nx1_vector & in){ UNUSED(in); return 0; };
-        const par_jacobi_func df1_dy  = [](const nx1_vector & in){ UNUSED(in); return 1; };
-        const par_jacobi_func df1_dax = [t2](const nx1_vector & in)
-        {
-            double phi = in(6, 0);
-            return -0.5*t2*std::sin(phi);
-        };
-        const par_jacobi_func df1_day = [t2](const nx1_vector & in)
-        {
-            double phi = in(6, 0);
-            return 0.5*t2*std::cos(phi);
-        };
-        const par_jacobi_func df1_dvx = [t](const nx1_vector & in)
+        auto reference = make_temperature_kafi();
+        auto online    = make_temperature_kafi();
+        auto solved    = make_temperature_kafi();
+        online->set_steady_state_tolerance(1e-12);
+        REQUIRE(solved->solve_steady_state(1e-12));
+        REQUIRE(solved->steady_state());
+
+        std::shared_ptr< mx1_vector > observation = std::make_shared< mx1_vector >();
+        for (size_t step = 0UL; step < 200UL; ++step)
         {
-            double phi = in(6, 0);
-            return -t*std::sin(phi);
-        };
-        const par_jacobi_func df1_dvy = [t](const nx1_vector & in)
+            (*observation)(0,0) = 20.0 + 0.5 * std::sin(0.1 * step);
+            (*observation)(1,0) = 20.0 - 0.5 * std::cos(0.3 * step);
+            reference->set_current_observation(observation);
+            online->set_current_observation(observation);
+            solved->set_current_observation(observation);
+
+            const double expected = std::get<0>(reference->step())(0,0);
+            REQUIRE(std::get<0>(online->step())(0,0) == Approx(expected).margin(1e-9));
+            // the solved gain skips the transient of the gain, the state converges to the reference
+            const double steady = std::get<0>(solved->step())(0,0);
+            if (step > 50UL) REQUIRE(steady == Approx(expected).margin(1e-9));
+        }
+        REQUIRE(online->steady_state());
+        REQUIRE(std::get<2>(solved->step())(0,0) == Approx(std::get<2>(reference->step())(0,0)).margin(1e-12));
+
+        // the gain can't freeze without a positive tolerance or with the iterated update, it isn't even tried
+        auto iterated = make_temperature_kafi();
+        iterated->set_iterated_update(5UL, 1e-9);
+        REQUIRE_FALSE(iterated->solve_steady_state(1e-12));
+        REQUIRE_FALSE(solved->solve_steady_state(0.0));
+        REQUIRE_FALSE(iterated->steady_state());
+    }
+
+    SECTION("the state transition never writes into its input, N = 2, M = 1") {
+        using nx1_vector = typename kafi::kafi<2,1>::nx1_vector;
+        using mx1_vector = typename kafi::kafi<2,1>::mx1_vector;
+        using mxm_matrix = typename kafi::kafi<2,1>::mxm_matrix;
+        using nxn_matrix = typename kafi::kafi<2,1>::nxn_matrix;
+
+        // constant velocity
+        size_t aliased = 0UL;
+        kafi::jacobian_function<2,2>::jacobi_func F
         {
-            double phi = in(6, 0);
-            return t*std::cos(phi);
+            { kafi::util::identity_derivative<2>(1), kafi::util::identity_derivative<2>(0.1) }
+         ,  { kafi::util::identity_derivative<2>(0), kafi::util::identity_derivative<2>(1)   }
         };
-        const par_jacobi_func df1_dphi = [t,t2](const nx1_vector & in)
+        kafi::jacobian_function<2,2> f(
+            [&](const nx1_vector & input, nx1_vector & output){
+                if (&input == &output) aliased++;
+                output(0,0) = input(0,0) + 0.1 * input(1,0);
+                output(1,0) = input(1,0);
+            }, F);
+
+        kafi::kafi<2,1> filter(std::move(f)
+                             , kafi::util::create_identity_jacobian<2,1>()
+                             , nx1_vector( { { 0 }, { 1 } } )
+                             , nxn_matrix( { { 0.01, 0 }, { 0, 0.01 } } )
+                             , mxm_matrix( { { 0.1 } } ));
+
+        std::shared_ptr< mx1_vector > observation = std::make_shared< mx1_vector >();
+        for (size_t step = 1UL; step <= 20UL; ++step)
         {
-            double ax  = in(2, 0);
-            double ay  = in(3, 0);
-            double vx  = in(4, 0);
-            double vy  = in(5, 0);
-            double phi = in(6, 0);
-            return -std::cos(phi)*(0.5*ax*t2 + vx*t) - std::sin(phi)*(0.5*ay*t2+vy*t);
-        };
+            // every other step only predicts
+            if (step % 2UL == 1UL)
+            {
+                (*observation)(0,0) = 0.1 * step;
+                filter.set_current_observation(observation);
+            }
+            const nx1_vector state = std::get<0>(filter.step());
+            REQUIRE(state(0,0) == Approx(0.1 * step).margin(1e-9));
+            REQUIRE(state(1,0) == Approx(1.0).margin(1e-9));
+        }
+        REQUIRE(aliased == 0UL);
+    }
+}
 
-        // fifth row of the jacobian, derivative of f4 (the output(4,0), vx update)
-        const par_jacobi_func df4_ax = [t](const nx1_vector & in){ UNUSED(in); return t; };
-        // sixth row of the jacobian, derivative of f5 (the output(5,0), vy update)
-        const par_jacobi_func df5_ay = [t](const nx1_vector & in){ UNUSED(in); return t; };
-
-        const par_jacobi_func df_one  = kafi::util::identity_derivative<N>(1);
-        const par_jacobi_func df_zero = kafi::util::identity_derivative<N>(0);
-
-        const f_jacobi_func _F
-        {  //      x        y        ax       ay       vx       vy       phi
-/*f0*/     { df0_dx,  df0_dy,  df0_dax, df0_day, df0_dvx, df0_dvy, df0_dphi } 
-/*f1*/   , { df1_dx,  df1_dy,  df1_dax, df1_day, df1_dvx, df1_dvy, df1_dphi } 
-/*f2*/   , { df_zero, df_zero, df_one,  df_zero, df_zero, df_zero, df_zero  } 
-/*f3*/   , { df_zero, df_zero, df_zero, df_one,  df_zero, df_zero, df_zero  } 
-/*f4*/   , { df_zero, df_zero, df4_ax,  df_zero, df_one,  df_zero, df_zero  } 
-/*f5*/   , { df_zero, df_zero, df_zero, df5_ay,  df_zero, df_one,  df_zero  } 
-/*f6*/   , { df_zero, df_zero, df_zero, df_zero, df_zero, df_zero, df_one   } 
-        };
+TEST_CASE("acceleration / correvit replay benchmark, N = 7, M = 5", "[kafi][replay]") {
+    // the model is shared with the equivalence tests and the benchmarks, see tests/models.h
+    using namespace models::correvit;
 
-        kafi::jacobian_function<N,N> f(_f, _F);
+    using return_t = typename kafi::kafi<N,M>::return_t;
 
-        // cut the `x` and `y` from the state vector
-        const h_func _h = [](nx1_vector & in, mx1_vector & out)
-        {
-            out(0,0) = in(2,0);
-            out(1,0) = in(3,0);
-            out(2,0) = in(4,0);
-            out(3,0) = in(5,0);
-            out(4,0) = in(6,0);
-        };
+    // every `golden_stride`th estimated state of this replay, see the end of this test how to regenerate it
+    std::string golden_path = "test-data/2017-01-01-sensordata-wemding-golden.csv";
+    const size_t golden_stride = 100;
 
-        const par_jacobi_func dh_one  = kafi::util::identity_derivative<N>(1);
-        const par_jacobi_func dh_zero = kafi::util::identity_derivative<N>(0);
+    using clock_t    = std::chrono::steady_clock;
+    using duration_t = std::chrono::duration<double>;
 
-        const h_jacobi_func _H
-        {
-            { dh_zero, dh_zero, dh_one,  dh_zero, dh_zero, dh_zero, dh_zero }
-         ,  { dh_zero, dh_zero, dh_zero, dh_one,  dh_zero, dh_zero, dh_zero }
-         ,  { dh_zero, dh_zero, dh_zero, dh_zero, dh_one,  dh_zero, dh_zero }
-         ,  { dh_zero, dh_zero, dh_zero, dh_zero, dh_zero, dh_one,  dh_zero }
-         ,  { dh_zero, dh_zero, dh_zero, dh_zero, dh_zero, dh_zero, dh_one  }
-        };
+    // 1. parse the whole csv upfront, so the filter timing is not polluted by the file access
+    clock_t::time_point parse_start = clock_t::now();
+    std::vector< mx1_vector > observations = read_log(wemding_log);
+    const duration_t parse_time = clock_t::now() - parse_start;
+
+    REQUIRE(observations.size() > 0);
+
+    // init kalman filter
+    kafi::kafi<N,M> kafi(transition()
+                       , prediction_scaling()
+                       , starting_state(observations[0])
+                       , process_noise()
+                       , sensor_noise());
+
+    // 2. replay, the observation handoff and the filter step are timed separately
+    duration_t handoff_time(0);
+    duration_t filter_time(0);
+    std::vector< nx1_vector > trajectory;
+    trajectory.reserve(observations.size() / golden_stride + 1);
+
+    for (size_t sample = 0; sample < observations.size(); ++sample)
+    {
+        clock_t::time_point handoff_start = clock_t::now();
+        std::shared_ptr< mx1_vector > observation = std::make_shared< mx1_vector >(observations[sample]);
+        // update the observation
+        kafi.set_current_observation(observation);
+
+        clock_t::time_point filter_start = clock_t::now();
+        // run the estimation
+        return_t   result          = kafi.step();
+        clock_t::time_point filter_end = clock_t::now();
 
-        kafi::jacobian_function<N,M> h(_h, _H);
+        handoff_time += filter_start - handoff_start;
+        filter_time  += filter_end   - filter_start;
 
-        nxn_matrix process_noise(
+        if (sample % golden_stride == 0)
         {
-            { 0.00000, 0.00000, 0.00000, 0.00000, 0.00000, 0.00000, 0.00000 }
-          , { 0.00000, 0.00000, 0.00000, 0.00000, 0.00000, 0.00000, 0.00000 }
-          , { 0.00000, 0.00000, 0.10000, 0.00000, 0.00000, 0.00000, 0.00000 }
-          , { 0.00000, 0.00000, 0.00000, 0.10000, 0.00000, 0.00000, 0.00000 }
-          , { 0.00000, 0.00000, 0.00000, 0.00000, 0.10000, 0.00000, 0.00000 }
-          , { 0.00000, 0.00000, 0.00000, 0.00000, 0.00000, 0.10000, 0.00000 }
-          , { 0.00000, 0.00000, 0.00000, 0.00000, 0.00000, 0.00000, 0.10000 }
-        } );
-
-        mxm_matrix sensor_noise( { { 0.7,   0,    0,    0,    0  }
-                                 , { 0,   0.7,    0,    0,    0  }
-                                 , { 0,     0, 0.45,    0,    0  }
-                                 , { 0,     0,    0, 0.45,    0  }
-                                 , { 0,     0,    0,    0, 0.001 }
-                                 });
-
-
-        // Time[s], ax[m/s^2], ay[m/s^2], vx[m/s], vy[m/s], psi[rad]
-        std::string csv_path = "test-data/2017-01-01-sensordata-wemding-alle-runden.csv";
-
-        io::CSVReader<5> in(csv_path);
-        in.read_header(io::ignore_extra_column, "ax[m/s^2]", "ay[m/s^2]", "vx[m/s]", "vy[m/s]", "psi[rad]");
-        double ax_, ay_, vx_, vy_, phi_;
-        in.read_row(ax_, ay_, vx_, vy_, phi_);
-
-        std::shared_ptr< mx1_vector > first_observation = std::make_shared< mx1_vector >( 
-                          mx1_vector( { { ax_ } 
-                                      , { ay_ }
-                                      , { vx_ }
-                                      , { vy_ }
-                                      , { phi_} }));
-
-        nx1_vector starting_state( { { 0 }
-                                   , { 0 }
-                                   , { ax_ } 
-                                   , { ay_ }
-                                   , { vx_ }
-                                   , { vy_ }
-                                   , { phi_} });
+            trajectory.push_back(std::get<0>(result));
+        }
+    }
 
+    const double samples = static_cast<double>(observations.size());
+    const double total   = parse_time.count() + handoff_time.count() + filter_time.count();
+    // the timings are only reported on request, e.g. `build/tests> KAFI_REPORT_TIMINGS=1 ./kafi_test "[replay]"`
+    if (std::getenv("KAFI_REPORT_TIMINGS") != nullptr)
+    {
+        WARN("wemding replay, N = " << N << ", M = " << M << ", " << observations.size() << " samples\n"
+             << "  csv parse:            " << parse_time.count()   * 1e3 << " ms\n"
+             << "  observation handoff:  " << handoff_time.count() * 1e3 << " ms\n"
+             << "  filter:               " << filter_time.count()  * 1e3 << " ms\n"
+             << "  filter samples/sec:   " << samples / filter_time.count() << '\n'
+             << "  overall samples/sec:  " << samples / total);
+    }
 
-        // init kalman filter
-        kafi::kafi<N,M> kafi(std::move(f)
-                           , std::move(h)
-                           , starting_state
-                           , process_noise
-                           , sensor_noise);
+    // 3. compare against the golden trajectory
+    //
+    // to regenerate it after an intended change of the results:
+    // ```
+    // build/tests> KAFI_WRITE_GOLDEN=../../tests/test-data/2017-01-01-sensordata-wemding-golden.csv ./kafi_test "[replay]"
+    // ```
+    const char * golden_output = std::getenv("KAFI_WRITE_GOLDEN");
+    if (golden_output != nullptr)
+    {
+        std::ofstream golden(golden_output);
+        golden << "sample,x,y,ax,ay,vx,vy,phi\n" << std::setprecision(17);
+        for (size_t row = 0; row < trajectory.size(); ++row)
+        {
+            golden << row * golden_stride;
+            for (size_t n = 0; n < N; ++n)
+            {
+                golden << ',' << trajectory[row](n, 0);
+            }
+            golden << '\n';
+        }
+        WARN("wrote golden trajectory to " << golden_output << ", nothing was compared");
+        return;
+    }
 
-        kafi.set_current_observation(first_observation);
-        kafi.step();
-
-        while(in.read_row(ax_, ay_, vx_, vy_, phi_))
-        {   
-            std::shared_ptr< mx1_vector > second_observation = std::make_shared< mx1_vector >(
-                                mx1_vector({ { ax_ } 
-                                           , { ay_ }
-                                           , { vx_ }
-                                           , { vy_ }
-                                           , { phi_} }));
-            // update the observation
-            kafi.set_current_observation(second_observation);
-
-            // run the estimation
-            return_t   result          = kafi.step();
-            nx1_vector estimated_state = std::get<0>(result);
-            UNUSED(estimated_state);
-            // nxn_matrix predicton_error = std::get<1>(result);
-            // std::cout << predicton_error << '\n';
-            // std::cout << estimated_state(0,0) << ", " << estimated_state(1,0) << '\n';
-            // std::cout << estimated_state(4,0) - vx_ << ", " << estimated_state(5,0) - vy_ << '\n';
-            // std::cout << estimated_state(2,0) - ax_ << ", " << estimated_state(3,0) - ay_ << '\n';
+    // differences are expected only by reordered floating point operations (e.g. other blas/lapack kernels).
+    //
+    // The golden trajectory predates later optimizations which reorder the operations of the same algorithm:
+    // the shared `P * trans(H)` of the gain and the innovation covariance, the fused evaluation of the correvit
+    // transition and the cached constant jacobian entries, and the built-in inverse of builds without LAPACK.
+    // Each changes a step by rounding, about `1e-16` relative, and the updates damp these differences instead of
+    // accumulating them, so they stay orders of magnitude below `eps`. The margin covers the entries close to
+    // zero, e.g. the position of the first samples is about `1e-7` and `phi` stays `0`, where a relative
+    // tolerance alone is meaningless.
+    const double eps = 1e-6;
+
+    io::CSVReader<8> golden(golden_path);
+    golden.read_header(io::ignore_no_column, "sample", "x", "y", "ax", "ay", "vx", "vy", "phi");
+    size_t golden_sample;
+    nx1_vector golden_state(0);
+    size_t row = 0;
+    while(golden.read_row(golden_sample
+                        , golden_state(0,0), golden_state(1,0), golden_state(2,0), golden_state(3,0)
+                        , golden_state(4,0), golden_state(5,0), golden_state(6,0)))
+    {
+        REQUIRE(row < trajectory.size());
+        REQUIRE(golden_sample == row * golden_stride);
+        for (size_t n = 0; n < N; ++n)
+        {
+            REQUIRE(golden_state(n,0) == Approx(trajectory[row](n,0)).epsilon(eps).margin(eps));
         }
-        // to plot the output:
-        // ```
-        // cd build && make
-        // build> ./tests/kafi_test > temp.csv
-        // build> gnuplot
-        // gnuplot> plot 'temp.csv'
-        //
-
-        REQUIRE(true);
+        ++row;
     }
+    REQUIRE(row == trajectory.size());
+
+    // to plot the output:
+    // ```
+    // build/tests> ./kafi_test "[replay]"
+    // gnuplot> plot 'test-data/2017-01-01-sensordata-wemding-golden.csv' using 2:3 with lines
+    // ```
 }
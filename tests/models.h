@@ -0,0 +1,1180 @@
+// Copyright 2018 municHMotorsport e.V. <info@munichmotorsport.de>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef KAFI_TESTS_MODELS_H
+#define KAFI_TESTS_MODELS_H
+
+#include <blaze/Math.h>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <math.h>
+#include "csv.h"
+
+#include "../library/kafi.h"
+#include "../library/dynamic_kafi.h"
+#include "../library/error_state_kafi.h"
+
+/** \brief Models shared by the tests and the benchmarks
+ *
+ * * `models::correvit` - the acceleration / correvit model which is replayed on the recorded wemding log
+ * * `models::cone`     - range and bearing to a track cone, a strongly nonlinear sensor model
+ * * `models::linear`   - randomized linear models for the equivalence tests, of static and runtime size
+ * * `models::braking`  - a car which cruises, brakes and accelerates, for filters which switch models
+ * * `models::unicycle` - a car on a circle with the heading as a unit vector, for the error-state filter
+ */
+namespace models {
+
+/** \brief Acceleration / correvit model
+ *
+ * ```
+ *                 0  1   2   3   4   5   6
+ * state        = [x, y, ax, ay, vx, vy, phi]
+ * observations = [      ax, ay, vx, vy, phi]
+ * ```
+ */
+namespace correvit {
+
+    //! state dimensions
+    const size_t N = 7UL;
+    //! sensor dimensions
+    const size_t M = 5UL;
+
+    using nx1_vector = typename kafi::jacobian_function<N,M>::nx1_vector;
+    using mx1_vector = typename kafi::jacobian_function<N,M>::mx1_vector;
+    using nxn_matrix = typename kafi::jacobian_function<N,M>::nxn_matrix;
+    using mxm_matrix = typename kafi::jacobian_function<N,M>::mxm_matrix;
+
+    // unqualified, so scalar types like kafi::fixed find their own `cos` and `sin`
+    using std::cos;
+    using std::sin;
+
+    //! sample rate of the recorded log, 0.001 second, or 1 millisecond, or 1000Hz
+    const double sample_time = 0.001;
+
+    /** \brief State transition model with updates to x,y from the a(x,y), v(x,y) and phi
+     *
+     * Template arguments:
+     * * `T` = scalar type (default: `double`)
+     *
+     * Arguments:
+     * * `sample` = sample time in seconds
+     * * `fused`  = with the fused evaluation of `f` and its jacobian, which shares the trigonometric terms
+     */
+    template< typename T = double >
+    kafi::jacobian_function<N,N,T> transition(const double sample = sample_time, const bool fused = true)
+    {
+        using nx1_vector      = typename kafi::jacobian_function<N,N,T>::nx1_vector;
+        using nxn_matrix      = typename kafi::jacobian_function<N,N,T>::nxn_matrix;
+        using f_func          = typename kafi::jacobian_function<N,N,T>::func;
+        using f_fused_func    = typename kafi::jacobian_function<N,N,T>::fused_func;
+        using par_jacobi_func = typename kafi::jacobian_function<N,N,T>::par_jacobi_func;
+        using f_jacobi_func   = typename kafi::jacobian_function<N,N,T>::jacobi_func;
+
+        const T t    = static_cast<T>(sample);
+        // t squared precomputed
+        const T t2   = static_cast<T>(sample * sample);
+        const T half = static_cast<T>(0.5);
+
+        const f_func _f =
+             [t,t2,half](const nx1_vector & input, nx1_vector & output){
+
+                T x   = input(0, 0);
+                T y   = input(1, 0);
+                T ax  = input(2, 0);
+                T ay  = input(3, 0);
+                T vx  = input(4, 0);
+                T vy  = input(5, 0);
+                T phi = input(6, 0);
+
+                // x update
+                output(0, 0) = (half * ax * t2 + vx*t) * cos(phi) \
+                             + (half * ay * t2 + vy*t) * sin(phi) \
+                             + x;
+                // y update
+                output(1, 0) = - (half * ax * t2 + vx*t) * sin(phi) \
+                             + (half * ay * t2 + vy*t) * cos(phi) \
+                             + y;
+                // vx update
+                output(4, 0) = vx + ax*t;
+                // vy update
+                output(5, 0) = vy + ay*t;
+                // accelerations and the yaw angle are kept
+                output(2, 0) = ax;
+                output(3, 0) = ay;
+                output(6, 0) = phi;
+        };
+
+        // jacobian of `f`
+
+        // first row of the jacobian, derivative of f0 (the output(0,0), x update)
+        const par_jacobi_func df0_dax = [t2,half](const nx1_vector & in)
+        {
+             T phi = in(6, 0);
+             return half*t2*cos(phi);
+        };
+        const par_jacobi_func df0_day = [t2,half](const nx1_vector & in)
+        {
+            T phi = in(6, 0);
+            return half*t2*sin(phi);
+        };
+        const par_jacobi_func df0_dvx = [t](const nx1_vector & in)
+        {
+            T phi = in(6, 0);
+            return t*cos(phi);
+        };
+        const par_jacobi_func df0_dvy = [t](const nx1_vector & in)
+        {
+            T phi = in(6, 0);
+            return t*sin(phi);
+        };
+        const par_jacobi_func df0_dphi = [t,t2,half](const nx1_vector & in)
+        {
+            T ax  = in(2, 0);
+            T ay  = in(3, 0);
+            T vx  = in(4, 0);
+            T vy  = in(5, 0);
+            T phi = in(6, 0);
+            return cos(phi)*(half*ay*t2 + vy*t) - sin(phi)*(half*ax*t2+vx*t);
+        };
+
+        // second row of the jacobian, derivative of f1 (the output(1,0), y update)
+        const par_jacobi_func df1_dax = [t2,half](const nx1_vector & in)
+        {
+            T phi = in(6, 0);
+            return -half*t2*sin(phi);
+        };
+        const par_jacobi_func df1_day = [t2,half](const nx1_vector & in)
+        {
+            T phi = in(6, 0);
+            return half*t2*cos(phi);
+        };
+        const par_jacobi_func df1_dvx = [t](const nx1_vector & in)
+        {
+            T phi = in(6, 0);
+            return -t*sin(phi);
+        };
+        const par_jacobi_func df1_dvy = [t](const nx1_vector & in)
+        {
+            T phi = in(6, 0);
+            return t*cos(phi);
+        };
+        const par_jacobi_func df1_dphi = [t,t2,half](const nx1_vector & in)
+        {
+            T ax  = in(2, 0);
+            T ay  = in(3, 0);
+            T vx  = in(4, 0);
+            T vy  = in(5, 0);
+            T phi = in(6, 0);
+            return -cos(phi)*(half*ax*t2 + vx*t) - sin(phi)*(half*ay*t2+vy*t);
+        };
+
+        // the constant partial derivatives are evaluated once by the jacobian_function, see kafi::constant_derivative
+        const par_jacobi_func df_one  = kafi::util::identity_derivative<N,T>(1);
+        const par_jacobi_func df_zero = kafi::util::identity_derivative<N,T>(0);
+        // derivative of f4 and f5 (the output(4,0) and output(5,0), vx and vy update) by ax and ay
+        const par_jacobi_func df_t    = kafi::util::identity_derivative<N,T>(sample);
+
+        const f_jacobi_func _F
+        {  //      x        y        ax       ay       vx       vy       phi
+/*f0*/     { df_one,  df_zero, df0_dax, df0_day, df0_dvx, df0_dvy, df0_dphi }
+/*f1*/   , { df_zero, df_one,  df1_dax, df1_day, df1_dvx, df1_dvy, df1_dphi }
+/*f2*/   , { df_zero, df_zero, df_one,  df_zero, df_zero, df_zero, df_zero  }
+/*f3*/   , { df_zero, df_zero, df_zero, df_one,  df_zero, df_zero, df_zero  }
+/*f4*/   , { df_zero, df_zero, df_t,    df_zero, df_one,  df_zero, df_zero  }
+/*f5*/   , { df_zero, df_zero, df_zero, df_t,    df_zero, df_one,  df_zero  }
+/*f6*/   , { df_zero, df_zero, df_zero, df_zero, df_zero, df_zero, df_one   }
+        };
+
+        // `_f` and the state dependent entries of `_F` in a single call, the same expressions
+        const f_fused_func _fused =
+             [t,t2,half](const nx1_vector & input, nx1_vector & output, nxn_matrix & jacobian){
+
+                const T x   = input(0, 0);
+                const T y   = input(1, 0);
+                const T ax  = input(2, 0);
+                const T ay  = input(3, 0);
+                const T vx  = input(4, 0);
+                const T vy  = input(5, 0);
+                const T phi = input(6, 0);
+
+                const T c  = cos(phi);
+                const T s  = sin(phi);
+                const T dx = half * ax * t2 + vx*t;
+                const T dy = half * ay * t2 + vy*t;
+
+                output(0, 0) =   dx * c + dy * s + x;
+                output(1, 0) = - dx * s + dy * c + y;
+                output(4, 0) = vx + ax*t;
+                output(5, 0) = vy + ay*t;
+                output(2, 0) = ax;
+                output(3, 0) = ay;
+                output(6, 0) = phi;
+
+                jacobian(0, 2) =  half*t2*c;
+                jacobian(0, 3) =  half*t2*s;
+                jacobian(0, 4) =  t*c;
+                jacobian(0, 5) =  t*s;
+                jacobian(0, 6) =  c*dy - s*dx;
+                jacobian(1, 2) = -half*t2*s;
+                jacobian(1, 3) =  half*t2*c;
+                jacobian(1, 4) = -t*s;
+                jacobian(1, 5) =  t*c;
+                jacobian(1, 6) = -c*dx - s*dy;
+        };
+
+        return fused ? kafi::jacobian_function<N,N,T>(_f, _F, _fused)
+                     : kafi::jacobian_function<N,N,T>(_f, _F);
+    }
+
+    /** \brief Prediction scaling which cuts the `x` and `y` from the state vector
+     */
+    template< typename T = double >
+    kafi::jacobian_function<N,M,T> prediction_scaling()
+    {
+        using nx1_vector      = typename kafi::jacobian_function<N,M,T>::nx1_vector;
+        using mx1_vector      = typename kafi::jacobian_function<N,M,T>::mx1_vector;
+        using h_func          = typename kafi::jacobian_function<N,M,T>::func;
+        using par_jacobi_func = typename kafi::jacobian_function<N,M,T>::par_jacobi_func;
+        using h_jacobi_func   = typename kafi::jacobian_function<N,M,T>::jacobi_func;
+
+        const h_func _h = [](const nx1_vector & in, mx1_vector & out)
+        {
+            out(0,0) = in(2,0);
+            out(1,0) = in(3,0);
+            out(2,0) = in(4,0);
+            out(3,0) = in(5,0);
+            out(4,0) = in(6,0);
+        };
+
+        const par_jacobi_func dh_one  = kafi::util::identity_derivative<N,T>(1);
+        const par_jacobi_func dh_zero = kafi::util::identity_derivative<N,T>(0);
+
+        const h_jacobi_func _H
+        {
+            { dh_zero, dh_zero, dh_one,  dh_zero, dh_zero, dh_zero, dh_zero }
+         ,  { dh_zero, dh_zero, dh_zero, dh_one,  dh_zero, dh_zero, dh_zero }
+         ,  { dh_zero, dh_zero, dh_zero, dh_zero, dh_one,  dh_zero, dh_zero }
+         ,  { dh_zero, dh_zero, dh_zero, dh_zero, dh_zero, dh_one,  dh_zero }
+         ,  { dh_zero, dh_zero, dh_zero, dh_zero, dh_zero, dh_zero, dh_one  }
+        };
+
+        return kafi::jacobian_function<N,M,T>(_h, _H);
+    }
+
+    //! `Q`, the positions are only integrated
+    template< typename T = double >
+    typename kafi::jacobian_function<N,M,T>::nxn_matrix process_noise()
+    {
+        using nxn_matrix = typename kafi::jacobian_function<N,M,T>::nxn_matrix;
+        return nxn_matrix(
+        {
+            { 0.00000, 0.00000, 0.00000, 0.00000, 0.00000, 0.00000, 0.00000 }
+          , { 0.00000, 0.00000, 0.00000, 0.00000, 0.00000, 0.00000, 0.00000 }
+          , { 0.00000, 0.00000, 0.10000, 0.00000, 0.00000, 0.00000, 0.00000 }
+          , { 0.00000, 0.00000, 0.00000, 0.10000, 0.00000, 0.00000, 0.00000 }
+          , { 0.00000, 0.00000, 0.00000, 0.00000, 0.10000, 0.00000, 0.00000 }
+          , { 0.00000, 0.00000, 0.00000, 0.00000, 0.00000, 0.10000, 0.00000 }
+          , { 0.00000, 0.00000, 0.00000, 0.00000, 0.00000, 0.00000, 0.10000 }
+        } );
+    }
+
+    //! `cN`, uncorrelated sensors
+    template< typename T = double >
+    typename kafi::jacobian_function<N,M,T>::mxm_matrix sensor_noise()
+    {
+        using mxm_matrix = typename kafi::jacobian_function<N,M,T>::mxm_matrix;
+        return mxm_matrix( { { 0.7,   0,    0,    0,    0  }
+                           , { 0,   0.7,    0,    0,    0  }
+                           , { 0,     0, 0.45,    0,    0  }
+                           , { 0,     0,    0, 0.45,    0  }
+                           , { 0,     0,    0,    0, 0.001 }
+                           });
+    }
+
+    //! starts at the origin with the sensor values of the first observation
+    template< typename T = double >
+    typename kafi::jacobian_function<N,M,T>::nx1_vector starting_state(const mx1_vector & first_observation)
+    {
+        using nx1_vector = typename kafi::jacobian_function<N,M,T>::nx1_vector;
+        return nx1_vector( { { T(0) }
+                           , { T(0) }
+                           , { static_cast<T>(first_observation(0,0)) }
+                           , { static_cast<T>(first_observation(1,0)) }
+                           , { static_cast<T>(first_observation(2,0)) }
+                           , { static_cast<T>(first_observation(3,0)) }
+                           , { static_cast<T>(first_observation(4,0)) } });
+    }
+
+    /** \brief Reads all observations of a recorded log
+     *
+     * Columns: Time[s], ax[m/s^2], ay[m/s^2], vx[m/s], vy[m/s], psi[rad]
+     */
+    inline std::vector< mx1_vector > read_log(const std::string & csv_path)
+    {
+        std::vector< mx1_vector > observations;
+        io::CSVReader<5> in(csv_path);
+        in.read_header(io::ignore_extra_column, "ax[m/s^2]", "ay[m/s^2]", "vx[m/s]", "vy[m/s]", "psi[rad]");
+        double ax_ = 0, ay_ = 0, vx_ = 0, vy_ = 0, phi_ = 0;
+        while(in.read_row(ax_, ay_, vx_, vy_, phi_))
+        {
+            observations.push_back( mx1_vector( { { ax_ }
+                                                , { ay_ }
+                                                , { vx_ }
+                                                , { vy_ }
+                                                , { phi_} }));
+        }
+        return observations;
+    }
+
+    //! the recorded log which is shipped with the tests
+    const std::string wemding_log = "test-data/2017-01-01-sensordata-wemding.csv";
+
+} // namespace correvit
+
+/** \brief A car passing a track cone at the origin, observed by range and bearing from the car to the cone
+ *
+ * ```
+ *                 0      1        2   3
+ * state        = [x,     y,       vx, vy]
+ * observations = [range, bearing]
+ * ```
+ *
+ * Close to the cone the bearing changes quickly with the position, a single linearization of `h` is poor.
+ * The car passes the cone on its left side (`x < 0`), the bearing stays within `(-pi/2, pi/2)` and never wraps.
+ */
+namespace cone {
+
+    //! state dimensions
+    const size_t N = 4UL;
+    //! sensor dimensions
+    const size_t M = 2UL;
+
+    using nx1_vector = typename kafi::jacobian_function<N,M>::nx1_vector;
+    using mx1_vector = typename kafi::jacobian_function<N,M>::mx1_vector;
+    using nxn_matrix = typename kafi::jacobian_function<N,M>::nxn_matrix;
+    using mxm_matrix = typename kafi::jacobian_function<N,M>::mxm_matrix;
+
+    //! 20Hz
+    const double sample_time = 0.05;
+    //! standard deviation of the range in meters
+    const double range_deviation = 0.02;
+    //! standard deviation of the bearing in radians
+    const double bearing_deviation = 0.005;
+    //! standard deviation of the starting position in meters
+    const double position_deviation = 1.0;
+
+    //! constant velocity, every partial derivative is constant
+    template< typename T = double >
+    kafi::jacobian_function<N,N,T> transition(const double sample = sample_time)
+    {
+        using nx1_vector      = typename kafi::jacobian_function<N,N,T>::nx1_vector;
+        using f_func          = typename kafi::jacobian_function<N,N,T>::func;
+        using par_jacobi_func = typename kafi::jacobian_function<N,N,T>::par_jacobi_func;
+        using f_jacobi_func   = typename kafi::jacobian_function<N,N,T>::jacobi_func;
+
+        const T t = static_cast<T>(sample);
+        const f_func _f = [t](const nx1_vector & input, nx1_vector & output)
+        {
+            output(0, 0) = input(0, 0) + t * input(2, 0);
+            output(1, 0) = input(1, 0) + t * input(3, 0);
+            output(2, 0) = input(2, 0);
+            output(3, 0) = input(3, 0);
+        };
+
+        const par_jacobi_func df_one  = kafi::util::identity_derivative<N,T>(1);
+        const par_jacobi_func df_zero = kafi::util::identity_derivative<N,T>(0);
+        const par_jacobi_func df_t    = kafi::util::identity_derivative<N,T>(sample);
+        const f_jacobi_func _F
+        {
+            { df_one,  df_zero, df_t,    df_zero }
+         ,  { df_zero, df_one,  df_zero, df_t    }
+         ,  { df_zero, df_zero, df_one,  df_zero }
+         ,  { df_zero, df_zero, df_zero, df_one  }
+        };
+        return kafi::jacobian_function<N,N,T>(_f, _F);
+    }
+
+    //! range and bearing from the car to the cone at the origin
+    template< typename T = double >
+    kafi::jacobian_function<N,M,T> prediction_scaling()
+    {
+        using std::atan2;
+        using std::sqrt;
+        using nx1_vector      = typename kafi::jacobian_function<N,M,T>::nx1_vector;
+        using mx1_vector      = typename kafi::jacobian_function<N,M,T>::mx1_vector;
+        using h_func          = typename kafi::jacobian_function<N,M,T>::func;
+        using par_jacobi_func = typename kafi::jacobian_function<N,M,T>::par_jacobi_func;
+        using h_jacobi_func   = typename kafi::jacobian_function<N,M,T>::jacobi_func;
+
+        const h_func _h = [](const nx1_vector & in, mx1_vector & out)
+        {
+            out(0, 0) = sqrt(in(0, 0) * in(0, 0) + in(1, 0) * in(1, 0));
+            out(1, 0) = atan2(-in(1, 0), -in(0, 0));
+        };
+
+        const par_jacobi_func dr_dx = [](const nx1_vector & in)
+        {
+            return in(0, 0) / sqrt(in(0, 0) * in(0, 0) + in(1, 0) * in(1, 0));
+        };
+        const par_jacobi_func dr_dy = [](const nx1_vector & in)
+        {
+            return in(1, 0) / sqrt(in(0, 0) * in(0, 0) + in(1, 0) * in(1, 0));
+        };
+        // atan2(-y, -x) differs from atan2(y, x) by a constant, the derivatives are the same
+        const par_jacobi_func db_dx = [](const nx1_vector & in)
+        {
+            return - in(1, 0) / (in(0, 0) * in(0, 0) + in(1, 0) * in(1, 0));
+        };
+        const par_jacobi_func db_dy = [](const nx1_vector & in)
+        {
+            return in(0, 0) / (in(0, 0) * in(0, 0) + in(1, 0) * in(1, 0));
+        };
+        const par_jacobi_func dh_zero = kafi::util::identity_derivative<N,T>(0);
+
+        const h_jacobi_func _H
+        {
+            { dr_dx, dr_dy, dh_zero, dh_zero }
+         ,  { db_dx, db_dy, dh_zero, dh_zero }
+        };
+        return kafi::jacobian_function<N,M,T>(_h, _H);
+    }
+
+    /** \brief A simulated pass of the cone with the true states, the estimate starts off by up to a meter
+     */
+    struct drive
+    {
+        /** \brief Simulates `steps` observations with `seed`
+         *
+         * The car starts 10 meters before the cone, passes it with `lateral_offset` meters at 4 m/s. The closer
+         * it passes, the more curved are range and bearing within the uncertainty of the estimate.
+         */
+        drive(const unsigned int seed, const size_t steps, const double lateral_offset = 2.0)
+        : process_noise( { { 0,    0,    0,    0    }
+                         , { 0,    0,    0,    0    }
+                         , { 0,    0,    0.01, 0    }
+                         , { 0,    0,    0,    0.01 } } )
+        , sensor_noise( { { range_deviation * range_deviation, 0                                     }
+                        , { 0,                                 bearing_deviation * bearing_deviation } } )
+        , prediction_error( { { position_deviation * position_deviation, 0,                                       0,    0    }
+                            , { 0,                                       position_deviation * position_deviation, 0,    0    }
+                            , { 0,   0,   0.25, 0    }
+                            , { 0,   0,   0,    0.25 } } )
+        {
+            std::mt19937 generator(seed);
+            std::normal_distribution<double> normal(0.0, 1.0);
+
+            nx1_vector truth( { { -lateral_offset }, { -10.0 }, { 0.0 }, { 4.0 } } );
+            for (size_t row = 0UL; row < N; ++row)
+            {
+                starting_state(row, 0) = truth(row, 0) + std::sqrt(prediction_error(row, row)) * normal(generator);
+            }
+
+            const kafi::jacobian_function<N,N> f = transition();
+            const kafi::jacobian_function<N,M> h = prediction_scaling();
+            nx1_vector next;
+            mx1_vector observation;
+            states.reserve(steps);
+            observations.reserve(steps);
+            for (size_t step = 0UL; step < steps; ++step)
+            {
+                f(truth, next);
+                next(2, 0) += 0.1 * normal(generator);
+                next(3, 0) += 0.1 * normal(generator);
+                truth = next;
+                h(truth, observation);
+                observation(0, 0) += range_deviation   * normal(generator);
+                observation(1, 0) += bearing_deviation * normal(generator);
+                states.push_back(truth);
+                observations.push_back(observation);
+            }
+        }
+
+        nxn_matrix process_noise;
+        mxm_matrix sensor_noise;
+        nxn_matrix prediction_error;
+        nx1_vector starting_state;
+        //! true state after every step
+        std::vector< nx1_vector > states;
+        std::vector< mx1_vector > observations;
+    };
+
+} // namespace cone
+
+/** \brief Randomized linear models `f(s) = A * s`, `h(s) = C * s`
+ *
+ * Template arguments:
+ * * `N`  = state dimensions
+ * * `M`  = sensor dimensions
+ */
+namespace linear {
+
+    /** \brief Creates a linear jacobian_function `f(s) = A * s` with the constant jacobian `A`
+     *
+     * `A` is converted to the scalar type `T` once, the zeros of `A` are structural zeros of the jacobian
+     */
+    template< size_t   N
+            , size_t   M
+            , typename T = double >
+    kafi::jacobian_function<N,M,T> function(const typename kafi::jacobian_function<N,M>::mxn_matrix & A)
+    {
+        using nx1_vector      = typename kafi::jacobian_function<N,M,T>::nx1_vector;
+        using mx1_vector      = typename kafi::jacobian_function<N,M,T>::mx1_vector;
+        using mxn_matrix      = typename kafi::jacobian_function<N,M,T>::mxn_matrix;
+        using func            = typename kafi::jacobian_function<N,M,T>::func;
+        using jacobi_func     = typename kafi::jacobian_function<N,M,T>::jacobi_func;
+
+        const mxn_matrix A_(A);
+        const func f = [A_](const nx1_vector & input, mx1_vector & output)
+        {
+            output = A_ * input;
+        };
+
+        jacobi_func F;
+        for (size_t row = 0UL; row < M; ++row)
+        {
+            for (size_t col = 0UL; col < N; ++col)
+            {
+                // the zeros of A stay empty, i.e. structural zeros of the jacobian
+                if (A(row, col) == T(0)) continue;
+                F(row, col) = kafi::util::identity_derivative<N,T>(A(row, col));
+            }
+        }
+        return kafi::jacobian_function<N,M,T>(f, F);
+    }
+
+    /** \brief A stable, randomly drawn linear system together with a simulated log of observations
+     */
+    template< size_t N
+            , size_t M >
+    struct random_model
+    {
+        using nx1_vector = typename kafi::jacobian_function<N,M>::nx1_vector;
+        using mx1_vector = typename kafi::jacobian_function<N,M>::mx1_vector;
+        using nxn_matrix = typename kafi::jacobian_function<N,M>::nxn_matrix;
+        using mxn_matrix = typename kafi::jacobian_function<N,M>::mxn_matrix;
+        using mxm_matrix = typename kafi::jacobian_function<N,M>::mxm_matrix;
+
+        /** \brief Draws the model with `seed` and simulates `steps` observations
+         */
+        random_model(const unsigned int seed, const size_t steps)
+        {
+            std::mt19937 generator(seed);
+            std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+            std::normal_distribution<double>       normal(0.0, 1.0);
+
+            // close to identity to keep the system stable
+            for (size_t row = 0UL; row < N; ++row)
+            {
+                for (size_t col = 0UL; col < N; ++col)
+                {
+                    A(row, col) = (row == col ? 0.95 : 0.0) + 0.05 * uniform(generator) / N;
+                }
+            }
+            for (size_t row = 0UL; row < M; ++row)
+            {
+                for (size_t col = 0UL; col < N; ++col)
+                {
+                    C(row, col) = uniform(generator);
+                }
+            }
+            // symmetric positive definite noise matrices
+            nxn_matrix q_root;
+            mxm_matrix r_root;
+            for (size_t row = 0UL; row < N; ++row)
+            {
+                for (size_t col = 0UL; col < N; ++col)
+                {
+                    q_root(row, col) = 0.1 * uniform(generator);
+                }
+            }
+            for (size_t row = 0UL; row < M; ++row)
+            {
+                for (size_t col = 0UL; col < M; ++col)
+                {
+                    r_root(row, col) = 0.5 * uniform(generator);
+                }
+            }
+            process_noise = q_root * blaze::trans(q_root) + 0.01 * kafi::util::create_identity<N, blaze::rowMajor>();
+            sensor_noise  = r_root * blaze::trans(r_root) + 0.1  * kafi::util::create_identity<M, blaze::rowMajor>();
+
+            for (size_t row = 0UL; row < N; ++row)
+            {
+                starting_state(row, 0) = uniform(generator);
+            }
+
+            // simulate the true system
+            nx1_vector truth(starting_state);
+            observations.reserve(steps);
+            for (size_t step = 0UL; step < steps; ++step)
+            {
+                nx1_vector process_sample;
+                for (size_t row = 0UL; row < N; ++row)
+                {
+                    process_sample(row, 0) = 0.1 * normal(generator);
+                }
+                truth = A * truth + process_sample;
+
+                mx1_vector sensor_sample;
+                for (size_t row = 0UL; row < M; ++row)
+                {
+                    sensor_sample(row, 0) = 0.3 * normal(generator);
+                }
+                observations.push_back(mx1_vector(C * truth + sensor_sample));
+            }
+        }
+
+        //! state transition
+        template< typename T = double >
+        kafi::jacobian_function<N,N,T> transition() const
+        {
+            return function<N,N,T>(A);
+        }
+
+        //! prediction scaling
+        template< typename T = double >
+        kafi::jacobian_function<N,M,T> prediction_scaling() const
+        {
+            return function<N,M,T>(C);
+        }
+
+        nxn_matrix A;
+        mxn_matrix C;
+        nxn_matrix process_noise;
+        mxm_matrix sensor_noise;
+        nx1_vector starting_state;
+        std::vector< mx1_vector > observations;
+    };
+
+    /** \brief A chain of `N` states, every state only interacts with its neighbours, observed by `M` evenly spread sensors
+     *
+     * The jacobians are sparse (tridiagonal transition, one state per sensor) and so is the information matrix,
+     * a model for kafi::information_kafi. Allocate it on the heap for a large `N`.
+     */
+    template< size_t N
+            , size_t M >
+    struct chain_model
+    {
+        using nx1_vector = typename kafi::jacobian_function<N,M>::nx1_vector;
+        using mx1_vector = typename kafi::jacobian_function<N,M>::mx1_vector;
+        using nxn_matrix = typename kafi::jacobian_function<N,M>::nxn_matrix;
+        using mxn_matrix = typename kafi::jacobian_function<N,M>::mxn_matrix;
+        using mxm_matrix = typename kafi::jacobian_function<N,M>::mxm_matrix;
+
+        /** \brief Draws the starting state with `seed` and simulates `steps` observations
+         */
+        chain_model(const unsigned int seed, const size_t steps)
+        : A(0)
+        , C(0)
+        , process_noise(0)
+        , sensor_noise(0)
+        {
+            std::mt19937 generator(seed);
+            std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+            std::normal_distribution<double>       normal(0.0, 1.0);
+
+            // diffusion along the chain, stable with a spectral radius below 0.95
+            for (size_t row = 0UL; row < N; ++row)
+            {
+                A(row, row) = 0.85;
+                if (row > 0UL)     A(row, row - 1UL) = 0.05;
+                if (row + 1UL < N) A(row, row + 1UL) = 0.05;
+                process_noise(row, row) = 0.01;
+                starting_state(row, 0)  = uniform(generator);
+            }
+            for (size_t row = 0UL; row < M; ++row)
+            {
+                C(row, row * N / M) = 1.0;
+                sensor_noise(row, row) = 0.1;
+            }
+
+            // simulate the true system
+            nx1_vector truth(starting_state);
+            observations.reserve(steps);
+            for (size_t step = 0UL; step < steps; ++step)
+            {
+                nx1_vector process_sample;
+                for (size_t row = 0UL; row < N; ++row)
+                {
+                    process_sample(row, 0) = 0.1 * normal(generator);
+                }
+                truth = A * truth + process_sample;
+
+                mx1_vector sensor_sample;
+                for (size_t row = 0UL; row < M; ++row)
+                {
+                    sensor_sample(row, 0) = 0.3 * normal(generator);
+                }
+                observations.push_back(mx1_vector(C * truth + sensor_sample));
+            }
+        }
+
+        //! state transition
+        template< typename T = double >
+        kafi::jacobian_function<N,N,T> transition() const
+        {
+            return function<N,N,T>(A);
+        }
+
+        //! prediction scaling
+        template< typename T = double >
+        kafi::jacobian_function<N,M,T> prediction_scaling() const
+        {
+            return function<N,M,T>(C);
+        }
+
+        nxn_matrix A;
+        mxn_matrix C;
+        nxn_matrix process_noise;
+        mxm_matrix sensor_noise;
+        nx1_vector starting_state;
+        std::vector< mx1_vector > observations;
+    };
+
+    /** \brief Creates a linear kafi::dynamic_jacobian_function `f(s) = A * s` with the constant jacobian `A`
+     *
+     * Input and output are never the same view, so the product is written directly and calling the function doesn't allocate.
+     */
+    inline kafi::dynamic_jacobian_function<> dynamic_function(const blaze::DynamicMatrix<double, blaze::rowMajor> & A)
+    {
+        using matrix_t    = blaze::DynamicMatrix<double, blaze::rowMajor>;
+        using view_t      = kafi::dynamic_jacobian_function<>::view_t;
+        using jacobi_func = kafi::dynamic_jacobian_function<>::jacobi_func;
+
+        const std::shared_ptr< const matrix_t > A_ = std::make_shared< const matrix_t >(A);
+        const kafi::dynamic_jacobian_function<>::func f = [A_](const view_t & input, view_t & output)
+        {
+            output = (*A_) * input;
+        };
+
+        jacobi_func F(A.rows(), A.columns());
+        for (size_t row = 0UL; row < A.rows(); ++row)
+        {
+            for (size_t col = 0UL; col < A.columns(); ++col)
+            {
+                const double derivative = A(row, col);
+                F(row, col) = [derivative](const view_t &){ return derivative; };
+            }
+        }
+        return kafi::dynamic_jacobian_function<>(A.columns(), A.rows(), f, F);
+    }
+
+    /** \brief The runtime-sized counterpart of random_model, e.g. for the large states of the large-state mode
+     *
+     * The noise matrices are diagonal, so drawing a model of `N = 500` stays cheap.
+     */
+    struct runtime_model
+    {
+        using matrix_t = blaze::DynamicMatrix<double, blaze::rowMajor>;
+
+        /** \brief Draws the model with `seed` and simulates `steps` observations
+         */
+        runtime_model(const size_t N, const size_t M, const unsigned int seed, const size_t steps)
+        : A(N, N)
+        , C(M, N)
+        , process_noise(N, N, 0.0)
+        , sensor_noise(M, M, 0.0)
+        , starting_state(N, 1UL)
+        {
+            std::mt19937 generator(seed);
+            std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+            std::normal_distribution<double>       normal(0.0, 1.0);
+
+            // close to identity to keep the system stable
+            for (size_t row = 0UL; row < N; ++row)
+            {
+                for (size_t col = 0UL; col < N; ++col)
+                {
+                    A(row, col) = (row == col ? 0.95 : 0.0) + 0.05 * uniform(generator) / N;
+                }
+                process_noise(row, row) = 0.01;
+                starting_state(row, 0)  = uniform(generator);
+            }
+            for (size_t row = 0UL; row < M; ++row)
+            {
+                for (size_t col = 0UL; col < N; ++col)
+                {
+                    C(row, col) = uniform(generator);
+                }
+                sensor_noise(row, row) = 0.1;
+            }
+
+            // simulate the true system
+            matrix_t truth(starting_state);
+            matrix_t next(N, 1UL);
+            observations.reserve(steps);
+            for (size_t step = 0UL; step < steps; ++step)
+            {
+                next = A * truth;
+                for (size_t row = 0UL; row < N; ++row)
+                {
+                    truth(row, 0) = next(row, 0) + 0.1 * normal(generator);
+                }
+                matrix_t observation(C * truth);
+                for (size_t row = 0UL; row < M; ++row)
+                {
+                    observation(row, 0) += 0.3 * normal(generator);
+                }
+                observations.push_back(observation);
+            }
+        }
+
+        //! state transition
+        kafi::dynamic_jacobian_function<> transition() const
+        {
+            return dynamic_function(A);
+        }
+
+        //! prediction scaling
+        kafi::dynamic_jacobian_function<> prediction_scaling() const
+        {
+            return dynamic_function(C);
+        }
+
+        matrix_t A;
+        matrix_t C;
+        matrix_t process_noise;
+        matrix_t sensor_noise;
+        matrix_t starting_state;
+        std::vector< matrix_t > observations;
+    };
+
+} // namespace linear
+
+/** \brief A car on a straight line which cruises, brakes and accelerates, observed by position and wheel speed
+ *
+ * ```
+ *                 0         1         2
+ * state        = [position, velocity, acceleration]
+ * observations = [position, velocity]
+ * ```
+ *
+ * The regimes switch abruptly, a single filter either lags behind the braking or is noisy while cruising.
+ */
+namespace braking {
+
+    //! state dimensions
+    const size_t N = 3UL;
+    //! sensor dimensions
+    const size_t M = 2UL;
+
+    using nx1_vector = typename kafi::jacobian_function<N,M>::nx1_vector;
+    using mx1_vector = typename kafi::jacobian_function<N,M>::mx1_vector;
+    using nxn_matrix = typename kafi::jacobian_function<N,M>::nxn_matrix;
+    using mxm_matrix = typename kafi::jacobian_function<N,M>::mxm_matrix;
+
+    //! 10Hz
+    const double sample_time = 0.1;
+    //! standard deviation of the position in meters
+    const double position_deviation = 0.5;
+    //! standard deviation of the wheel speed in m/s
+    const double velocity_deviation = 0.2;
+
+    /** \brief Constant velocity if `cruising`, the acceleration is dropped, otherwise constant acceleration
+     */
+    inline kafi::jacobian_function<N,N> transition(const bool cruising)
+    {
+        const double t = sample_time;
+        const double a = cruising ? 0.0 : 1.0;
+        return linear::function<N,N>(typename kafi::jacobian_function<N,N>::nxn_matrix(
+            { { 1, t, a * t * t / 2 }
+            , { 0, 1, a * t         }
+            , { 0, 0, a             } } ));
+    }
+
+    //! position and velocity
+    inline kafi::jacobian_function<N,M> prediction_scaling()
+    {
+        return linear::function<N,M>(typename kafi::jacobian_function<N,M>::mxn_matrix(
+            { { 1, 0, 0 }
+            , { 0, 1, 0 } } ));
+    }
+
+    //! small velocity changes while cruising, jerk while braking
+    inline nxn_matrix process_noise(const bool cruising)
+    {
+        return cruising ? nxn_matrix( { { 0, 0,    0    }
+                                      , { 0, 0.01, 0    }
+                                      , { 0, 0,    0.01 } } )
+                        : nxn_matrix( { { 0, 0,    0    }
+                                      , { 0, 0.01, 0    }
+                                      , { 0, 0,    1.0  } } );
+    }
+
+    //! the covariance of the sensors
+    inline mxm_matrix sensor_noise()
+    {
+        return mxm_matrix( { { position_deviation * position_deviation, 0                                       }
+                           , { 0,                                       velocity_deviation * velocity_deviation } } );
+    }
+
+    /** \brief A simulated drive with the true states: cruise at 20 m/s, brake with 6 m/s^2, cruise, accelerate with 3 m/s^2
+     */
+    struct drive
+    {
+        //! simulates 200 steps with `seed`
+        explicit drive(const unsigned int seed)
+        : starting_state( { { 0.0 }, { 20.0 }, { 0.0 } } )
+        {
+            std::mt19937 generator(seed);
+            std::normal_distribution<double> normal(0.0, 1.0);
+
+            const size_t steps = 200UL;
+            nx1_vector truth(starting_state);
+            mx1_vector observation;
+            states.reserve(steps);
+            observations.reserve(steps);
+            for (size_t step = 0UL; step < steps; ++step)
+            {
+                double acceleration = 0.0;
+                if (step >= 50UL  && step < 75UL)  acceleration = -6.0;
+                if (step >= 130UL && step < 150UL) acceleration =  3.0;
+
+                const double t = sample_time;
+                truth(0, 0) += t * truth(1, 0) + t * t / 2 * acceleration;
+                truth(1, 0) += t * acceleration + 0.02 * normal(generator);
+                truth(2, 0)  = acceleration;
+                observation(0, 0) = truth(0, 0) + position_deviation * normal(generator);
+                observation(1, 0) = truth(1, 0) + velocity_deviation * normal(generator);
+                states.push_back(truth);
+                observations.push_back(observation);
+            }
+        }
+
+        nx1_vector starting_state;
+        //! true state after every step
+        std::vector< nx1_vector > states;
+        std::vector< mx1_vector > observations;
+    };
+
+} // namespace braking
+
+/** \brief A car on a circle, the heading of the nominal state is a unit vector, the one of the error an angle
+ *
+ * ```
+ *                 0  1  2         3         4  5
+ * nominal      = [x, y, cos(phi), sin(phi), v, omega]
+ * error        = [x, y, phi,                v, omega]
+ * observations = [x, y]
+ * ```
+ *
+ * The error has one dimension less than the nominal state. Its transition is the jacobian of the same model
+ * with the heading as an angle, which kafi::kafi estimates as the reference.
+ */
+namespace unicycle {
+
+    //! nominal state dimensions
+    const size_t N = 6UL;
+    //! error state dimensions, and the state dimensions of the reference with the heading as an angle
+    const size_t E = 5UL;
+    //! sensor dimensions
+    const size_t M = 2UL;
+
+    using nx1_vector = typename kafi::error_state_kafi<N,E,M>::nx1_vector;
+    using ex1_vector = typename kafi::error_state_kafi<N,E,M>::ex1_vector;
+    using mx1_vector = typename kafi::error_state_kafi<N,E,M>::mx1_vector;
+    using exe_matrix = typename kafi::error_state_kafi<N,E,M>::exe_matrix;
+    using mxm_matrix = typename kafi::error_state_kafi<N,E,M>::mxm_matrix;
+
+    //! 10Hz
+    const double sample_time = 0.1;
+    //! standard deviation of the position in meters
+    const double position_deviation = 0.5;
+
+    //! rotates the heading of `nominal` by `angle` in place
+    inline void rotate(nx1_vector & nominal, const double angle)
+    {
+        const double c = nominal(2, 0);
+        const double s = nominal(3, 0);
+        nominal(2, 0) = c * std::cos(angle) - s * std::sin(angle);
+        nominal(3, 0) = s * std::cos(angle) + c * std::sin(angle);
+    }
+
+    //! the nominal integrator, constant velocity and turn rate
+    inline void integrate(const nx1_vector & nominal, nx1_vector & next)
+    {
+        const double t = sample_time;
+        next = nominal;
+        next(0, 0) += t * nominal(4, 0) * nominal(2, 0);
+        next(1, 0) += t * nominal(4, 0) * nominal(3, 0);
+        rotate(next, t * nominal(5, 0));
+    }
+
+    //! the same model with the heading as an angle, its jacobian is the transition of the error
+    inline kafi::jacobian_function<E,E> transition()
+    {
+        using par_jacobi_func = typename kafi::jacobian_function<E,E>::par_jacobi_func;
+        using jacobi_func     = typename kafi::jacobian_function<E,E>::jacobi_func;
+
+        const double t = sample_time;
+        const par_jacobi_func df0_dphi = [t](const ex1_vector & in){ return -t * in(3, 0) * std::sin(in(2, 0)); };
+        const par_jacobi_func df0_dv   = [t](const ex1_vector & in){ return  t * std::cos(in(2, 0)); };
+        const par_jacobi_func df1_dphi = [t](const ex1_vector & in){ return  t * in(3, 0) * std::cos(in(2, 0)); };
+        const par_jacobi_func df1_dv   = [t](const ex1_vector & in){ return  t * std::sin(in(2, 0)); };
+        const par_jacobi_func df_one   = kafi::util::identity_derivative<E>(1);
+        const par_jacobi_func df_t     = kafi::util::identity_derivative<E>(t);
+
+        // empty partial derivatives are structural zeros
+        jacobi_func F;
+        F(0, 0) = df_one; F(0, 2) = df0_dphi; F(0, 3) = df0_dv;
+        F(1, 1) = df_one; F(1, 2) = df1_dphi; F(1, 3) = df1_dv;
+        F(2, 2) = df_one; F(2, 4) = df_t;
+        F(3, 3) = df_one;
+        F(4, 4) = df_one;
+
+        return kafi::jacobian_function<E,E>(
+            [t](const ex1_vector & in, ex1_vector & out)
+            {
+                out = in;
+                out(0, 0) += t * in(3, 0) * std::cos(in(2, 0));
+                out(1, 0) += t * in(3, 0) * std::sin(in(2, 0));
+                out(2, 0) += t * in(4, 0);
+            }, F);
+    }
+
+    //! the position, of the heading as an angle or of the error
+    inline kafi::jacobian_function<E,M> prediction_scaling()
+    {
+        return linear::function<E,M>(typename kafi::jacobian_function<E,M>::mxn_matrix(
+            { { 1, 0, 0, 0, 0 }
+            , { 0, 1, 0, 0, 0 } } ));
+    }
+
+    //! `h(x)` of the nominal state
+    inline void measure(const nx1_vector & nominal, mx1_vector & prediction)
+    {
+        prediction(0, 0) = nominal(0, 0);
+        prediction(1, 0) = nominal(1, 0);
+    }
+
+    //! the heading as an angle, the linearization point of the error
+    inline void linearize(const nx1_vector & nominal, ex1_vector & point)
+    {
+        point = { { nominal(0, 0) }, { nominal(1, 0) }, { std::atan2(nominal(3, 0), nominal(2, 0)) }, { nominal(4, 0) }, { nominal(5, 0) } };
+    }
+
+    //! composes the nominal state with the error, the heading is rotated by the error of the angle
+    inline void inject(nx1_vector & nominal, const ex1_vector & error)
+    {
+        nominal(0, 0) += error(0, 0);
+        nominal(1, 0) += error(1, 0);
+        rotate(nominal, error(2, 0));
+        nominal(4, 0) += error(3, 0);
+        nominal(5, 0) += error(4, 0);
+    }
+
+    //! small changes of the velocity and of the turn rate
+    inline exe_matrix process_noise()
+    {
+        exe_matrix Q(0.0);
+        Q(0, 0) = 1e-4;
+        Q(1, 1) = 1e-4;
+        Q(2, 2) = 1e-4;
+        Q(3, 3) = 0.01;
+        Q(4, 4) = 1e-3;
+        return Q;
+    }
+
+    //! the covariance of the sensors
+    inline mxm_matrix sensor_noise()
+    {
+        return mxm_matrix( { { position_deviation * position_deviation, 0                                       }
+                           , { 0,                                       position_deviation * position_deviation } } );
+    }
+
+    /** \brief A simulated drive on a circle with 10 m/s and 0.3 rad/s, the filters start with a wrong heading
+     */
+    struct drive
+    {
+        //! simulates 200 steps with `seed`
+        explicit drive(const unsigned int seed)
+        : starting_state( { { 0.0 }, { 0.0 }, { 0.5 }, { 10.0 }, { 0.2 } } )
+        {
+            std::mt19937 generator(seed);
+            std::normal_distribution<double> normal(0.0, 1.0);
+
+            const size_t steps = 200UL;
+            ex1_vector truth( { { 0.0 }, { 0.0 }, { 0.0 }, { 10.0 }, { 0.3 } } );
+            mx1_vector observation;
+            observations.reserve(steps);
+            for (size_t step = 0UL; step < steps; ++step)
+            {
+                const double t = sample_time;
+                truth(0, 0) += t * truth(3, 0) * std::cos(truth(2, 0));
+                truth(1, 0) += t * truth(3, 0) * std::sin(truth(2, 0));
+                truth(2, 0) += t * truth(4, 0);
+                observation(0, 0) = truth(0, 0) + position_deviation * normal(generator);
+                observation(1, 0) = truth(1, 0) + position_deviation * normal(generator);
+                observations.push_back(observation);
+            }
+        }
+
+        //! the nominal state of `starting_state`
+        nx1_vector starting_nominal() const
+        {
+            return nx1_vector( { { starting_state(0, 0) }, { starting_state(1, 0) }
+                               , { std::cos(starting_state(2, 0)) }, { std::sin(starting_state(2, 0)) }
+                               , { starting_state(3, 0) }, { starting_state(4, 0) } } );
+        }
+
+        //! with the heading as an angle
+        ex1_vector starting_state;
+        std::vector< mx1_vector > observations;
+    };
+
+} // namespace unicycle
+
+/** \brief kafi::error_state_kafi of a model with an additive error of the same dimensions, `x += dx` by default
+ *
+ * `f` integrates the nominal state and its jacobian is the transition of the error, `h` predicts the observation
+ * and its jacobian is the one by the error. The linearization point is the nominal state itself, so with
+ * `inject` empty the filter estimates the same as kafi::kafi.
+ */
+template< size_t N
+        , size_t M >
+std::unique_ptr< kafi::error_state_kafi<N,N,M> > additive_error_state(      kafi::jacobian_function<N,N>                    f
+                                                                     ,       kafi::jacobian_function<N,M>                    h
+                                                                     , const typename kafi::error_state_kafi<N,N,M>::nx1_vector & starting_state
+                                                                     , const typename kafi::error_state_kafi<N,N,M>::exe_matrix & process_noise
+                                                                     , const typename kafi::error_state_kafi<N,N,M>::mxm_matrix & sensor_noise
+                                                                     ,       typename kafi::error_state_kafi<N,N,M>::inject_func  inject
+                                                                           = typename kafi::error_state_kafi<N,N,M>::inject_func())
+{
+    using filter_t   = kafi::error_state_kafi<N,N,M>;
+    using nx1_vector = typename filter_t::nx1_vector;
+
+    if (!inject)
+    {
+        inject = [](nx1_vector & nominal, const nx1_vector & error){ nominal += error; };
+    }
+    const typename filter_t::integrate_func integrate = f.function();
+    const typename filter_t::measure_func   measure   = h.function();
+    return std::unique_ptr< filter_t >(
+        new filter_t(integrate
+                   , std::move(f)
+                   , measure
+                   , std::move(h)
+                   , [](const nx1_vector & nominal, nx1_vector & point){ point = nominal; }
+                   , inject
+                   , starting_state
+                   , process_noise
+                   , sensor_noise));
+}
+
+} // namespace models
+
+#endif // KAFI_TESTS_MODELS_H
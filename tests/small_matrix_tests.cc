@@ -0,0 +1,229 @@
+// Copyright 2018 municHMotorsport e.V. <info@munichmotorsport.de>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <blaze/Math.h>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include "catch.h"
+
+#include "../library/small_matrix.h"
+#include "../library/fixed_point.h"
+
+/** \brief A random symmetric positive definite matrix, like the innovation covariance `H * P * trans(H) + cN`
+ */
+template< size_t M >
+blaze::StaticMatrix<double, M, M, blaze::rowMajor> random_covariance(const unsigned int seed)
+{
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+    blaze::StaticMatrix<double, M, M, blaze::rowMajor> root;
+    for (size_t row = 0UL; row < M; ++row)
+    {
+        for (size_t col = 0UL; col < M; ++col)
+        {
+            root(row, col) = uniform(generator);
+        }
+    }
+    return root * blaze::trans(root) + 0.5 * kafi::util::create_identity<M, blaze::rowMajor>();
+}
+
+/** \brief util::inverse() with the kernel selected for `T` and `M` against the double Gauss-Jordan inversion
+ */
+template< size_t   M
+        , typename T = double >
+void test_inverse(const double eps)
+{
+    std::string description = "M = ";
+    description.append(std::to_string(M));
+    description.append(std::is_same<T, double>::value ? "" : std::is_same<T, float>::value ? ", float" : ", fixed");
+    SECTION(description){
+        using matrix_t = blaze::StaticMatrix<double, M, M, blaze::rowMajor>;
+        using typed_t  = blaze::StaticMatrix<T,      M, M, blaze::rowMajor>;
+
+        const matrix_t S = random_covariance<M>(M);
+        matrix_t expected;
+        kafi::util::gauss_jordan_inverse(S, expected);
+
+        typed_t typed_S;
+        for (size_t row = 0UL; row < M; ++row)
+        {
+            for (size_t col = 0UL; col < M; ++col)
+            {
+                typed_S(row, col) = static_cast<T>(S(row, col));
+            }
+        }
+        typed_t inverse;
+        kafi::util::inverse(typed_S, inverse);
+
+        for (size_t row = 0UL; row < M; ++row)
+        {
+            for (size_t col = 0UL; col < M; ++col)
+            {
+                REQUIRE(static_cast<double>(inverse(row, col)) == Approx(expected(row, col)).margin(eps));
+            }
+        }
+
+        // a singular matrix is reported like blaze::inv does
+        typed_t singular(0);
+        REQUIRE_THROWS_AS(kafi::util::inverse(singular, inverse), std::invalid_argument);
+    }
+}
+
+TEST_CASE("small_matrix.h", "[small_matrix]") {
+
+    SECTION("kernel selection") {
+        using kernel = kafi::util::inverse_kernel;
+        REQUIRE((kafi::util::inverse_kernel_t<double, 1>::value) == kernel::closed_form);
+        REQUIRE((kafi::util::inverse_kernel_t<double, 3>::value) == kernel::closed_form);
+        REQUIRE((kafi::util::inverse_kernel_t<kafi::fixed<16>, 5>::value) == kernel::gauss_jordan);
+#ifdef KAFI_NO_LAPACK
+        REQUIRE((kafi::util::inverse_kernel_t<double, 5>::value) == kernel::gauss_jordan);
+#else
+        REQUIRE((kafi::util::inverse_kernel_t<double, 5>::value) == kernel::lapack);
+#endif
+    }
+
+    SECTION("inverse with double", "M = 1..8,12") {
+        test_inverse<1>(1e-12);
+        test_inverse<2>(1e-12);
+        test_inverse<3>(1e-12);
+        test_inverse<4>(1e-12);
+        test_inverse<5>(1e-12);
+        test_inverse<6>(1e-12);
+        test_inverse<7>(1e-12);
+        test_inverse<8>(1e-12);
+        test_inverse<12>(1e-12);
+    }
+
+    SECTION("inverse with float", "M = 1,2,3,5,8") {
+        test_inverse<1, float>(1e-4);
+        test_inverse<2, float>(1e-4);
+        test_inverse<3, float>(1e-4);
+        test_inverse<5, float>(1e-4);
+        test_inverse<8, float>(1e-4);
+    }
+
+    SECTION("inverse with Q15.16 fixed-point", "M = 1,2,3,5,8") {
+        test_inverse<1, kafi::fixed<16>>(1e-3);
+        test_inverse<2, kafi::fixed<16>>(1e-3);
+        test_inverse<3, kafi::fixed<16>>(1e-3);
+        test_inverse<5, kafi::fixed<16>>(1e-3);
+        test_inverse<8, kafi::fixed<16>>(1e-3);
+    }
+
+    SECTION("cholesky factor") {
+        using matrix_t = blaze::StaticMatrix<double, 6, 6, blaze::rowMajor>;
+        const matrix_t S = random_covariance<6>(6);
+        matrix_t L;
+        kafi::util::cholesky_factor(S, L);
+        for (size_t row = 0UL; row < 6; ++row)
+        {
+            REQUIRE(L(row, row) > 0.0);
+            for (size_t col = row + 1UL; col < 6; ++col)
+            {
+                REQUIRE(L(row, col) == 0.0);
+            }
+        }
+        const matrix_t product = L * blaze::trans(L);
+        for (size_t row = 0UL; row < 6; ++row)
+        {
+            for (size_t col = 0UL; col < 6; ++col)
+            {
+                REQUIRE(product(row, col) == Approx(S(row, col)).margin(1e-12));
+            }
+        }
+
+        // a semidefinite matrix has a zero column
+        matrix_t semidefinite(S);
+        for (size_t i = 0UL; i < 6; ++i)
+        {
+            semidefinite(2, i) = semidefinite(i, 2) = 0.0;
+        }
+        kafi::util::cholesky_factor(semidefinite, L);
+        REQUIRE(L(2, 2) == 0.0);
+        REQUIRE(L(4, 2) == 0.0);
+
+        semidefinite(2, 2) = -1.0;
+        REQUIRE_THROWS_AS(kafi::util::cholesky_factor(semidefinite, L), std::invalid_argument);
+    }
+
+    SECTION("householder triangularization") {
+        blaze::StaticMatrix<double, 9, 4, blaze::rowMajor> work;
+        std::mt19937 generator(9);
+        std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+        for (size_t row = 0UL; row < 9; ++row)
+        {
+            for (size_t col = 0UL; col < 4; ++col)
+            {
+                work(row, col) = uniform(generator);
+            }
+        }
+        const blaze::StaticMatrix<double, 4, 4, blaze::rowMajor> gram = blaze::trans(work) * work;
+        kafi::util::householder_triangularize(work);
+
+        blaze::StaticMatrix<double, 4, 4, blaze::rowMajor> R;
+        for (size_t row = 0UL; row < 9; ++row)
+        {
+            for (size_t col = 0UL; col < 4; ++col)
+            {
+                if (row >= 4 || col < row) REQUIRE(work(row, col) == 0.0);
+                if (row == col)            REQUIRE(work(row, col) >= 0.0);
+                if (row < 4)               R(row, col) = work(row, col);
+            }
+        }
+        const blaze::StaticMatrix<double, 4, 4, blaze::rowMajor> product = blaze::trans(R) * R;
+        for (size_t row = 0UL; row < 4; ++row)
+        {
+            for (size_t col = 0UL; col < 4; ++col)
+            {
+                REQUIRE(product(row, col) == Approx(gram(row, col)).margin(1e-12));
+            }
+        }
+    }
+
+    SECTION("UD factor") {
+        using matrix_t = blaze::StaticMatrix<double, 6, 6, blaze::rowMajor>;
+        using vector_t = blaze::StaticMatrix<double, 6, 1, blaze::rowMajor>;
+        const matrix_t S = random_covariance<6>(7);
+        matrix_t U;
+        vector_t d;
+        kafi::util::ud_factor(S, U, d);
+
+        matrix_t D(0);
+        for (size_t row = 0UL; row < 6; ++row)
+        {
+            REQUIRE(U(row, row) == 1.0);
+            REQUIRE(d(row, 0) > 0.0);
+            for (size_t col = 0UL; col < row; ++col)
+            {
+                REQUIRE(U(row, col) == 0.0);
+            }
+            D(row, row) = d(row, 0);
+        }
+        const matrix_t product = U * D * blaze::trans(U);
+        for (size_t row = 0UL; row < 6; ++row)
+        {
+            for (size_t col = 0UL; col < 6; ++col)
+            {
+                REQUIRE(product(row, col) == Approx(S(row, col)).margin(1e-12));
+            }
+        }
+
+        matrix_t indefinite(S);
+        indefinite(5, 5) = -1.0;
+        REQUIRE_THROWS_AS(kafi::util::ud_factor(indefinite, U, d), std::invalid_argument);
+    }
+}
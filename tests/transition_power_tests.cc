@@ -0,0 +1,76 @@
+// Copyright 2018 municHMotorsport e.V. <info@munichmotorsport.de>
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <blaze/Math.h>
+#include <random>
+#include <string>
+#include "catch.h"
+
+#include "../library/transition_power.h"
+
+/** \brief util::transition_power over `steps` steps against `steps` times `F * P * trans(F) + Q` of blaze
+ */
+template< size_t N >
+void test_transition_power(const size_t steps)
+{
+    using nxn_matrix = typename kafi::util::transition_power<N>::nxn_matrix;
+
+    std::string description = "N = ";
+    description.append(std::to_string(N));
+    description.append(", steps = ");
+    description.append(std::to_string(steps));
+    SECTION(description){
+        std::mt19937 generator(static_cast<unsigned int>(N * 100UL + steps));
+        std::uniform_real_distribution<double> uniform(-1.0, 1.0);
+
+        // stable, so the powers of 100 steps neither explode nor vanish
+        nxn_matrix F, root, Q(0.0);
+        for (size_t row = 0UL; row < N; ++row)
+        {
+            for (size_t col = 0UL; col < N; ++col)
+            {
+                F(row, col)    = (row == col ? 0.9 : 0.0) + 0.05 * uniform(generator);
+                root(row, col) = uniform(generator);
+            }
+            Q(row, row) = 0.5;
+        }
+        // symmetric like every covariance
+        nxn_matrix P(root * blaze::trans(root));
+        nxn_matrix expected(P);
+        for (size_t step = 0UL; step < steps; ++step)
+        {
+            expected = F * expected * blaze::trans(F) + Q;
+        }
+
+        kafi::util::transition_power<N> power;
+        power(F, Q, steps, P);
+
+        for (size_t row = 0UL; row < N; ++row)
+        {
+            for (size_t col = 0UL; col < N; ++col)
+            {
+                REQUIRE(P(row, col) == Approx(expected(row, col)).epsilon(1e-9).margin(1e-9));
+            }
+        }
+    }
+}
+
+TEST_CASE("transition_power.h", "[transition_power]") {
+
+    // no composition, a single doubling, odd and even counts, powers of two
+    for (const size_t steps : { 0UL, 1UL, 2UL, 3UL, 7UL, 10UL, 16UL, 100UL })
+    {
+        test_transition_power<3>(steps);
+        test_transition_power<12>(steps);
+    }
+}
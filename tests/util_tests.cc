@@ -16,19 +16,21 @@
 #include <vector>
 #include <iostream>
 #include <random>
+#include <type_traits>
 #include "catch.h"
 
 #include "../library/util.h"
 
 #define UNUSED(x) (void)(x)
 
-template<size_t N>
+template<size_t N, typename T = double>
 void test_create_identity()
 {
     std::string description = "N = ";
     description.append(std::to_string(N));
+    description.append(std::is_same<T, float>::value ? ", float" : "");
     SECTION(description){
-        auto matrix(kafi::util::create_identity<N, blaze::rowMajor>());
+        auto matrix(kafi::util::create_identity<N, blaze::rowMajor, T>());
         REQUIRE(blaze::isIdentity(matrix));
         REQUIRE(blaze::isDiagonal(matrix));
     }
@@ -49,13 +51,19 @@ TEST_CASE("util.h", "[util]") {
         test_create_identity<1000>();
     }
 
+    SECTION("testing create_identity with float", "N = 1,7,100") {
+        test_create_identity<1, float>();
+        test_create_identity<7, float>();
+        test_create_identity<100, float>();
+    }
+
     SECTION("testin identity_broadcast_function") {
         const size_t N = 1;
         const size_t M = 4;
 
         using nx1_vector = blaze::StaticMatrix<double, N, 1UL, blaze::rowMajor>;
         using mx1_vector = blaze::StaticMatrix<double, M, 1UL, blaze::rowMajor>;
-        using func       = std::function<void(nx1_vector &, mx1_vector &)>;
+        using func       = std::function<void(const nx1_vector &, mx1_vector &)>;
 
         nx1_vector input( { { 1 } } );
         mx1_vector output(0);
@@ -89,4 +97,16 @@ TEST_CASE("util.h", "[util]") {
 
         REQUIRE(result_zero == 0.0);
     }
+
+    SECTION("testing identity_derivative with float"){
+        const size_t N = 2;
+
+        using nx1_vector = blaze::StaticMatrix<float, N, 1UL, blaze::rowMajor>;
+        using par_jacobi_func = std::function<float(const nx1_vector &)>;
+
+        const nx1_vector input({ { 0.f }, { 1.f } });
+
+        const par_jacobi_func f_half = kafi::util::identity_derivative<N, float>(0.5);
+        REQUIRE(f_half(input) == 0.5f);
+    }
 }